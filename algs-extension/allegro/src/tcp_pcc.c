@@ -9,6 +9,7 @@
 #include <linux/module.h>
 #include <net/tcp.h>
 #include <linux/random.h>
+#include "pcc_math.h"
 
 /* Ignore the first and last packets of every interval because they might
  * contain data of the previous / next interval. */
@@ -208,24 +209,6 @@ static void pcc_start_interval(struct sock *sk, struct pcc_data *pcc)
 /************************
  * Utility and decisions *
  * **********************/
-/* get x = number * pcc_rounding_factor, return 
- * (e ^ number) * pcc_rounding_factor
- */
-static u32 pcc_exp(s32 x)
-{
-	s64 temp = pcc_rounding_factor;
-	s64 exp = pcc_rounding_factor;
-	int i;
-
-	for (i = 1; temp != 0; i++) {
-		temp *= x;
-		temp /= i;
-		temp /= pcc_rounding_factor;
-		exp += temp;
-	}
-	return exp;
-}
-
 static void pcc_calc_utility(struct pcc_interval *interval)
 {
 	s64 loss_ratio, delivered, lost, rate, util;
@@ -246,8 +229,7 @@ static void pcc_calc_utility(struct pcc_interval *interval)
 	 */
 	util = loss_ratio- (pcc_loss_margin * pcc_rounding_factor);
 	if (util < pcc_max_loss*pcc_rounding_factor)
-		util = (rate * pcc_rounding_factor) /
-		       (pcc_exp(util) + pcc_rounding_factor);
+		util = pcc_sigmoid(rate, util);
 	else
 		util = 0;
 
@@ -257,7 +239,7 @@ static void pcc_calc_utility(struct pcc_interval *interval)
 	/* util -= "wasted rate" */
 	util -= (rate * loss_ratio) / (pcc_alpha * pcc_rounding_factor);
 
-	printk(KERN_INFO
+	pcc_dbg(
 		"rate %lld sent %u delv %lld lost %lld util %lld \n",
 		 rate, interval->segs_sent_end - interval->segs_sent_start,
 		 delivered, lost, util);
@@ -324,11 +306,11 @@ static void pcc_decide(struct pcc_data *pcc, struct tcp_sock *tsk)
 	pcc_change_epsilon_after_dicision(pcc, new_rate);
 
 	if (new_rate != pcc->rate)
-		printk(KERN_INFO "%d decide: on new rate %d %lld (%d) %d\n",
+		pcc_dbg("%d decide: on new rate %d %lld (%d) %d\n",
 		       pcc->id, pcc->rate < new_rate, new_rate,
 		       pcc->intervals_count, pcc_get_rtt(tsk));
 	else
-		printk(KERN_INFO "%d decide: stay %lld (%d) %d\n", pcc->id,
+		pcc_dbg("%d decide: stay %lld (%d) %d\n", pcc->id,
 			pcc->rate, pcc->intervals_count, pcc_get_rtt(tsk));
 
 	if (pcc->mode == PCC_RATE_ADJUSMENT) {
@@ -353,7 +335,7 @@ static void pcc_decide_rate_adjusment(struct pcc_data *pcc)
 	prev = interval->utility;
 	pcc_calc_utility(interval);
 
-	printk(KERN_INFO "%d: adj mode: rate %lld utility %lld (%d)\n",
+	pcc_dbg("%d: adj mode: rate %lld utility %lld (%d)\n",
 		pcc->id, interval->rate, interval->utility, pcc->intervals_count);
 	if (prev < interval->utility) {
 		pcc_increase_epsilon(pcc);
@@ -367,7 +349,7 @@ static void pcc_decide_rate_adjusment(struct pcc_data *pcc)
 		pcc->rate = pcc->last_rate;
 		pcc->epsilon = pcc_epsilon_min;
 		pcc->mode = PCC_DECISION_MAKING;
-		printk(KERN_INFO "%d: adj mode ended\n", pcc->id);
+		pcc_dbg("%d: adj mode ended\n", pcc->id);
 	}
 	pcc->intervals_count++;
 }
@@ -393,7 +375,7 @@ static void pcc_decide_slow_start(struct pcc_data *pcc, struct tcp_sock *tsk)
 	adjust_utility = pcc_adjust_utility(interval->utility, pcc->rate,
 					interval->utility < 0);
 
-	printk(KERN_INFO "%d: start mode: rate %lld utility %lld (%lld, %lld)\n",
+	pcc_dbg("%d: start mode: rate %lld utility %lld (%lld, %lld)\n",
 		pcc->id, pcc->rate, interval->utility,
 		prev_adjust_utility, adjust_utility);
 	if (adjust_utility > prev_adjust_utility) {
@@ -404,7 +386,7 @@ static void pcc_decide_slow_start(struct pcc_data *pcc, struct tcp_sock *tsk)
 	} else {
 		pcc->rate = pcc->last_rate;
 		pcc->mode = PCC_DECISION_MAKING;
-		printk(KERN_INFO "%d: start mode ended\n", pcc->id);
+		pcc_dbg("%d: start mode ended\n", pcc->id);
 	}
 }
 
@@ -583,14 +565,14 @@ static void pcc_set_state(struct sock *sk, u8 new_state)
 		double_counted -= tsk->data_segs_out;
 		double_counted -= pcc->double_counted;
 		pcc->double_counted+= double_counted;
-		printk(KERN_INFO "%d loss ended: double_counted %d\n",
+		pcc_dbg("%d loss ended: double_counted %d\n",
 		       pcc->id, double_counted);
 
 		pcc->mode = PCC_DECISION_MAKING;
 		pcc_setup_intervals(pcc);
 		pcc_start_interval(sk, pcc);
 	} else if (pcc->mode != PCC_LOSS && new_state  == TCP_CA_Loss) {
-		printk(KERN_INFO "%d loss: started\n", pcc->id);
+		pcc_dbg("%d loss: started\n", pcc->id);
 		pcc->mode = PCC_LOSS;
 		pcc->wait_mode = true;
 		pcc_start_interval(sk, pcc);
@@ -639,7 +621,7 @@ static struct tcp_congestion_ops tcp_pcc_cong_ops __read_mostly = {
 static int __init pcc_register(void)
 {
         BUILD_BUG_ON(sizeof(struct pcc_data) > ICSK_CA_PRIV_SIZE);
-	printk(KERN_INFO "pcc init reg\n");
+	pcc_dbg("pcc init reg\n");
         return tcp_register_congestion_control(&tcp_pcc_cong_ops);
 }
 
@@ -0,0 +1,699 @@
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <iostream>
+#include <deque>
+#include <queue>
+#include <string>
+#include <vector>
+#include "../core/udt.h"
+#include "../core/core.h"
+
+using namespace std;
+
+// Times the calls the data path makes on the core data structures, one
+// structure at a time, with as many packets in flight as a fast or a long path
+// keeps:
+//
+//    microbench [-n INFLIGHT[,INFLIGHT...]] [-f FLOWS[,FLOWS...]] [-k CALLS]
+//               [-l LOSS_PERCENT] [-p PAYLOAD] [STRUCTURE...]
+//
+// STRUCTURE is any of tracker, sndloss, rcvloss, unitqueue, miqueue and
+// sndulist; all of them by default. Each is filled to INFLIGHT packets
+// (default 1000, 100000 and 1000000), then driven for CALLS steady state steps
+// (default 1000000) in which one packet is sent and one is acknowledged or,
+// with probability LOSS_PERCENT (default 1), lost. sndulist holds sockets, not
+// packets, so it runs with FLOWS sockets instead (default 16, 256 and 4096).
+//
+// Every call is timed on the TSC, less the cost of reading it, and each line
+// reports one kind of call:
+//    STRUCTURE CALL INFLIGHT CALLS NS/CALL CYCLES/CALL
+
+struct COptions
+{
+   vector<int> m_viInflight;
+   vector<int> m_viFlows;
+   int m_iCalls;
+   double m_dLoss;
+   int m_iPayload;
+};
+
+// cycles spent in one kind of call
+struct CCallStat
+{
+   CCallStat(): m_ullCycles(0), m_llCalls(0) {}
+
+   void add(const uint64_t& start)
+   {
+      uint64_t end;
+      CTimer::rdtsc(end);
+      m_ullCycles += end - start;
+      ++ m_llCalls;
+   }
+
+   uint64_t m_ullCycles;
+   int64_t m_llCalls;
+};
+
+static uint64_t s_ullRandom = 1;
+static double s_dTimerCycles = 0;
+
+// splitmix64
+static uint64_t nextRandom()
+{
+   uint64_t z = (s_ullRandom += 0x9E3779B97F4A7C15ULL);
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+}
+
+static bool chance(const double& percent)
+{
+   return (nextRandom() % 1000000) < percent * 10000;
+}
+
+// average cycles of an empty timed region
+static void calibrate()
+{
+   CCallStat stat;
+   for (int i = 0; i < 1000000; ++ i)
+   {
+      uint64_t t;
+      CTimer::rdtsc(t);
+      stat.add(t);
+   }
+   s_dTimerCycles = double(stat.m_ullCycles) / stat.m_llCalls;
+}
+
+static void report(const char* structure, const char* call, const int& inflight, const CCallStat& stat)
+{
+   if (0 == stat.m_llCalls)
+      return;
+
+   double cycles = double(stat.m_ullCycles) / stat.m_llCalls - s_dTimerCycles;
+   if (cycles < 0)
+      cycles = 0;
+   printf("%s %s %d %lld %.1f %.1f\n", structure, call, inflight, (long long)stat.m_llCalls,
+          cycles * 1000 / CTimer::getCPUFrequency(), cycles);
+   fflush(stdout);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The tracker calls of CUDT::sendmsg(), packData(), ProcessAck(),
+// add_to_loss_record() and checkTimers(). New data is queued only when there
+// is no loss to retransmit, so the tracker keeps its INFLIGHT sent packets.
+class CTrackerBench
+{
+public:
+   CTrackerBench(const int& payload):
+      m_Tracker(&m_SendCond),
+      m_iNextSeqNo(0)
+   {
+      pthread_cond_init(&m_SendCond, NULL);
+      m_pcData = new char[payload];
+      memset(m_pcData, 0, payload);
+      m_Packet.m_pcData = m_pcData;
+      m_Packet.setLength(payload);
+   }
+
+   ~CTrackerBench()
+   {
+      pthread_cond_destroy(&m_SendCond);
+      delete [] m_pcData;
+   }
+
+   void enqueue()
+   {
+      m_Packet.m_iSeqNo = m_iNextSeqNo ++;
+      m_Packet.m_iMsgNo = 0;
+      m_Packet.m_pcData = m_pcData;
+      m_Tracker.EnqueuePacket(m_Packet);
+   }
+
+   // returns true for a retransmission
+   bool send()
+   {
+      bool retransmit = m_Tracker.HasRetransmittablePackets();
+      int32_t seq_no;
+      if (retransmit)
+         seq_no = m_Tracker.GetLowestRetransmittableSeqNo();
+      else if (m_Tracker.HasSendablePackets())
+         seq_no = m_Tracker.GetLowestSendableSeqNo();
+      else
+      {
+         cerr << "tracker: no transmittable packets" << endl;
+         exit(1);
+      }
+
+      m_SendPacket.m_pcData = m_Tracker.GetPacketPayloadPointer(seq_no);
+      m_SendPacket.setLength(m_Tracker.GetPacketSize(seq_no));
+      m_SendPacket.m_iSeqNo = seq_no;
+      m_SendPacket.m_iMsgNo = m_Tracker.GetPacketLastMsgNo(seq_no) + 1;
+      m_Tracker.OnPacketSent(m_SendPacket);
+      m_Tracker.GetPacketId(seq_no, m_SendPacket.m_iMsgNo);
+
+      m_Flight.push_back(make_pair(seq_no, (int32_t)m_SendPacket.m_iMsgNo));
+      return retransmit;
+   }
+
+   void ack(const int32_t& seq_no, const int32_t& msg_no)
+   {
+      int32_t latest_msg_no = m_Tracker.GetPacketLastMsgNo(seq_no);
+      m_Tracker.GetPacketId(seq_no, msg_no);
+      m_Tracker.GetPacketState(seq_no);
+      m_Tracker.OnPacketAck(seq_no, msg_no);
+      m_Tracker.GetPacketRtt(seq_no, msg_no);
+      m_Tracker.GetPacketSize(seq_no);
+      if (msg_no == latest_msg_no)
+         m_Tracker.DeletePacketRecord(seq_no);
+   }
+
+   void loss(const int32_t& seq_no)
+   {
+      int32_t msg_no = m_Tracker.GetPacketLastMsgNo(seq_no);
+      m_Tracker.GetPacketId(seq_no, msg_no);
+      m_Tracker.GetPacketSize(seq_no);
+      m_Tracker.OnPacketLoss(seq_no, msg_no);
+   }
+
+   void timer()
+   {
+      if (m_Tracker.HasSentPackets())
+      {
+         int32_t seq_no = m_Tracker.GetOldestSentSeqNo();
+         m_Tracker.GetPacketSentTime(seq_no, m_Tracker.GetPacketLastMsgNo(seq_no));
+      }
+   }
+
+   void run(const COptions& opt, const int& inflight)
+   {
+      for (int i = 0; i < inflight; ++ i)
+      {
+         enqueue();
+         send();
+      }
+
+      CCallStat enqueues, sends, acks, losses, timers;
+      int pending = 0;
+      for (int i = 0; i < opt.m_iCalls; ++ i)
+      {
+         uint64_t t;
+         if (0 == pending)
+         {
+            CTimer::rdtsc(t);
+            enqueue();
+            enqueues.add(t);
+         }
+
+         CTimer::rdtsc(t);
+         if (send())
+            -- pending;
+         sends.add(t);
+
+         pair<int32_t, int32_t> oldest = m_Flight.front();
+         m_Flight.pop_front();
+         if (chance(opt.m_dLoss))
+         {
+            CTimer::rdtsc(t);
+            loss(oldest.first);
+            losses.add(t);
+            ++ pending;
+         }
+         else
+         {
+            CTimer::rdtsc(t);
+            ack(oldest.first, oldest.second);
+            acks.add(t);
+         }
+
+         CTimer::rdtsc(t);
+         timer();
+         timers.add(t);
+      }
+
+      report("tracker", "enqueue", inflight, enqueues);
+      report("tracker", "send", inflight, sends);
+      report("tracker", "ack", inflight, acks);
+      report("tracker", "loss", inflight, losses);
+      report("tracker", "timer", inflight, timers);
+   }
+
+private:
+   pthread_cond_t m_SendCond;
+   PacketTracker<int32_t, PacketId> m_Tracker;
+   CPacket m_Packet;                          // new data, copied in by EnqueuePacket()
+   CPacket m_SendPacket;
+   char* m_pcData;
+   int32_t m_iNextSeqNo;
+   deque<pair<int32_t, int32_t> > m_Flight;   // (seq. no., msg. no.) in sending order
+};
+
+// NAKs report losses in the newer half of the window, the sender retransmits
+// the oldest, and each ACK moves the window by a packet. The first INFLIGHT
+// steps, which fill the list, are not timed.
+static void benchSndLossList(const COptions& opt, const int& inflight)
+{
+   CSndLossList list(inflight * 2);
+   CCallStat inserts, removes, pops;
+   int32_t ack = 0;
+
+   for (int i = -inflight; i < opt.m_iCalls; ++ i)
+   {
+      uint64_t t;
+      if (chance(opt.m_dLoss))
+      {
+         int32_t first = ack + inflight / 2 + nextRandom() % (inflight / 2 + 1);
+         int32_t last = first + nextRandom() % 4;
+         if (last >= ack + inflight)
+            last = ack + inflight - 1;
+         if (first > last)
+            first = last;
+
+         CTimer::rdtsc(t);
+         list.insert(first, last);
+         if (i >= 0)
+            inserts.add(t);
+      }
+
+      if (chance(opt.m_dLoss))
+      {
+         CTimer::rdtsc(t);
+         list.getLostSeq();
+         if (i >= 0)
+            pops.add(t);
+      }
+
+      CTimer::rdtsc(t);
+      list.remove(ack);
+      if (i >= 0)
+         removes.add(t);
+      ++ ack;
+   }
+
+   report("sndloss", "insert", inflight, inserts);
+   report("sndloss", "remove", inflight, removes);
+   report("sndloss", "getLostSeq", inflight, pops);
+}
+
+// The receiver records gaps of 1 to 4 packets as they open, their
+// retransmissions arrive one at a time an RTT (INFLIGHT packets) later, and a
+// NAK is built every 64 packets. The first INFLIGHT steps are not timed.
+static void benchRcvLossList(const COptions& opt, const int& inflight)
+{
+   struct CGap
+   {
+      int32_t m_iFirst;
+      int32_t m_iLast;
+      int m_iDue;
+   };
+
+   CRcvLossList list(inflight * 2);
+   deque<CGap> gaps;
+   const int limit = opt.m_iPayload / 4;
+   vector<int32_t> array(limit);
+   CCallStat inserts, removes, naks;
+   int32_t next = 0;
+
+   for (int i = -inflight; i < opt.m_iCalls; ++ i)
+   {
+      uint64_t t;
+      if (chance(opt.m_dLoss))
+      {
+         CGap gap;
+         gap.m_iFirst = next;
+         gap.m_iLast = next + nextRandom() % 4;
+         gap.m_iDue = i + inflight;
+
+         CTimer::rdtsc(t);
+         list.insert(gap.m_iFirst, gap.m_iLast);
+         if (i >= 0)
+            inserts.add(t);
+
+         gaps.push_back(gap);
+         next = gap.m_iLast + 1;
+      }
+      ++ next;
+
+      while (!gaps.empty() && (gaps.front().m_iDue <= i))
+      {
+         for (int32_t s = gaps.front().m_iFirst; s <= gaps.front().m_iLast; ++ s)
+         {
+            CTimer::rdtsc(t);
+            list.remove(s);
+            if (i >= 0)
+               removes.add(t);
+         }
+         gaps.pop_front();
+      }
+
+      if (0 == (i & 63))
+      {
+         int len;
+         int offset = 0;
+         CTimer::rdtsc(t);
+         list.getLossArray(&array[0], len, limit, offset);
+         if (i >= 0)
+            naks.add(t);
+      }
+   }
+
+   report("rcvloss", "insert", inflight, inserts);
+   report("rcvloss", "remove", inflight, removes);
+   report("rcvloss", "getLossArray", inflight, naks);
+}
+
+// The receive worker takes a unit per packet and the application frees them
+// in order, except that a lost packet holds the units after it for another
+// half RTT. The queue is sized for INFLIGHT units up front: it grows only by
+// recounting all its units, which is warm-up, not steady state. A call that
+// finds no unit is reported apart; the scan gives up when it wraps onto a
+// unit still in use.
+static void benchUnitQueue(const COptions& opt, const int& inflight)
+{
+   CUnitQueue queue;
+   queue.init(inflight + inflight / 8 + 32, opt.m_iPayload, AF_INET);
+
+   deque<CUnit*> held;
+   deque<pair<CUnit*, int> > late;
+   CCallStat gets, misses;
+
+   for (int i = -inflight; i < opt.m_iCalls; ++ i)
+   {
+      if ((int)held.size() >= inflight)
+      {
+         if (chance(opt.m_dLoss))
+            late.push_back(make_pair(held.front(), i + inflight / 2));
+         else
+            held.front()->m_iFlag = 0;
+         held.pop_front();
+      }
+      while (!late.empty() && (late.front().second <= i))
+      {
+         late.front().first->m_iFlag = 0;
+         late.pop_front();
+      }
+
+      uint64_t t;
+      CTimer::rdtsc(t);
+      CUnit* unit = queue.getNextAvailUnit();
+      if (i >= 0)
+         (NULL != unit ? gets : misses).add(t);
+
+      // the receive worker drops the packet and tries again with the next one
+      if (NULL == unit)
+         continue;
+      unit->m_iFlag = 1;
+      held.push_back(unit);
+   }
+
+   report("unitqueue", "getNextAvailUnit", inflight, gets);
+   report("unitqueue", "getNextAvailUnit-null", inflight, misses);
+}
+
+// Monitor intervals of an RTT (INFLIGHT packets) each, in groups of four
+// useful ones as in PROBING, followed by intervals that are not useful until
+// the group's utilities are handed to the sender. Each ACK or loss is one
+// event, as in ProcessAck() and add_to_loss_record().
+static void benchMonitorIntervalQueue(const COptions& opt, const int& inflight)
+{
+   PccSender sender(10000, 10, 10);
+   PccMonitorIntervalQueue queue(&sender);
+   deque<int32_t> flight;
+   AckedPacketVector acked;
+   LostPacketVector lost;
+   CCallStat events;
+   const int64_t rtt_us = inflight;
+   int useful = 0;
+   int32_t packet_number = 0;
+   QuicTime now = 0;
+
+   for (int i = -inflight; i < opt.m_iCalls; ++ i)
+   {
+      // one packet a microsecond
+      ++ now;
+      if (queue.empty() || (queue.current().n_packets >= inflight))
+      {
+         if (0 == queue.num_useful_intervals())
+            useful = 4;
+         queue.EnqueueNewMonitorInterval(100000000.0, useful > 0, 0.05, rtt_us, now + inflight);
+         if (useful > 0)
+            -- useful;
+      }
+      queue.OnPacketSent(now, ++ packet_number, opt.m_iPayload);
+      flight.push_back(packet_number);
+
+      if (i < 0)
+         continue;
+
+      CongestionEvent event;
+      event.packet_number = flight.front();
+      event.time = now;
+      flight.pop_front();
+      acked.clear();
+      lost.clear();
+      if (chance(opt.m_dLoss))
+      {
+         event.bytes_acked = 0;
+         event.bytes_lost = opt.m_iPayload;
+         lost.push_back(event);
+      }
+      else
+      {
+         event.bytes_acked = opt.m_iPayload;
+         event.bytes_lost = 0;
+         acked.push_back(event);
+      }
+
+      uint64_t t;
+      CTimer::rdtsc(t);
+      queue.OnCongestionEvent(acked, lost, rtt_us, now);
+      events.add(t);
+   }
+
+   report("miqueue", "OnCongestionEvent", inflight, events);
+}
+
+// The sending worker pops the socket due first and reschedules it after its
+// own pacing interval; one pop in four leaves the socket waiting for data or
+// window, and a waiting socket is brought back by the update() of a send or
+// an ACK. The sockets are bound, never connected, so pop() only takes them
+// off the list and the bench puts them back. Time stamps are virtual and
+// below the TSC, so every socket is due, and the bench checks that the list
+// pops the socket it expects.
+static void benchSndUList(const COptions& opt, const int& flows)
+{
+   vector<UDTSOCKET> sockets(flows);
+   vector<CUDT*> udts(flows);
+   vector<uint64_t> intervals(flows);
+   sockaddr_in addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   for (int i = 0; i < flows; ++ i)
+   {
+      sockets[i] = UDT::socket(AF_INET, SOCK_STREAM, 0);
+      if (UDT::ERROR == UDT::bind(sockets[i], (sockaddr*)&addr, sizeof(addr)))
+      {
+         cerr << "sndulist: bind: " << UDT::getlasterror().getErrorMessage() << endl;
+         exit(1);
+      }
+      // the first socket picks the port, the others share its multiplexer
+      int len = sizeof(addr);
+      UDT::getsockname(sockets[i], (sockaddr*)&addr, &len);
+
+      udts[i] = CUDT::getUDTHandle(sockets[i]);
+      intervals[i] = 1 + nextRandom() % flows;
+   }
+
+   CTimer timer;
+   pthread_mutex_t windowlock;
+   pthread_cond_t windowcond;
+   pthread_mutex_init(&windowlock, NULL);
+   pthread_cond_init(&windowcond, NULL);
+   CSndUList list;
+   list.init(&timer, &windowlock, &windowcond);
+
+   // the list as the bench expects it, by unique time stamp: clock * flows + socket
+   priority_queue<uint64_t, vector<uint64_t>, greater<uint64_t> > due;
+   deque<int> waiting;
+   CCallStat inserts, updates, pops;
+   uint64_t clock = 1;
+
+   for (int i = 0; i < flows; ++ i)
+   {
+      uint64_t ts = (clock + intervals[i]) * flows + i;
+      list.insert(ts, udts[i]);
+      due.push(ts);
+   }
+
+   CPacket packet;
+   uint64_t now;
+   CTimer::rdtsc(now);
+   for (int i = 0; i < opt.m_iCalls; ++ i)
+   {
+      uint64_t t;
+      uint64_t expected = 1;
+      int head;
+      if (!waiting.empty() && (due.empty() || (0 == nextRandom() % 4)))
+      {
+         // update() puts the socket first, at time stamp 1
+         head = waiting.front();
+         waiting.pop_front();
+         CTimer::rdtsc(t);
+         list.update(udts[head], false);
+         updates.add(t);
+      }
+      else
+      {
+         expected = due.top();
+         head = expected % flows;
+         clock = expected / flows;
+         due.pop();
+      }
+
+      if (list.getNextProcTime() != expected)
+      {
+         cerr << "sndulist: the list is not in time stamp order" << endl;
+         exit(1);
+      }
+
+      sockaddr* peer;
+      CTimer::rdtsc(t);
+      list.pop(peer, packet);
+      pops.add(t);
+
+      if (0 == nextRandom() % 4)
+         waiting.push_back(head);
+      else
+      {
+         uint64_t ts = (clock + intervals[head]) * flows + head;
+         if (ts >= now)
+         {
+            cerr << "sndulist: the virtual time stamps have reached the TSC" << endl;
+            exit(1);
+         }
+         CTimer::rdtsc(t);
+         list.insert(ts, udts[head]);
+         inserts.add(t);
+         due.push(ts);
+      }
+   }
+
+   report("sndulist", "insert", flows, inserts);
+   report("sndulist", "update", flows, updates);
+   report("sndulist", "pop", flows, pops);
+
+   for (int i = 0; i < flows; ++ i)
+      list.remove(udts[i]);
+   for (int i = 0; i < flows; ++ i)
+      UDT::close(sockets[i]);
+   pthread_mutex_destroy(&windowlock);
+   pthread_cond_destroy(&windowcond);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool parseList(const char* arg, vector<int>& values)
+{
+   values.clear();
+   while (*arg)
+   {
+      char* end;
+      long v = strtol(arg, &end, 10);
+      if ((end == arg) || (v <= 0))
+         return false;
+      values.push_back((int)v);
+      arg = end;
+      if (',' == *arg)
+         ++ arg;
+      else if (*arg)
+         return false;
+   }
+   return !values.empty();
+}
+
+static int usage(const char* name)
+{
+   cerr << "usage: " << name << " [-n INFLIGHT[,INFLIGHT...]] [-f FLOWS[,FLOWS...]] [-k CALLS]" << endl;
+   cerr << "          [-l LOSS_PERCENT] [-p PAYLOAD] [tracker|sndloss|rcvloss|unitqueue|miqueue|sndulist...]" << endl;
+   return 1;
+}
+
+int main(int argc, char* argv[])
+{
+   static const char* structures[] = {"tracker", "sndloss", "rcvloss", "unitqueue", "miqueue", "sndulist"};
+   const int count = sizeof(structures) / sizeof(structures[0]);
+
+   COptions opt;
+   opt.m_viInflight.push_back(1000);
+   opt.m_viInflight.push_back(100000);
+   opt.m_viInflight.push_back(1000000);
+   opt.m_viFlows.push_back(16);
+   opt.m_viFlows.push_back(256);
+   opt.m_viFlows.push_back(4096);
+   opt.m_iCalls = 1000000;
+   opt.m_dLoss = 1;
+   opt.m_iPayload = 1500 - 28 - CPacket::m_iPktHdrSize;
+
+   int c;
+   while ((c = getopt(argc, argv, "n:f:k:l:p:")) != -1)
+   {
+      switch (c)
+      {
+      case 'n': if (!parseList(optarg, opt.m_viInflight)) return usage(argv[0]); break;
+      case 'f': if (!parseList(optarg, opt.m_viFlows)) return usage(argv[0]); break;
+      case 'k': opt.m_iCalls = atoi(optarg); break;
+      case 'l': opt.m_dLoss = atof(optarg); break;
+      case 'p': opt.m_iPayload = atoi(optarg); break;
+      default: return usage(argv[0]);
+      }
+   }
+   if ((opt.m_iCalls <= 0) || (opt.m_dLoss < 0) || (opt.m_dLoss > 100) || (opt.m_iPayload < 16))
+      return usage(argv[0]);
+
+   vector<bool> selected(count, optind == argc);
+   for (int i = optind; i < argc; ++ i)
+   {
+      int j = 0;
+      while ((j < count) && (0 != strcmp(argv[i], structures[j])))
+         ++ j;
+      if (j == count)
+         return usage(argv[0]);
+      selected[j] = true;
+   }
+
+   calibrate();
+   printf("# structure call inflight calls ns_per_call cycles_per_call\n");
+   fflush(stdout);
+
+   for (size_t i = 0; i < opt.m_viInflight.size(); ++ i)
+   {
+      int inflight = opt.m_viInflight[i];
+      if (selected[0])
+      {
+         CTrackerBench bench(opt.m_iPayload);
+         bench.run(opt, inflight);
+      }
+      if (selected[1])
+         benchSndLossList(opt, inflight);
+      if (selected[2])
+         benchRcvLossList(opt, inflight);
+      if (selected[3])
+         benchUnitQueue(opt, inflight);
+      if (selected[4])
+         benchMonitorIntervalQueue(opt, inflight);
+   }
+
+   if (selected[5])
+   {
+      UDT::startup();
+      for (size_t i = 0; i < opt.m_viFlows.size(); ++ i)
+         benchSndUList(opt, opt.m_viFlows[i]);
+      UDT::cleanup();
+   }
+
+   return 0;
+}
@@ -0,0 +1,181 @@
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <iostream>
+#include "../core/udt.h"
+#include "../core/common.h"
+#include "emulator.h"
+
+using namespace std;
+
+// Runs one PCC flow between two UDT sockets of this process over emulated
+// links, without mahimahi shells or root: the data direction follows the
+// downlink description and the ACKs the uplink description. The flow runs on
+// the emulator's virtual clock, so a run takes as long as its packets take to
+// process rather than its duration. Link descriptions are those of
+// CEmuConfig::parse(), e.g. for 60 seconds:
+//    pccemu trace=../../../../traces/mit/ATT-LTE-driving.down,delay=20,bytes=150000
+//           trace=../../../../traces/mit/ATT-LTE-driving.up,delay=20 60
+
+void* senddata(void*);
+void* recvdata(void*);
+
+static int localport(UDTSOCKET u)
+{
+   sockaddr_in addr;
+   int len = sizeof(addr);
+   UDT::getsockname(u, (sockaddr*)&addr, &len);
+   return ntohs(addr.sin_port);
+}
+
+static UDTSOCKET bindsocket()
+{
+   sockaddr_in addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   addr.sin_port = 0;
+
+   UDTSOCKET u = UDT::socket(AF_INET, SOCK_STREAM, 0);
+   if (UDT::ERROR == UDT::bind(u, (sockaddr*)&addr, sizeof(addr)))
+   {
+      cout << "bind: " << UDT::getlasterror().getErrorMessage() << endl;
+      exit(1);
+   }
+
+   return u;
+}
+
+int main(int argc, char* argv[])
+{
+   if ((argc < 3) || (argc > 4))
+   {
+      cout << "usage: " << argv[0] << " downlink_link uplink_link [seconds]" << endl;
+      return 0;
+   }
+
+   int duration = (argc == 4) ? atoi(argv[3]) : 30;
+
+   CEmuConfig down, up;
+   try
+   {
+      down = CEmuConfig::parse(argv[1]);
+      up = CEmuConfig::parse(argv[2]);
+   }
+   catch (CUDTException& e)
+   {
+      cout << "link description: " << e.getErrorMessage() << endl;
+      return 0;
+   }
+
+   // before any socket is opened, so that every UDT thread takes part in the clock
+   CEmuClock::enable();
+
+   UDT::startup();
+
+   // every channel opened from here on is attached to the emulator
+   CEmuNetwork* net = CEmuNetwork::enable(up);
+
+   UDTSOCKET serv = bindsocket();
+   UDTSOCKET client = bindsocket();
+   int servport = localport(serv);
+   int clientport = localport(client);
+
+   net->setLink(servport, clientport, down);
+   net->setLink(clientport, servport, up);
+
+   UDT::listen(serv, 1);
+
+   sockaddr_in peer;
+   memset(&peer, 0, sizeof(peer));
+   peer.sin_family = AF_INET;
+   peer.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   peer.sin_port = htons(servport);
+
+   if (UDT::ERROR == UDT::connect(client, (sockaddr*)&peer, sizeof(peer)))
+   {
+      cout << "connect: " << UDT::getlasterror().getErrorMessage() << endl;
+      return 0;
+   }
+
+   sockaddr_storage clientaddr;
+   int addrlen = sizeof(clientaddr);
+   UDTSOCKET sender = UDT::accept(serv, (sockaddr*)&clientaddr, &addrlen);
+   if (UDT::INVALID_SOCK == sender)
+   {
+      cout << "accept: " << UDT::getlasterror().getErrorMessage() << endl;
+      return 0;
+   }
+
+   pthread_t t;
+   CEmuClock::spawn(&t, senddata, new UDTSOCKET(sender));
+   pthread_detach(t);
+   CEmuClock::spawn(&t, recvdata, new UDTSOCKET(client));
+   pthread_detach(t);
+
+   // the PCC receiver acknowledges every packet but does not deliver data to the
+   // application, so goodput is taken from the far end of the data link
+   cout << "Time(s)\tGoodput(Mb/s)\tSendRate(Mb/s)\tRTT(ms)\tLost\tDropped" << endl;
+
+   int64_t delivered = 0;
+   uint64_t start = CEmuClock::time();
+   for (int i = 1; i <= duration; ++ i)
+   {
+      CEmuClock::sleepto(start + i * 1000000ULL);
+
+      UDT::TRACEINFO perf;
+      if (UDT::ERROR == UDT::perfmon(sender, &perf))
+      {
+         cout << "perfmon: " << UDT::getlasterror().getErrorMessage() << endl;
+         break;
+      }
+
+      CEmuStats stats;
+      if (!net->stats(servport, clientport, stats))
+         continue;
+
+      cout << i << "\t" << (stats.m_llDeliveredBytes - delivered) * 8.0 / 1000000 << "\t" << perf.mbpsSendRate << "\t"
+           << perf.msRTT << "\t" << stats.m_llLost << "\t" << stats.m_llDropped << endl;
+      delivered = stats.m_llDeliveredBytes;
+   }
+
+   UDT::close(client);
+   UDT::close(sender);
+   UDT::close(serv);
+   UDT::cleanup();
+
+   return 0;
+}
+
+void* senddata(void* usocket)
+{
+   UDTSOCKET sender = *(UDTSOCKET*)usocket;
+   delete (UDTSOCKET*)usocket;
+
+   int size = 1000000;
+   char* data = new char[size];
+   memset(data, 0, size);
+
+   while (UDT::ERROR != UDT::send(sender, data, size, 0))
+   {
+   }
+
+   delete [] data;
+
+   return NULL;
+}
+
+void* recvdata(void* usocket)
+{
+   UDTSOCKET recver = *(UDTSOCKET*)usocket;
+   delete (UDTSOCKET*)usocket;
+
+   char data[65536];
+   while (UDT::ERROR != UDT::recv(recver, data, sizeof(data), 0))
+   {
+   }
+
+   return NULL;
+}
@@ -0,0 +1,200 @@
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "../core/common.h"
+#include "../core/pccrecord.h"
+#include "../pcc/pcc_sender.h"
+
+using namespace std;
+
+// Replays recordings made with UDT_PCC_RECORD=PREFIX into a new PccSender, and
+// compares the pacing rate it chooses after every call with the rate of the
+// recorded connection:
+//
+//    pccreplay [-t] [-n RUNS] FILE...
+//
+// The calls are fed as fast as the sender takes them, open loop: the packets
+// sent and acked are those of the recording whatever the replayed sender
+// decides. With the pcc/ code the recording was made with, the two rates are
+// the same after every call; after a change to it, the summary tells how far
+// the decisions moved:
+//    calls       calls replayed, and how many per second
+//    diverged    calls after which the two rates differ, and the first of them
+//    mean rate   time-weighted mean of the recorded and the replayed rate
+//    mean error  time-weighted mean of |replayed - recorded| / recorded
+// -t prints the two trajectories instead, one line per change of either:
+//    TIME(us) RECORDED(Mb/s) REPLAYED(Mb/s)
+// -n replays each file RUNS times, for a steadier calls per second.
+
+struct CTrajectory
+{
+   int64_t m_llCalls;
+   int64_t m_llDiverged;
+   int64_t m_llFirstDiverged;          // call index, -1 if none
+   QuicTime m_llFirstDivergedTime;
+   double m_dFirstRecorded;
+   double m_dFirstReplayed;
+   double m_dDuration;                 // microseconds covered by the calls
+   double m_dRecordedSum;              // rates integrated over time
+   double m_dReplayedSum;
+   double m_dErrorSum;
+};
+
+// Compares the rates after call number "call", which is in force until "next".
+static void settle(CTrajectory& t, int64_t call, QuicTime time, QuicTime next, double recorded, double replayed, bool print)
+{
+   if (recorded != replayed)
+   {
+      if (0 == t.m_llDiverged ++)
+      {
+         t.m_llFirstDiverged = call;
+         t.m_llFirstDivergedTime = time;
+         t.m_dFirstRecorded = recorded;
+         t.m_dFirstReplayed = replayed;
+      }
+   }
+
+   double dt = (next > time) ? double(next - time) : 0;
+   t.m_dDuration += dt;
+   t.m_dRecordedSum += recorded * dt;
+   t.m_dReplayedSum += replayed * dt;
+   if (recorded > 0)
+      t.m_dErrorSum += fabs(replayed - recorded) / recorded * dt;
+
+   if (print)
+      printf("%lld %.6f %.6f\n", (long long)time, recorded / 1000000.0, replayed / 1000000.0);
+}
+
+static void replay(CPccRecordReader& reader, CTrajectory& t, bool print)
+{
+   const CPccRecordHeader& h = reader.header();
+   PccSender sender(h.m_llInitialRtt, h.m_iInitialCwnd, h.m_iMaxCwnd);
+   sender.set_random_seed(h.m_iSeed);
+
+   t.m_llCalls = t.m_llDiverged = 0;
+   t.m_llFirstDiverged = -1;
+   t.m_dDuration = t.m_dRecordedSum = t.m_dReplayedSum = t.m_dErrorSum = 0;
+
+   // the call whose resulting rates are not settled yet: the RATE record
+   // after it, if any, carries the recorded rate
+   bool pending = false;
+   QuicTime time = 0;
+   QuicTime start = h.m_ullStartTime;
+   double recorded = 0;
+   double replayed = 0;
+   double lastrecorded = -1;
+   double lastreplayed = -1;
+
+   CPccRecordEvent e;
+   reader.rewind();
+   while (reader.next(e))
+   {
+      if (CPccRecordEvent::RATE == e.m_iType)
+      {
+         recorded = e.m_dRate;
+         continue;
+      }
+
+      // WARM_START carries no time; it takes the time of the call before it
+      QuicTime now = (CPccRecordEvent::WARM_START == e.m_iType) ? time : e.m_llTime - start;
+      if (pending)
+      {
+         bool changed = (recorded != lastrecorded) || (replayed != lastreplayed);
+         settle(t, t.m_llCalls - 1, time, now, recorded, replayed, print && changed);
+         lastrecorded = recorded;
+         lastreplayed = replayed;
+      }
+
+      switch (e.m_iType)
+      {
+      case CPccRecordEvent::SENT:
+         sender.OnPacketSent(e.m_llTime, e.m_llBytesInFlight, e.m_iPacketNumber, e.m_llBytes, e.m_bFlag);
+         break;
+
+      case CPccRecordEvent::CONGESTION:
+         sender.OnCongestionEvent(e.m_bFlag, e.m_llBytesInFlight, e.m_llTime, e.m_llRtt, e.m_vAcked, e.m_vLost);
+         break;
+
+      case CPccRecordEvent::WARM_START:
+         sender.WarmStart(e.m_dRate, e.m_llRtt);
+         break;
+      }
+
+      replayed = sender.PacingRate(0);
+      time = now;
+      pending = true;
+      ++ t.m_llCalls;
+   }
+
+   if (pending)
+      settle(t, t.m_llCalls - 1, time, time, recorded, replayed, print && ((recorded != lastrecorded) || (replayed != lastreplayed)));
+}
+
+static int usage(const char* name)
+{
+   cerr << "usage: " << name << " [-t] [-n RUNS] FILE..." << endl;
+   return 1;
+}
+
+int main(int argc, char* argv[])
+{
+   bool print = false;
+   int runs = 1;
+
+   int c;
+   while ((c = getopt(argc, argv, "tn:")) != -1)
+   {
+      switch (c)
+      {
+      case 't': print = true; break;
+      case 'n': runs = atoi(optarg); break;
+      default: return usage(argv[0]);
+      }
+   }
+   if ((optind == argc) || (runs <= 0))
+      return usage(argv[0]);
+
+   int status = 0;
+   for (int i = optind; i < argc; ++ i)
+   {
+      CPccRecordReader reader;
+      if (reader.open(argv[i]) < 0)
+      {
+         cerr << argv[i] << ": not a PCC recording" << endl;
+         status = 1;
+         continue;
+      }
+
+      CTrajectory t;
+      if (print)
+      {
+         printf("# %s socket %d\n", argv[i], reader.header().m_iSocket);
+         replay(reader, t, true);
+         continue;
+      }
+
+      uint64_t begin = CTimer::getTime();
+      for (int r = 0; r < runs; ++ r)
+         replay(reader, t, false);
+      double elapsed = max(1.0, double(CTimer::getTime() - begin));
+
+      printf("%s: socket %d seed %u\n", argv[i], reader.header().m_iSocket, reader.header().m_iSeed);
+      if (reader.truncated())
+         printf("   truncated after %lld calls\n", (long long)t.m_llCalls);
+      printf("   calls %lld, %.2f million/s\n", (long long)t.m_llCalls, t.m_llCalls * runs / elapsed);
+      if (0 == t.m_llDiverged)
+         printf("   diverged 0 calls\n");
+      else
+         printf("   diverged %lld calls (%.2f%%), first at call %lld, %.3f s: recorded %.3f Mb/s, replayed %.3f Mb/s\n",
+                (long long)t.m_llDiverged, t.m_llDiverged * 100.0 / t.m_llCalls, (long long)t.m_llFirstDiverged,
+                t.m_llFirstDivergedTime / 1000000.0, t.m_dFirstRecorded / 1000000.0, t.m_dFirstReplayed / 1000000.0);
+      if (t.m_dDuration > 0)
+         printf("   mean rate %.3f Mb/s recorded, %.3f Mb/s replayed, mean error %.2f%% over %.3f s\n",
+                t.m_dRecordedSum / t.m_dDuration / 1000000.0, t.m_dReplayedSum / t.m_dDuration / 1000000.0,
+                t.m_dErrorSum / t.m_dDuration * 100.0, t.m_dDuration / 1000000.0);
+   }
+
+   return status;
+}
@@ -0,0 +1,312 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <iostream>
+#include <vector>
+#include "../core/udt.h"
+#include "../core/common.h"
+#include "channel.h"
+#include "packet.h"
+
+using namespace std;
+
+// Measures the cost of the UDT data path over real UDP sockets: flows between
+// sender and receiver sockets of this process, over loopback by default or
+// between the two ends of a veth pair given by address:
+//
+//    udtbench [-t SECONDS] [-w SECONDS] [-m MSS[,MSS...]] [-n FLOWS[,FLOWS...]]
+//             [-r MBPS[,MBPS...]] [-s SENDER_ADDR] [-d RECEIVER_ADDR]
+//
+// Every combination of an MSS, a flow count and a target rate is a run, in a
+// process of its own. The target rate is shared evenly between the flows, and
+// each is paced at its share through UDT_FIXEDBW whatever PCC decides. 0 leaves
+// the rate to PCC. After -w seconds of warm-up (default 2), a run measures for -t
+// seconds (default 5) and prints one line:
+//    MSS FLOWS TARGET(Mb/s) SENT(Mb/s) GOODPUT(Mb/s) CYCLES/BYTE SYSCALLS/PKT
+//    ACKS/PKT PACING50(us) PACING99(us) PACING999(us) RETRANS(%)
+// SENT is the rate the senders achieved, in full packets of MSS bytes as the
+// target is, retransmissions included. CYCLES/BYTE is the CPU time of the
+// whole process, both ends, in TSC cycles per byte received. SYSCALLS/PKT
+// counts the sendmsg() and recvmsg() calls of both ends per data packet
+// received, and ACKS/PKT the ACKs the senders got per data packet sent. The
+// pacing columns are percentiles of the lateness of a packet behind its pacing
+// time, the worst of the flows.
+
+struct COptions
+{
+   int m_iSeconds;
+   int m_iWarmup;
+   vector<double> m_vdMSS;
+   vector<double> m_vdFlows;
+   vector<double> m_vdRates;
+   const char* m_pcSenderAddr;
+   const char* m_pcReceiverAddr;
+};
+
+struct CResult
+{
+   int64_t m_llRecv;
+   int64_t m_llSent;
+   int64_t m_llAcks;
+   int64_t m_llRetrans;
+   double m_dPacing[3];
+};
+
+void* senddata(void*);
+void* recvdata(void*);
+
+static bool parseList(const char* arg, vector<double>& values)
+{
+   values.clear();
+   while (*arg)
+   {
+      char* end;
+      double v = strtod(arg, &end);
+      if ((end == arg) || (v < 0))
+         return false;
+      values.push_back(v);
+      arg = end;
+      if (',' == *arg)
+         ++ arg;
+      else if (*arg)
+         return false;
+   }
+   return !values.empty();
+}
+
+static UDTSOCKET bindsocket(const char* ip, int mss)
+{
+   sockaddr_in addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port = 0;
+   if (1 != inet_pton(AF_INET, ip, &addr.sin_addr))
+   {
+      cerr << "bad address " << ip << endl;
+      _exit(1);
+   }
+
+   UDTSOCKET u = UDT::socket(AF_INET, SOCK_STREAM, 0);
+   UDT::setsockopt(u, 0, UDT_MSS, &mss, sizeof(int));
+   if (UDT::ERROR == UDT::bind(u, (sockaddr*)&addr, sizeof(addr)))
+   {
+      cerr << "bind " << ip << ": " << UDT::getlasterror().getErrorMessage() << endl;
+      _exit(1);
+   }
+
+   return u;
+}
+
+static void sample(const vector<UDTSOCKET>& senders, const vector<UDTSOCKET>& receivers, CResult& r)
+{
+   memset(&r, 0, sizeof(r));
+   for (size_t i = 0; i < senders.size(); ++ i)
+   {
+      UDT::TRACEINFO perf;
+      UDT::perfmon(senders[i], &perf, true);
+      r.m_llSent += perf.pktSent;
+      r.m_llAcks += perf.pktRecvACK;
+      r.m_llRetrans += perf.pktRetrans;
+      r.m_dPacing[0] = max(r.m_dPacing[0], perf.usPacingErrorP50);
+      r.m_dPacing[1] = max(r.m_dPacing[1], perf.usPacingErrorP99);
+      r.m_dPacing[2] = max(r.m_dPacing[2], perf.usPacingErrorP999);
+
+      UDT::perfmon(receivers[i], &perf, true);
+      r.m_llRecv += perf.pktRecv;
+   }
+}
+
+static int64_t cpuTime()
+{
+   rusage ru;
+   getrusage(RUSAGE_SELF, &ru);
+   return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+// one run, in the child process
+static void run(const COptions& opt, int mss, int flows, double rate)
+{
+   // the library prints on stdout; keep it out of the results
+   FILE* out = fdopen(dup(1), "w");
+   int null = open("/dev/null", O_WRONLY);
+   dup2(null, 1);
+   close(null);
+
+   UDT::startup();
+
+   UDTSOCKET serv = bindsocket(opt.m_pcSenderAddr, mss);
+   int64_t bw = (int64_t)(rate * 1000000.0 / 8 / flows);
+   if (bw > 0)
+      UDT::setsockopt(serv, 0, UDT_FIXEDBW, &bw, sizeof(int64_t));
+   UDT::listen(serv, flows);
+
+   sockaddr_in peer;
+   int len = sizeof(peer);
+   UDT::getsockname(serv, (sockaddr*)&peer, &len);
+
+   vector<UDTSOCKET> senders, receivers;
+   for (int i = 0; i < flows; ++ i)
+   {
+      UDTSOCKET client = bindsocket(opt.m_pcReceiverAddr, mss);
+      if (UDT::ERROR == UDT::connect(client, (sockaddr*)&peer, sizeof(peer)))
+      {
+         cerr << "connect: " << UDT::getlasterror().getErrorMessage() << endl;
+         _exit(1);
+      }
+      receivers.push_back(client);
+
+      sockaddr_storage clientaddr;
+      int addrlen = sizeof(clientaddr);
+      UDTSOCKET sender = UDT::accept(serv, (sockaddr*)&clientaddr, &addrlen);
+      if (UDT::INVALID_SOCK == sender)
+      {
+         cerr << "accept: " << UDT::getlasterror().getErrorMessage() << endl;
+         _exit(1);
+      }
+      senders.push_back(sender);
+   }
+
+   for (int i = 0; i < flows; ++ i)
+   {
+      pthread_t t;
+      pthread_create(&t, NULL, senddata, new UDTSOCKET(senders[i]));
+      pthread_detach(t);
+      pthread_create(&t, NULL, recvdata, new UDTSOCKET(receivers[i]));
+      pthread_detach(t);
+   }
+
+   sleep(opt.m_iWarmup);
+
+   CResult r;
+   sample(senders, receivers, r);
+   int64_t cpu = cpuTime();
+   int64_t calls = CChannel::getSysCalls();
+   uint64_t start = CTimer::getTime();
+
+   sleep(opt.m_iSeconds);
+
+   sample(senders, receivers, r);
+   cpu = cpuTime() - cpu;
+   calls = CChannel::getSysCalls() - calls;
+   double elapsed = double(CTimer::getTime() - start);
+
+   double bytes = double(r.m_llRecv) * (mss - 28 - CPacket::m_iPktHdrSize);
+   double recv = max(1.0, double(r.m_llRecv));
+   double sent = max(1.0, double(r.m_llSent));
+
+   fprintf(out, "%d %d %.1f %.2f %.2f %.2f %.3f %.3f %.1f %.1f %.1f %.3f\n", mss, flows, rate,
+          double(r.m_llSent) * mss * 8 / elapsed, bytes * 8 / elapsed,
+          cpu * (double)CTimer::getCPUFrequency() / max(1.0, bytes), calls / recv, r.m_llAcks / sent,
+          r.m_dPacing[0], r.m_dPacing[1], r.m_dPacing[2], r.m_llRetrans * 100.0 / sent);
+   fflush(out);
+
+   // the worker threads are still running; leave without tearing them down
+   _exit(0);
+}
+
+static int usage(const char* name)
+{
+   cerr << "usage: " << name << " [-t SECONDS] [-w SECONDS] [-m MSS[,MSS...]] [-n FLOWS[,FLOWS...]]" << endl;
+   cerr << "          [-r MBPS[,MBPS...]] [-s SENDER_ADDR] [-d RECEIVER_ADDR]" << endl;
+   return 1;
+}
+
+int main(int argc, char* argv[])
+{
+   COptions opt;
+   opt.m_iSeconds = 5;
+   opt.m_iWarmup = 2;
+   opt.m_vdMSS.assign(1, 1500);
+   opt.m_vdFlows.assign(1, 1);
+   opt.m_vdRates.assign(1, 0);
+   opt.m_pcSenderAddr = "127.0.0.1";
+   opt.m_pcReceiverAddr = "127.0.0.1";
+
+   int c;
+   while ((c = getopt(argc, argv, "t:w:m:n:r:s:d:")) != -1)
+   {
+      switch (c)
+      {
+      case 't': opt.m_iSeconds = atoi(optarg); break;
+      case 'w': opt.m_iWarmup = atoi(optarg); break;
+      case 'm': if (!parseList(optarg, opt.m_vdMSS)) return usage(argv[0]); break;
+      case 'n': if (!parseList(optarg, opt.m_vdFlows)) return usage(argv[0]); break;
+      case 'r': if (!parseList(optarg, opt.m_vdRates)) return usage(argv[0]); break;
+      case 's': opt.m_pcSenderAddr = optarg; break;
+      case 'd': opt.m_pcReceiverAddr = optarg; break;
+      default: return usage(argv[0]);
+      }
+   }
+   if ((optind != argc) || (opt.m_iSeconds <= 0) || (opt.m_iWarmup < 0))
+      return usage(argv[0]);
+
+   printf("# mss flows target_mbps sent_mbps goodput_mbps cycles_per_byte syscalls_per_pkt acks_per_pkt"
+          " pacing_p50_us pacing_p99_us pacing_p999_us retrans_pct\n");
+   fflush(stdout);
+
+   int status = 0;
+   for (size_t i = 0; i < opt.m_vdMSS.size(); ++ i)
+      for (size_t j = 0; j < opt.m_vdFlows.size(); ++ j)
+         for (size_t k = 0; k < opt.m_vdRates.size(); ++ k)
+         {
+            int mss = (int)opt.m_vdMSS[i];
+            int flows = (int)opt.m_vdFlows[j];
+            if ((mss <= 28 + CPacket::m_iPktHdrSize) || (flows <= 0))
+               return usage(argv[0]);
+
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+               perror("fork");
+               return 1;
+            }
+            if (0 == pid)
+               run(opt, mss, flows, opt.m_vdRates[k]);
+
+            int s;
+            waitpid(pid, &s, 0);
+            if (!WIFEXITED(s) || (0 != WEXITSTATUS(s)))
+            {
+               cerr << "run mss " << mss << " flows " << flows << " rate " << opt.m_vdRates[k] << " failed" << endl;
+               status = 1;
+            }
+         }
+
+   return status;
+}
+
+void* senddata(void* usocket)
+{
+   UDTSOCKET sender = *(UDTSOCKET*)usocket;
+   delete (UDTSOCKET*)usocket;
+
+   int size = 1000000;
+   char* data = new char[size];
+   memset(data, 0, size);
+
+   while (UDT::ERROR != UDT::send(sender, data, size, 0))
+   {
+   }
+
+   delete [] data;
+
+   return NULL;
+}
+
+void* recvdata(void* usocket)
+{
+   UDTSOCKET recver = *(UDTSOCKET*)usocket;
+   delete (UDTSOCKET*)usocket;
+
+   char data[65536];
+   while (UDT::ERROR != UDT::recv(recver, data, sizeof(data), 0))
+   {
+   }
+
+   return NULL;
+}
@@ -0,0 +1,179 @@
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "../core/eventtrace.h"
+
+using namespace std;
+
+// Converts an event trace, written by a process run with UDT_TRACE=FILE, to
+// text:
+//
+//    udttrace [-c] [-s SOCKET] [-e EVENT[,EVENT...]] FILE
+//
+// Records are sorted by time, which is in microseconds since tracing started.
+// By default each line is "TIME THREAD SOCKET EVENT" followed by the named
+// fields of the event. -c prints comma separated raw fields instead:
+//    time_us,thread,socket,event,arg1,arg2,value,flags
+// -s keeps the records of one socket, and -e the events named in a list of
+// sent, ack, loss, rate, mi_start, mi_end, utility and dropped.
+
+static const char* s_pcEventNames[CEventRecord::EVENT_MAX] =
+   {"unknown", "sent", "ack", "loss", "rate", "mi_start", "mi_end", "utility", "dropped"};
+
+static const char* s_pcModeNames[] = {"starting", "probing", "decision_made"};
+
+static bool timeLess(const CEventRecord& a, const CEventRecord& b)
+{
+   return a.m_ullTime < b.m_ullTime;
+}
+
+static bool parseEvents(const char* arg, vector<bool>& keep)
+{
+   keep.assign(CEventRecord::EVENT_MAX, false);
+   while (*arg)
+   {
+      size_t len = strcspn(arg, ",");
+      int e = 1;
+      while ((e < CEventRecord::EVENT_MAX) && ((strlen(s_pcEventNames[e]) != len) || (0 != strncmp(arg, s_pcEventNames[e], len))))
+         ++ e;
+      if (e == CEventRecord::EVENT_MAX)
+         return false;
+      keep[e] = true;
+      arg += len;
+      if (',' == *arg)
+         ++ arg;
+   }
+   return true;
+}
+
+static void printFields(const CEventRecord& r)
+{
+   switch (r.m_iEvent)
+   {
+   case CEventRecord::SENT:
+      printf(" seq=%d msg=%d bytes=%.0f%s", r.m_iArg1, r.m_iArg2, r.m_dValue, r.m_iFlags ? " retrans" : "");
+      break;
+
+   case CEventRecord::ACK:
+      printf(" seq=%d msg=%d rtt_us=%.0f", r.m_iArg1, r.m_iArg2, r.m_dValue);
+      break;
+
+   case CEventRecord::LOSS:
+      printf(" seq=%d msg=%d bytes=%.0f", r.m_iArg1, r.m_iArg2, r.m_dValue);
+      break;
+
+   case CEventRecord::RATE:
+      printf(" mode=%s rate_mbps=%.3f", ((r.m_iArg1 >= 0) && (r.m_iArg1 < 3)) ? s_pcModeNames[r.m_iArg1] : "unknown", r.m_dValue / 1000000.0);
+      break;
+
+   case CEventRecord::MI_START:
+      printf(" useful=%d rtt_us=%d rate_mbps=%.3f", r.m_iArg1, r.m_iArg2, r.m_dValue / 1000000.0);
+      break;
+
+   case CEventRecord::MI_END:
+      printf(" packets=%d duration_us=%d loss=%.4f", r.m_iArg1, r.m_iArg2, r.m_dValue);
+      break;
+
+   case CEventRecord::UTILITY:
+      printf(" utility=%g rate_mbps=%.3f latency_inflation=%.6f", r.m_dValue, r.m_iArg1 / 1000.0, r.m_iArg2 / 1000000.0);
+      break;
+
+   case CEventRecord::DROPPED:
+      printf(" records=%d", r.m_iArg1);
+      break;
+
+   default:
+      printf(" arg1=%d arg2=%d value=%g flags=%d", r.m_iArg1, r.m_iArg2, r.m_dValue, r.m_iFlags);
+      break;
+   }
+}
+
+static int usage(const char* name)
+{
+   cerr << "usage: " << name << " [-c] [-s SOCKET] [-e EVENT[,EVENT...]] FILE" << endl;
+   return 1;
+}
+
+int main(int argc, char* argv[])
+{
+   bool csv = false;
+   bool onesocket = false;
+   int32_t socket = 0;
+   vector<bool> keep(CEventRecord::EVENT_MAX, true);
+
+   int c;
+   while ((c = getopt(argc, argv, "cs:e:")) != -1)
+   {
+      switch (c)
+      {
+      case 'c': csv = true; break;
+      case 's': onesocket = true; socket = atoi(optarg); break;
+      case 'e': if (!parseEvents(optarg, keep)) return usage(argv[0]); break;
+      default: return usage(argv[0]);
+      }
+   }
+   if (optind + 1 != argc)
+      return usage(argv[0]);
+
+   FILE* f = fopen(argv[optind], "rb");
+   if (NULL == f)
+   {
+      perror(argv[optind]);
+      return 1;
+   }
+
+   CEventTraceHeader header;
+   if ((1 != fread(&header, sizeof(CEventTraceHeader), 1, f)) || (0 != memcmp(header.m_pcMagic, CEventTraceHeader::m_pcTraceMagic, 8)))
+   {
+      cerr << argv[optind] << ": not an event trace" << endl;
+      return 1;
+   }
+   if ((header.m_iVersion != CEventTraceHeader::m_iTraceVersion) || (header.m_iRecordSize != sizeof(CEventRecord)))
+   {
+      cerr << argv[optind] << ": trace version " << header.m_iVersion << " is not supported" << endl;
+      return 1;
+   }
+
+   vector<CEventRecord> records;
+   CEventRecord r;
+   while (1 == fread(&r, sizeof(CEventRecord), 1, f))
+   {
+      if ((onesocket && (r.m_iSocket != socket)) || (r.m_iEvent >= CEventRecord::EVENT_MAX) || !keep[r.m_iEvent])
+         continue;
+      records.push_back(r);
+   }
+   fclose(f);
+
+   // the cycle rate measured over the whole trace is more precise than the
+   // whole cycles per microsecond of the header, when the process stopped it
+   double frequency = double(header.m_ullFrequency);
+   if ((header.m_ullEndTime > header.m_ullStartTime) && (header.m_ullEndCycles > header.m_ullStartCycles))
+      frequency = double(header.m_ullEndCycles - header.m_ullStartCycles) / (header.m_ullEndTime - header.m_ullStartTime);
+   if (frequency <= 0)
+      frequency = 1;
+
+   stable_sort(records.begin(), records.end(), timeLess);
+
+   if (csv)
+      printf("time_us,thread,socket,event,arg1,arg2,value,flags\n");
+
+   for (vector<CEventRecord>::const_iterator i = records.begin(); i != records.end(); ++ i)
+   {
+      double t = (double(i->m_ullTime) - double(header.m_ullStartCycles)) / frequency;
+      if (csv)
+      {
+         printf("%.3f,%d,%d,%s,%d,%d,%.17g,%d\n", t, i->m_iThread, i->m_iSocket, s_pcEventNames[i->m_iEvent],
+                i->m_iArg1, i->m_iArg2, i->m_dValue, i->m_iFlags);
+         continue;
+      }
+      printf("%.3f %d %d %s", t, i->m_iThread, i->m_iSocket, s_pcEventNames[i->m_iEvent]);
+      printFields(*i);
+      printf("\n");
+   }
+
+   return 0;
+}
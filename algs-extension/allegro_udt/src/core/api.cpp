@@ -47,9 +47,12 @@ written by
 #else
    #include <unistd.h>
 #endif
+#include <cstdlib>
 #include <cstring>
 #include "api.h"
 #include "core.h"
+#include "eventtrace.h"
+#include "emulator.h"
 
 using namespace std;
 
@@ -123,6 +126,7 @@ m_TLSError(),
 m_mMultiplexer(),
 m_MultiplexerLock(),
 m_pCache(NULL),
+m_pCacheStore(NULL),
 m_bClosing(false),
 m_GCStopLock(),
 m_GCStopCond(),
@@ -154,6 +158,7 @@ m_ClosedSockets()
    #endif
 
    m_pCache = new CCache<CInfoBlock>;
+   m_pCacheStore = new CInfoStore;
 }
 
 CUDTUnited::~CUDTUnited()
@@ -176,6 +181,7 @@ CUDTUnited::~CUDTUnited()
    #endif
 
    delete m_pCache;
+   delete m_pCacheStore;
 }
 
 int CUDTUnited::startup()
@@ -200,11 +206,26 @@ int CUDTUnited::startup()
    if (m_bGCStatus)
       return true;
 
+   // path information persists across restarts if a cache file is given
+   const char* cachefile = getenv("UDT_PATH_CACHE");
+   if (NULL != cachefile)
+      m_pCacheStore->open(cachefile);
+
+   // binary event trace of every connection, for app/udttrace
+   const char* tracefile = getenv("UDT_TRACE");
+   if (NULL != tracefile)
+      CEventTrace::start(tracefile);
+
+   // the calls each connection makes to PCC, for app/pccreplay
+   const char* recordprefix = getenv("UDT_PCC_RECORD");
+   if (NULL != recordprefix)
+      CPccRecorder::enable(recordprefix);
+
    m_bClosing = false;
    #ifndef WIN32
       pthread_mutex_init(&m_GCStopLock, NULL);
       pthread_cond_init(&m_GCStopCond, NULL);
-      pthread_create(&m_GCThread, NULL, garbageCollect, this);
+      CEmuClock::spawn(&m_GCThread, garbageCollect, this);
    #else
       m_GCStopLock = CreateMutex(NULL, false, NULL);
       m_GCStopCond = CreateEvent(NULL, false, false, NULL);
@@ -231,8 +252,8 @@ int CUDTUnited::cleanup()
 
    m_bClosing = true;
    #ifndef WIN32
-      pthread_cond_signal(&m_GCStopCond);
-      pthread_join(m_GCThread, NULL);
+      CEmuClock::signal(&m_GCStopCond);
+      CEmuClock::join(m_GCThread);
       pthread_mutex_destroy(&m_GCStopLock);
       pthread_cond_destroy(&m_GCStopCond);
    #else
@@ -245,6 +266,9 @@ int CUDTUnited::cleanup()
 
    m_bGCStatus = false;
 
+   m_pCacheStore->close();
+   CEventTrace::stop();
+
    // Global destruction code
    #ifdef WIN32
       WSACleanup();
@@ -291,6 +315,7 @@ UDTSOCKET CUDTUnited::newSocket(const int& af, const int& type)
    ns->m_pUDT->m_iSockType = (SOCK_STREAM == type) ? UDT_STREAM : UDT_DGRAM;
    ns->m_pUDT->m_iIPversion = ns->m_iIPversion = af;
    ns->m_pUDT->m_pCache = m_pCache;
+   ns->m_pUDT->m_pCacheStore = m_pCacheStore;
 
    // protect the m_Sockets structure.
    CGuard::enterCS(m_ControlLock);
@@ -453,7 +478,7 @@ int CUDTUnited::newConnection(const UDTSOCKET listen, const sockaddr* peer, CHan
    // wake up a waiting accept() call
    #ifndef WIN32
       pthread_mutex_lock(&(ls->m_AcceptLock));
-      pthread_cond_signal(&(ls->m_AcceptCond));
+      CEmuClock::signal(&(ls->m_AcceptCond));
       pthread_mutex_unlock(&(ls->m_AcceptLock));
    #else
       SetEvent(ls->m_AcceptCond);
@@ -660,7 +685,7 @@ UDTSOCKET CUDTUnited::accept(const UDTSOCKET listen, sockaddr* addr, int* addrle
          }
 
          if (!accepted && (LISTENING == ls->m_Status))
-            pthread_cond_wait(&(ls->m_AcceptCond), &(ls->m_AcceptLock));
+            CEmuClock::wait(&(ls->m_AcceptCond), &(ls->m_AcceptLock));
 
          if (ls->m_pQueuedSockets->empty())
             m_EPoll.disable_read(listen, ls->m_pUDT->m_sPollID);
@@ -823,7 +848,7 @@ int CUDTUnited::close(const UDTSOCKET u)
       // broadcast all "accept" waiting
       #ifndef WIN32
          pthread_mutex_lock(&(s->m_AcceptLock));
-         pthread_cond_broadcast(&(s->m_AcceptCond));
+         CEmuClock::broadcast(&(s->m_AcceptCond));
          pthread_mutex_unlock(&(s->m_AcceptLock));
       #else
          SetEvent(s->m_AcceptCond);
@@ -1479,13 +1504,7 @@ void CUDTUnited::updateMux(CUDTSocket* s, const CUDTSocket* ls)
       #endif
 
       #ifndef WIN32
-         timeval now;
-         timespec timeout;
-         gettimeofday(&now, 0);
-         timeout.tv_sec = now.tv_sec + 1;
-         timeout.tv_nsec = now.tv_usec * 1000;
-
-         pthread_cond_timedwait(&self->m_GCStopCond, &self->m_GCStopLock, &timeout);
+         CEmuClock::timedwait(&self->m_GCStopCond, &self->m_GCStopLock, CTimer::getTime() + 1000000);
       #else
          WaitForSingleObject(self->m_GCStopCond, 1000);
       #endif
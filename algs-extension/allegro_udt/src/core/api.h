@@ -232,6 +232,7 @@ private:
 
 private:
    CCache<CInfoBlock>* m_pCache;			// UDT network information cache
+   CInfoStore* m_pCacheStore;				// persistent copy of m_pCache, enabled by UDT_PATH_CACHE
 
 private:
    volatile bool m_bClosing;
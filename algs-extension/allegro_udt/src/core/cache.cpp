@@ -46,6 +46,14 @@ written by
    #endif
 #endif
 
+#ifndef WIN32
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/file.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+#endif
+
 #include <cstring>
 #include "cache.h"
 #include "core.h"
@@ -63,6 +71,8 @@ CInfoBlock& CInfoBlock::operator=(const CInfoBlock& obj)
    m_iReorderDistance = obj.m_iReorderDistance;
    m_dInterval = obj.m_dInterval;
    m_dCWnd = obj.m_dCWnd;
+   m_dPccRate = obj.m_dPccRate;
+   m_iMinRTT = obj.m_iMinRTT;
 
    return *this;
 }
@@ -97,6 +107,8 @@ CInfoBlock* CInfoBlock::clone()
    obj->m_iReorderDistance = m_iReorderDistance;
    obj->m_dInterval = m_dInterval;
    obj->m_dCWnd = m_dCWnd;
+   obj->m_dPccRate = m_dPccRate;
+   obj->m_iMinRTT = m_iMinRTT;
 
    return obj;
 }
@@ -121,3 +133,211 @@ void CInfoBlock::convert(const sockaddr* addr, const int& ver, uint32_t ip[])
       memcpy((char*)ip, (char*)((sockaddr_in6*)addr)->sin6_addr.s6_addr, 16);
    }
 }
+
+const uint32_t CInfoStore::m_iMagic = 0x55445443;	// "UDTC"
+const uint32_t CInfoStore::m_iFileVersion = 1;
+const int CInfoStore::m_iProbeLen = 8;
+const uint64_t CInfoStore::m_ullMaxAge = 3600000000ULL;
+
+CInfoStore::CInfoStore():
+m_iFD(-1),
+m_pMap(NULL),
+m_iMapSize(0),
+m_pHeader(NULL),
+m_pSlots(NULL)
+{
+   CGuard::createMutex(m_Lock);
+}
+
+CInfoStore::~CInfoStore()
+{
+   close();
+   CGuard::releaseMutex(m_Lock);
+}
+
+int CInfoStore::open(const char* path, const int& size)
+{
+#ifndef WIN32
+   CGuard storeguard(m_Lock);
+
+   if ((NULL != m_pMap) || (size <= 0))
+      return -1;
+
+   int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+   if (fd < 0)
+      return -1;
+
+   // another process may be formatting the file at the same time
+   if (flock(fd, LOCK_EX) < 0)
+   {
+      ::close(fd);
+      return -1;
+   }
+
+   struct stat st;
+   if (fstat(fd, &st) < 0)
+   {
+      ::close(fd);
+      return -1;
+   }
+
+   // an existing file keeps its own geometry; an empty or foreign one is reformatted
+   CHeader hdr;
+   bool valid = (st.st_size >= (off_t)sizeof(CHeader)) && (pread(fd, &hdr, sizeof(CHeader), 0) == (ssize_t)sizeof(CHeader))
+      && (hdr.m_iMagic == m_iMagic) && (hdr.m_iVersion == m_iFileVersion) && (hdr.m_iSize > 0)
+      && (st.st_size == (off_t)(sizeof(CHeader) + hdr.m_iSize * sizeof(CRecord)));
+
+   uint32_t slots = valid ? hdr.m_iSize : size;
+   size_t len = sizeof(CHeader) + slots * sizeof(CRecord);
+
+   if (!valid && ((ftruncate(fd, 0) < 0) || (ftruncate(fd, len) < 0)))
+   {
+      ::close(fd);
+      return -1;
+   }
+
+   void* map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (MAP_FAILED == map)
+   {
+      ::close(fd);
+      return -1;
+   }
+
+   m_pMap = (char*)map;
+   m_iMapSize = len;
+   m_pHeader = (CHeader*)m_pMap;
+   m_pSlots = (CRecord*)(m_pMap + sizeof(CHeader));
+
+   if (!valid)
+   {
+      // ftruncate() zero-fills, so every slot starts out empty (m_iIPversion == 0)
+      m_pHeader->m_iMagic = m_iMagic;
+      m_pHeader->m_iVersion = m_iFileVersion;
+      m_pHeader->m_iSize = slots;
+      m_pHeader->m_iReserved = 0;
+   }
+
+   flock(fd, LOCK_UN);
+   m_iFD = fd;
+
+   return 0;
+#else
+   return -1;
+#endif
+}
+
+void CInfoStore::close()
+{
+#ifndef WIN32
+   CGuard storeguard(m_Lock);
+
+   if (NULL == m_pMap)
+      return;
+
+   msync(m_pMap, m_iMapSize, MS_ASYNC);
+   munmap(m_pMap, m_iMapSize);
+   ::close(m_iFD);
+   m_iFD = -1;
+   m_pMap = NULL;
+   m_iMapSize = 0;
+   m_pHeader = NULL;
+   m_pSlots = NULL;
+#endif
+}
+
+bool CInfoStore::match(const CRecord& r, const CInfoBlock& data)
+{
+   if (r.m_iIPversion != data.m_iIPversion)
+      return false;
+
+   if (AF_INET == data.m_iIPversion)
+      return r.m_piIP[0] == data.m_piIP[0];
+
+   return 0 == memcmp(r.m_piIP, data.m_piIP, sizeof(r.m_piIP));
+}
+
+int CInfoStore::lookup(CInfoBlock* data)
+{
+   CGuard storeguard(m_Lock);
+
+   if (NULL == m_pMap)
+      return -1;
+
+#ifndef WIN32
+   // the mutex only orders the threads of this process
+   flock(m_iFD, LOCK_SH);
+#endif
+
+   uint32_t slots = m_pHeader->m_iSize;
+   uint32_t key = (uint32_t)data->getKey() % slots;
+   uint64_t now = CTimer::getTime();
+   int res = -1;
+
+   for (int i = 0; i < m_iProbeLen; ++ i)
+   {
+      const CRecord& r = m_pSlots[(key + i) % slots];
+      if (0 == r.m_iIPversion)
+         break;
+      if (!match(r, *data))
+         continue;
+      if (now - r.m_ullTimeStamp > m_ullMaxAge)
+         break;
+
+      data->m_ullTimeStamp = r.m_ullTimeStamp;
+      data->m_iRTT = r.m_iRTT;
+      data->m_iBandwidth = r.m_iBandwidth;
+      data->m_iMinRTT = r.m_iMinRTT;
+      data->m_dPccRate = r.m_dPccRate;
+      res = 0;
+      break;
+   }
+
+#ifndef WIN32
+   flock(m_iFD, LOCK_UN);
+#endif
+
+   return res;
+}
+
+int CInfoStore::update(CInfoBlock* data)
+{
+   CGuard storeguard(m_Lock);
+
+   if (NULL == m_pMap)
+      return -1;
+
+#ifndef WIN32
+   flock(m_iFD, LOCK_EX);
+#endif
+
+   uint32_t slots = m_pHeader->m_iSize;
+   uint32_t key = (uint32_t)data->getKey() % slots;
+
+   // use the matching slot, else the first empty one, else the oldest one in the probe window
+   CRecord* victim = NULL;
+   for (int i = 0; i < m_iProbeLen; ++ i)
+   {
+      CRecord* r = m_pSlots + (key + i) % slots;
+      if (match(*r, *data) || (0 == r->m_iIPversion))
+      {
+         victim = r;
+         break;
+      }
+      if ((NULL == victim) || (r->m_ullTimeStamp < victim->m_ullTimeStamp))
+         victim = r;
+   }
+
+   memcpy(victim->m_piIP, data->m_piIP, sizeof(victim->m_piIP));
+   victim->m_iRTT = data->m_iRTT;
+   victim->m_iBandwidth = data->m_iBandwidth;
+   victim->m_iMinRTT = data->m_iMinRTT;
+   victim->m_dPccRate = data->m_dPccRate;
+   victim->m_ullTimeStamp = CTimer::getTime();
+   victim->m_iIPversion = data->m_iIPversion;
+
+#ifndef WIN32
+   flock(m_iFD, LOCK_UN);
+#endif
+
+   return 0;
+}
@@ -266,8 +266,12 @@ public:
    int m_iReorderDistance;	// packet reordering distance
    double m_dInterval;		// inter-packet time, congestion control
    double m_dCWnd;		// congestion window size, congestion control
+   double m_dPccRate;		// last converged PCC sending rate, in bits per second, 0 if unknown
+   int m_iMinRTT;		// minimum RTT observed on the path, in microseconds, 0 if unknown
 
 public:
+   CInfoBlock(): m_iIPversion(0), m_ullTimeStamp(0), m_iRTT(0), m_iBandwidth(0), m_iLossRate(0), m_iReorderDistance(0),
+      m_dInterval(0), m_dCWnd(0), m_dPccRate(0), m_iMinRTT(0) {}
    virtual ~CInfoBlock() {}
    virtual CInfoBlock& operator=(const CInfoBlock& obj);
    virtual bool operator==(const CInfoBlock& obj);
@@ -289,5 +293,92 @@ public:
    static void convert(const sockaddr* addr, const int& ver, uint32_t ip[]);
 };
 
+// Persistent, mmap-backed copy of the CInfoBlock cache, so that path information
+// survives process restarts. The file is a fixed-size open-addressed table. It
+// can be shared by several processes, so every access also holds flock() on it.
+class CInfoStore
+{
+public:
+   CInfoStore();
+   ~CInfoStore();
+
+public:
+      // Functionality:
+      //    map (and create if necessary) the backing file.
+      // Parameters:
+      //    0) [in] path: file name.
+      //    1) [in] size: number of slots, only used when the file is created.
+      // Returned value:
+      //    0 if success, otherwise -1.
+
+   int open(const char* path, const int& size = 4096);
+
+      // Functionality:
+      //    unmap the backing file.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None.
+
+   void close();
+
+      // Functionality:
+      //    find the record for a peer.
+      // Parameters:
+      //    0) [in/out] data: storage for the retrieved item; initially it must carry the key information
+      // Returned value:
+      //    0 if found a record that has not expired, otherwise -1.
+
+   int lookup(CInfoBlock* data);
+
+      // Functionality:
+      //    write a record through to the file; the oldest record in the probe window may be replaced.
+      // Parameters:
+      //    0) [in] data: the new item to be updated/inserted.
+      // Returned value:
+      //    0 if success, otherwise -1.
+
+   int update(CInfoBlock* data);
+
+private:
+   struct CRecord
+   {
+      uint32_t m_piIP[4];
+      int32_t m_iIPversion;
+      int32_t m_iRTT;
+      int32_t m_iBandwidth;
+      int32_t m_iMinRTT;
+      uint64_t m_ullTimeStamp;
+      double m_dPccRate;
+   };
+
+   struct CHeader
+   {
+      uint32_t m_iMagic;
+      uint32_t m_iVersion;
+      uint32_t m_iSize;
+      uint32_t m_iReserved;
+   };
+
+   static bool match(const CRecord& r, const CInfoBlock& data);
+
+   int m_iFD;				// backing file, kept open for flock(); -1 if not opened
+   char* m_pMap;			// mapped file, NULL if not opened
+   size_t m_iMapSize;			// size of the mapping, in bytes
+   CHeader* m_pHeader;
+   CRecord* m_pSlots;
+
+   pthread_mutex_t m_Lock;
+
+   static const uint32_t m_iMagic;
+   static const uint32_t m_iFileVersion;
+   static const int m_iProbeLen;		// number of slots searched for a key
+   static const uint64_t m_ullMaxAge;	// records older than this (microseconds) are ignored
+
+private:
+   CInfoStore(const CInfoStore&);
+   CInfoStore& operator=(const CInfoStore&);
+};
+
 
 #endif
@@ -55,8 +55,14 @@ written by
 #endif
 
 #include <cmath>
+#ifndef WIN32
+#include <fcntl.h>
+#endif
 #include "md5.h"
 #include "common.h"
+#ifndef WIN32
+#include "emulator.h"
+#endif
 
 uint64_t CTimer::s_ullCPUFrequency = CTimer::readCPUFrequency();
 #ifndef WIN32
@@ -94,6 +100,16 @@ CTimer::~CTimer()
 
 void CTimer::rdtsc(uint64_t &x)
 {
+#ifndef WIN32
+	// on the emulator's virtual clock, CCs are its microseconds at the measured frequency
+	CEmuClock* clock = CEmuClock::instance();
+	if (NULL != clock)
+	{
+		x = clock->now() * s_ullCPUFrequency;
+		return;
+	}
+#endif
+
 #ifdef WIN32
 	//HANDLE hCurThread = ::GetCurrentThread();
 	//DWORD_PTR dwOldMask = ::SetThreadAffinityMask(hCurThread, 1);
@@ -172,6 +188,20 @@ void CTimer::sleepto(const uint64_t& nexttime)
 	uint64_t t;
 	rdtsc(t);
 
+#ifndef WIN32
+	if (NULL != CEmuClock::instance())
+	{
+		// busy waiting would stop the virtual clock; wait for the time to come or for tick()
+		CGuard tickguard(m_TickLock);
+		while (t < m_ullSchedTime)
+		{
+			CEmuClock::timedwait(&m_TickCond, &m_TickLock, (m_ullSchedTime + s_ullCPUFrequency - 1) / s_ullCPUFrequency);
+			rdtsc(t);
+		}
+		return;
+	}
+#endif
+
 	while (t < m_ullSchedTime)
 	{
 #ifndef NO_BUSY_WAITING
@@ -245,6 +275,14 @@ void CTimer::interrupt()
 void CTimer::tick()
 {
 #ifndef WIN32
+	if (NULL != CEmuClock::instance())
+	{
+		// under the lock, so a sleepto() about to wait cannot miss it
+		CGuard tickguard(m_TickLock);
+		CEmuClock::signal(&m_TickCond);
+		return;
+	}
+
 	pthread_cond_signal(&m_TickCond);
 #else
 	SetEvent(m_TickCond);
@@ -259,6 +297,10 @@ uint64_t CTimer::getTime()
 	//return x / s_ullCPUFrequency;
 
 #ifndef WIN32
+	CEmuClock* clock = CEmuClock::instance();
+	if (NULL != clock)
+		return clock->now();
+
 	timeval t;
 	gettimeofday(&t, 0);
 	return t.tv_sec * 1000000ULL + t.tv_usec;
@@ -284,7 +326,7 @@ uint64_t CTimer::getTime()
 void CTimer::triggerEvent()
 {
 #ifndef WIN32
-	pthread_cond_signal(&m_EventCond);
+	CEmuClock::signal(&m_EventCond);
 #else
 	SetEvent(m_EventCond);
 #endif
@@ -293,21 +335,8 @@ void CTimer::triggerEvent()
 void CTimer::waitForEvent()
 {
 #ifndef WIN32
-	timeval now;
-	timespec timeout;
-	gettimeofday(&now, 0);
-	if (now.tv_usec < 990000)
-	{
-		timeout.tv_sec = now.tv_sec;
-		timeout.tv_nsec = (now.tv_usec + 10000) * 1000;
-	}
-	else
-	{
-		timeout.tv_sec = now.tv_sec + 1;
-		timeout.tv_nsec = (now.tv_usec + 10000 - 1000000) * 1000;
-	}
 	pthread_mutex_lock(&m_EventLock);
-	pthread_cond_timedwait(&m_EventCond, &m_EventLock, &timeout);
+	CEmuClock::timedwait(&m_EventCond, &m_EventLock, getTime() + 10000);
 	pthread_mutex_unlock(&m_EventLock);
 #else
 	WaitForSingleObject(m_EventCond, 1);
@@ -317,7 +346,7 @@ void CTimer::waitForEvent()
 void CTimer::sleep()
 {
 #ifndef WIN32
-	usleep(10);
+	CEmuClock::sleepto(getTime() + 10);
 #else
 	Sleep(1);
 #endif
@@ -771,3 +800,163 @@ void CMD5::compute(const char* input, unsigned char result[16])
 	md5_append(&state, (const md5_byte_t *)input, strlen(input));
 	md5_finish(&state, result);
 }
+
+#define SIPROUND(v0, v1, v2, v3) \
+	do { \
+		v0 += v1; v1 = (v1 << 13) | (v1 >> 51); v1 ^= v0; v0 = (v0 << 32) | (v0 >> 32); \
+		v2 += v3; v3 = (v3 << 16) | (v3 >> 48); v3 ^= v2; \
+		v0 += v3; v3 = (v3 << 21) | (v3 >> 43); v3 ^= v0; \
+		v2 += v1; v1 = (v1 << 17) | (v1 >> 47); v1 ^= v2; v2 = (v2 << 32) | (v2 >> 32); \
+	} while (0)
+
+uint64_t CSipHash::compute(const uint64_t key[2], const void* input, const int& len)
+{
+	uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+	uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+	uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+	uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+
+	const unsigned char* p = (const unsigned char*)input;
+	const unsigned char* end = p + (len & ~7);
+	uint64_t m;
+
+	for (; p != end; p += 8)
+	{
+		memcpy(&m, p, 8);
+		v3 ^= m;
+		SIPROUND(v0, v1, v2, v3);
+		SIPROUND(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+
+	// last block: remaining bytes plus the message length in the top byte
+	m = (uint64_t)len << 56;
+	for (int i = (len & 7) - 1; i >= 0; -- i)
+		m |= (uint64_t)p[i] << (8 * i);
+
+	v3 ^= m;
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	v0 ^= m;
+
+	v2 ^= 0xFF;
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef SIPROUND
+
+//
+CCookie::CCookie()
+{
+	// only listeners issue cookies; they call rekey() in listen()
+	m_pullSecret[0] = m_pullSecret[1] = 0;
+}
+
+void CCookie::rekey()
+{
+#ifndef WIN32
+	int fd = open("/dev/urandom", O_RDONLY);
+	if (fd >= 0)
+	{
+		ssize_t res = read(fd, m_pullSecret, sizeof(m_pullSecret));
+		close(fd);
+		if (res == (ssize_t)sizeof(m_pullSecret))
+			return;
+	}
+#endif
+
+	// no entropy device, fall back to the clock and rand()
+	uint64_t tsc;
+	CTimer::rdtsc(tsc);
+	m_pullSecret[0] = (CTimer::getTime() << 32) ^ tsc ^ (uint64_t)rand();
+	m_pullSecret[1] = ((uint64_t)rand() << 32) ^ (uint64_t)rand() ^ (tsc << 17);
+}
+
+int32_t CCookie::compute(const sockaddr* addr, const int& ver, const int64_t& epoch) const
+{
+	// port + address in network byte order; IPv4 leaves the tail zeroed
+	uint32_t data[5];
+	if (AF_INET == ver)
+	{
+		const sockaddr_in* a = (const sockaddr_in*)addr;
+		data[0] = a->sin_port;
+		data[1] = a->sin_addr.s_addr;
+		data[2] = data[3] = data[4] = 0;
+	}
+	else
+	{
+		const sockaddr_in6* a = (const sockaddr_in6*)addr;
+		data[0] = a->sin6_port;
+		memcpy(data + 1, a->sin6_addr.s6_addr, 16);
+	}
+
+	// the secret rotates with the epoch, so an old cookie cannot be replayed later
+	uint64_t key[2];
+	key[0] = m_pullSecret[0] ^ (uint64_t)epoch;
+	key[1] = m_pullSecret[1];
+
+	return (int32_t)CSipHash::compute(key, data, sizeof(data));
+}
+
+//
+CHistogram::CHistogram()
+{
+	for (int i = 0; i < m_iSize; ++ i)
+		m_piCount[i] = 0;
+}
+
+void CHistogram::record(const uint64_t& value)
+{
+	int i;
+	if (value < (1ULL << m_iSubBits))
+		i = (int)value;
+	else if (value >= (1ULL << m_iMaxBits))
+		i = m_iSize - 1;
+	else
+	{
+		// the top m_iSubBits + 1 bits of the value, and its power of two
+#ifndef WIN32
+		int e = 63 - __builtin_clzll(value);
+#else
+		int e = m_iSubBits;
+		while (value >> (e + 1))
+			++ e;
+#endif
+		i = ((e - m_iSubBits + 1) << m_iSubBits) + (int)((value >> (e - m_iSubBits)) & ((1 << m_iSubBits) - 1));
+	}
+	m_piCount[i] = m_piCount[i] + 1;
+}
+
+uint64_t CHistogram::percentile(const double& q, const CHistogram* base) const
+{
+	uint64_t total = 0;
+	for (int i = 0; i < m_iSize; ++ i)
+		total += m_piCount[i] - ((NULL == base) ? 0 : base->m_piCount[i]);
+	if (0 == total)
+		return 0;
+
+	uint64_t rank = (uint64_t)(q * total);
+	if (rank >= total)
+		rank = total - 1;
+
+	uint64_t seen = 0;
+	int i = 0;
+	for (; i < m_iSize - 1; ++ i)
+	{
+		seen += m_piCount[i] - ((NULL == base) ? 0 : base->m_piCount[i]);
+		if (seen > rank)
+			break;
+	}
+
+	if (i < (1 << m_iSubBits))
+		return i;
+
+	int e = (i >> m_iSubBits) + m_iSubBits - 1;
+	uint64_t low = ((uint64_t)((1 << m_iSubBits) + (i & ((1 << m_iSubBits) - 1)))) << (e - m_iSubBits);
+	return low + (1ULL << (e - m_iSubBits)) / 2;
+}
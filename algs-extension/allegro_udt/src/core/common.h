@@ -312,5 +312,99 @@ struct CMD5
    static void compute(const char* input, unsigned char result[16]);
 };
 
+////////////////////////////////////////////////////////////////////////////////
+
+struct CSipHash
+{
+      // Functionality:
+      //    SipHash-2-4 keyed hash of a memory block.
+      // Parameters:
+      //    0) [in] key: 128-bit secret key.
+      //    1) [in] input: data to be hashed.
+      //    2) [in] len: size of "input", in bytes.
+      // Returned value:
+      //    64-bit hash value.
+
+   static uint64_t compute(const uint64_t key[2], const void* input, const int& len);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Stateless handshake cookie: a keyed hash of the binary peer address and a
+// time epoch. It does no string formatting and no heap allocation, so it can be
+// checked on every handshake in the receive worker.
+class CCookie
+{
+public:
+   CCookie();
+
+public:
+      // Functionality:
+      //    replace the secret with a new random one; cookies issued before are invalidated.
+      //    The secret is all zero until this is called.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None.
+
+   void rekey();
+
+      // Functionality:
+      //    compute the cookie of a peer for a given epoch.
+      // Parameters:
+      //    0) [in] addr: peer address.
+      //    1) [in] ver: IP version.
+      //    2) [in] epoch: time epoch; the key is rotated with it.
+      // Returned value:
+      //    The cookie.
+
+   int32_t compute(const sockaddr* addr, const int& ver, const int64_t& epoch) const;
+
+private:
+   uint64_t m_pullSecret[2];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Counts of non-negative values in buckets of constant relative width: values
+// below 16 exactly, then 16 buckets for each power of two, so a percentile is
+// within 1/16 of the true value. Values from 2^36 up share the last bucket.
+// Recording is an index computation and an increment. One thread records;
+// others may read or copy the histogram meanwhile without locking it, and see
+// each count either before or after an increment.
+class CHistogram
+{
+public:
+   CHistogram();
+
+public:
+      // Functionality:
+      //    count a value.
+      // Parameters:
+      //    0) [in] value: the value.
+      // Returned value:
+      //    None.
+
+   void record(const uint64_t& value);
+
+      // Functionality:
+      //    the value below which a fraction of the counts fall.
+      // Parameters:
+      //    0) [in] q: the fraction, 0 to 1.
+      //    1) [in] base: a copy taken earlier; only counts added since then are used. NULL for all counts.
+      // Returned value:
+      //    The middle of the bucket of the percentile, 0 if there are no counts.
+
+   uint64_t percentile(const double& q, const CHistogram* base = NULL) const;
+
+public:
+   static const int m_iSubBits = 4;
+   static const int m_iMaxBits = 36;
+   static const int m_iSize = (m_iMaxBits - m_iSubBits + 1) << m_iSubBits;
+
+private:
+   volatile uint32_t m_piCount[m_iSize];     // written by the recording thread only
+};
+
 
 #endif
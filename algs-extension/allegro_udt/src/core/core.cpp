@@ -38,7 +38,6 @@ written by
    Yunhong Gu, last updated 05/07/2011
  *****************************************************************************/
 
-//#define DEBUG_CORE_SENDING_RATE
 
 #ifndef WIN32
 #include <assert.h>
@@ -64,6 +63,9 @@ written by
 #include <iostream>
 #include "queue.h"
 #include "core.h"
+#include "eventtrace.h"
+#include "pccrecord.h"
+#include "emulator.h"
 #include <unordered_map>
 #include <map>
 #include <mutex>
@@ -71,15 +73,18 @@ written by
 //#define DEBUG_SEND_SEQ_AND_ID
 //#define DEBUG_LOSS
 
-namespace std {
-    int operator==(const struct timespec& ts1, const struct timespec& ts2) {
-            return ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec == ts2.tv_nsec;
-    }
+int operator==(const struct timespec& ts1, const struct timespec& ts2) {
+        return ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec == ts2.tv_nsec;
 }
 using namespace std;
 
 std::mutex pcc_sender_lock;
 
+// PccSender(initial RTT in microseconds, initial and maximum window in packets)
+static const QuicTime s_llPccInitialRtt = 10000;
+static const QuicPacketCount s_iPccInitialCwnd = 10;
+static const QuicPacketCount s_iPccMaxCwnd = 10;
+
 CUDTUnited CUDT::s_UDTUnited;
 
 const UDTSOCKET CUDT::INVALID_SOCK = -1;
@@ -97,6 +102,8 @@ const int32_t CMsgNo::m_iMaxMsgNo = 0x1FFFFFFF;
 const int CUDT::m_iVersion = 4;
 const int CUDT::m_iSYNInterval = 1000000;
 const int CUDT::m_iSelfClockInterval = 64;
+const double CUDT::m_dMaxWarmRate = 1e11;
+const int CUDT::m_iMaxWarmRTT = 10000000;
 
 
 CUDT::CUDT()
@@ -138,13 +145,16 @@ CUDT::CUDT()
 	m_bReuseAddr = true;
 	lossptr=0;
 	m_llMaxBW = -1;
+	m_llFixedBW = -1;
 	m_llLastReqTime = CTimer::getTime();
 
 	m_pCCFactory = new CCCFactory<CUDTCC>;
 	m_pCC = m_pCCFactory->create();
 	m_pCache = NULL;
+	m_pCacheStore = NULL;
 
-    pcc_sender = new PccSender(10000, 10, 10);
+    pcc_sender = new PccSender(s_llPccInitialRtt, s_iPccInitialCwnd, s_iPccMaxCwnd);
+    m_pPccRecorder = NULL;
 	packet_tracker_ = new PacketTracker<int32_t, PacketId>(&m_SendBlockCond);
 
 	// Initial status
@@ -198,16 +208,19 @@ CUDT::CUDT(const CUDT& ancestor)
 	m_iRcvTimeOut = ancestor.m_iRcvTimeOut;
 	m_bReuseAddr = true;	// this must be true, because all accepted sockets shared the same port with the listener
 	m_llMaxBW = ancestor.m_llMaxBW;
+	m_llFixedBW = ancestor.m_llFixedBW;
 	m_llLastReqTime = CTimer::getTime();
 
 	m_pCCFactory = ancestor.m_pCCFactory->clone();
 	m_pCache = ancestor.m_pCache;
+	m_pCacheStore = ancestor.m_pCacheStore;
     if (m_pCC != NULL) {
         delete m_pCC;
     }
 	m_pCC = m_pCCFactory->create();
 
-    pcc_sender = new PccSender(10000, 10, 10);
+    pcc_sender = new PccSender(s_llPccInitialRtt, s_iPccInitialCwnd, s_iPccMaxCwnd);
+    m_pPccRecorder = NULL;
 	packet_tracker_ = new PacketTracker<int32_t, PacketId>(&m_SendBlockCond);
 
 	// Initial status
@@ -245,6 +258,7 @@ CUDT::~CUDT()
 	delete m_pSNode;
 	delete m_pRNode;
     delete pcc_sender;
+    delete m_pPccRecorder;
     delete packet_tracker_;
 }
 
@@ -390,6 +404,12 @@ void CUDT::setOpt(UDTOpt optName, const void* optval, const int&)
 		m_llMaxBW = *(int64_t*)optval;
 		break;
 
+	case UDT_FIXEDBW:
+		if (m_bConnecting || m_bConnected)
+			throw CUDTException(5, 1, 0);
+		m_llFixedBW = *(int64_t*)optval;
+		break;
+
 	default:
 		throw CUDTException(5, 0, 0);
 	}
@@ -482,6 +502,11 @@ void CUDT::getOpt(UDTOpt optName, void* optval, int& optlen)
 		optlen = sizeof(int64_t);
 		break;
 
+	case UDT_FIXEDBW:
+		*(int64_t*)optval = m_llFixedBW;
+		optlen = sizeof(int64_t);
+		break;
+
 	case UDT_STATE:
 		*(int32_t*)optval = s_UDTUnited.getStatus(m_SocketID);
 		optlen = sizeof(int32_t);
@@ -546,6 +571,17 @@ void CUDT::open()
 	m_LastSampleTime = CTimer::getTime();
 	m_llTraceSent = m_llTraceRecv = m_iTraceSndLoss = m_iTraceRcvLoss = m_iTraceRetrans = m_iSentACK = m_iRecvACK = m_iSentNAK = m_iRecvNAK = 0;
 	m_llSndDuration = m_llSndDurationTotal = 0;
+	m_llPccLockWait = m_llPccLockWaitBase = 0;
+	m_iPccLockContended = m_iPccLockContendedBase = 0;
+	m_llSndQueueLag = 0;
+	pcc_sender->set_trace_id(m_SocketID);
+	if (CPccRecorder::enabled() && (NULL == m_pPccRecorder))
+	{
+		// a seed of our own, written in the recording, makes the replay take the same random choices
+		uint32_t seed = rand();
+		pcc_sender->set_random_seed(seed);
+		m_pPccRecorder = new CPccRecorder(m_SocketID, seed, s_llPccInitialRtt, s_iPccInitialCwnd, s_iPccMaxCwnd);
+	}
 
 	// structures for queue
 	if (NULL == m_pSNode)
@@ -562,6 +598,7 @@ void CUDT::open()
 	m_pRNode->m_bOnList = false;
 
 	m_iRTT = 10 * m_iSYNInterval;
+	m_iMinRTT = 0;
 	last_rtt_ = 10 * m_iSYNInterval;
 	//for (int i = 0; i < MAX_MONITOR; i++) m_last_rtt[i] = 5 * m_iSYNInterval;
 	m_iRTTVar = m_iRTT / 2.0;
@@ -607,6 +644,9 @@ void CUDT::listen()
 	if (m_bListening)
 		return;
 
+	// fresh cookie secret for each listener
+	m_Cookie.rekey();
+
 	// if there is already another socket listening on the same port
 	if (m_pRcvQueue->setListener(this) < 0)
 		throw CUDTException(5, 11, 0);
@@ -821,14 +861,7 @@ int CUDT::connect(const CPacket& response) throw ()
 		throw CUDTException(3, 2, 0);
 	}
 
-	CInfoBlock ib;
-	ib.m_iIPversion = m_iIPversion;
-	CInfoBlock::convert(m_pPeerAddr, m_iIPversion, ib.m_piIP);
-	if (m_pCache->lookup(&ib) >= 0)
-	{
-		m_iRTT = ib.m_iRTT;
-		m_iBandwidth = ib.m_iBandwidth;
-	}
+	loadPathInfo(m_pPeerAddr);
 
 	m_pCC = m_pCCFactory->create();
     m_pCC->m_UDT = m_SocketID;
@@ -923,14 +956,7 @@ void CUDT::connect(const sockaddr* peer, CHandShake* hs)
 		throw CUDTException(3, 2, 0);
 	}
 
-	CInfoBlock ib;
-	ib.m_iIPversion = m_iIPversion;
-	CInfoBlock::convert(peer, m_iIPversion, ib.m_piIP);
-	if (m_pCache->lookup(&ib) >= 0)
-	{
-		m_iRTT = ib.m_iRTT;
-		m_iBandwidth = ib.m_iBandwidth;
-	}
+	loadPathInfo(peer);
 
 	m_pCC = m_pCCFactory->create();
 	m_pCC->m_UDT = m_SocketID;
@@ -991,10 +1017,7 @@ void CUDT::close()
 			}
 
 #ifndef WIN32
-			timespec ts;
-			ts.tv_sec = 0;
-			ts.tv_nsec = 1000000;
-			nanosleep(&ts, NULL);
+			CEmuClock::sleepto(CTimer::getTime() + 1000);
 #else
 			Sleep(1);
 #endif
@@ -1046,9 +1069,21 @@ void CUDT::close()
 		CInfoBlock ib;
 		ib.m_iIPversion = m_iIPversion;
 		CInfoBlock::convert(m_pPeerAddr, m_iIPversion, ib.m_piIP);
+		// keep the previous PCC state if this connection never left STARTING
+		m_pCache->lookup(&ib);
 		ib.m_iRTT = m_iRTT;
 		ib.m_iBandwidth = m_iBandwidth;
+		lockPccSender();
+		QuicBandwidth rate = pcc_sender->ConvergedRate();
+		pcc_sender_lock.unlock();
+		if ((rate > 0) && (m_iMinRTT > 0))
+		{
+			ib.m_dPccRate = rate;
+			ib.m_iMinRTT = m_iMinRTT;
+		}
 		m_pCache->update(&ib);
+		if (NULL != m_pCacheStore)
+			m_pCacheStore->update(&ib);
 
 		m_bConnected = false;
 	}
@@ -1061,6 +1096,37 @@ void CUDT::close()
 	m_bOpened = false;
 }
 
+void CUDT::loadPathInfo(const sockaddr* peer)
+{
+	CInfoBlock ib;
+	ib.m_iIPversion = m_iIPversion;
+	CInfoBlock::convert(peer, m_iIPversion, ib.m_piIP);
+	if (m_pCache->lookup(&ib) < 0)
+	{
+		// not seen by this process yet, try the records of earlier runs
+		if ((NULL == m_pCacheStore) || (m_pCacheStore->lookup(&ib) < 0))
+			return;
+		if ((ib.m_iRTT <= 0) || (ib.m_iRTT > m_iMaxWarmRTT))
+			return;
+		m_pCache->update(&ib);
+	}
+
+	m_iRTT = ib.m_iRTT;
+	m_iBandwidth = ib.m_iBandwidth;
+
+	// start PCC from the rate it converged to last time instead of doubling up from scratch;
+	// the record may come from a file other processes write, so only sane values are taken
+	if (std::isfinite(ib.m_dPccRate) && (ib.m_dPccRate > 0) && (ib.m_dPccRate <= m_dMaxWarmRate)
+		&& (ib.m_iMinRTT > 0) && (ib.m_iMinRTT <= m_iMaxWarmRTT))
+	{
+		lockPccSender();
+		pcc_sender->WarmStart(ib.m_dPccRate, ib.m_iMinRTT);
+		if (NULL != m_pPccRecorder)
+			m_pPccRecorder->warmStart(ib.m_dPccRate, ib.m_iMinRTT, pcc_sender->PacingRate(0));
+		pcc_sender_lock.unlock();
+	}
+}
+
 int32_t CUDT::GetNextSeqNo() {
     m_iSndCurrSeqNo = CSeqNo::incseq(m_iSndCurrSeqNo);
     return m_iSndCurrSeqNo;
@@ -1093,18 +1159,14 @@ int CUDT::send(const char* data, const int& len)
 			if (m_iSndTimeOut < 0)
 			{
 				while (!m_bBroken && m_bConnected && !m_bClosing && !packet_tracker_->CanEnqueuePacket() && m_bPeerHealth)
-					pthread_cond_wait(&m_SendBlockCond, &m_SendBlockLock);
+					CEmuClock::wait(&m_SendBlockCond, &m_SendBlockLock);
 			}
 			else
 			{
 				uint64_t exptime = CTimer::getTime() + m_iSndTimeOut * 1000ULL;
-				timespec locktime;
-
-				locktime.tv_sec = exptime / 1000000;
-				locktime.tv_nsec = (exptime % 1000000) * 1000;
 
 				while (!m_bBroken && m_bConnected && !m_bClosing && (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize()) && m_bPeerHealth && (CTimer::getTime() < exptime))
-					pthread_cond_timedwait(&m_SendBlockCond, &m_SendBlockLock, &locktime);
+					CEmuClock::timedwait(&m_SendBlockCond, &m_SendBlockLock, exptime);
 			}
 			pthread_mutex_unlock(&m_SendBlockLock);
 #else
@@ -1209,19 +1271,15 @@ int CUDT::recv(char* data, const int& len)
 			if (m_iRcvTimeOut < 0)
 			{
 				while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
-					pthread_cond_wait(&m_RecvDataCond, &m_RecvDataLock);
+					CEmuClock::wait(&m_RecvDataCond, &m_RecvDataLock);
 			}
 			else
 			{
 				uint64_t exptime = CTimer::getTime() + m_iRcvTimeOut * 1000ULL;
-				timespec locktime;
-
-				locktime.tv_sec = exptime / 1000000;
-				locktime.tv_nsec = (exptime % 1000000) * 1000;
 
 				while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
 				{
-					pthread_cond_timedwait(&m_RecvDataCond, &m_RecvDataLock, &locktime);
+					CEmuClock::timedwait(&m_RecvDataCond, &m_RecvDataLock, exptime);
 					if (CTimer::getTime() >= exptime)
 						break;
 				}
@@ -1306,12 +1364,34 @@ void CUDT::sample(CPerfMon* perf, bool clear)
 	perf->mbpsSendRate = double(m_llTraceSent) * m_iPayloadSize * 8.0 / interval;
 	perf->mbpsRecvRate = double(m_llTraceRecv) * m_iPayloadSize * 8.0 / interval;
 
+	// the data path fills these without taking the socket locks, and they are
+	// read the same way, so sampling never holds up sending
+	CHistogram pacing = m_PacingError;
+	perf->usPacingErrorP50 = pacing.percentile(0.5, &m_PacingErrorBase) / 1000.0;
+	perf->usPacingErrorP90 = pacing.percentile(0.9, &m_PacingErrorBase) / 1000.0;
+	perf->usPacingErrorP99 = pacing.percentile(0.99, &m_PacingErrorBase) / 1000.0;
+	perf->usPacingErrorP999 = pacing.percentile(0.999, &m_PacingErrorBase) / 1000.0;
+	perf->usPacingErrorMax = pacing.percentile(1.0, &m_PacingErrorBase) / 1000.0;
+
+	int64_t lockwait = m_llPccLockWait.load(std::memory_order_relaxed);
+	int contended = m_iPccLockContended.load(std::memory_order_relaxed);
+	perf->usPccLockWait = double(lockwait - m_llPccLockWaitBase) / m_ullCPUFrequency;
+	perf->pktPccLockContended = contended - m_iPccLockContendedBase;
+
 	perf->usPktSndPeriod = GetSendingInterval();
 	perf->pktFlowWindow = m_iFlowWindowSize;
 	perf->pktCongestionWindow = (int)m_dCongestionWindow;
 	perf->pktFlightSize = CSeqNo::seqlen(const_cast<int32_t&>(m_iSndLastAck), CSeqNo::incseq(m_iSndCurrSeqNo)) - 1;
 	perf->msRTT = m_iRTT/1000.0;
 	perf->mbpsBandwidth = m_iBandwidth * m_iPayloadSize * 8.0 / 1000000.0;
+	perf->usSndQueueLag = double(m_llSndQueueLag) / m_ullCPUFrequency;
+	perf->pktTrackerOccupancy = packet_tracker_->NumPackets();
+
+	PccSender::Snapshot pcc = pcc_sender->GetSnapshot();
+	perf->pccMode = pcc.mode;
+	perf->mbpsPccRate = pcc.sending_rate / 1000000.0;
+	perf->pccUtility = pcc.last_utility;
+	perf->pccIntervals = (int)pcc.num_intervals;
 
 #ifndef WIN32
 	if (0 == pthread_mutex_trylock(&m_ConnectionLock))
@@ -1338,6 +1418,9 @@ void CUDT::sample(CPerfMon* perf, bool clear)
 	{
 		m_llTraceSent = m_llTraceRecv = m_iTraceSndLoss = m_iTraceRcvLoss = m_iTraceRetrans = m_iSentACK = m_iRecvACK = m_iSentNAK = m_iRecvNAK = 0;
 		m_llSndDuration = 0;
+		m_PacingErrorBase = pacing;
+		m_llPccLockWaitBase = lockwait;
+		m_iPccLockContendedBase = contended;
 		m_LastSampleTime = currtime;
 	}
 }
@@ -1395,14 +1478,14 @@ void CUDT::releaseSynch()
 #ifndef WIN32
 	// wake up user calls
 	pthread_mutex_lock(&m_SendBlockLock);
-	pthread_cond_signal(&m_SendBlockCond);
+	CEmuClock::signal(&m_SendBlockCond);
 	pthread_mutex_unlock(&m_SendBlockLock);
 
 	pthread_mutex_lock(&m_SendLock);
 	pthread_mutex_unlock(&m_SendLock);
 
 	pthread_mutex_lock(&m_RecvDataLock);
-	pthread_cond_signal(&m_RecvDataCond);
+	CEmuClock::signal(&m_RecvDataCond);
 	pthread_mutex_unlock(&m_RecvDataLock);
 
 	pthread_mutex_lock(&m_RecvLock);
@@ -1510,12 +1593,25 @@ void CUDT::sendCtrl(const int& pkttype, void* lparam, void* rparam, const int& s
 	}
 }
 
+void CUDT::lockPccSender()
+{
+    if (pcc_sender_lock.try_lock())
+        return;
+
+    uint64_t start, end;
+    CTimer::rdtsc(start);
+    pcc_sender_lock.lock();
+    CTimer::rdtsc(end);
+    m_llPccLockWait.fetch_add(end - start, std::memory_order_relaxed);
+    m_iPccLockContended.fetch_add(1, std::memory_order_relaxed);
+}
+
 void CUDT::add_to_loss_record(int32_t loss1, int32_t loss2){
 //TODO: loss record does not have lock, this might cause problem
 
     AckedPacketVector acked_packets;
     LostPacketVector lost_packets;
-    pcc_sender_lock.lock();
+    lockPccSender();
     for (int loss = loss1; loss <= loss2; ++loss) {
         int32_t msg_no = packet_tracker_->GetPacketLastMsgNo(loss);
         PacketId pkt_id = packet_tracker_->GetPacketId(loss, msg_no);
@@ -1525,10 +1621,14 @@ void CUDT::add_to_loss_record(int32_t loss1, int32_t loss2){
         loss_event.bytes_lost = packet_tracker_->GetPacketSize(loss);
         loss_event.time = CTimer::getTime();
         lost_packets.push_back(loss_event);
+        CEventTrace::trace(CEventRecord::LOSS, m_SocketID, loss, msg_no, loss_event.bytes_lost);
         packet_tracker_->OnPacketLoss(loss, msg_no);
         ++m_iSndLossTotal;
     }
-    pcc_sender->OnCongestionEvent(true, 0, CTimer::getTime(), 0, acked_packets, lost_packets);
+    uint64_t now = CTimer::getTime();
+    pcc_sender->OnCongestionEvent(true, 0, now, 0, acked_packets, lost_packets);
+    if (NULL != m_pPccRecorder)
+        m_pPccRecorder->congestion(true, 0, now, 0, acked_packets, lost_packets, pcc_sender->PacingRate(0));
     pcc_sender_lock.unlock();
 		
 #ifdef EXPERIMENTAL_FEATURE_CONTINOUS_SEND
@@ -1543,15 +1643,19 @@ void CUDT::ProcessAck(CPacket& ctrlpkt) {
     int32_t seq_no = *(int32_t*)ctrlpkt.m_pcData;
     int32_t msg_no = ctrlpkt.m_iMsgNo;
     
-    pcc_sender_lock.lock();
+    lockPccSender();
     int32_t latest_msg_no = packet_tracker_->GetPacketLastMsgNo(seq_no);
     PacketId pkt_id = packet_tracker_->GetPacketId(seq_no, msg_no);
     PacketState old_state = packet_tracker_->GetPacketState(seq_no);
     packet_tracker_->OnPacketAck(seq_no, msg_no);
     uint64_t rtt_us = packet_tracker_->GetPacketRtt(seq_no, msg_no);
+    if (rtt_us > 0 && (m_iMinRTT == 0 || rtt_us < (uint64_t)m_iMinRTT)) {
+        m_iMinRTT = rtt_us;
+    }
     m_iRTT = (7.0 * m_iRTT + (double)rtt_us) / 8.0;
     m_iRTTVar = (m_iRTTVar * 7.0 + abs((double)rtt_us - m_iRTT) * 1.0) / 8.0;
     int32_t size = packet_tracker_->GetPacketSize(seq_no);
+    CEventTrace::trace(CEventRecord::ACK, m_SocketID, seq_no, msg_no, (double)rtt_us);
 
     if (msg_no != latest_msg_no) {
         pcc_sender_lock.unlock();
@@ -1577,7 +1681,10 @@ void CUDT::ProcessAck(CPacket& ctrlpkt) {
     ack_event.bytes_acked = size;
     ack_event.bytes_lost = 0;
     acked_packets.push_back(ack_event);
-    pcc_sender->OnCongestionEvent(true, 0, CTimer::getTime(), rtt_us, acked_packets, lost_packets);
+    uint64_t now = CTimer::getTime();
+    pcc_sender->OnCongestionEvent(true, 0, now, rtt_us, acked_packets, lost_packets);
+    if (NULL != m_pPccRecorder)
+        m_pPccRecorder->congestion(true, 0, now, rtt_us, acked_packets, lost_packets, pcc_sender->PacingRate(0));
     pcc_sender_lock.unlock();
     ++m_iRecvACK;
     ++m_iRecvACKTotal;
@@ -1707,17 +1814,14 @@ uint64_t CUDT::GetSendingInterval() {
      * frequency         * m_iMSS * 8      *  1 / sending_rate (in bits/second)
      */
 
-#ifdef DEBUG_CORE_SENDING_RATE
-    static double prev_rate = 0;
-    if (pcc_sender->PacingRate(0) != prev_rate) {
-        std::cerr << "Sending rate changed to " << pcc_sender->PacingRate(0) / 1000000.0f << "mbps" << std::endl;
-        std::cerr << "New clock cycle interval is " << 
-            m_ullCPUFrequency * m_iMSS * 8.0f * 1000000.0f / pcc_sender->PacingRate(0)
-            << std::endl;
-        prev_rate = pcc_sender->PacingRate(0);
-    }
-#endif
-    return m_ullCPUFrequency * m_iMSS * 8.0f * 1000000.0f / pcc_sender->PacingRate(0);
+    double rate = pcc_sender->PacingRate(0);
+
+    // UDT_FIXEDBW, in bytes per second, replaces the rate PCC chooses; PCC
+    // still sees every packet and ACK. UDT_MAXBW only reaches the CCC.
+    if (m_llFixedBW > 0)
+        rate = m_llFixedBW * 8.0;
+
+    return m_ullCPUFrequency * m_iMSS * 8.0f * 1000000.0f / rate;
 }
 
 int CUDT::packData(CPacket& packet, uint64_t& ts)
@@ -1728,18 +1832,22 @@ int CUDT::packData(CPacket& packet, uint64_t& ts)
 
     if (m_ullTargetTime != 0) {
         m_ullTimeDiff += (int64_t)entertime - m_ullTargetTime;
+        if ((int64_t)entertime > m_ullTargetTime)
+            m_PacingError.record(((int64_t)entertime - m_ullTargetTime) * 1000 / m_ullCPUFrequency);
+        else
+            m_PacingError.record(0);
     }
 
-    pcc_sender_lock.lock();
+    lockPccSender();
     int32_t seq_no;
-    if (packet_tracker_->HasRetransmittablePackets()) {
+    bool retransmission = packet_tracker_->HasRetransmittablePackets();
+    if (retransmission) {
         seq_no = packet_tracker_->GetLowestRetransmittableSeqNo();
         ++m_iTraceRetrans;
 		++m_iRetransTotal;
     } else if (packet_tracker_->HasSendablePackets()) {
         seq_no = packet_tracker_->GetLowestSendableSeqNo();
     } else {
-        std::cout << "no transmittable packets" << std::endl;
         pcc_sender_lock.unlock();
         return 0;
     }
@@ -1752,8 +1860,12 @@ int CUDT::packData(CPacket& packet, uint64_t& ts)
     packet.m_iMsgNo = msg_no + 1;
     packet_tracker_->OnPacketSent(packet);
     PacketId pkt_id = packet_tracker_->GetPacketId(seq_no, packet.m_iMsgNo);
-    pcc_sender->OnPacketSent(CTimer::getTime(), 0, pkt_id, payload, false);
+    uint64_t now = CTimer::getTime();
+    pcc_sender->OnPacketSent(now, 0, pkt_id, payload, false);
+    if (NULL != m_pPccRecorder)
+        m_pPccRecorder->sent(now, 0, pkt_id, payload, false, pcc_sender->PacingRate(0));
     pcc_sender_lock.unlock();
+    CEventTrace::trace(CEventRecord::SENT, m_SocketID, seq_no, packet.m_iMsgNo, payload, retransmission);
 
 	packet.m_iTimeStamp = int(CTimer::getTime() - m_StartTime);
 	packet.m_iID = m_PeerID;
@@ -1770,6 +1882,7 @@ int CUDT::packData(CPacket& packet, uint64_t& ts)
         ts = entertime + interval - m_ullTimeDiff;
         m_ullTimeDiff = 0;
     }
+    m_llSndQueueLag = m_ullTimeDiff;
 	m_ullTargetTime = ts;
     TotalBytes += payload;
 	return payload;
@@ -1821,18 +1934,11 @@ int CUDT::listen(sockaddr* addr, CPacket& packet)
 	hs.deserialize(packet.m_pcData, packet.getLength());
 
 	// SYN cookie
-	char clienthost[NI_MAXHOST];
-	char clientport[NI_MAXSERV];
-	getnameinfo(addr, (AF_INET == m_iVersion) ? sizeof(sockaddr_in) : sizeof(sockaddr_in6), clienthost, sizeof(clienthost), clientport, sizeof(clientport), NI_NUMERICHOST|NI_NUMERICSERV);
 	int64_t timestamp = (CTimer::getTime() - m_StartTime) / 60000000; // secret changes every one minute
-	stringstream cookiestr;
-	cookiestr << clienthost << ":" << clientport << ":" << timestamp;
-	unsigned char cookie[16];
-	CMD5::compute(cookiestr.str().c_str(), cookie);
 
 	if (1 == hs.m_iReqType)
 	{
-		hs.m_iCookie = *(int*)cookie;
+		hs.m_iCookie = m_Cookie.compute(addr, m_iIPversion, timestamp);
 		packet.m_iID = hs.m_iID;
 		int size = packet.getLength();
 		hs.serialize(packet.m_pcData, size);
@@ -1841,15 +1947,10 @@ int CUDT::listen(sockaddr* addr, CPacket& packet)
 	}
 	else
 	{
-		if (hs.m_iCookie != *(int*)cookie)
-		{
-			timestamp --;
-			cookiestr << clienthost << ":" << clientport << ":" << timestamp;
-			CMD5::compute(cookiestr.str().c_str(), cookie);
-
-			if (hs.m_iCookie != *(int*)cookie)
-				return -1;
-		}
+		// accept a cookie issued in the current or the previous minute
+		if ((hs.m_iCookie != m_Cookie.compute(addr, m_iIPversion, timestamp))
+			&& (hs.m_iCookie != m_Cookie.compute(addr, m_iIPversion, timestamp - 1)))
+			return -1;
 	}
 
 	int32_t id = hs.m_iID;
@@ -1897,14 +1998,14 @@ void CUDT::checkTimers()
     bool above_loss_threshold = true;
     uint64_t loss_thresh_us = 2.0 * m_iRTT + 4 * m_iRTTVar;
     struct timespec cur_time;
-    clock_gettime(CLOCK_MONOTONIC, &cur_time);
+    GetTrackerTime(&cur_time);
 
     while (packet_tracker_->HasSentPackets() && above_loss_threshold) {
         int32_t seq_no = packet_tracker_->GetOldestSentSeqNo();
         if (packet_tracker_->HasSentPackets()) {
             int32_t msg_no = packet_tracker_->GetPacketLastMsgNo(seq_no);
             struct timespec sent_time = packet_tracker_->GetPacketSentTime(seq_no, msg_no);
-            uint64_t time_since_sent = (cur_time.tv_nsec - sent_time.tv_nsec) / 1000 + (cur_time.tv_sec - sent_time.tv_sec) * 1000000;
+            uint64_t time_since_sent = TimespecDiffUs(sent_time, cur_time);
             if (time_since_sent > loss_thresh_us) {
                 add_to_loss_record(seq_no, seq_no);
             } else {
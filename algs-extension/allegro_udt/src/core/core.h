@@ -57,12 +57,14 @@ written by
 #include "queue.h"
 #include <vector>
 #include <deque>
+#include <atomic>
 #include <mutex>
 #include <thread>
 #include "time.h"
 
 #include "../pcc/pcc_sender.h"
 #include "packet_tracker.h"
+#include "pccrecord.h"
 
 typedef uint64_t PacketId;
 
@@ -308,7 +310,6 @@ private: // monitor
    double start_time[MAX_MONITOR], end_time[MAX_MONITOR], end_transmission_time[MAX_MONITOR];
    // for state, 1=sending, 2= waiting, 3=finished
    int lost[MAX_MONITOR], retransmission[MAX_MONITOR], total[MAX_MONITOR], new_transmission[MAX_MONITOR], left[MAX_MONITOR], state[MAX_MONITOR], left_monitor;//, end_pkt[MAX_MONITOR];
-   int32_t pkt_sending[MAX_MONITOR][8000];
    int32_t latency[MAX_MONITOR];
    vector<int32_t> loss_record1, loss_record2;
    vector<int32_t>::iterator itr_loss_record1, itr_loss_record2;
@@ -316,11 +317,8 @@ private: // monitor
    int32_t latency_time_start[MAX_MONITOR], latency_time_end[MAX_MONITOR];
    int32_t time_interval[MAX_MONITOR];
    int lossptr;
-   bool recv_ack[MAX_MONITOR][30000];
    int64_t latest_received_seq[MAX_MONITOR];
    uint64_t packet_space[MAX_MONITOR];
-   uint64_t send_timestamp[MAX_MONITOR][30000];
-   uint64_t rtt_trace[MAX_MONITOR][30000];
    int rtt_count[MAX_MONITOR];
    uint64_t rtt_value[MAX_MONITOR];
    bool monitor;
@@ -361,13 +359,16 @@ private: // Options
    int m_iRcvTimeOut;                           // receiving timeout in milliseconds
    bool m_bReuseAddr;				// reuse an exiting port or not, for UDP multiplexer
    int64_t m_llMaxBW;				// maximum data transfer rate (threshold)
+   int64_t m_llFixedBW;				// data transfer rate that overrides PCC, if above 0
 
 private: // congestion control
    CCCVirtualFactory* m_pCCFactory;             // Factory class to create a specific CC instance
    CCC* m_pCC;                                  // congestion control class
    PccSender* pcc_sender;
+   CPccRecorder* m_pPccRecorder;		// calls to pcc_sender, if UDT_PCC_RECORD is set
    PacketTracker<int32_t, PacketId>* packet_tracker_;
    CCache<CInfoBlock>* m_pCache;		// network information cache
+   CInfoStore* m_pCacheStore;			// persistent network information cache, may be unmapped
 
 private: // Status
    volatile bool m_bListening;                  // If the UDT entit is listening to connection
@@ -383,6 +384,7 @@ private: // Status
    int m_iEXPCount;                             // Expiration counter
    int m_iBandwidth;                            // Estimated bandwidth, number of packets per second
    double m_iRTT;                                  // RTT, in microseconds
+   int m_iMinRTT;                               // minimum RTT sample, in microseconds, 0 if none yet
    int last_rtt_;
    deque<double> m_last_rtt;
    static const size_t kRTTHistorySize = 100;
@@ -393,6 +395,7 @@ private: // Status
 
    uint64_t m_ullLingerExpiration;		// Linger expiration time (for GC to close a socket with data in sending buffer)
 
+   CCookie m_Cookie;				// secret for stateless handshake cookies
    CHandShake m_ConnReq;			// connection request
    CHandShake m_ConnRes;			// connection response
    int64_t m_llLastReqTime;			// last time when a connection request is sent
@@ -465,6 +468,7 @@ private: // Generation and processing of packets
    int processData(CUnit* unit);
    int listen(sockaddr* addr, CPacket& packet);
    void add_to_loss_record(int32_t loss1, int32_t loss2);
+   void lockPccSender();					// lock pcc_sender_lock, counting the wait
    uint64_t deadlines[MAX_MONITOR];
    uint64_t allocated_times_[MAX_MONITOR];
    int32_t GetNextSeqNo();
@@ -498,12 +502,21 @@ private: // Trace
    int m_iRecvNAK;                              // number of NAKs received in the last trace interval
    int64_t m_llSndDuration;			// real time for sending
    int64_t m_llSndDurationCounter;		// timers to record the sending duration
+   CHistogram m_PacingError;			// lateness of each packet behind its pacing time, in nanoseconds
+   CHistogram m_PacingErrorBase;		// m_PacingError at the start of the trace interval
+   std::atomic<int64_t> m_llPccLockWait;	// CPU cycles spent waiting for pcc_sender_lock
+   std::atomic<int> m_iPccLockContended;	// acquisitions of pcc_sender_lock that had to wait
+   int64_t m_llPccLockWaitBase;		// m_llPccLockWait at the start of the trace interval
+   int m_iPccLockContendedBase;		// m_iPccLockContended at the start of the trace interval
+   volatile int64_t m_llSndQueueLag;		// m_ullTimeDiff after the last packet, written by the sending thread only
 
 private: // Timers
    uint64_t m_ullCPUFrequency;                  // CPU clock frequency, used for Timer, ticks per microsecond
 
    static const int m_iSYNInterval;             // Periodical Rate Control Interval, 10000 microsecond
    static const int m_iSelfClockInterval;       // ACK interval for self-clocking
+   static const double m_dMaxWarmRate;          // highest cached PCC rate a warm start accepts, in bits per second
+   static const int m_iMaxWarmRTT;              // highest cached RTT a warm start accepts, in microseconds
 
    uint64_t m_ullNextACKTime;			// Next ACK time, in CPU clock cycles, same below
    uint64_t m_ullNextNAKTime;			// Next NAK time
@@ -532,6 +545,7 @@ private: // for UDP multiplexer
    CRNode* m_pRNode;                            // node information for UDT list used in rcv queue
 
    void init_state();
+   void loadPathInfo(const sockaddr* peer);
    time_t start_;
 
 private: // for epoll
@@ -0,0 +1,219 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include "common.h"
+#include "emulator.h"
+#include "eventtrace.h"
+
+
+const char CEventTraceHeader::m_pcTraceMagic[8] = "UDTEVTR";
+
+volatile bool CEventTrace::s_bEnabled = false;
+
+// 2 MB of records per thread. Drained every 10 ms, a ring holds the events of
+// a thread that writes up to 6.5 million of them per second.
+static const uint64_t s_ullRingSize = 1 << 16;
+static const int s_iFlushPeriod = 10000;
+
+// The owner thread moves the head and the flusher the tail; each reads the
+// other's index only to learn how far it may go. The padding keeps the two
+// sides off each other's cache line. Rings are never freed, there is one per
+// thread that ever traced an event.
+struct CEventRing
+{
+   std::atomic<uint64_t> m_ullHead;     // next record to write
+   std::atomic<uint64_t> m_ullDropped;  // records not written because the ring was full
+   uint64_t m_ullTailCache;             // the owner's last look at m_ullTail
+   char m_pcPad1[64];
+
+   std::atomic<uint64_t> m_ullTail;     // next record to drain
+   uint64_t m_ullDropReported;          // m_ullDropped when the flusher last reported it
+   char m_pcPad2[64];
+
+   uint16_t m_iThread;
+   CEventRing* m_pNext;
+   CEventRecord m_pRecords[s_ullRingSize];
+};
+
+static pthread_mutex_t s_RingLock = PTHREAD_MUTEX_INITIALIZER;
+static CEventRing* s_pRings = NULL;
+static uint16_t s_iThreads = 0;
+static __thread CEventRing* t_pRing = NULL;
+
+// start() and stop() hold s_ControlLock; the flusher waits on s_FlushCond
+static pthread_mutex_t s_ControlLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t s_FlushLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_FlushCond = PTHREAD_COND_INITIALIZER;
+static pthread_t s_Flusher;
+static bool s_bStopping = false;
+static FILE* s_pFile = NULL;
+static CEventTraceHeader s_Header;
+
+static CEventRing* newRing()
+{
+   CEventRing* r = new CEventRing;
+   r->m_ullHead.store(0);
+   r->m_ullDropped.store(0);
+   r->m_ullTailCache = 0;
+   r->m_ullTail.store(0);
+   r->m_ullDropReported = 0;
+
+   pthread_mutex_lock(&s_RingLock);
+   r->m_iThread = s_iThreads ++;
+   r->m_pNext = s_pRings;
+   s_pRings = r;
+   pthread_mutex_unlock(&s_RingLock);
+
+   return r;
+}
+
+void CEventTrace::record(int event, int32_t socket, int32_t arg1, int32_t arg2, double value, int flags)
+{
+   CEventRing* r = t_pRing;
+   if (NULL == r)
+      r = t_pRing = newRing();
+
+   uint64_t head = r->m_ullHead.load(std::memory_order_relaxed);
+   if (head - r->m_ullTailCache >= s_ullRingSize)
+   {
+      r->m_ullTailCache = r->m_ullTail.load(std::memory_order_acquire);
+      if (head - r->m_ullTailCache >= s_ullRingSize)
+      {
+         r->m_ullDropped.store(r->m_ullDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+         return;
+      }
+   }
+
+   CEventRecord& e = r->m_pRecords[head & (s_ullRingSize - 1)];
+   CTimer::rdtsc(e.m_ullTime);
+   e.m_iSocket = socket;
+   e.m_iThread = r->m_iThread;
+   e.m_iEvent = (uint8_t)event;
+   e.m_iFlags = (uint8_t)flags;
+   e.m_iArg1 = arg1;
+   e.m_iArg2 = arg2;
+   e.m_dValue = value;
+
+   r->m_ullHead.store(head + 1, std::memory_order_release);
+}
+
+static void drain(CEventRing* r)
+{
+   uint64_t tail = r->m_ullTail.load(std::memory_order_relaxed);
+   uint64_t head = r->m_ullHead.load(std::memory_order_acquire);
+
+   // the records wrap around the end of the ring at most once
+   while (tail != head)
+   {
+      uint64_t first = tail & (s_ullRingSize - 1);
+      uint64_t n = head - tail;
+      if (n > s_ullRingSize - first)
+         n = s_ullRingSize - first;
+      fwrite(r->m_pRecords + first, sizeof(CEventRecord), n, s_pFile);
+      tail += n;
+   }
+   r->m_ullTail.store(tail, std::memory_order_release);
+
+   uint64_t dropped = r->m_ullDropped.load(std::memory_order_relaxed);
+   if (dropped != r->m_ullDropReported)
+   {
+      CEventRecord e;
+      memset(&e, 0, sizeof(CEventRecord));
+      CTimer::rdtsc(e.m_ullTime);
+      e.m_iThread = r->m_iThread;
+      e.m_iEvent = CEventRecord::DROPPED;
+      e.m_iArg1 = (int32_t)(dropped - r->m_ullDropReported);
+      fwrite(&e, sizeof(CEventRecord), 1, s_pFile);
+      r->m_ullDropReported = dropped;
+   }
+}
+
+static void drainAll()
+{
+   pthread_mutex_lock(&s_RingLock);
+   CEventRing* rings = s_pRings;
+   pthread_mutex_unlock(&s_RingLock);
+
+   // new rings go to the head of the list, so the ones after it never change
+   for (CEventRing* r = rings; NULL != r; r = r->m_pNext)
+      drain(r);
+   fflush(s_pFile);
+}
+
+void* CEventTrace::flusher(void*)
+{
+   pthread_mutex_lock(&s_FlushLock);
+   while (!s_bStopping)
+   {
+      CEmuClock::timedwait(&s_FlushCond, &s_FlushLock, CTimer::getTime() + s_iFlushPeriod);
+
+      pthread_mutex_unlock(&s_FlushLock);
+      drainAll();
+      pthread_mutex_lock(&s_FlushLock);
+   }
+   pthread_mutex_unlock(&s_FlushLock);
+
+   return NULL;
+}
+
+int CEventTrace::start(const char* path)
+{
+   CGuard cg(s_ControlLock);
+
+   if (NULL != s_pFile)
+      return -1;
+
+   s_pFile = fopen(path, "wb");
+   if (NULL == s_pFile)
+      return -1;
+
+   memset(&s_Header, 0, sizeof(CEventTraceHeader));
+   memcpy(s_Header.m_pcMagic, CEventTraceHeader::m_pcTraceMagic, 8);
+   s_Header.m_iVersion = CEventTraceHeader::m_iTraceVersion;
+   s_Header.m_iRecordSize = sizeof(CEventRecord);
+   s_Header.m_ullFrequency = CTimer::getCPUFrequency();
+   CTimer::rdtsc(s_Header.m_ullStartCycles);
+   s_Header.m_ullStartTime = CTimer::getTime();
+   fwrite(&s_Header, sizeof(CEventTraceHeader), 1, s_pFile);
+
+   // forget what was written while tracing was off
+   pthread_mutex_lock(&s_RingLock);
+   for (CEventRing* r = s_pRings; NULL != r; r = r->m_pNext)
+   {
+      r->m_ullTail.store(r->m_ullHead.load(std::memory_order_acquire), std::memory_order_release);
+      r->m_ullDropReported = r->m_ullDropped.load(std::memory_order_relaxed);
+   }
+   pthread_mutex_unlock(&s_RingLock);
+
+   s_bStopping = false;
+   CEmuClock::spawn(&s_Flusher, flusher, NULL);
+   s_bEnabled = true;
+
+   return 0;
+}
+
+void CEventTrace::stop()
+{
+   CGuard cg(s_ControlLock);
+
+   if (NULL == s_pFile)
+      return;
+
+   s_bEnabled = false;
+
+   pthread_mutex_lock(&s_FlushLock);
+   s_bStopping = true;
+   CEmuClock::signal(&s_FlushCond);
+   pthread_mutex_unlock(&s_FlushLock);
+   CEmuClock::join(s_Flusher);
+
+   drainAll();
+
+   CTimer::rdtsc(s_Header.m_ullEndCycles);
+   s_Header.m_ullEndTime = CTimer::getTime();
+   fseek(s_pFile, 0, SEEK_SET);
+   fwrite(&s_Header, sizeof(CEventTraceHeader), 1, s_pFile);
+   fclose(s_pFile);
+   s_pFile = NULL;
+}
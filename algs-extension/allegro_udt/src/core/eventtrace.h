@@ -0,0 +1,108 @@
+#ifndef __UDT_EVENTTRACE_H__
+#define __UDT_EVENTTRACE_H__
+
+#include <stdint.h>
+
+
+// Binary trace of the events of the sending side: packets sent, ACKs, losses,
+// PCC rate changes, monitor intervals and their utilities. Each thread writes
+// fixed-size records into a ring of its own, without locks; a flusher thread
+// drains the rings into a file every few milliseconds. A ring that the flusher
+// cannot keep up with drops records and says how many in a DROPPED record.
+//
+// Tracing is off unless the UDT_TRACE environment variable names a file when
+// UDT::startup() runs. Off, an event costs one branch on a global flag; on, it
+// costs a TSC read and a 32 byte store. app/udttrace converts a trace to text.
+
+struct CEventRecord
+{
+   enum EEvent
+   {
+      SENT = 1,         // arg1 = sequence number, arg2 = message number, value = payload bytes, flags = 1 for a retransmission
+      ACK,              // arg1 = sequence number, arg2 = message number, value = RTT in microseconds
+      LOSS,             // arg1 = sequence number, arg2 = message number, value = payload bytes
+      RATE,             // arg1 = PCC mode (0 starting, 1 probing, 2 decision made), value = new sending rate in bits/s
+      MI_START,         // arg1 = 1 for a useful interval, arg2 = RTT in microseconds, value = sending rate in bits/s
+      MI_END,           // arg1 = packets sent, arg2 = duration in microseconds, value = loss rate
+      UTILITY,          // arg1 = actual sending rate in kbits/s, arg2 = latency inflation * 1e6, value = utility
+      DROPPED,          // arg1 = records this thread has dropped since the last DROPPED record
+      EVENT_MAX
+   };
+
+   uint64_t m_ullTime;          // CPU cycles, CTimer::rdtsc()
+   int32_t m_iSocket;           // UDT socket ID, 0 if unknown
+   uint16_t m_iThread;          // index of the writing thread
+   uint8_t m_iEvent;            // EEvent
+   uint8_t m_iFlags;
+   int32_t m_iArg1;
+   int32_t m_iArg2;
+   double m_dValue;
+};
+
+// The trace file is this header followed by the records, in the order each
+// thread wrote them but with the threads interleaved. The end fields are
+// written when tracing stops; they are zero if the process did not stop it.
+struct CEventTraceHeader
+{
+   char m_pcMagic[8];           // "UDTEVTR"
+   uint32_t m_iVersion;
+   uint32_t m_iRecordSize;
+   uint64_t m_ullFrequency;     // CPU cycles per microsecond, CTimer::getCPUFrequency()
+   uint64_t m_ullStartCycles;   // CPU cycles when tracing started
+   uint64_t m_ullStartTime;     // CTimer::getTime() when tracing started
+   uint64_t m_ullEndCycles;
+   uint64_t m_ullEndTime;
+
+   static const char m_pcTraceMagic[8];
+   static const uint32_t m_iTraceVersion = 1;
+};
+
+class CEventTrace
+{
+public:
+      // Functionality:
+      //    record an event of the calling thread, if tracing is on.
+      // Parameters:
+      //    0) [in] event: CEventRecord::EEvent.
+      //    1) [in] socket: UDT socket ID.
+      //    2) [in] arg1: first integer field.
+      //    3) [in] arg2: second integer field.
+      //    4) [in] value: floating point field.
+      //    5) [in] flags: event specific flags.
+      // Returned value:
+      //    None.
+
+   static inline void trace(int event, int32_t socket, int32_t arg1, int32_t arg2, double value, int flags = 0)
+   {
+      if (__builtin_expect(s_bEnabled, 0))
+         record(event, socket, arg1, arg2, value, flags);
+   }
+
+      // Functionality:
+      //    start tracing into a file, dropping what threads wrote while tracing was off.
+      // Parameters:
+      //    0) [in] path: the trace file, truncated.
+      // Returned value:
+      //    0 if tracing started, -1 if the file cannot be opened or tracing is already on.
+
+   static int start(const char* path);
+
+      // Functionality:
+      //    stop tracing, write out what is left in the rings and close the file.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None.
+
+   static void stop();
+
+public:
+   static volatile bool s_bEnabled;
+
+private:
+   static void record(int event, int32_t socket, int32_t arg1, int32_t arg2, double value, int flags);
+   static void* flusher(void* param);
+};
+
+
+#endif
@@ -2,16 +2,42 @@
 #define PACKET_TRACKER_H_
 
 #include <pthread.h>
+#include <atomic>
 #include <iostream>
 #include <unordered_map>
 #include <time.h>
 #include <string.h>
 #include <mutex>
+#include "emulator.h"
 
 namespace {
     int kArbitraryPacketLimit = 100000;
 } // namespace
 
+// Reads the clock of the sent times: CLOCK_MONOTONIC, or the emulator's virtual
+// clock when it is enabled. Virtual time has only microseconds; PacketTracker
+// breaks ties between sent times itself.
+inline void GetTrackerTime(struct timespec* ts) {
+    CEmuClock* clock = CEmuClock::instance();
+    if (NULL == clock) {
+        clock_gettime(CLOCK_MONOTONIC, ts);
+        return;
+    }
+    uint64_t now = clock->now();
+    ts->tv_sec = now / 1000000;
+    ts->tv_nsec = (now % 1000000) * 1000;
+}
+
+inline int64_t TimespecToNs(const struct timespec& ts) {
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Microseconds from |from| to |to|, or 0 if |to| is not later.
+inline uint64_t TimespecDiffUs(const struct timespec& from, const struct timespec& to) {
+    int64_t diff_ns = TimespecToNs(to) - TimespecToNs(from);
+    return diff_ns > 0 ? diff_ns / 1000 : 0;
+}
+
 enum PacketState { PACKET_STATE_NONE, PACKET_STATE_QUEUED, PACKET_STATE_SENT, PACKET_STATE_ACKED, PACKET_STATE_LOST };
 
 template<typename SeqNoType, typename IdType>
@@ -27,7 +53,7 @@ class PacketRecord {
   public:
     PacketRecord(CPacket& packet, PacketState initial_packet_state);
     ~PacketRecord();
-    void UpdateRecord(PacketState new_packet_state, SeqNoType msg_no, IdType packet_id);
+    void UpdateRecord(PacketState new_packet_state, SeqNoType msg_no, IdType packet_id, const struct timespec& event_time);
     char* GetPacketPayloadPointer() { return payload_pointer_; }
     int32_t GetPacketSize() { return packet_size_; }
     SeqNoType GetPacketMostRecentMsgNo();
@@ -106,19 +132,17 @@ PacketRecord<SeqNoType, IdType>::~PacketRecord() {
 }
 
 template<typename SeqNoType, typename IdType>
-void PacketRecord<SeqNoType, IdType>::UpdateRecord(PacketState new_packet_state, SeqNoType msg_no, IdType packet_id) {
+void PacketRecord<SeqNoType, IdType>::UpdateRecord(PacketState new_packet_state, SeqNoType msg_no, IdType packet_id, const struct timespec& event_time) {
     if (new_packet_state == PACKET_STATE_SENT) {
         MessageRecord<SeqNoType, IdType> msg_record;
         msg_record.rtt_us = 0;
-        clock_gettime(CLOCK_MONOTONIC, &msg_record.sent_time);
+        msg_record.sent_time = event_time;
         msg_record.msg_no = msg_no;
         msg_record.packet_id = packet_id;
         msg_records_.push_back(msg_record);
     } else if (new_packet_state == PACKET_STATE_ACKED) {
-        struct timespec ack_time;
-        clock_gettime(CLOCK_MONOTONIC, &ack_time);
         MessageRecord<SeqNoType, IdType>* msg_record = SafeGetMessageRecord(msg_no);
-        msg_record->rtt_us = 1000000 * (ack_time.tv_sec - msg_record->sent_time.tv_sec) + (ack_time.tv_nsec - msg_record->sent_time.tv_nsec) / 1000;
+        msg_record->rtt_us = TimespecDiffUs(msg_record->sent_time, event_time);
     }
     if (msg_no == msg_records_.back().msg_no) {
         packet_state_ = new_packet_state;
@@ -149,9 +173,11 @@ namespace std {
             return hash<int>()(ts.tv_nsec);
         }
     };
-    int operator==(const struct timespec& ts1, const struct timespec& ts2);
 } // namespace std
 
+// Declared at global scope so std::equal_to<timespec> finds it through ADL.
+int operator==(const struct timespec& ts1, const struct timespec& ts2);
+
 template<typename SeqNoType, typename IdType>
 class PacketTracker {
   public:
@@ -176,15 +202,22 @@ class PacketTracker {
     SeqNoType GetLowestRetransmittableSeqNo();
     SeqNoType GetOldestSentSeqNo();
     char* GetPacketPayloadPointer(SeqNoType seq_no);
+    // Packets held: queued, in flight or waiting for retransmission. Safe to
+    // call without any lock.
+    int NumPackets() const { return cur_num_packets_.load(std::memory_order_relaxed); }
   private:
     IdType MakeNewPacketId(CPacket& packet);
+    struct timespec MakeSentTime();
     std::unordered_map<SeqNoType, PacketRecord<SeqNoType, IdType>*> packet_record_map_;
     std::priority_queue<SeqNoType, std::vector<SeqNoType>, TrackerLessThan<SeqNoType> > retransmittable_queue_;
     std::priority_queue<SeqNoType, std::vector<SeqNoType>, TrackerLessThan<SeqNoType> > send_queue_;
     std::priority_queue<struct timespec, std::vector<struct timespec>, TimespecLessThan> sent_queue_;
     std::unordered_map<struct timespec, SeqNoType> sent_time_map_;
     IdType prev_packet_id_;
-    int cur_num_packets_;
+    // Latest sent time handed out, in ns. Sent times key sent_time_map_, so
+    // they are kept unique and increasing.
+    int64_t last_sent_ns_;
+    std::atomic<int> cur_num_packets_;
     int arbitrary_packet_limit_;
     std::mutex lock_;
     pthread_cond_t* send_cond_;
@@ -197,6 +230,7 @@ PacketTracker<SeqNoType, IdType>::~PacketTracker() {
 template <typename SeqNoType, typename IdType>
 PacketTracker<SeqNoType, IdType>::PacketTracker(pthread_cond_t* send_cond) {
     prev_packet_id_ = 0;
+    last_sent_ns_ = 0;
     arbitrary_packet_limit_ = kArbitraryPacketLimit;
     send_cond_ = send_cond;
     cur_num_packets_ = 0;
@@ -209,6 +243,22 @@ IdType PacketTracker<SeqNoType, IdType>::MakeNewPacketId(CPacket& packet) {
     return result;
 }
 
+// Called with lock_ held. The virtual clock can give several sends the same
+// microsecond, so a tie is moved 1 ns past the previous sent time.
+template <typename SeqNoType, typename IdType>
+struct timespec PacketTracker<SeqNoType, IdType>::MakeSentTime() {
+    struct timespec ts;
+    GetTrackerTime(&ts);
+    int64_t now_ns = TimespecToNs(ts);
+    if (now_ns <= last_sent_ns_) {
+        now_ns = last_sent_ns_ + 1;
+        ts.tv_sec = now_ns / 1000000000;
+        ts.tv_nsec = now_ns % 1000000000;
+    }
+    last_sent_ns_ = now_ns;
+    return ts;
+}
+
 template <typename SeqNoType, typename IdType>
 bool PacketTracker<SeqNoType, IdType>::CanEnqueuePacket() {
     return cur_num_packets_ < arbitrary_packet_limit_;
@@ -270,7 +320,7 @@ void PacketTracker<SeqNoType, IdType>::OnPacketSent(CPacket& packet) {
             }
         }
         PacketRecord<SeqNoType, IdType>* packet_record = packet_record_iter->second;
-        packet_record->UpdateRecord(PACKET_STATE_SENT, packet.m_iMsgNo, MakeNewPacketId(packet));
+        packet_record->UpdateRecord(PACKET_STATE_SENT, packet.m_iMsgNo, MakeNewPacketId(packet), MakeSentTime());
         sent_queue_.push(packet_record->GetPacketSentTime(packet.m_iMsgNo));
         sent_time_map_.insert(std::make_pair(packet_record->GetPacketSentTime(packet.m_iMsgNo), seq_no)); 
     }
@@ -284,7 +334,9 @@ void PacketTracker<SeqNoType, IdType>::OnPacketAck(SeqNoType seq_no, SeqNoType m
     if (packet_record_iter != packet_record_map_.end()) {
         PacketRecord<SeqNoType, IdType>* packet_record = packet_record_iter->second;
         sent_time_map_.erase(packet_record->GetPacketSentTime(msg_no));
-        packet_record->UpdateRecord(PACKET_STATE_ACKED, msg_no, 0);
+        struct timespec ack_time;
+        GetTrackerTime(&ack_time);
+        packet_record->UpdateRecord(PACKET_STATE_ACKED, msg_no, 0, ack_time);
     } else {
         //std::cerr << "ERROR: Packet was acked but never recorded as sent!" << std::endl;
         //std::cerr << "\t seq_no = " << seq_no << std::endl;
@@ -301,7 +353,9 @@ void PacketTracker<SeqNoType, IdType>::OnPacketLoss(SeqNoType seq_no, SeqNoType
     if (packet_record_iter != packet_record_map_.end()) {
         PacketRecord<SeqNoType, IdType>* packet_record = packet_record_iter->second;
         sent_time_map_.erase(packet_record->GetPacketSentTime(msg_no));
-        packet_record->UpdateRecord(PACKET_STATE_LOST, msg_no, 0);
+        struct timespec loss_time;
+        GetTrackerTime(&loss_time);
+        packet_record->UpdateRecord(PACKET_STATE_LOST, msg_no, 0, loss_time);
         //packet_record->SetPacketId(0);
         retransmittable_queue_.push(seq_no);
         //std::cout << "Added " << seq_no << " to retransmittable queue" << std::endl;
@@ -330,7 +384,7 @@ void PacketTracker<SeqNoType, IdType>::DeletePacketRecord(SeqNoType seq_no) {
     }
     --cur_num_packets_;
     if (cur_num_packets_ < arbitrary_packet_limit_) {
-        pthread_cond_signal(send_cond_);
+        CEmuClock::signal(send_cond_);
     }
     //std::cout << "\t num packets = " << cur_num_packets_ << std::endl;
     lock_.unlock();
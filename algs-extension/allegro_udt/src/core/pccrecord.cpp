@@ -0,0 +1,342 @@
+#include <cstring>
+#include <string>
+#include <sstream>
+#include "pccrecord.h"
+
+
+const char CPccRecordHeader::m_pcRecordMagic[8] = "UDTPCCR";
+
+const char* CPccRecorder::s_pcPrefix = NULL;
+
+// The record tag: the event type in the low bits, and the SENT or CONGESTION
+// flag above them.
+static const int s_iTypeMask = 7;
+static const int s_iFlagBit = 8;
+
+// Written out when this much has been recorded, a few thousand calls, or
+// when a second has passed since the last write.
+static const int s_iBufSize = 65536;
+static const QuicTime s_llFlushPeriod = 1000000;
+
+// Bounds on the encoded size of a record without its packets, and of a packet.
+// A varint takes up to 10 bytes.
+static const int s_iMaxRecord = 64;
+static const int s_iMaxPacket = 20;
+
+CPccRecorder::CPccRecorder(int32_t socket, uint32_t seed, QuicTime initial_rtt, QuicPacketCount initial_cwnd, QuicPacketCount max_cwnd):
+m_pFile(NULL),
+m_bFailed(false),
+m_iBufSize(s_iBufSize),
+m_iLength(0),
+m_llLastTime(0),
+m_llFlushTime(0),
+m_iLastSent(0),
+m_iLastEvent(0),
+m_dLastRate(-1)
+{
+   memset(&m_Header, 0, sizeof(CPccRecordHeader));
+   memcpy(m_Header.m_pcMagic, CPccRecordHeader::m_pcRecordMagic, 8);
+   m_Header.m_iVersion = CPccRecordHeader::m_iRecordVersion;
+   m_Header.m_iSocket = socket;
+   m_Header.m_iSeed = seed;
+   m_Header.m_iInitialCwnd = initial_cwnd;
+   m_Header.m_iMaxCwnd = max_cwnd;
+   m_Header.m_llInitialRtt = initial_rtt;
+
+   m_pcBuffer = new char[m_iBufSize];
+}
+
+CPccRecorder::~CPccRecorder()
+{
+   flush();
+   if (NULL != m_pFile)
+      fclose(m_pFile);
+   delete [] m_pcBuffer;
+}
+
+void CPccRecorder::enable(const char* prefix)
+{
+   s_pcPrefix = prefix;
+}
+
+void CPccRecorder::sent(QuicTime time, QuicByteCount inflight, QuicPacketNumber number, QuicByteCount bytes, bool retransmittable, QuicBandwidth rate)
+{
+   reserve(s_iMaxRecord);
+   m_pcBuffer[m_iLength ++] = CPccRecordEvent::SENT | (retransmittable ? s_iFlagBit : 0);
+   putTime(time);
+   putVarint(inflight);
+   putSigned(int64_t(number) - m_iLastSent);
+   putVarint(bytes);
+   m_iLastSent = number;
+   putRate(rate);
+   flushOnTime();
+}
+
+void CPccRecorder::congestion(bool rtt_updated, QuicByteCount inflight, QuicTime time, QuicTime rtt,
+                              const AckedPacketVector& acked, const LostPacketVector& lost, QuicBandwidth rate)
+{
+   reserve(s_iMaxRecord + s_iMaxPacket * int(acked.size() + lost.size()));
+   m_pcBuffer[m_iLength ++] = CPccRecordEvent::CONGESTION | (rtt_updated ? s_iFlagBit : 0);
+   putTime(time);
+   putVarint(inflight);
+   putVarint(rtt);
+   putPackets(acked, false);
+   putPackets(lost, true);
+   putRate(rate);
+   flushOnTime();
+}
+
+void CPccRecorder::warmStart(QuicBandwidth sending_rate, QuicTime min_rtt, QuicBandwidth rate)
+{
+   reserve(s_iMaxRecord);
+   m_pcBuffer[m_iLength ++] = CPccRecordEvent::WARM_START;
+   putDouble(sending_rate);
+   putVarint(min_rtt);
+   putRate(rate);
+}
+
+void CPccRecorder::reserve(int size)
+{
+   if (m_iLength + size <= m_iBufSize)
+      return;
+
+   flush();
+   if (size > m_iBufSize)
+   {
+      delete [] m_pcBuffer;
+      m_iBufSize = size;
+      m_pcBuffer = new char[m_iBufSize];
+   }
+}
+
+void CPccRecorder::putVarint(uint64_t value)
+{
+   while (value >= 0x80)
+   {
+      m_pcBuffer[m_iLength ++] = char(value | 0x80);
+      value >>= 7;
+   }
+   m_pcBuffer[m_iLength ++] = char(value);
+}
+
+void CPccRecorder::putDouble(double value)
+{
+   memcpy(m_pcBuffer + m_iLength, &value, sizeof(double));
+   m_iLength += sizeof(double);
+}
+
+void CPccRecorder::putTime(QuicTime time)
+{
+   // the header takes the time of the first call, written with the first flush
+   if ((0 == m_Header.m_ullStartTime) && (NULL == m_pFile))
+      m_Header.m_ullStartTime = m_llLastTime = m_llFlushTime = time;
+
+   // gettimeofday() may step back, so the delta is signed
+   putSigned(time - m_llLastTime);
+   m_llLastTime = time;
+}
+
+void CPccRecorder::putPackets(const std::vector<CongestionEvent>& packets, bool lost)
+{
+   putVarint(packets.size());
+   for (std::vector<CongestionEvent>::const_iterator i = packets.begin(); i != packets.end(); ++ i)
+   {
+      putSigned(int64_t(i->packet_number) - m_iLastEvent);
+      putVarint(lost ? i->bytes_lost : i->bytes_acked);
+      m_iLastEvent = i->packet_number;
+   }
+}
+
+void CPccRecorder::putRate(QuicBandwidth rate)
+{
+   if (rate == m_dLastRate)
+      return;
+
+   m_pcBuffer[m_iLength ++] = CPccRecordEvent::RATE;
+   putDouble(rate);
+   m_dLastRate = rate;
+}
+
+void CPccRecorder::flushOnTime()
+{
+   if (m_llLastTime - m_llFlushTime < s_llFlushPeriod)
+      return;
+
+   flush();
+   m_llFlushTime = m_llLastTime;
+}
+
+void CPccRecorder::flush()
+{
+   if (m_bFailed || (0 == m_iLength))
+   {
+      m_iLength = 0;
+      return;
+   }
+
+   if (NULL == m_pFile)
+   {
+      std::stringstream path;
+      path << s_pcPrefix << "." << m_Header.m_iSocket;
+      m_pFile = fopen(path.str().c_str(), "wb");
+      if ((NULL == m_pFile) || (1 != fwrite(&m_Header, sizeof(CPccRecordHeader), 1, m_pFile)))
+         m_bFailed = true;
+   }
+
+   // flushed at once, so a process that is killed loses only the records still in m_pcBuffer,
+   // a second of them at most
+   if (!m_bFailed && ((size_t(m_iLength) != fwrite(m_pcBuffer, 1, m_iLength, m_pFile)) || (0 != fflush(m_pFile))))
+      m_bFailed = true;
+   m_iLength = 0;
+}
+
+CPccRecordReader::CPccRecordReader():
+m_pcData(NULL),
+m_pcPos(NULL),
+m_pcEnd(NULL),
+m_llLastTime(0),
+m_iLastSent(0),
+m_iLastEvent(0)
+{
+   memset(&m_Header, 0, sizeof(CPccRecordHeader));
+}
+
+CPccRecordReader::~CPccRecordReader()
+{
+   delete [] m_pcData;
+}
+
+int CPccRecordReader::open(const char* path)
+{
+   FILE* f = fopen(path, "rb");
+   if (NULL == f)
+      return -1;
+
+   if ((1 != fread(&m_Header, sizeof(CPccRecordHeader), 1, f))
+      || (0 != memcmp(m_Header.m_pcMagic, CPccRecordHeader::m_pcRecordMagic, 8))
+      || (m_Header.m_iVersion != CPccRecordHeader::m_iRecordVersion))
+   {
+      fclose(f);
+      return -1;
+   }
+
+   long start = ftell(f);
+   fseek(f, 0, SEEK_END);
+   long size = ftell(f) - start;
+   fseek(f, start, SEEK_SET);
+
+   delete [] m_pcData;
+   m_pcData = new char[size];
+   size_t len = fread(m_pcData, 1, size, f);
+   fclose(f);
+
+   m_pcEnd = m_pcData + len;
+   rewind();
+
+   return 0;
+}
+
+bool CPccRecordReader::next(CPccRecordEvent& e)
+{
+   if (m_pcPos == m_pcEnd)
+      return false;
+
+   const char* start = m_pcPos;
+   int tag = (unsigned char)*m_pcPos ++;
+   e.m_iType = tag & s_iTypeMask;
+   e.m_bFlag = (0 != (tag & s_iFlagBit));
+   e.m_llTime = 0;
+
+   bool ok = false;
+   uint64_t u;
+   int64_t d;
+
+   switch (e.m_iType)
+   {
+   case CPccRecordEvent::SENT:
+      ok = getSigned(d);
+      e.m_llTime = m_llLastTime += d;
+      ok = ok && getVarint(u);
+      e.m_llBytesInFlight = u;
+      ok = ok && getSigned(d);
+      e.m_iPacketNumber = m_iLastSent = QuicPacketNumber(m_iLastSent + d);
+      ok = ok && getVarint(u);
+      e.m_llBytes = u;
+      break;
+
+   case CPccRecordEvent::CONGESTION:
+      ok = getSigned(d);
+      e.m_llTime = m_llLastTime += d;
+      ok = ok && getVarint(u);
+      e.m_llBytesInFlight = u;
+      ok = ok && getVarint(u);
+      e.m_llRtt = u;
+      ok = ok && getPackets(e.m_vAcked, false, e.m_llTime) && getPackets(e.m_vLost, true, e.m_llTime);
+      break;
+
+   case CPccRecordEvent::WARM_START:
+      ok = getDouble(e.m_dRate) && getVarint(u);
+      e.m_llRtt = u;
+      break;
+
+   case CPccRecordEvent::RATE:
+      ok = getDouble(e.m_dRate);
+      break;
+   }
+
+   if (!ok)
+      m_pcPos = start;
+   return ok;
+}
+
+bool CPccRecordReader::getVarint(uint64_t& value)
+{
+   value = 0;
+   for (int shift = 0; (m_pcPos != m_pcEnd) && (shift < 64); shift += 7)
+   {
+      uint64_t b = (unsigned char)*m_pcPos ++;
+      value |= (b & 0x7F) << shift;
+      if (b < 0x80)
+         return true;
+   }
+   return false;
+}
+
+bool CPccRecordReader::getSigned(int64_t& value)
+{
+   uint64_t u;
+   if (!getVarint(u))
+      return false;
+   value = int64_t(u >> 1) ^ -int64_t(u & 1);
+   return true;
+}
+
+bool CPccRecordReader::getDouble(double& value)
+{
+   if (m_pcEnd - m_pcPos < (int)sizeof(double))
+      return false;
+   memcpy(&value, m_pcPos, sizeof(double));
+   m_pcPos += sizeof(double);
+   return true;
+}
+
+bool CPccRecordReader::getPackets(std::vector<CongestionEvent>& packets, bool lost, QuicTime time)
+{
+   uint64_t n;
+   if (!getVarint(n) || (n > uint64_t(m_pcEnd - m_pcPos)))
+      return false;
+
+   packets.resize(n);
+   for (std::vector<CongestionEvent>::iterator i = packets.begin(); i != packets.end(); ++ i)
+   {
+      int64_t d;
+      uint64_t bytes;
+      if (!getSigned(d) || !getVarint(bytes))
+         return false;
+      i->packet_number = m_iLastEvent = QuicPacketNumber(m_iLastEvent + d);
+      i->bytes_acked = lost ? 0 : int32_t(bytes);
+      i->bytes_lost = lost ? int32_t(bytes) : 0;
+      i->time = time;
+   }
+   return true;
+}
@@ -0,0 +1,181 @@
+#ifndef __UDT_PCCRECORD_H__
+#define __UDT_PCCRECORD_H__
+
+#include <stdint.h>
+#include <cstdio>
+#include <vector>
+#include "../pcc/pcc_monitor_interval_queue.h"
+
+
+// Recording of the calls a connection makes to its PccSender: every
+// OnPacketSent, OnCongestionEvent and WarmStart with their arguments, and the
+// pacing rate after each call whenever it changes. Fed to a new PccSender
+// built with the same arguments and random seed, the calls reproduce the rate
+// decisions of the connection exactly; app/pccreplay does this and compares
+// the two rate trajectories.
+//
+// Recording is off unless the UDT_PCC_RECORD environment variable is set when
+// UDT::startup() runs. Each connection that sends then writes PREFIX.SOCKET,
+// PREFIX being the value of the variable. Records are a tag byte followed by
+// variable length integers, most of them deltas, about ten bytes per call.
+// The file is written every second and when the socket is destroyed.
+
+struct CPccRecordHeader
+{
+   char m_pcMagic[8];           // "UDTPCCR"
+   uint32_t m_iVersion;
+   int32_t m_iSocket;           // UDT socket ID
+   uint32_t m_iSeed;            // PccSender::set_random_seed()
+   int32_t m_iInitialCwnd;      // PccSender constructor arguments
+   int32_t m_iMaxCwnd;
+   int32_t m_iReserved;
+   int64_t m_llInitialRtt;
+   uint64_t m_ullStartTime;     // time of the first call, microseconds
+
+   static const char m_pcRecordMagic[8];
+   static const uint32_t m_iRecordVersion = 1;
+};
+
+struct CPccRecordEvent
+{
+   enum EType
+   {
+      SENT = 1,         // OnPacketSent
+      CONGESTION,       // OnCongestionEvent
+      WARM_START,       // WarmStart
+      RATE              // pacing rate of the recorded sender after the last call
+   };
+
+   int m_iType;
+   QuicTime m_llTime;                   // sent_time or event_time, 0 for WARM_START and RATE
+   QuicByteCount m_llBytesInFlight;
+   QuicPacketNumber m_iPacketNumber;    // SENT
+   QuicByteCount m_llBytes;             // SENT
+   bool m_bFlag;                        // SENT: retransmittable, CONGESTION: rtt_updated
+   QuicTime m_llRtt;                    // CONGESTION, and min RTT for WARM_START
+   QuicBandwidth m_dRate;               // WARM_START and RATE
+   AckedPacketVector m_vAcked;          // CONGESTION
+   LostPacketVector m_vLost;            // CONGESTION
+};
+
+class CPccRecorder
+{
+public:
+      // Functionality:
+      //    prepare the recording of a connection; the file is created at the first call recorded.
+      // Parameters:
+      //    0) [in] socket: UDT socket ID.
+      //    1) [in] seed: random seed given to the PccSender.
+      //    2) [in] initial_rtt: PccSender constructor arguments.
+      //    3) [in] initial_cwnd: ditto.
+      //    4) [in] max_cwnd: ditto.
+      // Returned value:
+      //    None.
+
+   CPccRecorder(int32_t socket, uint32_t seed, QuicTime initial_rtt, QuicPacketCount initial_cwnd, QuicPacketCount max_cwnd);
+   ~CPccRecorder();
+
+public:
+      // Functionality:
+      //    record a call to the PccSender, and its pacing rate after the call.
+      // Parameters:
+      //    the arguments of the call, then the rate.
+      // Returned value:
+      //    None.
+
+   void sent(QuicTime time, QuicByteCount inflight, QuicPacketNumber number, QuicByteCount bytes, bool retransmittable, QuicBandwidth rate);
+   void congestion(bool rtt_updated, QuicByteCount inflight, QuicTime time, QuicTime rtt,
+                   const AckedPacketVector& acked, const LostPacketVector& lost, QuicBandwidth rate);
+   void warmStart(QuicBandwidth sending_rate, QuicTime min_rtt, QuicBandwidth rate);
+
+public:
+      // Functionality:
+      //    turn recording on for the connections opened from now on.
+      // Parameters:
+      //    0) [in] prefix: the files are named prefix.SOCKET.
+      // Returned value:
+      //    None.
+
+   static void enable(const char* prefix);
+
+   static bool enabled() {return NULL != s_pcPrefix;}
+
+private:
+   void reserve(int size);
+   void putVarint(uint64_t value);
+   void putSigned(int64_t value) {putVarint((uint64_t(value) << 1) ^ uint64_t(value >> 63));}
+   void putDouble(double value);
+   void putTime(QuicTime time);
+   void putPackets(const std::vector<CongestionEvent>& packets, bool lost);
+   void putRate(QuicBandwidth rate);
+   void flushOnTime();
+   void flush();
+
+private:
+   static const char* s_pcPrefix;
+
+   CPccRecordHeader m_Header;
+   FILE* m_pFile;
+   bool m_bFailed;                      // the file cannot be written, give up
+   char* m_pcBuffer;
+   int m_iBufSize;
+   int m_iLength;
+
+   QuicTime m_llLastTime;               // deltas are taken from these
+   QuicTime m_llFlushTime;              // time of the call that last wrote the file
+   QuicPacketNumber m_iLastSent;        // last packet sent
+   QuicPacketNumber m_iLastEvent;       // last packet acked or lost
+   QuicBandwidth m_dLastRate;
+};
+
+class CPccRecordReader
+{
+public:
+   CPccRecordReader();
+   ~CPccRecordReader();
+
+public:
+      // Functionality:
+      //    read a recording into memory.
+      // Parameters:
+      //    0) [in] path: the recording.
+      // Returned value:
+      //    0 on success, -1 if the file cannot be read or is not a recording of this version.
+
+   int open(const char* path);
+
+      // Functionality:
+      //    decode the next record.
+      // Parameters:
+      //    0) [out] e: the record; its vectors are reused from call to call.
+      // Returned value:
+      //    true if a record was decoded, false at the end or at a truncated record.
+
+   bool next(CPccRecordEvent& e);
+
+   const CPccRecordHeader& header() const {return m_Header;}
+
+   // true if next() stopped before the end of the file
+   bool truncated() const {return m_pcPos != m_pcEnd;}
+
+   void rewind() {m_pcPos = m_pcData; m_llLastTime = m_Header.m_ullStartTime; m_iLastSent = m_iLastEvent = 0;}
+
+private:
+   bool getVarint(uint64_t& value);
+   bool getSigned(int64_t& value);
+   bool getDouble(double& value);
+   bool getPackets(std::vector<CongestionEvent>& packets, bool lost, QuicTime time);
+
+private:
+   CPccRecordHeader m_Header;
+   char* m_pcData;
+   const char* m_pcPos;
+   const char* m_pcEnd;
+
+   QuicTime m_llLastTime;
+   QuicPacketNumber m_iLastSent;
+   QuicPacketNumber m_iLastEvent;
+};
+
+
+#endif
@@ -154,7 +154,8 @@ enum UDTOpt
    UDT_STATE,		// current socket state, see UDTSTATUS, read only
    UDT_EVENT,		// current avalable events associated with the socket
    UDT_SNDDATA,		// size of data in the sending buffer
-   UDT_RCVDATA		// size of data available for recv
+   UDT_RCVDATA,		// size of data available for recv
+   UDT_FIXEDBW		// fixed bandwidth (bytes per second) the connection is paced at, whatever PCC decides
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -189,6 +190,13 @@ struct CPerfMon
    double mbpsRecvRate;                 // receiving rate in Mb/s
    int64_t usSndDuration;		// busy sending time (i.e., idle time exclusive)
    double mbpsGoodput;		// busy sending time (i.e., idle time exclusive)
+   double usPacingErrorP50;             // median lateness of a data packet behind its pacing time, in microseconds
+   double usPacingErrorP90;             // 90th percentile of the lateness
+   double usPacingErrorP99;             // 99th percentile of the lateness
+   double usPacingErrorP999;            // 99.9th percentile of the lateness
+   double usPacingErrorMax;             // largest lateness
+   double usPccLockWait;                // time the data path waited for the PCC sender lock, in microseconds
+   int pktPccLockContended;             // number of times the data path had to wait for the PCC sender lock
 
    // instant measurements
    double usPktSndPeriod;               // packet sending period, in microseconds
@@ -199,6 +207,12 @@ struct CPerfMon
    double mbpsBandwidth;                // estimated bandwidth, in Mb/s
    int byteAvailSndBuf;                 // available UDT sender buffer size
    int byteAvailRcvBuf;                 // available UDT receiver buffer size
+   double usSndQueueLag;                // lateness the sender has yet to make up against its pacing schedule, in microseconds
+   int pktTrackerOccupancy;             // packets held by the sender: queued, on flight or waiting for retransmission
+   int pccMode;                         // PCC sender mode: 0 starting, 1 probing, 2 decision made
+   double mbpsPccRate;                  // sending rate chosen by PCC, in Mb/s
+   double pccUtility;                   // utility of the last monitor interval PCC computed one for
+   int pccIntervals;                    // PCC monitor intervals waiting for their packets to be acked or lost
 };
 
 ////////////////////////////////////////////////////////////////////////////////
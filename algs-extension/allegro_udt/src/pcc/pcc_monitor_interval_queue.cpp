@@ -9,7 +9,7 @@
 #else
 #include "pcc_monitor_interval_queue.h"
 #include "pcc_sender.h"
-#include <iostream>
+#include "../core/eventtrace.h"
 #endif
 
 #ifdef QUIC_PORT
@@ -21,14 +21,6 @@ DEFINE_bool(use_utility_version_2, false, "Use version-2 utility function");
 #endif
 #endif
 
-#ifndef QUIC_PORT
-//#define DEBUG_UTILITY_CALC
-//#define DEBUG_MONITOR_INTERVAL_QUEUE_ACKS
-//#define DEBUG_MONITOR_INTERVAL_QUEUE_LOSS
-//#define DEBUG_INTERVAL_SIZE
-
-#endif
-
 namespace {
 // Number of probing MonitorIntervals necessary for Probing.
 //const size_t kRoundsPerProbing = 4;
@@ -188,6 +180,10 @@ void PccMonitorIntervalQueue::EnqueueNewMonitorInterval(
   monitor_intervals_.emplace_back(sending_rate, is_useful,
                                   rtt_fluctuation_tolerance_ratio, rtt_us,
                                   end_time);
+  #ifndef QUIC_PORT
+  CEventTrace::trace(CEventRecord::MI_START, delegate_->trace_id(), is_useful,
+                     rtt_us, sending_rate);
+  #endif
 }
 
 void PccMonitorIntervalQueue::OnPacketSent(QuicTime sent_time,
@@ -210,11 +206,6 @@ void PccMonitorIntervalQueue::OnPacketSent(QuicTime sent_time,
   monitor_intervals_.back().last_packet_number = packet_number;
   monitor_intervals_.back().bytes_sent += bytes;
   ++monitor_intervals_.back().n_packets;
-  #if ! defined(QUIC_PORT) && defined(DEBUG_INTERVAL_SIZE)
-  if (monitor_intervals_.back().is_useful) {
-    std::cerr << "Added packet " << packet_number << " to monitor interval, now " << monitor_intervals_.back().bytes_sent << " bytes " << std::endl;
-  }
-  #endif
 }
 
 void PccMonitorIntervalQueue::OnCongestionEvent(
@@ -244,12 +235,6 @@ void PccMonitorIntervalQueue::OnCongestionEvent(
     for (const LostPacket& lost_packet : lost_packets) {
       if (IntervalContainsPacket(interval, lost_packet.packet_number)) {
         interval.bytes_lost += lost_packet.bytes_lost;
-        #if (! defined(QUIC_PORT)) && defined(DEBUG_MONITOR_INTERVAL_QUEUE_LOSS)
-        std::cerr << "\tattributed bytes to an interval" << std::endl;
-        std::cerr << "\tacked " << interval.bytes_acked << "/" << interval.bytes_sent << std::endl;
-        std::cerr << "\tlost " << interval.bytes_lost << "/" << interval.bytes_sent << std::endl;
-        std::cerr << "\ttotal " << interval.bytes_lost + interval.bytes_acked << "/" << interval.bytes_sent << std::endl;
-        #endif
       }
     }
 
@@ -262,17 +247,21 @@ void PccMonitorIntervalQueue::OnCongestionEvent(
             #else
             rtt_us));
             #endif
-        #if (! defined(QUIC_PORT)) && defined(DEBUG_MONITOR_INTERVAL_QUEUE_ACKS)
-        std::cerr << "\tattributed bytes to an interval" << std::endl;
-        std::cerr << "\tacked " << interval.bytes_acked << "/" << interval.bytes_sent << std::endl;
-        std::cerr << "\tlost " << interval.bytes_lost << "/" << interval.bytes_sent << std::endl;
-        std::cerr << "\ttotal " << interval.bytes_lost + interval.bytes_acked << "/" << interval.bytes_sent << std::endl;
-        #endif
       }
     }
 
     if (IsUtilityAvailable(interval, event_time)) {
       interval.rtt_on_monitor_end_us = rtt_us;
+      #ifndef QUIC_PORT
+      CEventTrace::trace(CEventRecord::MI_END, delegate_->trace_id(),
+                         interval.n_packets,
+                         interval.last_packet_sent_time -
+                             interval.first_packet_sent_time,
+                         interval.bytes_sent > 0
+                             ? static_cast<double>(interval.bytes_lost) /
+                                   interval.bytes_sent
+                             : 0.0);
+      #endif
       #ifdef QUIC_PORT
       has_invalid_utility = FLAGS_use_utility_version_2
                                 ? !CalculateUtility2(&interval)
@@ -290,10 +279,6 @@ void PccMonitorIntervalQueue::OnCongestionEvent(
     }
   }
 
-#if (!defined(QUIC_PORT)) && defined(DEBUG_INTERVAL_SIZE)
-    std::cerr << "Num useful = " << num_useful_intervals_ << ", num avail = " << num_available_intervals_ << std::endl;
-#endif
-
   if (num_useful_intervals_ > num_available_intervals_ &&
       !has_invalid_utility) {
     return;
@@ -364,9 +349,6 @@ bool PccMonitorIntervalQueue::IsUtilityAvailable(
 bool PccMonitorIntervalQueue::IntervalContainsPacket(
     const MonitorInterval& interval,
     QuicPacketNumber packet_number) const {
-    #if ! defined(QUIC_PORT) && (defined(DEBUG_MONITOR_INTERVAL_QUEUE_LOSS) || defined(DEBUG_MONITOR_INTERVAL_QUEUE_ACKS))
-    std::cerr << "Checking for packet " << packet_number << " in interval: [" << interval.first_packet_number << ", " << interval.last_packet_number << "]" << std::endl;
-    #endif
   return (packet_number >= interval.first_packet_number &&
           packet_number <= interval.last_packet_number);
 }
@@ -459,19 +441,12 @@ bool PccMonitorIntervalQueue::CalculateUtility(MonitorInterval* interval) {
       (loss_contribution + rtt_contribution) *
       (sending_rate_bps / kMegabit) / static_cast<float>(interval->n_packets);
 
-  #if !defined(QUIC_PORT) && defined(DEBUG_UTILITY_CALC)
-  std::cerr << "Calculate utility:" << std::endl;
-  std::cerr << "\tutility           = " << current_utility << std::endl;
-  std::cerr << "\tn_packets         = " << interval->n_packets << std::endl;
-  std::cerr << "\ttarget send_rate  = " << interval->sending_rate / 1000000.0f << std::endl;
-  std::cerr << "\tactual send_rate  = " << bytes_sent * 8.0f / (mi_time_seconds * 1000000.0f) << std::endl;
-  std::cerr << "\tthroughput        = " << (bytes_sent - bytes_lost) * 8.0f / (mi_time_seconds * 1000000.0f) << std::endl;
-  std::cerr << "\tthroughput factor = " << sending_factor << std::endl;
-  std::cerr << "\tavg_rtt           = " << (rtt_first_half_sum + rtt_second_half_sum) / (2 * half_samples) << std::endl;
-  std::cerr << "\tlatency_infla.    = " << latency_inflation << std::endl;
-  std::cerr << "\trtt_contribution  = " << rtt_contribution << std::endl;
-  std::cerr << "\tloss_rate         = " << loss_rate << std::endl;
-  std::cerr << "\tloss_contribution = " << loss_contribution << std::endl;
+  #ifndef QUIC_PORT
+  CEventTrace::trace(CEventRecord::UTILITY, delegate_->trace_id(),
+                     sending_rate_bps / 1000.0f,
+                     std::isfinite(latency_inflation)
+                         ? latency_inflation * 1000000.0f : 0.0f,
+                     current_utility);
   #endif
 
   interval->utility = current_utility;
@@ -12,8 +12,7 @@
 #endif
 #else
 #include "pcc_sender.h"
-
-//#define DEBUG_RATE_CONTROL
+#include "../core/eventtrace.h"
 #endif
 
 #include <algorithm>
@@ -129,6 +128,14 @@ PccSender::PccSender(QuicTime initial_rtt_us,
       interval_queue_(/*delegate=*/this),
       #ifndef QUIC_PORT
       avg_rtt_(0),
+      trace_id_(0),
+      random_seed_(rand()),
+      last_utility_(0),
+      snapshot_seq_(0),
+      snapshot_mode_(STARTING),
+      snapshot_rate_(0),
+      snapshot_utility_(0),
+      snapshot_intervals_(0),
       #endif
       avg_gradient_(0),
       swing_buffer_(0),
@@ -144,6 +151,7 @@ PccSender::PccSender(QuicTime initial_rtt_us,
   latest_utility_info_.sending_rate = QuicBandwidth::Zero();
   #else
   latest_utility_info_.sending_rate = 0;
+  PublishSnapshot();
   #endif
 }
 
@@ -211,6 +219,9 @@ void PccSender::OnPacketSent(QuicTime sent_time,
     #endif
   }
   interval_queue_.OnPacketSent(sent_time, packet_number, bytes);
+  #ifndef QUIC_PORT
+  PublishSnapshot();
+  #endif
 }
 
 void PccSender::OnCongestionEvent(bool rtt_updated,
@@ -251,6 +262,9 @@ void PccSender::OnCongestionEvent(bool rtt_updated,
       // ratio, so as to reduce packet losses and mitigate rtt inflation.
       interval_queue_.OnRttInflationInStarting();
       EnterProbing();
+      #ifndef QUIC_PORT
+      PublishSnapshot();
+      #endif
       return;
     }
   }
@@ -259,6 +273,9 @@ void PccSender::OnCongestionEvent(bool rtt_updated,
                                     lost_packets,
                                     avg_rtt_us, 
                                     event_time);
+  #ifndef QUIC_PORT
+  PublishSnapshot();
+  #endif
 }
 
 #ifdef QUIC_PORT
@@ -451,17 +468,6 @@ QuicBandwidth PccSender::ComputeRateChange(
     change = kMinimumRateChange;
   }
 
-  #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-    std::cerr << "CalculateRateChange:" << std::endl;
-    std::cerr << "\tUtility 1    = " << utility_sample_1.utility << std::endl;
-    std::cerr << "\tRate 1       = " << utility_sample_1.sending_rate << "mbps" << std::endl    ;
-    std::cerr << "\tUtility 2    = " << utility_sample_2.utility << std::endl;
-    std::cerr << "\tRate 2       = " << utility_sample_2.sending_rate << "mbps" << std::endl    ;
-    std::cerr << "\tGradient     = " << utility_gradient << std::endl;
-    std::cerr << "\tAvg Gradient = " << avg_gradient_ << std::endl;
-    std::cerr << "\tRate Change  = " << change << "mbps" << std::endl;
-  #endif
-
   return change;
 }
 
@@ -483,8 +489,15 @@ void PccSender::UpdateAverageGradient(float new_gradient) {
 
 void PccSender::OnUtilityAvailable(
     const std::vector<UtilityInfo>& utility_info) {
-  #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-      std::cerr << "OnUtilityAvailable" << std::endl;
+  #ifndef QUIC_PORT
+  // An interval that completed before its end time was skipped by the queue
+  // without a utility, which is left at 0; report the latest computed one.
+  for (auto it = utility_info.rbegin(); it != utility_info.rend(); ++it) {
+    if (it->utility != 0) {
+      last_utility_ = it->utility;
+      break;
+    }
+  }
   #endif
   switch (mode_) {
     case STARTING:
@@ -495,8 +508,8 @@ void PccSender::OnUtilityAvailable(
         // Stay in STARTING mode. Double the sending rate and update
         // latest_utility.
         sending_rate_ = sending_rate_ * 2;
-        #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-        std::cerr << "Starting mode rate: " << sending_rate_ / 2.0 << "-->" << sending_rate_ << std::endl;
+        #ifndef QUIC_PORT
+        TraceRate();
         #endif
         latest_utility_info_ = utility_info[0];
         ++rounds_;
@@ -557,8 +570,8 @@ void PccSender::OnUtilityAvailable(
         // sending rate.
         previous_change_ = rate_change;
         sending_rate_ = sending_rate_ + rate_change;
-        #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-        std::cerr << "Decision made rate: " << sending_rate_ - rate_change << "-->" << sending_rate_ << std::endl;
+        #ifndef QUIC_PORT
+        TraceRate();
         #endif
         latest_utility_info_ = utility_info[0];
       } else {
@@ -580,6 +593,58 @@ void PccSender::SetFlag(double val) {
   FLAGS_max_rtt_fluctuation_tolerance_ratio_in_decision_made = val;
 }
 
+#endif
+#ifndef QUIC_PORT
+void PccSender::WarmStart(QuicBandwidth sending_rate, QuicTime min_rtt_us) {
+  if (!interval_queue_.empty() || sending_rate < kMinSendingRate ||
+      min_rtt_us <= 0) {
+    return;
+  }
+  sending_rate_ = sending_rate;
+  avg_rtt_ = min_rtt_us;
+  mode_ = PROBING;
+  rounds_ = 1;
+  TraceRate();
+  PublishSnapshot();
+}
+
+QuicBandwidth PccSender::ConvergedRate() const {
+  return mode_ == STARTING ? 0 : sending_rate_;
+}
+
+void PccSender::TraceRate() const {
+  CEventTrace::trace(CEventRecord::RATE, trace_id_, mode_, 0, sending_rate_);
+}
+
+void PccSender::PublishSnapshot() {
+  // Callers are serialized, so only readers race with the writes.
+  uint32_t seq = snapshot_seq_.load(std::memory_order_relaxed);
+  snapshot_seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  snapshot_mode_.store(mode_, std::memory_order_relaxed);
+  snapshot_rate_.store(sending_rate_, std::memory_order_relaxed);
+  snapshot_utility_.store(last_utility_, std::memory_order_relaxed);
+  snapshot_intervals_.store(interval_queue_.size(), std::memory_order_relaxed);
+  snapshot_seq_.store(seq + 2, std::memory_order_release);
+}
+
+PccSender::Snapshot PccSender::GetSnapshot() const {
+  Snapshot snapshot;
+  uint32_t seq;
+  do {
+    seq = snapshot_seq_.load(std::memory_order_acquire);
+    snapshot.mode =
+        static_cast<SenderMode>(snapshot_mode_.load(std::memory_order_relaxed));
+    snapshot.sending_rate = snapshot_rate_.load(std::memory_order_relaxed);
+    snapshot.last_utility = snapshot_utility_.load(std::memory_order_relaxed);
+    snapshot.num_intervals =
+        snapshot_intervals_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1) != 0 ||
+           seq != snapshot_seq_.load(std::memory_order_relaxed));
+  return snapshot;
+}
+
 #endif
 bool PccSender::CreateUsefulInterval() const {
   #ifdef QUIC_PORT
@@ -617,13 +682,13 @@ void PccSender::MaybeSetSendingRate() {
     // Restore central sending rate.
     if (direction_ == INCREASE) {
       sending_rate_ = sending_rate_ * (1.0 / (1 + kProbingStepSize));
-      #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-      std::cerr << "Maybe undo increase: " << sending_rate_ * (1.0 + kProbingStepSize) << "-->" << sending_rate_ << std::endl;
+      #ifndef QUIC_PORT
+      TraceRate();
       #endif
     } else {
       sending_rate_ = sending_rate_ * (1.0 / (1 - kProbingStepSize));
-      #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-      std::cerr << "Maybe undo decrease: " << sending_rate_ * (1.0 - kProbingStepSize) << "-->" << sending_rate_ << std::endl;
+      #ifndef QUIC_PORT
+      TraceRate();
       #endif
     }
 
@@ -639,19 +704,23 @@ void PccSender::MaybeSetSendingRate() {
   // interval with increased sending rate and an interval with decreased sending
   // rate. Which interval goes first is randomly decided.
   if (interval_queue_.num_useful_intervals() % 2 == 0) {
+    #ifdef QUIC_PORT
     direction_ = (rand() % 2 == 1) ? INCREASE : DECREASE;
+    #else
+    direction_ = (rand_r(&random_seed_) % 2 == 1) ? INCREASE : DECREASE;
+    #endif
   } else {
     direction_ = (direction_ == INCREASE) ? DECREASE : INCREASE;
   }
   if (direction_ == INCREASE) {
     sending_rate_ = sending_rate_ * (1 + kProbingStepSize);
-    #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-    std::cerr << "Maybe probe increase: " << sending_rate_ / (1.0 + kProbingStepSize) << "-->" << sending_rate_ << std::endl;
+    #ifndef QUIC_PORT
+    TraceRate();
     #endif
   } else {
     sending_rate_ = sending_rate_ * (1 - kProbingStepSize);
-    #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-    std::cerr << "Maybe probe decrease: " << sending_rate_ / (1.0 - kProbingStepSize) << "-->" << sending_rate_ << std::endl;
+    #ifndef QUIC_PORT
+    TraceRate();
     #endif
   }
 }
@@ -694,8 +763,8 @@ void PccSender::EnterProbing() {
     case STARTING:
       // Use half sending_rate_ as central probing rate.
       sending_rate_ = sending_rate_ * 0.5;
-      #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-      std::cerr << "Probing after starting: " << sending_rate_ * 2.0 << "-->" << sending_rate_ << std::endl;
+      #ifndef QUIC_PORT
+      TraceRate();
       #endif
       break;
     case DECISION_MADE:
@@ -705,17 +774,15 @@ void PccSender::EnterProbing() {
         sending_rate_ = sending_rate_ *
                         (1.0 / (1 + std::min(rounds_ * kDecisionMadeStepSize,
                                              kMaxDecisionMadeStepSize)));
-      #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-      std::cerr << "Decision made resotore: " << sending_rate_ * (1.0 + std::min(rounds_ * kDecisionMadeStepSize,
-      kMaxDecisionMadeStepSize)) << "-->" << sending_rate_ << std::endl;
+      #ifndef QUIC_PORT
+      TraceRate();
       #endif
       } else {
         sending_rate_ = sending_rate_ *
                         (1.0 / (1 - std::min(rounds_ * kDecisionMadeStepSize,
                                              kMaxDecisionMadeStepSize)));
-      #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-      std::cerr << "Decision made resotore: " << sending_rate_ * (1.0 - std::min(rounds_ * kDecisionMadeStepSize,
-      kMaxDecisionMadeStepSize)) << "-->" << sending_rate_ << std::endl;
+      #ifndef QUIC_PORT
+      TraceRate();
       #endif
       }
       break;
@@ -725,13 +792,13 @@ void PccSender::EnterProbing() {
       if (interval_queue_.current().is_useful) {
         if (direction_ == INCREASE) {
           sending_rate_ = sending_rate_ * (1.0 / (1 + kProbingStepSize));
-          #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-          std::cerr << "Probing restore: " << sending_rate_ * (1.0 + kProbingStepSize) << "-->" << sending_rate_ << std::endl;
+          #ifndef QUIC_PORT
+          TraceRate();
           #endif
         } else {
           sending_rate_ = sending_rate_ * (1.0 / (1 - kProbingStepSize));
-          #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-          std::cerr << "Probing restore: " << sending_rate_ * (1.0 - kProbingStepSize) << "-->" << sending_rate_ << std::endl;
+          #ifndef QUIC_PORT
+          TraceRate();
           #endif
         }
       }
@@ -751,10 +818,10 @@ void PccSender::EnterDecisionMade(QuicBandwidth new_rate) {
   #ifdef QUIC_PORT
   DCHECK_EQ(PROBING, mode_);
   #endif
-  #if ! defined(QUIC_PORT) && defined(DEBUG_RATE_CONTROL)
-  std::cerr << "Made decision: " << sending_rate_ << "-->" << new_rate << std::endl;
-  #endif
   sending_rate_ = new_rate;
+  #ifndef QUIC_PORT
+  TraceRate();
+  #endif
   mode_ = DECISION_MADE;
   rounds_ = 1;
 }
@@ -27,6 +27,7 @@
 #endif
 #else
 #include "pcc_monitor_interval_queue.h"
+#include <atomic>
 #include <iostream>
 #define QUIC_EXPORT_PRIVATE
 
@@ -186,6 +187,38 @@ class QUIC_EXPORT_PRIVATE PccSender
   #if defined(QUIC_PORT) && defined(QUIC_PORT_LOCAL)
   void SetFlag(double val);
   #endif
+
+  #ifndef QUIC_PORT
+  // Seeds the sender with the rate and minimum RTT learned by an earlier
+  // connection on the same path, so it skips STARTING and probes around that
+  // rate directly. Must be called before the first packet is sent.
+  void WarmStart(QuicBandwidth sending_rate, QuicTime min_rtt_us);
+  // Returns the rate the sender has settled on, or 0 while still in STARTING.
+  QuicBandwidth ConvergedRate() const;
+  // UDT socket ID that tags the sender's records in the event trace.
+  void set_trace_id(int32_t trace_id) { trace_id_ = trace_id; }
+  int32_t trace_id() const { return trace_id_; }
+  // Seeds the choice of which rate a probing group tries first. Senders fed
+  // the same calls after the same seed make the same decisions.
+  void set_random_seed(unsigned int seed) { random_seed_ = seed; }
+
+  // State of the sender as of its last OnPacketSent, OnCongestionEvent or
+  // WarmStart call.
+  struct Snapshot {
+    SenderMode mode;
+    QuicBandwidth sending_rate;
+    // Utility of the last monitor interval with a computed utility, 0
+    // before the first.
+    float last_utility;
+    // Monitor intervals in the queue, waiting for their packets to be acked
+    // or lost.
+    size_t num_intervals;
+  };
+  // Returns a consistent Snapshot. Safe on any thread while another one
+  // drives the sender: the sender publishes under a sequence lock and the
+  // reader retries instead of blocking it.
+  Snapshot GetSnapshot() const;
+  #endif
  private:
   #ifdef QUIC_PORT
   friend class test::PccSenderPeer;
@@ -202,6 +235,12 @@ class QUIC_EXPORT_PRIVATE PccSender
   void EnterProbing();
   // Set the sending rate when entering DECISION_MADE from PROBING mode.
   void EnterDecisionMade(QuicBandwidth new_rate);
+  #ifndef QUIC_PORT
+  // Records sending_rate_ and the mode that set it in the event trace.
+  void TraceRate() const;
+  // Publishes the state returned by GetSnapshot().
+  void PublishSnapshot();
+  #endif
 
   // Current mode of PccSender.
   SenderMode mode_;
@@ -233,6 +272,17 @@ class QUIC_EXPORT_PRIVATE PccSender
   QuicRandom* random_;
   #else
   QuicTime avg_rtt_;
+  int32_t trace_id_;
+  // State of the generator behind the probing direction, see set_random_seed().
+  unsigned int random_seed_;
+  // Utility of the last monitor interval with a computed utility.
+  float last_utility_;
+  // Odd while PublishSnapshot() writes the snapshot_ fields.
+  std::atomic<uint32_t> snapshot_seq_;
+  std::atomic<int> snapshot_mode_;
+  std::atomic<QuicBandwidth> snapshot_rate_;
+  std::atomic<float> snapshot_utility_;
+  std::atomic<size_t> snapshot_intervals_;
   #endif
 
   // The number of consecutive rate changes in a single direction
@@ -0,0 +1,51 @@
+#ifndef _KSHIM_LINUX_INET_DIAG_H
+#define _KSHIM_LINUX_INET_DIAG_H
+
+#include <linux/skbuff.h>
+#include <linux/string.h>
+
+enum {
+	INET_DIAG_NONE,
+	INET_DIAG_MEMINFO,
+	INET_DIAG_INFO,
+	INET_DIAG_VEGASINFO,
+	INET_DIAG_CONG,
+};
+
+struct tcpvegas_info {
+	__u32 tcpv_enabled;
+	__u32 tcpv_rttcnt;
+	__u32 tcpv_rtt;
+	__u32 tcpv_minrtt;
+};
+
+union tcp_cc_info {
+	struct tcpvegas_info vegas;
+};
+
+/* rtnetlink attributes, for the get_info of Linux 2.6 */
+struct rtattr {
+	unsigned short rta_len;
+	unsigned short rta_type;
+};
+
+#define RTA_ALIGNTO		4U
+#define RTA_ALIGN(len)		(((len) + RTA_ALIGNTO - 1) & ~(RTA_ALIGNTO - 1))
+#define RTA_LENGTH(len)		(RTA_ALIGN(sizeof(struct rtattr)) + (len))
+#define RTA_DATA(rta)		((void *)(((char *)(rta)) + RTA_LENGTH(0)))
+
+static inline struct rtattr *__rta_reserve(struct sk_buff *skb, int attrtype, int attrlen)
+{
+	struct rtattr *rta;
+	int size = RTA_LENGTH(attrlen);
+
+	rta = (struct rtattr *)skb_put(skb, RTA_ALIGN(size));
+	rta->rta_type = attrtype;
+	rta->rta_len = size;
+	memset(RTA_DATA(rta) + attrlen, 0, RTA_ALIGN(size) - size);
+	return rta;
+}
+
+#define __RTA_PUT(skb, attrtype, attrlen) __rta_reserve(skb, attrtype, attrlen)
+
+#endif /* _KSHIM_LINUX_INET_DIAG_H */
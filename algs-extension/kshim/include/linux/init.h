@@ -0,0 +1,8 @@
+#ifndef _KSHIM_LINUX_INIT_H
+#define _KSHIM_LINUX_INIT_H
+
+#define __init
+#define __exit
+#define __read_mostly
+
+#endif /* _KSHIM_LINUX_INIT_H */
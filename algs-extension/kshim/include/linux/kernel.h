@@ -0,0 +1,151 @@
+#ifndef _KSHIM_LINUX_KERNEL_H
+#define _KSHIM_LINUX_KERNEL_H
+
+/* The parts of the kernel core API that the congestion control modules use,
+ * implemented in userspace. Time is the virtual clock of the simulator, which
+ * sets kshim_now_us (and jiffies, at HZ 1000) before every call into a module.
+ */
+
+#include <linux/types.h>
+
+#define HZ 1000
+
+#define USEC_PER_MSEC	1000L
+#define MSEC_PER_SEC	1000L
+#define USEC_PER_SEC	1000000L
+#define NSEC_PER_USEC	1000L
+#define NSEC_PER_MSEC	1000000L
+#define NSEC_PER_SEC	1000000000L
+
+#define U8_MAX		((u8)~0U)
+#define U16_MAX		((u16)~0U)
+#define U32_MAX		((u32)~0U)
+#define U64_MAX		((u64)~0ULL)
+#define S32_MAX		((s32)(U32_MAX >> 1))
+#define S32_MIN		((s32)(-S32_MAX - 1))
+#define S64_MAX		((s64)(U64_MAX >> 1))
+#define S64_MIN		((s64)(-S64_MAX - 1))
+#define INT_MAX		((int)(~0U >> 1))
+#define INT_MIN		(-INT_MAX - 1)
+#define UINT_MAX	(~0U)
+#define LONG_MAX	((long)(~0UL >> 1))
+#define ULONG_MAX	(~0UL)
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+#define min(x, y) ({ __typeof__(x) _min1 = (x); __typeof__(y) _min2 = (y); _min1 < _min2 ? _min1 : _min2; })
+#define max(x, y) ({ __typeof__(x) _max1 = (x); __typeof__(y) _max2 = (y); _max1 > _max2 ? _max1 : _max2; })
+#define min_t(type, x, y) ({ type _min1 = (x); type _min2 = (y); _min1 < _min2 ? _min1 : _min2; })
+#define max_t(type, x, y) ({ type _max1 = (x); type _max2 = (y); _max1 > _max2 ? _max1 : _max2; })
+#define clamp(val, lo, hi) min(max(val, lo), hi)
+#define clamp_t(type, val, lo, hi) min_t(type, max_t(type, val, lo), hi)
+#define abs(x) ({ int __x = (x); (__x < 0) ? -__x : __x; })
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define BUILD_BUG_ON(condition) ((void)sizeof(char[1 - 2 * !!(condition)]))
+#define BUG_ON(condition) do { if (unlikely(condition)) kshim_bug(__FILE__, __LINE__); } while (0)
+#define WARN_ON_ONCE(condition) unlikely(condition)
+
+/* divides the 64 bit n in place and returns the remainder */
+#define do_div(n, base) ({						\
+	u32 __base = (base);						\
+	u32 __rem = (u32)((u64)(n) % __base);				\
+	(n) = (u64)(n) / __base;					\
+	__rem;								\
+})
+
+static inline int fls(unsigned int x)
+{
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+
+static inline int fls64(u64 x)
+{
+	return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+/* printk levels, stripped by printk */
+#define KERN_SOH	"\001"
+#define KERN_EMERG	KERN_SOH "0"
+#define KERN_ALERT	KERN_SOH "1"
+#define KERN_CRIT	KERN_SOH "2"
+#define KERN_ERR	KERN_SOH "3"
+#define KERN_WARNING	KERN_SOH "4"
+#define KERN_NOTICE	KERN_SOH "5"
+#define KERN_INFO	KERN_SOH "6"
+#define KERN_DEBUG	KERN_SOH "7"
+
+/* writes to stderr when kshim_verbose is set, with the virtual time */
+int printk(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+void kshim_bug(const char *file, int line) __attribute__((noreturn));
+
+/* virtual time */
+extern u64 kshim_now_us;
+extern unsigned long volatile jiffies;
+extern int kshim_verbose;
+
+#define time_after(a, b)	((long)((b) - (a)) < 0)
+#define time_before(a, b)	time_after(b, a)
+#define time_after_eq(a, b)	((long)((a) - (b)) >= 0)
+#define time_before_eq(a, b)	time_after_eq(b, a)
+
+static inline unsigned int jiffies_to_msecs(const unsigned long j)
+{
+	return (unsigned int)j;
+}
+
+static inline unsigned int jiffies_to_usecs(const unsigned long j)
+{
+	return (unsigned int)(j * USEC_PER_MSEC);
+}
+
+static inline unsigned long msecs_to_jiffies(const unsigned int m)
+{
+	return m;
+}
+
+static inline unsigned long usecs_to_jiffies(const unsigned int u)
+{
+	return (u + USEC_PER_MSEC - 1) / USEC_PER_MSEC;
+}
+
+static inline unsigned long get_seconds(void)
+{
+	return (unsigned long)(kshim_now_us / USEC_PER_SEC);
+}
+
+static inline ktime_t ktime_get(void)
+{
+	return (ktime_t)kshim_now_us * NSEC_PER_USEC;
+}
+
+static inline ktime_t ktime_get_real(void)
+{
+	return ktime_get();
+}
+
+static inline s64 ktime_to_us(const ktime_t kt)
+{
+	return kt / NSEC_PER_USEC;
+}
+
+static inline s64 ktime_to_ms(const ktime_t kt)
+{
+	return kt / NSEC_PER_MSEC;
+}
+
+/* no concurrency in the simulator: a plain compare and exchange */
+#define cmpxchg(ptr, old, new) ({					\
+	__typeof__(*(ptr)) __cur = *(ptr);				\
+	if (__cur == (old))						\
+		*(ptr) = (new);						\
+	__cur;								\
+})
+
+#define READ_ONCE(x) (x)
+#define WRITE_ONCE(x, val) ((x) = (val))
+
+#endif /* _KSHIM_LINUX_KERNEL_H */
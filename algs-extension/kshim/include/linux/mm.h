@@ -0,0 +1,6 @@
+#ifndef _KSHIM_LINUX_MM_H
+#define _KSHIM_LINUX_MM_H
+
+#include <linux/slab.h>
+
+#endif /* _KSHIM_LINUX_MM_H */
@@ -0,0 +1,54 @@
+#ifndef _KSHIM_LINUX_MODULE_H
+#define _KSHIM_LINUX_MODULE_H
+
+/* Module boilerplate. Every module is linked into the simulator, and its
+ * module_init function runs from a constructor before main(), so the
+ * congestion control it registers is available by name. KBUILD_MODNAME is set
+ * by the Makefile to the directory of the module, as kbuild sets it to the
+ * module name, and tells apart the two "pcc" modules.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+
+#ifndef KBUILD_MODNAME
+#define KBUILD_MODNAME "unknown"
+#endif
+
+struct module;
+#define THIS_MODULE ((struct module *)0)
+
+/* name of the module whose constructor is running */
+extern const char *kshim_module_name;
+
+void kshim_param_register(const char *module, const char *name, int *value);
+
+#define module_init(fn)							\
+	static void __attribute__((constructor)) __kshim_init_##fn(void)	\
+	{								\
+		kshim_module_name = KBUILD_MODNAME;			\
+		fn();							\
+		kshim_module_name = 0;					\
+	}
+
+#define module_exit(fn)							\
+	static void (*__kshim_exit_##fn)(void) __attribute__((unused)) = fn
+
+/* only int parameters are used by the modules */
+#define module_param(name, type, perm)					\
+	static void __attribute__((constructor)) __kshim_param_##name(void)	\
+	{								\
+		kshim_param_register(KBUILD_MODNAME, #name, &name);	\
+	}
+
+#define MODULE_PARM_DESC(name, desc)
+#define MODULE_AUTHOR(author)
+#define MODULE_LICENSE(license)
+#define MODULE_DESCRIPTION(desc)
+#define MODULE_VERSION(version)
+#define MODULE_ALIAS(alias)
+
+#define EXPORT_SYMBOL(sym)
+#define EXPORT_SYMBOL_GPL(sym)
+
+#endif /* _KSHIM_LINUX_MODULE_H */
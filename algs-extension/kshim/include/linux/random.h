@@ -0,0 +1,10 @@
+#ifndef _KSHIM_LINUX_RANDOM_H
+#define _KSHIM_LINUX_RANDOM_H
+
+#include <linux/types.h>
+
+/* a seeded generator, so that a simulation is repeatable */
+void get_random_bytes(void *buf, int nbytes);
+u32 prandom_u32(void);
+
+#endif /* _KSHIM_LINUX_RANDOM_H */
@@ -0,0 +1,24 @@
+#ifndef _KSHIM_LINUX_SKBUFF_H
+#define _KSHIM_LINUX_SKBUFF_H
+
+#include <linux/kernel.h>
+
+/* Only what a get_info callback needs to append a netlink attribute. The
+ * simulator has no netlink and never calls get_info.
+ */
+struct sk_buff {
+	unsigned char *data;
+	unsigned int len;
+	unsigned int size;
+};
+
+static inline void *skb_put(struct sk_buff *skb, unsigned int len)
+{
+	void *tail = skb->data + skb->len;
+
+	BUG_ON(skb->len + len > skb->size);
+	skb->len += len;
+	return tail;
+}
+
+#endif /* _KSHIM_LINUX_SKBUFF_H */
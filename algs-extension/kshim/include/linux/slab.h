@@ -0,0 +1,15 @@
+#ifndef _KSHIM_LINUX_SLAB_H
+#define _KSHIM_LINUX_SLAB_H
+
+#include <linux/types.h>
+
+#define GFP_KERNEL	0U
+#define GFP_ATOMIC	1U
+#define GFP_NOWAIT	2U
+
+/* the C library allocator, so that allocation failures are not simulated */
+void *kmalloc(size_t size, gfp_t flags);
+void *kzalloc(size_t size, gfp_t flags);
+void kfree(const void *p);
+
+#endif /* _KSHIM_LINUX_SLAB_H */
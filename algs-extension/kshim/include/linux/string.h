@@ -0,0 +1,6 @@
+#ifndef _KSHIM_LINUX_STRING_H
+#define _KSHIM_LINUX_STRING_H
+
+#include <string.h>
+
+#endif /* _KSHIM_LINUX_STRING_H */
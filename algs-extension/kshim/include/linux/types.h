@@ -0,0 +1,39 @@
+#ifndef _KSHIM_LINUX_TYPES_H
+#define _KSHIM_LINUX_TYPES_H
+
+/* Kernel integer types, with the same widths and signedness as on x86-64, so
+ * that printk formats such as %lld and %llu match.
+ */
+
+#include <stddef.h>
+
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+typedef signed char s8;
+typedef short s16;
+typedef int s32;
+typedef long long s64;
+
+typedef u8 __u8;
+typedef u16 __u16;
+typedef u32 __u32;
+typedef u64 __u64;
+typedef s32 __s32;
+typedef s64 __s64;
+
+#ifndef __cplusplus
+typedef _Bool bool;
+#define true 1
+#define false 0
+#endif
+
+typedef unsigned int gfp_t;
+typedef s64 ktime_t;
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#endif /* _KSHIM_LINUX_TYPES_H */
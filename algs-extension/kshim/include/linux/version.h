@@ -0,0 +1,15 @@
+#ifndef _KSHIM_LINUX_VERSION_H
+#define _KSHIM_LINUX_VERSION_H
+
+/* The shim follows the congestion control API of Linux 4.14. The Makefile
+ * sets KSHIM_KERNEL for a module written for an older kernel, which then sees
+ * the older prototype of the callbacks that changed (see net/tcp.h).
+ */
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + (c))
+#ifdef KSHIM_KERNEL
+#define LINUX_VERSION_CODE KSHIM_KERNEL
+#else
+#define LINUX_VERSION_CODE KERNEL_VERSION(4, 14, 0)
+#endif
+
+#endif /* _KSHIM_LINUX_VERSION_H */
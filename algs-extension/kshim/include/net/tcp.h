@@ -0,0 +1,309 @@
+#ifndef _KSHIM_NET_TCP_H
+#define _KSHIM_NET_TCP_H
+
+/* The TCP socket and congestion control interface of Linux 4.14, as seen by
+ * a congestion control module, for modules linked into the simulator.
+ *
+ * struct tcp_sock holds the fields the modules in algs-extension read, in the
+ * units of the kernel. A few fields and callbacks of older kernels are kept
+ * so that compound (2.6.22) and siad (3.5.7) compile unchanged as well:
+ * tp->srtt, tcp_time_stamp, the in_flight argument of tcp_is_cwnd_limited(),
+ * the min_cwnd and rtt_sample callbacks and the SIAD sysctls. The simulator
+ * (tcpsock.c) keeps all of them up to date.
+ */
+
+#include <linux/kernel.h>
+#include <linux/version.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/skbuff.h>
+#include <linux/inet_diag.h>
+#include <linux/random.h>
+
+#define TCP_INFINITE_SSTHRESH	0x7fffffff
+#define TCP_CA_NAME_MAX		16
+#define TCP_INIT_CWND		10
+
+/* the clock of TCP timestamps, in ms at HZ 1000 */
+#define tcp_time_stamp		((__u32)(jiffies))
+#define tcp_jiffies32		((u32)jiffies)
+
+enum tcp_ca_state {
+	TCP_CA_Open = 0,
+	TCP_CA_Disorder = 1,
+	TCP_CA_CWR = 2,
+	TCP_CA_Recovery = 3,
+	TCP_CA_Loss = 4
+};
+
+enum tcp_ca_event {
+	CA_EVENT_TX_START,	/* first transmit when no packets in flight */
+	CA_EVENT_CWND_RESTART,	/* congestion window restart */
+	CA_EVENT_COMPLETE_CWR,	/* end of congestion recovery */
+	CA_EVENT_LOSS,		/* loss timeout */
+	CA_EVENT_ECN_NO_CE,	/* ECT set, but not CE marked */
+	CA_EVENT_ECN_IS_CE,	/* received CE marked IP packet */
+	CA_EVENT_DELAYED_ACK,	/* delayed ack is sent */
+	CA_EVENT_NON_DELAYED_ACK,
+};
+
+/* in_ack_event() flags */
+enum tcp_ca_ack_event_flags {
+	CA_ACK_SLOWPATH		= (1 << 0),
+	CA_ACK_WIN_UPDATE	= (1 << 1),
+	CA_ACK_ECE		= (1 << 2),
+};
+
+#define TCP_CONG_NON_RESTRICTED	0x1
+#define TCP_CONG_NEEDS_ECN	0x2
+#define TCP_CONG_RTT_STAMP	0x4	/* Linux 2.6: wants usec rtt_sample() */
+
+enum sk_pacing {
+	SK_PACING_NONE		= 0,
+	SK_PACING_NEEDED	= 1,
+	SK_PACING_FQ		= 2,
+};
+
+enum {
+	BPF_SOCK_OPS_VOID,
+	BPF_SOCK_OPS_TIMEOUT_INIT,
+	BPF_SOCK_OPS_RWND_INIT,
+	BPF_SOCK_OPS_TCP_CONNECT_CB,
+	BPF_SOCK_OPS_ACTIVE_ESTABLISHED_CB,
+	BPF_SOCK_OPS_PASSIVE_ESTABLISHED_CB,
+	BPF_SOCK_OPS_NEEDS_ECN,
+	BPF_SOCK_OPS_BASE_RTT,
+};
+
+/* SNMP counters are not kept */
+enum {
+	LINUX_MIB_TCPHYSTARTTRAINDETECT,
+	LINUX_MIB_TCPHYSTARTTRAINCWND,
+	LINUX_MIB_TCPHYSTARTDELAYDETECT,
+	LINUX_MIB_TCPHYSTARTDELAYCWND,
+};
+
+struct net;
+#define NET_INC_STATS(net, field)	do { (void)(net); } while (0)
+#define NET_ADD_STATS(net, field, adnd)	do { (void)(net); (void)(adnd); } while (0)
+
+struct sock {
+	u32 sk_pacing_rate;		/* bytes per second */
+	u32 sk_max_pacing_rate;		/* bytes per second */
+	u32 sk_pacing_status;		/* see enum sk_pacing */
+};
+
+static inline struct net *sock_net(const struct sock *sk)
+{
+	return (struct net *)0;
+}
+
+struct tcp_congestion_ops;
+
+#define ICSK_CA_PRIV_SIZE	(13 * sizeof(u64))
+
+struct inet_connection_sock {
+	struct sock icsk_inet;		/* the inet_sock of the kernel */
+	const struct tcp_congestion_ops *icsk_ca_ops;
+	u8 icsk_ca_state;
+	u64 icsk_ca_priv[13];
+};
+
+struct tcp_options_received {
+	u32 ts_recent_stamp;
+	u32 ts_recent;
+	u32 rcv_tsval;			/* timestamp value of the last ACK */
+	u32 rcv_tsecr;			/* our timestamp echoed by that ACK */
+	u16 saw_tstamp : 1,
+	    tstamp_ok : 1;
+};
+
+struct tcp_sock {
+	struct inet_connection_sock inet_conn;
+
+	u32 snd_una;			/* first byte we want an ack for */
+	u32 snd_nxt;			/* next sequence we send */
+	u32 mss_cache;			/* cached effective mss */
+
+	u32 srtt_us;			/* smoothed round trip time << 3 in usecs */
+	u32 mdev_us;			/* medium deviation */
+	u32 rttvar_us;
+	u32 srtt;			/* Linux < 3.15: smoothed RTT << 3 in jiffies */
+
+	u64 tcp_mstamp;			/* most recent packet received/sent, in usecs */
+	u32 lsndtime;			/* timestamp of last sent data packet */
+
+	u32 packets_out;		/* packets which are "in flight" */
+	u32 retrans_out;		/* retransmitted packets out */
+	u32 sacked_out;			/* SACK'd packets */
+	u32 lost_out;			/* lost packets */
+	u32 max_packets_out;		/* max packets_out in last window */
+	u32 max_packets_seq;		/* right edge of max_packets_out flight */
+	u8 is_cwnd_limited;		/* forward progress limited by snd_cwnd? */
+
+	u32 snd_ssthresh;		/* slow start size threshold */
+	u32 snd_cwnd;			/* sending congestion window */
+	u32 snd_cwnd_cnt;		/* linear increase counter */
+	u32 snd_cwnd_clamp;		/* do not allow snd_cwnd to grow above this */
+	u32 prior_cwnd;			/* cwnd right before starting loss recovery */
+	u32 prior_ssthresh;		/* ssthresh saved at recovery start */
+	u32 high_seq;			/* snd_nxt at onset of congestion */
+
+	u32 delivered;			/* total data packets delivered incl. rexmits */
+	u32 lost;			/* total data packets lost incl. rexmits */
+	u32 data_segs_out;		/* total data segments sent, incl. rexmits */
+	u64 bytes_acked;		/* bytes cumulatively acknowledged */
+	u32 total_retrans;
+
+	struct tcp_options_received rx_opt;
+};
+
+static inline struct tcp_sock *tcp_sk(const struct sock *sk)
+{
+	return (struct tcp_sock *)sk;
+}
+
+static inline struct inet_connection_sock *inet_csk(const struct sock *sk)
+{
+	return (struct inet_connection_sock *)sk;
+}
+
+static inline void *inet_csk_ca(const struct sock *sk)
+{
+	return (void *)inet_csk(sk)->icsk_ca_priv;
+}
+
+/* A rate sample, computed on every ACK (tcp_rate.c) */
+struct rate_sample {
+	u64 prior_mstamp;	/* starting timestamp for interval */
+	u32 prior_delivered;	/* tp->delivered at "prior_mstamp" */
+	s32 delivered;		/* number of packets delivered over interval */
+	long interval_us;	/* time for tp->delivered to incr "delivered" */
+	long rtt_us;		/* RTT of last (S)ACKed packet (or -1) */
+	int losses;		/* number of packets marked lost upon ACK */
+	u32 acked_sacked;	/* number of packets newly (S)ACKed upon ACK */
+	u32 prior_in_flight;	/* in flight before this ACK */
+	bool is_app_limited;	/* is sample from packet with bubble in pipe? */
+	bool is_retrans;	/* is sample from retransmission? */
+};
+
+struct ack_sample {
+	u32 pkts_acked;
+	s32 rtt_us;
+	u32 in_flight;		/* bytes in flight when the packet was sent */
+};
+
+struct tcp_congestion_ops {
+	struct list_head list;
+	u32 key;
+	u32 flags;
+
+	/* initialize private data (optional) */
+	void (*init)(struct sock *sk);
+	/* cleanup private data  (optional) */
+	void (*release)(struct sock *sk);
+
+	/* return slow start threshold (required) */
+	u32 (*ssthresh)(struct sock *sk);
+	/* do new cwnd calculation (required). It is (sk, ack, acked) since
+	 * Linux 3.18 and (sk, ack, in_flight) before, which have the same type.
+	 */
+	void (*cong_avoid)(struct sock *sk, u32 ack, u32 acked);
+	/* Linux 2.6 before 2.6.25: cong_avoid(sk, ack, seq_rtt, in_flight,
+	 * flag), which a module of that kernel sets as cong_avoid (see below)
+	 */
+	void (*cong_avoid_2_6)(struct sock *sk, u32 ack, u32 seq_rtt, u32 in_flight, int flag);
+	/* call before changing ca_state (optional) */
+	void (*set_state)(struct sock *sk, u8 new_state);
+	/* call when cwnd event occurs (optional) */
+	void (*cwnd_event)(struct sock *sk, enum tcp_ca_event ev);
+	/* call when ack arrives (optional) */
+	void (*in_ack_event)(struct sock *sk, u32 flags);
+	/* new value of cwnd after loss (required) */
+	u32 (*undo_cwnd)(struct sock *sk);
+	/* hook for packet ack accounting (optional) */
+	void (*pkts_acked)(struct sock *sk, const struct ack_sample *sample);
+	/* call when packets are delivered to update cwnd and pacing rate,
+	 * after all the ca_state processing. (optional)
+	 */
+	void (*cong_control)(struct sock *sk, const struct rate_sample *rs);
+	/* get info for inet_diag (optional). Its signature changed as well,
+	 * and the simulator never calls it.
+	 */
+	void *get_info;
+
+	/* Linux 2.6: lower bound for congestion window (optional) */
+	u32 (*min_cwnd)(const struct sock *sk);
+	/* Linux 2.6: round trip time sample per acked packet, in usecs (optional) */
+	void (*rtt_sample)(struct sock *sk, u32 usrtt);
+
+	char name[TCP_CA_NAME_MAX];
+	struct module *owner;
+};
+
+/* A module of a kernel before 2.6.25 sets its five argument cong_avoid, and
+ * tcpsock.c calls each through its own type.
+ */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 25)
+#define cong_avoid cong_avoid_2_6
+#endif
+
+int tcp_register_congestion_control(struct tcp_congestion_ops *type);
+void tcp_unregister_congestion_control(struct tcp_congestion_ops *type);
+
+/* sequence number comparison, with wrap around */
+static inline bool before(__u32 seq1, __u32 seq2)
+{
+	return (__s32)(seq1 - seq2) < 0;
+}
+#define after(seq2, seq1)	before(seq1, seq2)
+
+static inline unsigned int tcp_left_out(const struct tcp_sock *tp)
+{
+	return tp->sacked_out + tp->lost_out;
+}
+
+/* packets_out - left_out + retrans_out, as in the kernel */
+static inline unsigned int tcp_packets_in_flight(const struct tcp_sock *tp)
+{
+	return tp->packets_out - tcp_left_out(tp) + tp->retrans_out;
+}
+
+static inline bool tcp_in_slow_start(const struct tcp_sock *tp)
+{
+	return tp->snd_cwnd < tp->snd_ssthresh;
+}
+
+static inline bool __tcp_is_cwnd_limited(const struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	/* If in slow start, ensure cwnd grows to twice what was ACKed. */
+	if (tcp_in_slow_start(tp))
+		return tp->snd_cwnd < 2 * tp->max_packets_out;
+
+	return tp->is_cwnd_limited;
+}
+
+/* Linux < 3.18 passed the packets in flight; the flag kept by the
+ * simulator is the same test on the current flight.
+ */
+#define tcp_is_cwnd_limited(sk, ...)	__tcp_is_cwnd_limited(sk)
+
+static inline int tcp_call_bpf(struct sock *sk, int op, u32 nargs, u32 *args)
+{
+	return -1;
+}
+
+u32 tcp_slow_start(struct tcp_sock *tp, u32 acked);
+void tcp_cong_avoid_ai(struct tcp_sock *tp, u32 w, u32 acked);
+void tcp_reno_cong_avoid(struct sock *sk, u32 ack, u32 acked);
+u32 tcp_reno_ssthresh(struct sock *sk);
+u32 tcp_reno_undo_cwnd(struct sock *sk);
+u32 tcp_reno_min_cwnd(const struct sock *sk);
+
+/* SIAD sysctls added by linux-3.5.7_siad-sysctls.patch, 0 for the default */
+extern int sysctl_tcp_siad_num_rtt;
+extern int sysctl_tcp_siad_num_ms;
+
+#endif /* _KSHIM_NET_TCP_H */
@@ -0,0 +1,298 @@
+/* Userspace implementation of the kernel functions that the congestion
+ * control modules call: printk, allocation, random bytes, the Reno helpers of
+ * tcp_cong.c and the registry of congestion controls.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <net/tcp.h>
+#include "kshim.h"
+
+u64 kshim_now_us;
+unsigned long volatile jiffies;
+int kshim_verbose;
+const char *kshim_module_name;
+
+int sysctl_tcp_siad_num_rtt;
+int sysctl_tcp_siad_num_ms;
+
+int printk(const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	if (!kshim_verbose)
+		return 0;
+
+	/* strip the log level */
+	if ((fmt[0] == KERN_SOH[0]) && (fmt[1] != '\0'))
+		fmt += 2;
+
+	fprintf(stderr, "[%llu.%06llu] ", kshim_now_us / USEC_PER_SEC, kshim_now_us % USEC_PER_SEC);
+	va_start(args, fmt);
+	n = vfprintf(stderr, fmt, args);
+	va_end(args);
+	return n;
+}
+
+void kshim_bug(const char *file, int line)
+{
+	fprintf(stderr, "kernel BUG at %s:%d\n", file, line);
+	abort();
+}
+
+void *kmalloc(size_t size, gfp_t flags)
+{
+	return malloc(size);
+}
+
+void *kzalloc(size_t size, gfp_t flags)
+{
+	return calloc(1, size);
+}
+
+void kfree(const void *p)
+{
+	free((void *)p);
+}
+
+/* splitmix64, as trace-synth uses */
+static u64 random_state = 1;
+
+static u64 random_next(void)
+{
+	u64 z = (random_state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+void get_random_bytes(void *buf, int nbytes)
+{
+	unsigned char *p = buf;
+
+	while (nbytes > 0) {
+		u64 r = random_next();
+		int i;
+
+		for (i = 0; (i < 8) && (nbytes > 0); ++i, --nbytes)
+			*p++ = (unsigned char)(r >> (8 * i));
+	}
+}
+
+u32 prandom_u32(void)
+{
+	return (u32)random_next();
+}
+
+void kshim_seed(uint64_t seed)
+{
+	random_state = seed;
+}
+
+void kshim_set_time(uint64_t now_us)
+{
+	kshim_now_us = now_us;
+	jiffies = (unsigned long)(now_us / USEC_PER_MSEC);
+}
+
+/* registered congestion controls, with the module that registered them */
+#define KSHIM_MAX_CA 32
+
+static struct {
+	const char *module;
+	struct tcp_congestion_ops *ops;
+} ca_list[KSHIM_MAX_CA];
+static int ca_count;
+
+int tcp_register_congestion_control(struct tcp_congestion_ops *ca)
+{
+	if (!ca->ssthresh || !(ca->cong_avoid || ca->cong_avoid_2_6 || ca->cong_control)) {
+		fprintf(stderr, "%s does not implement required ops\n", ca->name);
+		return -1;
+	}
+
+	if (ca_count == KSHIM_MAX_CA)
+		return -1;
+
+	ca_list[ca_count].module = kshim_module_name ? kshim_module_name : "";
+	ca_list[ca_count].ops = ca;
+	++ca_count;
+	return 0;
+}
+
+void tcp_unregister_congestion_control(struct tcp_congestion_ops *ca)
+{
+	int i;
+
+	for (i = 0; i < ca_count; ++i) {
+		if (ca_list[i].ops == ca) {
+			ca_list[i] = ca_list[--ca_count];
+			return;
+		}
+	}
+}
+
+int kshim_ca_count(void)
+{
+	return ca_count;
+}
+
+const char *kshim_ca_module(int i)
+{
+	return ca_list[i].module;
+}
+
+const char *kshim_ca_name(int i)
+{
+	return ca_list[i].ops->name;
+}
+
+const struct tcp_congestion_ops *kshim_ca_find(const char *name)
+{
+	int i;
+
+	/* the module name first, as it is unique */
+	for (i = 0; i < ca_count; ++i)
+		if (strcmp(ca_list[i].module, name) == 0)
+			return ca_list[i].ops;
+
+	for (i = 0; i < ca_count; ++i)
+		if (strcmp(ca_list[i].ops->name, name) == 0)
+			return ca_list[i].ops;
+
+	return NULL;
+}
+
+/* module parameters */
+#define KSHIM_MAX_PARAMS 256
+
+static struct {
+	const char *module;
+	const char *name;
+	int *value;
+} param_list[KSHIM_MAX_PARAMS];
+static int param_count;
+
+void kshim_param_register(const char *module, const char *name, int *value)
+{
+	if (param_count == KSHIM_MAX_PARAMS)
+		return;
+
+	param_list[param_count].module = module;
+	param_list[param_count].name = name;
+	param_list[param_count].value = value;
+	++param_count;
+}
+
+static int *param_find(const char *module, const char *name)
+{
+	int i;
+
+	for (i = 0; i < param_count; ++i)
+		if ((strcmp(param_list[i].module, module) == 0) && (strcmp(param_list[i].name, name) == 0))
+			return param_list[i].value;
+
+	return NULL;
+}
+
+int kshim_param_get(const char *module, const char *name, int *value)
+{
+	int *p = param_find(module, name);
+
+	if (!p)
+		return -1;
+	*value = *p;
+	return 0;
+}
+
+int kshim_param_set(const char *module, const char *name, int value)
+{
+	int *p = param_find(module, name);
+
+	if (!p)
+		return -1;
+	*p = value;
+	return 0;
+}
+
+/* Reno helpers of tcp_cong.c (Linux 4.14) */
+
+/* Slow start is used when congestion window is no greater than the slow start
+ * threshold. We base on RFC2581 and also handle stretch ACKs properly.
+ */
+u32 tcp_slow_start(struct tcp_sock *tp, u32 acked)
+{
+	u32 cwnd = min(tp->snd_cwnd + acked, tp->snd_ssthresh);
+
+	acked -= cwnd - tp->snd_cwnd;
+	tp->snd_cwnd = min(cwnd, tp->snd_cwnd_clamp);
+
+	return acked;
+}
+
+/* In theory this is tp->snd_cwnd += 1 / tp->snd_cwnd (or alternative w),
+ * for every packet that was ACKed.
+ */
+void tcp_cong_avoid_ai(struct tcp_sock *tp, u32 w, u32 acked)
+{
+	/* If credits accumulated at a higher w, apply them gently now. */
+	if (tp->snd_cwnd_cnt >= w) {
+		tp->snd_cwnd_cnt = 0;
+		tp->snd_cwnd++;
+	}
+
+	tp->snd_cwnd_cnt += acked;
+	if (tp->snd_cwnd_cnt >= w) {
+		u32 delta = tp->snd_cwnd_cnt / w;
+
+		tp->snd_cwnd_cnt -= delta * w;
+		tp->snd_cwnd += delta;
+	}
+	tp->snd_cwnd = min(tp->snd_cwnd, tp->snd_cwnd_clamp);
+}
+
+void tcp_reno_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	if (!tcp_is_cwnd_limited(sk))
+		return;
+
+	/* In "safe" area, increase. */
+	if (tcp_in_slow_start(tp)) {
+		acked = tcp_slow_start(tp, acked);
+		if (!acked)
+			return;
+	}
+	/* In dangerous area, increase slowly. */
+	tcp_cong_avoid_ai(tp, tp->snd_cwnd, acked);
+}
+
+/* Slow start threshold is half the congestion window (min 2) */
+u32 tcp_reno_ssthresh(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	return max(tp->snd_cwnd >> 1U, 2U);
+}
+
+u32 tcp_reno_undo_cwnd(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	return max(tp->snd_cwnd, tp->prior_cwnd);
+}
+
+/* Lower bound on congestion window with halving (Linux 2.6). */
+u32 tcp_reno_min_cwnd(const struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	return tp->snd_ssthresh / 2;
+}
@@ -0,0 +1,90 @@
+#ifndef _KSHIM_H
+#define _KSHIM_H
+
+/* Interface of the kernel shim to the simulator. It does not include the
+ * kernel headers of the shim, so that C++ code can use it.
+ *
+ * A tcpsock is the sender side of a TCP connection whose congestion control
+ * is one of the registered modules. It keeps a SACK scoreboard, detects
+ * losses three transmissions after a hole (the FACK rule of the kernel, exact
+ * on a link that does not reorder), recovers with PRR or on a retransmission
+ * timeout, and calls the module as tcp_input.c does. Sequence numbers are
+ * counted in segments; the module sees them in bytes.
+ *
+ * Every call reads the time set by kshim_set_time().
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KSHIM_HEADER_BYTES 52	/* IP and TCP headers with timestamps */
+
+struct tcp_congestion_ops;
+struct tcpsock;
+
+struct tcpsock_seg {
+	uint32_t seq;		/* segment number */
+	uint32_t tsval;		/* TCP timestamp of the sender, in ms */
+	int retrans;		/* 1 for a retransmission */
+};
+
+struct tcpsock_ack {
+	uint32_t cum;		/* next segment expected by the receiver */
+	uint32_t sack;		/* segment that triggered the ACK */
+	uint32_t tsval;		/* TCP timestamp of the receiver, in ms */
+	uint32_t tsecr;		/* timestamp echoed from that segment */
+};
+
+struct tcpsock_info {
+	uint32_t cwnd;		/* in segments */
+	uint32_t ssthresh;
+	uint32_t srtt_us;
+	uint32_t in_flight;
+	uint32_t ca_state;
+	uint32_t pacing_rate;	/* bytes per second, 0 when not paced */
+	uint32_t delivered;
+	uint32_t lost;
+	uint32_t data_segs_out;
+	uint32_t total_retrans;
+};
+
+extern int kshim_verbose;
+
+void kshim_seed(uint64_t seed);
+void kshim_set_time(uint64_t now_us);
+
+/* registered congestion controls */
+int kshim_ca_count(void);
+const char *kshim_ca_module(int i);
+const char *kshim_ca_name(int i);
+/* by module name, or by congestion control name; NULL if none */
+const struct tcp_congestion_ops *kshim_ca_find(const char *name);
+
+/* reads or sets an int module_param; -1 if the module has no such parameter */
+int kshim_param_get(const char *module, const char *name, int *value);
+int kshim_param_set(const char *module, const char *name, int value);
+
+/* a connection whose handshake measured rtt_us; it calls the init op */
+struct tcpsock *tcpsock_create(const struct tcp_congestion_ops *ca, uint32_t mss, uint64_t rtt_us);
+void tcpsock_destroy(struct tcpsock *s);
+
+/* earliest time the next segment may be sent, UINT64_MAX while cwnd limited */
+uint64_t tcpsock_next_send(const struct tcpsock *s);
+/* sends one segment, lost ones first; 0 if the window or pacing forbids it */
+int tcpsock_send(struct tcpsock *s, struct tcpsock_seg *seg);
+void tcpsock_ack(struct tcpsock *s, const struct tcpsock_ack *ack);
+
+/* retransmission timer, UINT64_MAX when not armed */
+uint64_t tcpsock_timer(const struct tcpsock *s);
+void tcpsock_timeout(struct tcpsock *s);
+
+void tcpsock_info(const struct tcpsock *s, struct tcpsock_info *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KSHIM_H */
@@ -0,0 +1,503 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "emulator.h"
+#include "kshim.h"
+
+using namespace std;
+
+// Runs TCP flows whose congestion control is one of the kernel modules of
+// algs-extension, compiled unchanged against the kernel shim, over emulated
+// links on a virtual clock. A run takes as long as its events take to process,
+// not as long as the emulated time, needs no root and no mahimahi, and gives
+// the same result every time for the same arguments.
+//
+//    tcpsim [-t SECONDS] [-j JOBS] [-a ALG[+ALG...]]... [-P MODULE.PARAM=V[,V...]]...
+//           [-u UPLINK] [-s SEED] [-g MS] [-o PREFIX] [-i MS] [-v] [-l] DOWNLINK...
+//
+// Every combination of a downlink (a CEmuConfig description), an -a entry and
+// one value of each -P parameter is a run. An -a entry names the congestion
+// control of each flow of the run, "allegro+nv" for two competing flows, by
+// module (allegro, vivace, nv, lola, ...) or by name. Runs are independent
+// processes, JOBS at a time, and print one line per flow in argument order:
+//    RUN FLOW ALG PARAMS DOWNLINK GOODPUT(Mb/s) UTILIZATION(%) DELAY(ms) DELAY95(ms) RETRANS(%)
+// where the delays are one-way, from the sender to the receiver. The ACKs
+// cross the UPLINK description, by default the delay of the downlink.
+// -o writes PREFIX-RUN.dat with, every -i ms (default 100), the time and for
+// each flow its goodput, cwnd, smoothed RTT and pacing rate.
+
+static const uint32_t g_iMSS = 1448;
+
+struct CRun
+{
+   int m_iIndex;
+   string m_strDownlink;
+   vector<string> m_vAlgs;
+   vector<pair<string, int> > m_vParams;    // "module.param" and value
+};
+
+struct COptions
+{
+   uint64_t m_ullDuration;                   // in microseconds
+   string m_strUplink;
+   uint64_t m_ullSeed;
+   uint64_t m_ullStagger;                    // flow start spacing, in microseconds
+   string m_strSeries;
+   uint64_t m_ullInterval;                   // series interval, in microseconds
+};
+
+// the bytes of a simulated packet that the endpoints read
+struct CSimHeader
+{
+   uint32_t m_iFlow;
+   uint32_t m_iSeq;                          // data: segment; ACK: segment that triggered it
+   uint32_t m_iCum;                          // ACK: next segment expected
+   uint32_t m_iTsval;
+   uint32_t m_iTsecr;
+   uint32_t m_iAck;
+   uint64_t m_ullSent;                       // data: send time
+};
+
+class CSimFlow
+{
+public:
+   CSimFlow(): m_pSock(NULL), m_ullStart(0), m_iExpected(0), m_llGoodput(0), m_llSeriesGoodput(0), m_dDelaySum(0), m_llPackets(0), m_vDelay(m_iBuckets + 1, 0) {}
+
+   void receive(const CSimHeader& h, const uint64_t& now)
+   {
+      if (h.m_iSeq == m_iExpected)
+      {
+         ++ m_iExpected;
+         m_llGoodput += g_iMSS;
+         while (!m_Pending.empty() && (*m_Pending.begin() == m_iExpected))
+         {
+            m_Pending.erase(m_Pending.begin());
+            ++ m_iExpected;
+            m_llGoodput += g_iMSS;
+         }
+      }
+      else if ((int32_t)(h.m_iSeq - m_iExpected) > 0)
+         m_Pending.insert(h.m_iSeq);
+
+      uint64_t d = now - h.m_ullSent;
+      m_dDelaySum += d;
+      ++ m_llPackets;
+      ++ m_vDelay[(d / m_iBucketUs < m_iBuckets) ? d / m_iBucketUs : m_iBuckets];
+   }
+
+   double delayQuantile(const double& q) const
+   {
+      int64_t rank = (int64_t)(q * m_llPackets), seen = 0;
+      for (size_t i = 0; i < m_vDelay.size(); ++ i)
+      {
+         seen += m_vDelay[i];
+         if (seen > rank)
+            return (i + 0.5) * m_iBucketUs / 1000.0;
+      }
+      return 0;
+   }
+
+public:
+   static const uint64_t m_iBucketUs = 100;
+   static const uint64_t m_iBuckets = 100000;     // 10 s
+
+   string m_strAlg;
+   tcpsock* m_pSock;
+   uint64_t m_ullStart;
+
+   uint32_t m_iExpected;
+   set<uint32_t> m_Pending;                  // received above a hole
+   int64_t m_llGoodput;                      // in-order bytes at the receiver
+   int64_t m_llSeriesGoodput;
+   double m_dDelaySum;
+   int64_t m_llPackets;
+   vector<int64_t> m_vDelay;                 // one-way delay histogram
+};
+
+static bool loadTrace(const CEmuConfig& config, CTraceFile& trace)
+{
+   if (config.m_strTrace.empty())
+      return true;
+   if (trace.open(config.m_strTrace))
+      return true;
+   cerr << trace.error() << endl;
+   return false;
+}
+
+static void simulate(const CRun& run, const COptions& opt, FILE* out)
+{
+   for (size_t i = 0; i < run.m_vParams.size(); ++ i)
+   {
+      string key = run.m_vParams[i].first;
+      size_t dot = key.find('.');
+      kshim_param_set(key.substr(0, dot).c_str(), key.substr(dot + 1).c_str(), run.m_vParams[i].second);
+   }
+   kshim_seed(opt.m_ullSeed);
+
+   CEmuConfig downconf = CEmuConfig::parse(run.m_strDownlink);
+   CEmuConfig upconf;
+   if (opt.m_strUplink.empty())
+      upconf.m_iDelay = downconf.m_iDelay;
+   else
+      upconf = CEmuConfig::parse(opt.m_strUplink);
+
+   CTraceFile downtrace, uptrace;
+   if (!loadTrace(downconf, downtrace) || !loadTrace(upconf, uptrace))
+      exit(1);
+
+   CEmuLink down(downconf, downconf.m_strTrace.empty() ? NULL : &downtrace);
+   CEmuLink up(upconf, upconf.m_strTrace.empty() ? NULL : &uptrace);
+
+   // the virtual clock does not start at 0, which the kernel code reads as "no time"
+   const uint64_t start = 1000000;
+   const uint64_t end = start + opt.m_ullDuration;
+   const uint64_t handshake = (downconf.m_iDelay + upconf.m_iDelay) * 1000ULL;
+
+   vector<CSimFlow> flows(run.m_vAlgs.size());
+   for (size_t i = 0; i < flows.size(); ++ i)
+   {
+      flows[i].m_strAlg = run.m_vAlgs[i];
+      flows[i].m_ullStart = start + i * opt.m_ullStagger;
+   }
+
+   FILE* series = NULL;
+   if (!opt.m_strSeries.empty())
+   {
+      stringstream name;
+      name << opt.m_strSeries << "-" << run.m_iIndex << ".dat";
+      series = fopen(name.str().c_str(), "w");
+      if (NULL == series)
+      {
+         perror(name.str().c_str());
+         exit(1);
+      }
+   }
+   uint64_t nextsample = start + opt.m_ullInterval;
+
+   char packet[g_iMSS + KSHIM_HEADER_BYTES];
+   memset(packet, 0, sizeof(packet));
+   CSimHeader& h = *(CSimHeader*)packet;
+
+   uint64_t now = start;
+   down.nextArrival(now);
+   up.nextArrival(now);
+
+   while (now < end)
+   {
+      kshim_set_time(now);
+
+      // data at the receivers, each answered by an ACK
+      while (down.dequeue(packet, sizeof(CSimHeader), now) > 0)
+      {
+         CSimFlow& f = flows[h.m_iFlow];
+         f.receive(h, now);
+
+         h.m_iCum = f.m_iExpected;
+         h.m_iTsecr = h.m_iTsval;
+         h.m_iTsval = now / 1000;
+         h.m_iAck = 1;
+         up.enqueue(packet, KSHIM_HEADER_BYTES, now);
+      }
+
+      // ACKs at the senders
+      while (up.dequeue(packet, sizeof(CSimHeader), now) > 0)
+      {
+         struct tcpsock_ack ack;
+         ack.cum = h.m_iCum;
+         ack.sack = h.m_iSeq;
+         ack.tsval = h.m_iTsval;
+         ack.tsecr = h.m_iTsecr;
+         tcpsock_ack(flows[h.m_iFlow].m_pSock, &ack);
+      }
+
+      for (size_t i = 0; i < flows.size(); ++ i)
+      {
+         CSimFlow& f = flows[i];
+         if (NULL == f.m_pSock)
+         {
+            if (f.m_ullStart > now)
+               continue;
+            f.m_pSock = tcpsock_create(kshim_ca_find(f.m_strAlg.c_str()), g_iMSS, handshake);
+         }
+
+         if (tcpsock_timer(f.m_pSock) <= now)
+            tcpsock_timeout(f.m_pSock);
+
+         struct tcpsock_seg seg;
+         while (tcpsock_send(f.m_pSock, &seg))
+         {
+            h.m_iFlow = i;
+            h.m_iSeq = seg.seq;
+            h.m_iTsval = seg.tsval;
+            h.m_iAck = 0;
+            h.m_ullSent = now;
+            down.enqueue(packet, g_iMSS + KSHIM_HEADER_BYTES, now);
+         }
+      }
+
+      if ((NULL != series) && (now >= nextsample))
+      {
+         fprintf(series, "%.3f", (nextsample - start) / 1000000.0);
+         for (size_t i = 0; i < flows.size(); ++ i)
+         {
+            CSimFlow& f = flows[i];
+            struct tcpsock_info info;
+            memset(&info, 0, sizeof(info));
+            if (NULL != f.m_pSock)
+               tcpsock_info(f.m_pSock, &info);
+            fprintf(series, " %.3f %u %.3f %.3f", (f.m_llGoodput - f.m_llSeriesGoodput) * 8.0 / opt.m_ullInterval,
+                    info.cwnd, info.srtt_us / 1000.0, info.pacing_rate * 8.0 / 1000000);
+            f.m_llSeriesGoodput = f.m_llGoodput;
+         }
+         fprintf(series, "\n");
+         nextsample += opt.m_ullInterval;
+      }
+
+      // next event
+      uint64_t next = end;
+      next = min(next, down.nextArrival(now));
+      next = min(next, up.nextArrival(now));
+      if (NULL != series)
+         next = min(next, nextsample);
+      for (size_t i = 0; i < flows.size(); ++ i)
+      {
+         if (NULL == flows[i].m_pSock)
+            next = min(next, flows[i].m_ullStart);
+         else
+         {
+            next = min(next, tcpsock_next_send(flows[i].m_pSock));
+            next = min(next, tcpsock_timer(flows[i].m_pSock));
+         }
+      }
+      now = max(next, now + 1);
+   }
+
+   if (NULL != series)
+      fclose(series);
+
+   // the capacity of the downlink is shared by the flows
+   double capacity = max(1.0, (double)downtrace.capacity(0, opt.m_ullDuration / 1000));
+   for (size_t i = 0; i < flows.size(); ++ i)
+   {
+      CSimFlow& f = flows[i];
+      struct tcpsock_info info;
+      memset(&info, 0, sizeof(info));
+      if (NULL != f.m_pSock)
+         tcpsock_info(f.m_pSock, &info);
+
+      string params;
+      for (size_t p = 0; p < run.m_vParams.size(); ++ p)
+      {
+         stringstream ss;
+         ss << (p ? "," : "") << run.m_vParams[p].first << "=" << run.m_vParams[p].second;
+         params += ss.str();
+      }
+
+      fprintf(out, "%d %d %s %s %s %.3f %.2f %.2f %.2f %.2f\n", run.m_iIndex, (int)i, f.m_strAlg.c_str(),
+              params.empty() ? "-" : params.c_str(), run.m_strDownlink.c_str(), f.m_llGoodput * 8.0 / opt.m_ullDuration,
+              f.m_llGoodput * 100.0 / capacity, f.m_llPackets ? f.m_dDelaySum / f.m_llPackets / 1000 : 0, f.delayQuantile(0.95),
+              info.data_segs_out ? info.total_retrans * 100.0 / info.data_segs_out : 0);
+   }
+
+   for (size_t i = 0; i < flows.size(); ++ i)
+      if (NULL != flows[i].m_pSock)
+         tcpsock_destroy(flows[i].m_pSock);
+}
+
+static int usage(const char* name)
+{
+   cout << "usage: " << name << " [-t SECONDS] [-j JOBS] [-a ALG[+ALG...]]... [-P MODULE.PARAM=V[,V...]]..." << endl;
+   cout << "       [-u UPLINK] [-s SEED] [-g MS] [-o PREFIX] [-i MS] [-v] [-l] DOWNLINK..." << endl;
+   return 1;
+}
+
+static void list()
+{
+   for (int i = 0; i < kshim_ca_count(); ++ i)
+      cout << kshim_ca_module(i) << "\t" << kshim_ca_name(i) << endl;
+}
+
+static bool parseParam(const string& arg, vector<vector<pair<string, int> > >& params)
+{
+   size_t dot = arg.find('.'), eq = arg.find('=');
+   if ((dot == string::npos) || (eq == string::npos) || (eq < dot))
+      return false;
+
+   string key = arg.substr(0, eq);
+   int current;
+   if (kshim_param_get(key.substr(0, dot).c_str(), key.substr(dot + 1, eq - dot - 1).c_str(), &current) < 0)
+   {
+      cerr << "no module parameter " << key << endl;
+      return false;
+   }
+
+   vector<pair<string, int> > values;
+   stringstream ss(arg.substr(eq + 1));
+   string v;
+   while (getline(ss, v, ','))
+      values.push_back(make_pair(key, atoi(v.c_str())));
+   if (values.empty())
+      return false;
+
+   params.push_back(values);
+   return true;
+}
+
+int main(int argc, char* argv[])
+{
+   COptions opt;
+   opt.m_ullDuration = 30 * 1000000ULL;
+   opt.m_ullSeed = 1;
+   opt.m_ullStagger = 0;
+   opt.m_ullInterval = 100000;
+
+   int jobs = 1;
+   vector<string> algs;
+   vector<vector<pair<string, int> > > params;
+
+   int c;
+   while ((c = getopt(argc, argv, "t:j:a:P:u:s:g:o:i:vl")) != -1)
+   {
+      switch (c)
+      {
+      case 't': opt.m_ullDuration = (uint64_t)(atof(optarg) * 1000000); break;
+      case 'j': jobs = max(1, atoi(optarg)); break;
+      case 'a': algs.push_back(optarg); break;
+      case 'P': if (!parseParam(optarg, params)) return usage(argv[0]); break;
+      case 'u': opt.m_strUplink = optarg; break;
+      case 's': opt.m_ullSeed = strtoull(optarg, NULL, 10); break;
+      case 'g': opt.m_ullStagger = atoi(optarg) * 1000ULL; break;
+      case 'o': opt.m_strSeries = optarg; break;
+      case 'i': opt.m_ullInterval = max(1, atoi(optarg)) * 1000ULL; break;
+      case 'v': kshim_verbose = 1; break;
+      case 'l': list(); return 0;
+      default: return usage(argv[0]);
+      }
+   }
+
+   if ((optind == argc) || (opt.m_ullDuration == 0))
+      return usage(argv[0]);
+   if (algs.empty())
+      algs.push_back("allegro");
+
+   // every combination, checked before any run starts
+   vector<CRun> runs;
+   for (int l = optind; l < argc; ++ l)
+   {
+      try
+      {
+         // the trace is the bottleneck; without one the flows would grow without bound
+         CEmuConfig downconf = CEmuConfig::parse(argv[l]);
+         if (downconf.m_strTrace.empty())
+         {
+            cerr << "downlink " << argv[l] << " has no trace" << endl;
+            return 1;
+         }
+         CEmuConfig upconf = opt.m_strUplink.empty() ? CEmuConfig() : CEmuConfig::parse(opt.m_strUplink);
+
+         CTraceFile downtrace, uptrace;
+         if (!loadTrace(downconf, downtrace) || !loadTrace(upconf, uptrace))
+            return 1;
+      }
+      catch (CUDTException& e)
+      {
+         cerr << "link description: " << e.getErrorMessage() << endl;
+         return 1;
+      }
+
+      for (size_t a = 0; a < algs.size(); ++ a)
+      {
+         CRun run;
+         run.m_strDownlink = argv[l];
+         stringstream ss(algs[a]);
+         string alg;
+         while (getline(ss, alg, '+'))
+         {
+            if (NULL == kshim_ca_find(alg.c_str()))
+            {
+               cerr << "unknown congestion control " << alg << ", available:" << endl;
+               list();
+               return 1;
+            }
+            run.m_vAlgs.push_back(alg);
+         }
+
+         size_t combos = 1;
+         for (size_t p = 0; p < params.size(); ++ p)
+            combos *= params[p].size();
+         for (size_t k = 0; k < combos; ++ k)
+         {
+            run.m_vParams.clear();
+            for (size_t p = 0, r = k; p < params.size(); r /= params[p].size(), ++ p)
+               run.m_vParams.push_back(params[p][r % params[p].size()]);
+            run.m_iIndex = runs.size();
+            runs.push_back(run);
+         }
+      }
+   }
+
+   cout << "# run flow alg params downlink goodput(Mb/s) utilization(%) delay(ms) delay95(ms) retrans(%)" << endl;
+
+   // one process per run, so that every run starts from the same module state;
+   // results are printed in run order
+   deque<pair<pid_t, int> > active;
+   size_t next = 0;
+   int status = 0;
+   while ((next < runs.size()) || !active.empty())
+   {
+      if ((next < runs.size()) && (active.size() < (size_t)jobs))
+      {
+         int fd[2];
+         if (pipe(fd) < 0)
+         {
+            perror("pipe");
+            return 1;
+         }
+
+         fflush(stdout);
+         pid_t pid = fork();
+         if (pid < 0)
+         {
+            perror("fork");
+            return 1;
+         }
+
+         if (0 == pid)
+         {
+            close(fd[0]);
+            FILE* out = fdopen(fd[1], "w");
+            simulate(runs[next], opt, out);
+            fclose(out);
+            _exit(0);
+         }
+
+         close(fd[1]);
+         active.push_back(make_pair(pid, fd[0]));
+         ++ next;
+         continue;
+      }
+
+      char buf[4096];
+      ssize_t n;
+      while ((n = read(active.front().second, buf, sizeof(buf))) > 0)
+         fwrite(buf, 1, n, stdout);
+      close(active.front().second);
+
+      int s;
+      waitpid(active.front().first, &s, 0);
+      if (!WIFEXITED(s) || (WEXITSTATUS(s) != 0))
+         status = 1;
+      active.pop_front();
+   }
+
+   return status;
+}
@@ -0,0 +1,699 @@
+/* The sender side of a TCP connection, reduced to what drives a congestion
+ * control module: the ACK processing of tcp_input.c and tcp_rate.c and the
+ * transmit checks of tcp_output.c, after Linux 4.14. There is no receive
+ * window, no TSO and no undo; the sender always has data to send.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <net/tcp.h>
+#include "kshim.h"
+
+#define TCP_RTO_MIN	(200U * USEC_PER_MSEC)
+#define TCP_RTO_MAX	(120U * USEC_PER_SEC)
+#define TCP_TIMEOUT_INIT (1U * USEC_PER_SEC)
+#define TCP_DUPTHRESH	3
+
+#define TIMER_OFF	(~0ULL)
+
+/* scoreboard flags */
+#define SEG_SACKED		0x01	/* delivered out of order */
+#define SEG_LOST		0x02	/* marked lost, not cumulatively acked */
+#define SEG_RETRANS		0x04	/* a retransmission is in flight */
+#define SEG_EVER_RETRANS	0x08
+
+/* FLAG_* of tcp_input.c */
+#define FLAG_DATA_ACKED		0x04
+#define FLAG_RETRANS_DATA_ACKED	0x08
+#define FLAG_DATA_SACKED	0x20
+#define FLAG_LOST_RETRANS	0x80
+
+struct tcpseg {
+	u64 sent_us;		/* last transmission */
+	u64 first_tx_us;	/* tx.first_tx_mstamp */
+	u64 delivered_us;	/* tx.delivered_mstamp, 0 once counted */
+	u32 delivered;		/* tx.delivered */
+	u32 tx;			/* transmission number of the last transmission */
+	u32 in_flight;		/* tx.in_flight: bytes from snd_una to its end */
+	u32 tsval;
+	u8 flags;
+};
+
+struct tcpsock {
+	struct tcp_sock tp;	/* must be first: the module sees a struct sock */
+	const struct tcp_congestion_ops *ops;
+
+	struct tcpseg *ring;	/* segments [una, nxt), indexed modulo ring_size */
+	u32 ring_size;
+	u32 una;		/* first segment not cumulatively acked */
+	u32 nxt;		/* next new segment */
+
+	u32 tx_count;		/* transmissions so far */
+	u32 tx_delivered;	/* latest transmission known delivered, 0 if none */
+	u32 lost_pending;	/* segments marked lost and not retransmitted */
+	u32 rexmit_hint;	/* no lost segment waits for retransmission below it */
+
+	u32 rto_us;
+	u32 backoff;
+	int retransmits;	/* timeouts since the last forward progress */
+	u64 rto_at;
+
+	u64 pace_at_ns;		/* earliest time of the next paced segment */
+
+	u32 prr_delivered;
+	u32 prr_out;
+
+	u64 first_tx_mstamp;
+	u64 delivered_mstamp;
+	u32 min_rtt_us;
+};
+
+static inline struct sock *to_sk(struct tcpsock *s)
+{
+	return (struct sock *)&s->tp;
+}
+
+static inline struct tcpseg *seg_at(const struct tcpsock *s, u32 seq)
+{
+	return &s->ring[seq & (s->ring_size - 1)];
+}
+
+static inline u32 seq_bytes(const struct tcpsock *s, u32 seq)
+{
+	return seq * s->tp.mss_cache;
+}
+
+static void ring_grow(struct tcpsock *s)
+{
+	struct tcpseg *ring = calloc(s->ring_size * 2, sizeof(*ring));
+	u32 seq;
+
+	BUG_ON(!ring);
+	for (seq = s->una; seq != s->nxt; ++seq)
+		ring[seq & (s->ring_size * 2 - 1)] = *seg_at(s, seq);
+
+	free(s->ring);
+	s->ring = ring;
+	s->ring_size *= 2;
+}
+
+static void set_ca_state(struct tcpsock *s, u8 state)
+{
+	if (s->ops->set_state)
+		s->ops->set_state(to_sk(s), state);
+	s->tp.inet_conn.icsk_ca_state = state;
+}
+
+static void ca_event(struct tcpsock *s, enum tcp_ca_event event)
+{
+	if (s->ops->cwnd_event)
+		s->ops->cwnd_event(to_sk(s), event);
+}
+
+static void rtt_estimator(struct tcpsock *s, long mrtt_us)
+{
+	struct tcp_sock *tp = &s->tp;
+	long m = mrtt_us;
+	u32 srtt = tp->srtt_us;
+
+	if (srtt != 0) {
+		m -= (srtt >> 3);
+		srtt += m;
+		if (m < 0) {
+			m = -m;
+			m -= (tp->mdev_us >> 2);
+			if (m > 0)
+				m >>= 3;
+		} else {
+			m -= (tp->mdev_us >> 2);
+		}
+		tp->mdev_us += m;
+	} else {
+		srtt = m << 3;
+		tp->mdev_us = m << 1;
+	}
+	tp->srtt_us = max(1U, srtt);
+	tp->rttvar_us = max(tp->mdev_us, TCP_RTO_MIN);
+	tp->srtt = tp->srtt_us / USEC_PER_MSEC;
+
+	s->rto_us = min((tp->srtt_us >> 3) + tp->rttvar_us, TCP_RTO_MAX);
+	if (!s->min_rtt_us || ((u32)mrtt_us < s->min_rtt_us))
+		s->min_rtt_us = max(1L, mrtt_us);
+}
+
+static void rearm_rto(struct tcpsock *s)
+{
+	if (!s->tp.packets_out)
+		s->rto_at = TIMER_OFF;
+	else
+		s->rto_at = kshim_now_us + min((u64)s->rto_us << s->backoff, (u64)TCP_RTO_MAX);
+}
+
+/* tcp_rate_skb_delivered() */
+static void rate_delivered(struct tcpsock *s, struct tcpseg *seg, struct rate_sample *rs)
+{
+	if (!seg->delivered_us)
+		return;
+
+	if (!rs->prior_delivered || after(seg->delivered, rs->prior_delivered)) {
+		rs->prior_delivered = seg->delivered;
+		rs->prior_mstamp = seg->delivered_us;
+		rs->is_retrans = !!(seg->flags & SEG_RETRANS);
+		s->first_tx_mstamp = seg->sent_us;
+		rs->interval_us = (long)(seg->sent_us - seg->first_tx_us);
+	}
+
+	/* a SACKed segment is not counted again when it is cumulatively acked */
+	if (seg->flags & SEG_SACKED)
+		seg->delivered_us = 0;
+}
+
+/* tcp_rate_gen() */
+static void rate_gen(struct tcpsock *s, u32 delivered, u32 lost, struct rate_sample *rs)
+{
+	struct tcp_sock *tp = &s->tp;
+	long snd_us, ack_us;
+
+	if (delivered)
+		s->delivered_mstamp = tp->tcp_mstamp;
+
+	rs->acked_sacked = delivered;
+	rs->losses = lost;
+
+	if (!rs->prior_mstamp) {
+		rs->delivered = -1;
+		rs->interval_us = -1;
+		return;
+	}
+	rs->delivered = tp->delivered - rs->prior_delivered;
+
+	snd_us = rs->interval_us;
+	ack_us = (long)(tp->tcp_mstamp - rs->prior_mstamp);
+	rs->interval_us = max(snd_us, ack_us);
+
+	if (rs->interval_us < (long)s->min_rtt_us)
+		rs->interval_us = -1;
+}
+
+/* a segment is delivered, by a SACK or by the cumulative ACK */
+static void deliver(struct tcpsock *s, struct tcpseg *seg, int *flag, struct rate_sample *rs)
+{
+	struct tcp_sock *tp = &s->tp;
+
+	if (after(seg->tx, s->tx_delivered) || !s->tx_delivered)
+		s->tx_delivered = seg->tx;
+
+	if (seg->flags & SEG_LOST) {
+		tp->lost_out--;
+		if (!(seg->flags & SEG_RETRANS))
+			s->lost_pending--;
+		seg->flags &= ~SEG_LOST;
+	}
+	if (seg->flags & SEG_RETRANS) {
+		tp->retrans_out--;
+		*flag |= FLAG_RETRANS_DATA_ACKED;
+	}
+
+	tp->delivered++;
+	rate_delivered(s, seg, rs);
+	seg->flags &= ~SEG_RETRANS;
+}
+
+/* marks the holes that three later transmissions have passed */
+static u32 mark_lost(struct tcpsock *s, int *flag)
+{
+	struct tcp_sock *tp = &s->tp;
+	u32 lost = 0;
+	u32 seq;
+
+	if (!s->tx_delivered)
+		return 0;
+
+	for (seq = s->una; seq != s->nxt; ++seq) {
+		struct tcpseg *seg = seg_at(s, seq);
+
+		if ((s32)(s->tx_delivered - seg->tx) < TCP_DUPTHRESH) {
+			/* later segments were sent after this one */
+			if (!(seg->flags & SEG_EVER_RETRANS))
+				break;
+			continue;
+		}
+
+		if (seg->flags & SEG_SACKED)
+			continue;
+
+		if (seg->flags & SEG_RETRANS) {
+			/* the retransmission is lost as well */
+			seg->flags &= ~SEG_RETRANS;
+			tp->retrans_out--;
+			*flag |= FLAG_LOST_RETRANS;
+		} else if (seg->flags & SEG_LOST) {
+			continue;
+		} else {
+			seg->flags |= SEG_LOST;
+			tp->lost_out++;
+		}
+
+		tp->lost++;
+		s->lost_pending++;
+		if (before(seq, s->rexmit_hint))
+			s->rexmit_hint = seq;
+		++lost;
+	}
+
+	return lost;
+}
+
+/* tcp_cwnd_reduction(): proportional rate reduction */
+static void cwnd_reduction(struct tcpsock *s, int newly_acked_sacked, int flag)
+{
+	struct tcp_sock *tp = &s->tp;
+	int sndcnt = 0;
+	int delta = tp->snd_ssthresh - tcp_packets_in_flight(tp);
+
+	if (newly_acked_sacked <= 0 || !tp->prior_cwnd)
+		return;
+
+	s->prr_delivered += newly_acked_sacked;
+	if (delta < 0) {
+		u64 dividend = (u64)tp->snd_ssthresh * s->prr_delivered + tp->prior_cwnd - 1;
+
+		sndcnt = div_u64(dividend, tp->prior_cwnd) - s->prr_out;
+	} else if ((flag & FLAG_RETRANS_DATA_ACKED) && !(flag & FLAG_LOST_RETRANS)) {
+		sndcnt = min_t(int, delta, max_t(int, s->prr_delivered - s->prr_out, newly_acked_sacked) + 1);
+	} else {
+		sndcnt = min_t(int, delta, newly_acked_sacked);
+	}
+	/* Force a fast retransmit upon entering fast recovery */
+	sndcnt = max(sndcnt, (s->prr_out ? 0 : 1));
+	tp->snd_cwnd = tcp_packets_in_flight(tp) + sndcnt;
+
+	if (s->ops->min_cwnd)
+		tp->snd_cwnd = max(tp->snd_cwnd, s->ops->min_cwnd(to_sk(s)));
+}
+
+static void enter_recovery(struct tcpsock *s)
+{
+	struct tcp_sock *tp = &s->tp;
+
+	tp->prior_ssthresh = 0;
+	tp->high_seq = tp->snd_nxt;
+	s->prr_delivered = 0;
+	s->prr_out = 0;
+	tp->prior_cwnd = tp->snd_cwnd;
+	tp->snd_ssthresh = s->ops->ssthresh(to_sk(s));
+	set_ca_state(s, TCP_CA_Recovery);
+}
+
+/* tcp_end_cwnd_reduction() */
+static void end_recovery(struct tcpsock *s)
+{
+	struct tcp_sock *tp = &s->tp;
+
+	if (!s->ops->cong_control && (tp->snd_ssthresh < TCP_INFINITE_SSTHRESH)) {
+		tp->snd_cwnd = tp->snd_ssthresh;
+		tp->snd_cwnd_cnt = 0;
+	}
+	ca_event(s, CA_EVENT_COMPLETE_CWR);
+	set_ca_state(s, TCP_CA_Open);
+}
+
+/* tcp_fastretrans_alert(), without undo */
+static void fastretrans_alert(struct tcpsock *s, u32 newly_lost)
+{
+	struct tcp_sock *tp = &s->tp;
+	u8 state = tp->inet_conn.icsk_ca_state;
+
+	if ((state == TCP_CA_Recovery) || (state == TCP_CA_Loss)) {
+		if (before(tp->snd_una, tp->high_seq))
+			return;
+		if (state == TCP_CA_Recovery)
+			end_recovery(s);
+		else
+			set_ca_state(s, TCP_CA_Open);
+		state = TCP_CA_Open;
+	}
+
+	if (newly_lost || tp->lost_out)
+		enter_recovery(s);
+	else if (tp->sacked_out && (state == TCP_CA_Open))
+		set_ca_state(s, TCP_CA_Disorder);
+	else if (!tp->sacked_out && (state == TCP_CA_Disorder))
+		set_ca_state(s, TCP_CA_Open);
+}
+
+/* tcp_cong_control() */
+static void cong_control(struct tcpsock *s, u32 ack, u32 acked_sacked, u32 prior_in_flight, int flag, const struct rate_sample *rs)
+{
+	struct tcp_sock *tp = &s->tp;
+	u8 state = tp->inet_conn.icsk_ca_state;
+
+	if (s->ops->cong_control) {
+		s->ops->cong_control(to_sk(s), rs);
+		return;
+	}
+
+	if ((state == TCP_CA_CWR) || (state == TCP_CA_Recovery)) {
+		cwnd_reduction(s, acked_sacked, flag);
+	} else if (flag & FLAG_DATA_ACKED) {
+		/* (sk, ack, acked) for Linux 3.18 and later, and (sk, ack,
+		 * in_flight) before, which is the same test of the window
+		 * here. 2.6 took the RTT sample in jiffies, -1 if none.
+		 */
+		if (s->ops->cong_avoid_2_6)
+			s->ops->cong_avoid_2_6(to_sk(s), ack, rs->rtt_us < 0 ? (u32)-1 : (u32)(rs->rtt_us / USEC_PER_MSEC),
+					       prior_in_flight, flag);
+		else
+			s->ops->cong_avoid(to_sk(s), ack, acked_sacked);
+	}
+}
+
+struct tcpsock *tcpsock_create(const struct tcp_congestion_ops *ca, uint32_t mss, uint64_t rtt_us)
+{
+	struct tcpsock *s = calloc(1, sizeof(*s));
+	struct tcp_sock *tp;
+
+	if (!s)
+		return NULL;
+
+	s->ring_size = 1024;
+	s->ring = calloc(s->ring_size, sizeof(*s->ring));
+	if (!s->ring) {
+		free(s);
+		return NULL;
+	}
+
+	s->ops = ca;
+	s->rto_us = TCP_TIMEOUT_INIT;
+	s->rto_at = TIMER_OFF;
+
+	tp = &s->tp;
+	tp->inet_conn.icsk_ca_ops = ca;
+	tp->inet_conn.icsk_ca_state = TCP_CA_Open;
+	tp->inet_conn.icsk_inet.sk_pacing_rate = ~0U;
+	tp->inet_conn.icsk_inet.sk_max_pacing_rate = ~0U;
+	tp->inet_conn.icsk_inet.sk_pacing_status = SK_PACING_NONE;
+	tp->mss_cache = mss;
+	tp->snd_cwnd = TCP_INIT_CWND;
+	tp->snd_ssthresh = TCP_INFINITE_SSTHRESH;
+	tp->snd_cwnd_clamp = ~0U;
+	tp->tcp_mstamp = kshim_now_us;
+	tp->lsndtime = tcp_jiffies32;
+	tp->rx_opt.tstamp_ok = 1;
+
+	/* the SYN-ACK gives the first RTT sample before the module starts */
+	if (rtt_us)
+		rtt_estimator(s, (long)rtt_us);
+
+	if (ca->init)
+		ca->init(to_sk(s));
+
+	return s;
+}
+
+void tcpsock_destroy(struct tcpsock *s)
+{
+	if (s->ops->release)
+		s->ops->release(to_sk(s));
+	free(s->ring);
+	free(s);
+}
+
+static int paced(const struct tcpsock *s)
+{
+	const struct sock *sk = (const struct sock *)&s->tp;
+
+	return (sk->sk_pacing_status != SK_PACING_NONE) && (sk->sk_pacing_rate != ~0U) && (sk->sk_pacing_rate > 0);
+}
+
+uint64_t tcpsock_next_send(const struct tcpsock *s)
+{
+	const struct tcp_sock *tp = &s->tp;
+
+	if (tcp_packets_in_flight(tp) >= tp->snd_cwnd)
+		return TIMER_OFF;
+
+	if (paced(s))
+		return max(kshim_now_us, (s->pace_at_ns + NSEC_PER_USEC - 1) / NSEC_PER_USEC);
+
+	return kshim_now_us;
+}
+
+/* tcp_cwnd_validate() */
+static void cwnd_validate(struct tcpsock *s, int is_cwnd_limited)
+{
+	struct tcp_sock *tp = &s->tp;
+
+	if (!before(tp->snd_una, tp->max_packets_seq) || (tp->packets_out > tp->max_packets_out)) {
+		tp->max_packets_out = tp->packets_out;
+		tp->max_packets_seq = tp->snd_nxt;
+		tp->is_cwnd_limited = is_cwnd_limited;
+	} else if (is_cwnd_limited) {
+		tp->is_cwnd_limited = 1;
+	}
+}
+
+int tcpsock_send(struct tcpsock *s, struct tcpsock_seg *out)
+{
+	struct tcp_sock *tp = &s->tp;
+	struct sock *sk = to_sk(s);
+	struct tcpseg *seg = NULL;
+	u32 seq;
+	u64 now = kshim_now_us;
+
+	if (tcpsock_next_send(s) > now)
+		return 0;
+
+	tp->tcp_mstamp = now;
+
+	if (!tcp_packets_in_flight(tp))
+		ca_event(s, CA_EVENT_TX_START);
+
+	/* lost segments first, as tcp_xmit_retransmit_queue() */
+	if (s->lost_pending) {
+		for (seq = max_t(u32, s->rexmit_hint, s->una); seq != s->nxt; ++seq) {
+			seg = seg_at(s, seq);
+			if ((seg->flags & (SEG_LOST | SEG_RETRANS)) == SEG_LOST)
+				break;
+		}
+		BUG_ON(seq == s->nxt);
+		s->rexmit_hint = seq + 1;
+		s->lost_pending--;
+		seg->flags |= SEG_RETRANS | SEG_EVER_RETRANS;
+		tp->retrans_out++;
+		tp->total_retrans++;
+		out->retrans = 1;
+	} else {
+		if (s->nxt - s->una == s->ring_size)
+			ring_grow(s);
+		seq = s->nxt++;
+		seg = seg_at(s, seq);
+		memset(seg, 0, sizeof(*seg));
+		tp->packets_out++;
+		tp->snd_nxt = seq_bytes(s, s->nxt);
+		out->retrans = 0;
+	}
+
+	/* tcp_rate_skb_sent() */
+	if (tp->packets_out == 1 && !out->retrans) {
+		s->first_tx_mstamp = now;
+		s->delivered_mstamp = now;
+	}
+	seg->first_tx_us = s->first_tx_mstamp;
+	seg->delivered_us = s->delivered_mstamp;
+	seg->delivered = tp->delivered;
+
+	seg->sent_us = now;
+	seg->tx = ++s->tx_count;
+	seg->tsval = tcp_time_stamp;
+	seg->in_flight = seq_bytes(s, seq + 1) - tp->snd_una;
+
+	tp->data_segs_out++;
+	tp->lsndtime = tcp_jiffies32;
+	if (tp->inet_conn.icsk_ca_state == TCP_CA_Recovery)
+		s->prr_out++;
+
+	if (paced(s)) {
+		u64 len_ns = (u64)(tp->mss_cache + KSHIM_HEADER_BYTES) * NSEC_PER_SEC / sk->sk_pacing_rate;
+
+		s->pace_at_ns = max(s->pace_at_ns, now * NSEC_PER_USEC) + len_ns;
+	}
+
+	cwnd_validate(s, tcp_packets_in_flight(tp) >= tp->snd_cwnd);
+
+	if (s->rto_at == TIMER_OFF)
+		rearm_rto(s);
+
+	out->seq = seq;
+	out->tsval = seg->tsval;
+	return 1;
+}
+
+void tcpsock_ack(struct tcpsock *s, const struct tcpsock_ack *ack)
+{
+	struct tcp_sock *tp = &s->tp;
+	struct sock *sk = to_sk(s);
+	struct rate_sample rs;
+	struct ack_sample sample;
+	u32 prior_in_flight = tcp_packets_in_flight(tp);
+	u32 prior_delivered = tp->delivered;
+	u32 prior_lost = tp->lost;
+	u32 pkts_acked = 0;
+	u32 last_in_flight = 0;
+	u64 rtt_sent = 0;
+	long ca_rtt_us = -1;
+	u32 newly_lost;
+	int flag = 0;
+	u32 seq;
+
+	memset(&rs, 0, sizeof(rs));
+	rs.prior_in_flight = prior_in_flight;
+
+	tp->tcp_mstamp = kshim_now_us;
+	tp->rx_opt.saw_tstamp = 1;
+	tp->rx_opt.rcv_tsval = ack->tsval;
+	tp->rx_opt.rcv_tsecr = ack->tsecr;
+
+	/* tcp_sacktag_write_queue(): one SACK block, the segment that arrived */
+	if (!before(ack->sack, ack->cum) && !before(ack->sack, s->una) && before(ack->sack, s->nxt)) {
+		struct tcpseg *seg = seg_at(s, ack->sack);
+
+		if (!(seg->flags & SEG_SACKED)) {
+			if (!(seg->flags & SEG_EVER_RETRANS))
+				rtt_sent = seg->sent_us;
+			deliver(s, seg, &flag, &rs);
+			seg->flags |= SEG_SACKED;
+			tp->sacked_out++;
+			flag |= FLAG_DATA_SACKED;
+		}
+	}
+
+	if (s->ops->in_ack_event)
+		s->ops->in_ack_event(sk, (flag & FLAG_DATA_SACKED) ? CA_ACK_SLOWPATH : 0);
+
+	/* tcp_clean_rtx_queue() */
+	if (after(ack->cum, s->una) && !after(ack->cum, s->nxt)) {
+		for (seq = s->una; seq != ack->cum; ++seq) {
+			struct tcpseg *seg = seg_at(s, seq);
+
+			if (seg->flags & SEG_SACKED) {
+				tp->sacked_out--;
+			} else {
+				if (!(seg->flags & SEG_EVER_RETRANS) && (seg->sent_us > rtt_sent))
+					rtt_sent = seg->sent_us;
+				deliver(s, seg, &flag, &rs);
+			}
+			last_in_flight = seg->in_flight;
+			tp->packets_out--;
+			++pkts_acked;
+		}
+
+		tp->bytes_acked += (u64)(ack->cum - s->una) * tp->mss_cache;
+		s->una = ack->cum;
+		tp->snd_una = seq_bytes(s, s->una);
+		if (before(s->rexmit_hint, s->una))
+			s->rexmit_hint = s->una;
+		flag |= FLAG_DATA_ACKED;
+
+		s->backoff = 0;
+		s->retransmits = 0;
+	}
+
+	if (rtt_sent) {
+		ca_rtt_us = (long)(kshim_now_us - rtt_sent);
+		rtt_estimator(s, ca_rtt_us);
+		if (s->ops->rtt_sample)
+			s->ops->rtt_sample(sk, (u32)ca_rtt_us);
+	}
+	rs.rtt_us = ca_rtt_us;
+
+	if (flag & FLAG_DATA_ACKED)
+		rearm_rto(s);
+
+	if (s->ops->pkts_acked) {
+		sample.pkts_acked = pkts_acked;
+		sample.rtt_us = (s32)ca_rtt_us;
+		sample.in_flight = last_in_flight;
+		s->ops->pkts_acked(sk, &sample);
+	}
+
+	newly_lost = mark_lost(s, &flag);
+	fastretrans_alert(s, newly_lost);
+
+	rate_gen(s, tp->delivered - prior_delivered, tp->lost - prior_lost, &rs);
+	cong_control(s, tp->snd_una, tp->delivered - prior_delivered, prior_in_flight, flag, &rs);
+}
+
+uint64_t tcpsock_timer(const struct tcpsock *s)
+{
+	return s->rto_at;
+}
+
+/* tcp_retransmit_timer() and tcp_enter_loss() */
+void tcpsock_timeout(struct tcpsock *s)
+{
+	struct tcp_sock *tp = &s->tp;
+	u8 state = tp->inet_conn.icsk_ca_state;
+	u32 seq;
+
+	if (!tp->packets_out) {
+		s->rto_at = TIMER_OFF;
+		return;
+	}
+
+	tp->tcp_mstamp = kshim_now_us;
+
+	if ((state <= TCP_CA_Disorder) || !after(tp->high_seq, tp->snd_una) ||
+	    ((state == TCP_CA_Loss) && !s->retransmits)) {
+		tp->prior_ssthresh = 0;
+		tp->prior_cwnd = tp->snd_cwnd;
+		tp->snd_ssthresh = s->ops->ssthresh(to_sk(s));
+		ca_event(s, CA_EVENT_LOSS);
+	}
+	tp->snd_cwnd = 1;
+	tp->snd_cwnd_cnt = 0;
+
+	/* everything not SACKed is lost */
+	for (seq = s->una; seq != s->nxt; ++seq) {
+		struct tcpseg *seg = seg_at(s, seq);
+
+		if (seg->flags & SEG_SACKED)
+			continue;
+		if (seg->flags & SEG_RETRANS) {
+			seg->flags &= ~SEG_RETRANS;
+			tp->retrans_out--;
+		} else if (seg->flags & SEG_LOST) {
+			continue;
+		} else {
+			seg->flags |= SEG_LOST;
+			tp->lost_out++;
+		}
+		tp->lost++;
+		s->lost_pending++;
+	}
+	s->rexmit_hint = s->una;
+
+	tp->high_seq = tp->snd_nxt;
+	set_ca_state(s, TCP_CA_Loss);
+
+	s->retransmits++;
+	if (s->backoff < 16)
+		s->backoff++;
+	s->rto_at = kshim_now_us + min((u64)s->rto_us << s->backoff, (u64)TCP_RTO_MAX);
+}
+
+void tcpsock_info(const struct tcpsock *s, struct tcpsock_info *info)
+{
+	const struct tcp_sock *tp = &s->tp;
+
+	info->cwnd = tp->snd_cwnd;
+	info->ssthresh = tp->snd_ssthresh;
+	info->srtt_us = tp->srtt_us >> 3;
+	info->in_flight = tcp_packets_in_flight(tp);
+	info->ca_state = tp->inet_conn.icsk_ca_state;
+	info->pacing_rate = paced(s) ? tp->inet_conn.icsk_inet.sk_pacing_rate : 0;
+	info->delivered = tp->delivered;
+	info->lost = tp->lost;
+	info->data_segs_out = tp->data_segs_out;
+	info->total_retrans = tp->total_retrans;
+}
@@ -0,0 +1,95 @@
+#ifndef _LEDBAT_MINMAX_H
+#define _LEDBAT_MINMAX_H
+
+/* Windowed min filter for the LEDBAT delay history.
+ *
+ * Kathleen Nichols' algorithm, as lib/win_minmax.c of Linux 4.10 and later
+ * (which tcp_ledbat.c cannot rely on, as it supports older kernels): it keeps
+ * the best, second best and third best minimum of the window, each with the
+ * time it was seen, so that an update and a query take constant time and 24
+ * bytes whatever the length of the window. The time may be in any unit, a
+ * clock or a sample count. The result is exact when the window holds a new
+ * minimum every quarter of the window; otherwise, after the minimum leaves the
+ * window, it can be larger than the smallest sample left in it until the next
+ * one.
+ */
+
+#include <linux/kernel.h>
+
+struct ledbat_minmax_sample {
+	u32 t;	/* time the measurement was taken */
+	u32 v;	/* value measured */
+};
+
+struct ledbat_minmax {
+	struct ledbat_minmax_sample s[3];
+};
+
+static inline u32 ledbat_minmax_get(const struct ledbat_minmax *m)
+{
+	return m->s[0].v;
+}
+
+static inline u32 ledbat_minmax_reset(struct ledbat_minmax *m, u32 t, u32 meas)
+{
+	struct ledbat_minmax_sample val = { .t = t, .v = meas };
+
+	m->s[2] = m->s[1] = m->s[0] = val;
+	return m->s[0].v;
+}
+
+/* As time advances, update the 1st, 2nd, and 3rd choices. */
+static inline u32 ledbat_minmax_subwin_update(struct ledbat_minmax *m, u32 win,
+					      const struct ledbat_minmax_sample *val)
+{
+	u32 dt = val->t - m->s[0].t;
+
+	if (unlikely(dt > win)) {
+		/* Passed entire window without a new val so make 2nd
+		 * choice the new val & 3rd choice the new 2nd choice.
+		 * we may have to iterate this since our 2nd choice
+		 * may also be outside the window (we checked on entry
+		 * that the third choice was in the window).
+		 */
+		m->s[0] = m->s[1];
+		m->s[1] = m->s[2];
+		m->s[2] = *val;
+		if (unlikely(val->t - m->s[0].t > win)) {
+			m->s[0] = m->s[1];
+			m->s[1] = m->s[2];
+			m->s[2] = *val;
+		}
+	} else if (unlikely(m->s[1].t == m->s[0].t) && dt > win / 4) {
+		/* We've passed a quarter of the window without a new val
+		 * so take a 2nd choice from the 2nd quarter of the window.
+		 */
+		m->s[2] = m->s[1] = *val;
+	} else if (unlikely(m->s[2].t == m->s[1].t) && dt > win / 2) {
+		/* We've passed half the window without finding a new val
+		 * so take a 3rd choice from the last half of the window
+		 */
+		m->s[2] = *val;
+	}
+	return m->s[0].v;
+}
+
+/* Adds meas, taken at t, and returns the minimum of the samples taken since
+ * t - win.
+ */
+static inline u32 ledbat_minmax_running_min(struct ledbat_minmax *m, u32 win, u32 t, u32 meas)
+{
+	struct ledbat_minmax_sample val = { .t = t, .v = meas };
+
+	if (unlikely(val.v <= m->s[0].v) ||	/* found new min? */
+	    unlikely(val.t - m->s[2].t > win))	/* nothing left in window? */
+		return ledbat_minmax_reset(m, t, meas);	/* forget earlier samples */
+
+	if (unlikely(val.v <= m->s[1].v))
+		m->s[2] = m->s[1] = val;
+	else if (unlikely(val.v <= m->s[2].v))
+		m->s[2] = val;
+
+	return ledbat_minmax_subwin_update(m, win, &val);
+}
+
+#endif /* _LEDBAT_MINMAX_H */
@@ -0,0 +1,207 @@
+/* Checks the windowed min filter of tcp_ledbat.c against the exact minimum of
+ * the last CURRENT_FILTER delays, and measures the time per delay sample of
+ * the filter and of the linear scan of a CURRENT_FILTER list it replaces:
+ *
+ *    minmax_test [-n SAMPLES] [-s SEED]
+ *
+ * The delays are a queue that fills and drains at random over a fixed base,
+ * with jitter. Exits with 1 if the filter ever returns less than the exact
+ * minimum, or if it is not exact for a filter of 1 or 2 delays (the default).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "ledbat_minmax.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+static u64 random_state;
+
+/* splitmix64, as trace-synth uses */
+static u32 random_next(void)
+{
+	u64 z = (random_state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return (u32)(z ^ (z >> 31));
+}
+
+/* one-way delays in ms */
+static void make_delays(u32 *delays, int n)
+{
+	int queue = 0;
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		queue += (int)(random_next() % 5) - 2;
+		if (queue < 0)
+			queue = 0;
+		if (queue > 200)
+			queue = 200;
+		delays[i] = 20 + queue + random_next() % 4;
+	}
+}
+
+/* the exact minimum of the last len delays, by a monotonic deque of indexes */
+static void exact_min(const u32 *delays, int n, int len, u32 *out, int *deque)
+{
+	int head = 0, tail = 0;
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		while ((tail > head) && (delays[deque[tail - 1]] >= delays[i]))
+			--tail;
+		deque[tail++] = i;
+		if (deque[head] <= i - len)
+			++head;
+		out[i] = delays[deque[head]];
+	}
+}
+
+/* the list of tcp_ledbat.c before ledbat_minmax.h */
+static u32 list_min(const u32 *delays, int n, int len, u32 *list)
+{
+	u32 sink = 0;
+	int next = 0;
+	int i, j;
+
+	for (i = 0; i < len; ++i)
+		list[i] = UINT_MAX;
+	for (i = 0; i < n; ++i) {
+		u32 min_delay = UINT_MAX;
+
+		list[next] = delays[i];
+		if (++next == len)
+			next = 0;
+		for (j = 0; j < len; ++j)
+			min_delay = min(list[j], min_delay);
+		sink += min_delay;
+	}
+	return sink;
+}
+
+static void filter_min(const u32 *delays, int n, int len, u32 *out)
+{
+	struct ledbat_minmax m;
+	int i;
+
+	ledbat_minmax_reset(&m, 0, UINT_MAX);
+	for (i = 0; i < n; ++i)
+		out[i] = ledbat_minmax_running_min(&m, len - 1, i + 1, delays[i]);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned long long now_cycles(void)
+{
+#ifdef HAVE_RDTSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+	static const int lens[] = { 1, 2, 4, 16, 64, 256, 1024 };
+	int n = 1000000;
+	u64 seed = 1;
+	u32 *delays, *exact, *filtered, *list;
+	int *deque;
+	int status = 0;
+	size_t k;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:s:")) != -1) {
+		switch (c) {
+		case 'n':
+			n = atoi(optarg);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n SAMPLES] [-s SEED]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (n <= 0)
+		return 1;
+
+	random_state = seed;
+	delays = malloc(n * sizeof(u32));
+	exact = malloc(n * sizeof(u32));
+	filtered = malloc(n * sizeof(u32));
+	deque = malloc(n * sizeof(int));
+	list = malloc(lens[sizeof(lens) / sizeof(lens[0]) - 1] * sizeof(u32));
+	make_delays(delays, n);
+
+	printf("%8s %8s %10s %10s %10s %10s %10s %10s\n", "filter", "exact%", "mean over", "max over",
+	       "ns/list", "cyc/list", "ns/minmax", "cyc/minmax");
+	for (k = 0; k < sizeof(lens) / sizeof(lens[0]); ++k) {
+		int len = lens[k];
+		long exact_count = 0, below = 0;
+		double over = 0;
+		u32 max_over = 0;
+		double t0, t1, t2;
+		unsigned long long c0, c1, c2;
+		volatile u32 sink;
+		int i;
+
+		exact_min(delays, n, len, exact, deque);
+
+		t0 = now_ns();
+		c0 = now_cycles();
+		sink = list_min(delays, n, len, list);
+		t1 = now_ns();
+		c1 = now_cycles();
+		filter_min(delays, n, len, filtered);
+		t2 = now_ns();
+		c2 = now_cycles();
+		(void)sink;
+
+		for (i = 0; i < n; ++i) {
+			if (filtered[i] < exact[i]) {
+				++below;
+				continue;
+			}
+			if (filtered[i] == exact[i])
+				++exact_count;
+			over += filtered[i] - exact[i];
+			max_over = max(max_over, filtered[i] - exact[i]);
+		}
+
+		printf("%8d %8.2f %10.3f %10u %10.1f %10.1f %10.1f %10.1f\n", len, exact_count * 100.0 / n, over / n,
+		       max_over, (t1 - t0) / n, (double)(c1 - c0) / n, (t2 - t1) / n, (double)(c2 - c1) / n);
+
+		if (below) {
+			printf("FAIL: below the minimum %ld times\n", below);
+			status = 1;
+		}
+		if ((len <= 2) && (exact_count != n)) {
+			printf("FAIL: not exact\n");
+			status = 1;
+		}
+	}
+
+	if (!status)
+		printf("OK\n");
+	free(delays);
+	free(exact);
+	free(filtered);
+	free(deque);
+	free(list);
+	return status;
+}
@@ -14,6 +14,7 @@
 #include <linux/inet_diag.h>
 #include <net/tcp.h>
 #include <linux/random.h>
+#include "ledbat_minmax.h"
 
 #define GAIN 1 /* GAIN MUST be set to 1 or less. */
 #define ALLOWED_INCREASE 1 /* ALLOWED_INCREASE SHOULD be 1, and it MUST be greater than 0 */
@@ -27,34 +28,30 @@ MODULE_PARM_DESC(target, "TARGET is the maximum queueing delay that LEDBAT itsel
 
 /* Current_FILTER SHOULD be 1;
  * it MAY be tuned so that it is at least 1 and no more than cwnd/2 
+ * Both filters take constant time and space whatever their length, and can be
+ * changed at run time.
  */
 static int current_filter __read_mostly = 2; 
-module_param(current_filter, int, 0);
+module_param(current_filter, int, 0644);
 MODULE_PARM_DESC(current_filter, "Maintain a list of CURRENT_FILTER last delays observed.");
 
 /* BASE_HISTORY SHOULD be 2;
  * it MUST be no less than 2 and SHOULD NOT be more than 10 
  */
 static int base_history __read_mostly = 2;
-module_param(base_history, int, 0);
+module_param(base_history, int, 0644);
 MODULE_PARM_DESC(base_history, "Maintain BASE_HISTORY delay-minima where each minimum is measured over a period of a minute.");
 
 
-struct ledbat_list {
-	u32 *buffer;
-	u8 next;
-	u8 len;
-};
-   
 /* ledbat structure */
 struct ledbat {
-  u32 base_delay;
   s32 cwnd_cnt;
 
-  struct ledbat_list current_delays;
-  struct ledbat_list base_delays; 
-
-  u32 last_rollover; /* This is to be interpreted as time */
+  /* min of the last current_filter delays, timed by delay_samples */
+  struct ledbat_minmax current_delays;
+  /* min of the delays of the last base_history minutes, timed by jiffies */
+  struct ledbat_minmax base_delays;
+  u32 delay_samples;
   
   u32 remote_hz;
   u32 last_local_ts;
@@ -65,30 +62,16 @@ struct ledbat {
 };
 
 
-static void ledbat_init_list(struct ledbat_list *list, int len)
-{
-	list->buffer = kmalloc( len * sizeof(u32), GFP_KERNEL);
-        if (list->buffer !=  NULL) {
-           int i;
-           for (i=0; i<len; i++)
-             list->buffer[i] = UINT_MAX;
-        }
-	list->len = len;
-	list->next = 0;
-}
-
-
 static void tcp_ledbat_init(struct sock *sk){  
 
   struct ledbat *ledbat = inet_csk_ca(sk);
 
-  ledbat->base_delay = UINT_MAX;
   ledbat->cwnd_cnt = 0; 
 
-  ledbat_init_list(&ledbat->current_delays, current_filter);
-  ledbat_init_list(&ledbat->base_delays, base_history);
-
-  ledbat->last_rollover = 0;
+  /* the first delay resets both filters */
+  ledbat_minmax_reset(&ledbat->current_delays, 0, UINT_MAX);
+  ledbat_minmax_reset(&ledbat->base_delays, 0, UINT_MAX);
+  ledbat->delay_samples = 0;
 
   ledbat->local_time_offset = 0;
   ledbat->remote_time_offset = 0;
@@ -98,64 +81,28 @@ static void tcp_ledbat_init(struct sock *sk){
 
 }
 
-static void tcp_ledbat_release(struct sock *sk){
-
-  struct ledbat *ledbat = inet_csk_ca(sk);
-  kfree(ledbat->current_delays.buffer);
-  kfree(ledbat->base_delays.buffer);
-
-}
-
-void tcp_ledbat_update_current_delay(struct sock *sk, int delay){
+u32 tcp_ledbat_update_current_delay(struct sock *sk, u32 delay){
 
   struct ledbat *ledbat = inet_csk_ca(sk);
+  u32 win = max(current_filter, 1) - 1;
 
-  /* Maintain a list of CURRENT_FILTER last delays observed. */
-  /* delete first item in current_delays list
-   * append delay to current_delays list
-   */
-
-  ledbat->current_delays.buffer[ledbat->current_delays.next] = delay;
-  ledbat->current_delays.next++; 
-  if (ledbat->current_delays.next == current_filter)
-     ledbat->current_delays.next=0; 
+  /* Maintain a list of CURRENT_FILTER last delays observed, */
+  /* as the min of the samples numbered from now - (CURRENT_FILTER - 1) */
+  return ledbat_minmax_running_min(&ledbat->current_delays, win,
+                                   ++ledbat->delay_samples, delay);
  
 }
 
-void tcp_ledbat_update_base_delay(struct sock *sk, u32 delay) {
+u32 tcp_ledbat_update_base_delay(struct sock *sk, u32 delay) {
 
   struct ledbat *ledbat = inet_csk_ca(sk);
+  u32 win = max(base_history, 1) * 60 * HZ;
 
   /* Maintain BASE_HISTORY min delays. Each represents a minute.*/
-  /* if round_to_minute(now) != round_to_minute(last_rollover)
-   *   last_rollover = now
-   *   forget the earliest of base delays
-   *   add delay to the end of base_delays
-   * else
-   *   last of base_delays = min(last of base_delays, delay)
-   */
-
-  if (get_seconds() >= ledbat->last_rollover + 60) { 
-     ledbat->last_rollover = get_seconds(); 
-     ledbat->base_delays.next++; 
-     if (ledbat->base_delays.next == base_history)
-        ledbat->base_delays.next=0; 
-     ledbat->base_delays.buffer[ledbat->base_delays.next] = delay;
-  } else {
-     ledbat->base_delays.buffer[ledbat->base_delays.next] = 
-          min(ledbat->base_delays.buffer[ledbat->base_delays.next], delay);
-  }
-
-}
-
-u32 tcp_ledbat_get_min_from_list(struct ledbat_list *list) {  
-
-  u32 min_delay = UINT_MAX;
-  int i;
-  for (i=0; i<list->len; i++) {
-     min_delay = min(list->buffer[i], min_delay);
-  }
-  return min_delay;
+  /* The min over the last BASE_HISTORY minutes is the min of those
+   * minima, without per-minute rollover. */
+  return ledbat_minmax_running_min(&ledbat->base_delays, win,
+                                   (u32)jiffies, delay);
 
 }
 
@@ -204,6 +151,7 @@ void tcp_ledbat_cong_avoid(struct sock *sk, u32 ack, u32 acked) {
    struct ledbat *ledbat = inet_csk_ca(sk);
 
    u32 delay = 0;
+   u32 current_delay, base_delay;
    u32 queuing_delay;
    int off_target;
    u32 cwnd;
@@ -226,17 +174,12 @@ void tcp_ledbat_cong_avoid(struct sock *sk, u32 ack, u32 acked) {
       delay = time - remote_time;
    
    // update delays
-   tcp_ledbat_update_base_delay(sk, delay);
-   tcp_ledbat_update_current_delay(sk, delay);
-   ledbat->base_delay = min(ledbat->base_delay, delay);
-
-   // calculate queuing delay
-   if (ledbat->current_delays.buffer!=NULL && ledbat->base_delays.buffer!=NULL) {
-      queuing_delay = tcp_ledbat_get_min_from_list(&ledbat->current_delays) - 
-   	   tcp_ledbat_get_min_from_list(&ledbat->base_delays);
-   } else {
-      queuing_delay = delay - ledbat->base_delay;
-   }
+   current_delay = tcp_ledbat_update_current_delay(sk, delay);
+   base_delay = tcp_ledbat_update_base_delay(sk, delay);
+
+   // calculate queuing delay; the base filter may lag behind a minimum
+   // that left its window, but never goes above the current one
+   queuing_delay = current_delay - min(base_delay, current_delay);
 
    /* don't change cwnd is not cwnd-limited */
    if (!tcp_is_cwnd_limited(sk))
@@ -278,12 +221,12 @@ EXPORT_SYMBOL_GPL(tcp_ledbat_cong_avoid);
 static struct tcp_congestion_ops tcp_ledbat = {
   .init = tcp_ledbat_init,
   .ssthresh = tcp_reno_ssthresh,
-  .release = tcp_ledbat_release,
   .cong_avoid = tcp_ledbat_cong_avoid,
   .name = "ledbat",
 };
   
 static int __init tcp_ledbat_register(void){
+  BUILD_BUG_ON(sizeof(struct ledbat) > ICSK_CA_PRIV_SIZE);
   tcp_register_congestion_control(&tcp_ledbat);
 }
 
@@ -0,0 +1,164 @@
+/* Checks pcc_exp() and pcc_sigmoid() against libm and against the Taylor loop
+ * they replace, and measures the time per call of both:
+ *
+ *    exp_test [-n ROUNDS]
+ *
+ * The arguments are the range the PCC modules pass, a loss ratio of 0 to 15%
+ * minus the 5% margin, in PCC_EXP_SCALE units. Exits with 1 if pcc_exp() is
+ * off by more than its rounding to an integer plus 1e-4 relative anywhere in
+ * it.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "pcc_math.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+#define X_MIN	(-5 * PCC_EXP_SCALE)
+#define X_MAX	(10 * PCC_EXP_SCALE)
+
+/* the loop of tcp_pcc.c before pcc_math.h */
+static u32 pcc_exp_taylor(s32 x)
+{
+	s64 temp = PCC_EXP_SCALE;
+	s64 e = PCC_EXP_SCALE;
+	int i;
+
+	for (i = 1; temp != 0; i++) {
+		temp *= x;
+		temp /= i;
+		temp /= PCC_EXP_SCALE;
+		e += temp;
+	}
+	return e;
+}
+
+static u32 pcc_exp_table(s32 x)
+{
+	return pcc_exp(x);
+}
+
+struct error {
+	double max_rel;
+	s32 max_rel_x;
+	double max_abs;
+	s32 max_abs_x;
+	int bad;
+};
+
+static void check(u32 (*f)(s32), struct error *err)
+{
+	s32 x;
+
+	err->max_rel = err->max_abs = 0;
+	err->bad = 0;
+	for (x = X_MIN; x < X_MAX; ++x) {
+		double exact = exp((double)x / PCC_EXP_SCALE) * PCC_EXP_SCALE;
+		double abs_err = fabs(f(x) - exact);
+		double rel_err = abs_err / exact;
+
+		if (rel_err > err->max_rel) {
+			err->max_rel = rel_err;
+			err->max_rel_x = x;
+		}
+		if (abs_err > err->max_abs) {
+			err->max_abs = abs_err;
+			err->max_abs_x = x;
+		}
+		if (abs_err > 0.5 + 1e-4 * exact)
+			++err->bad;
+	}
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* time per call over the whole range, in ns and in cycles */
+static void measure(u32 (*f)(s32), int rounds, double *ns, double *cycles)
+{
+	volatile u32 sink = 0;
+	double start = now_ns();
+	unsigned long long calls = (unsigned long long)rounds * (X_MAX - X_MIN);
+#ifdef HAVE_RDTSC
+	unsigned long long tsc = __rdtsc();
+#endif
+	int r;
+	s32 x;
+
+	for (r = 0; r < rounds; ++r)
+		for (x = X_MIN; x < X_MAX; ++x)
+			sink += f(x);
+
+#ifdef HAVE_RDTSC
+	*cycles = (double)(__rdtsc() - tsc) / calls;
+#else
+	*cycles = 0;
+#endif
+	*ns = (now_ns() - start) / calls;
+	(void)sink;
+}
+
+int main(int argc, char *argv[])
+{
+	struct error taylor, table;
+	double taylor_ns, taylor_cycles, table_ns, table_cycles;
+	double sig_max_rel = 0;
+	int rounds = 20;
+	s32 x;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n ROUNDS]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	check(pcc_exp_taylor, &taylor);
+	check(pcc_exp_table, &table);
+
+	/* the utility term of a 100 Mbit/s interval */
+	for (x = X_MIN; x < X_MAX; ++x) {
+		s64 rate = 12500000;
+		double exact = rate / (1 + exp((double)x / PCC_EXP_SCALE));
+		double rel = fabs(pcc_sigmoid(rate, x) - exact) / exact;
+
+		if (rel > sig_max_rel)
+			sig_max_rel = rel;
+	}
+
+	measure(pcc_exp_taylor, rounds, &taylor_ns, &taylor_cycles);
+	measure(pcc_exp_table, rounds, &table_ns, &table_cycles);
+
+	printf("x in [%d, %d) / %d\n", X_MIN, X_MAX, PCC_EXP_SCALE);
+	printf("%-8s %12s %8s %12s %8s %8s %10s %10s\n", "", "max rel err", "at x", "max abs err", "at x",
+	       "too far", "ns/call", "cyc/call");
+	printf("%-8s %12.2e %8d %12.2f %8d %8d %10.1f %10.1f\n", "taylor", taylor.max_rel, taylor.max_rel_x,
+	       taylor.max_abs, taylor.max_abs_x, taylor.bad, taylor_ns, taylor_cycles);
+	printf("%-8s %12.2e %8d %12.2f %8d %8d %10.1f %10.1f\n", "table", table.max_rel, table.max_rel_x,
+	       table.max_abs, table.max_abs_x, table.bad, table_ns, table_cycles);
+	printf("pcc_sigmoid max rel err %.2e\n", sig_max_rel);
+
+	if (table.bad) {
+		printf("FAIL: pcc_exp off by more than 1e-4 at %d points\n", table.bad);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,84 @@
+#ifndef _PCC_MATH_H
+#define _PCC_MATH_H
+
+/* Fixed-point math shared by the PCC kernel modules (allegro/src and
+ * vivace/src), and debug logging that is compiled in only with PCC_DEBUG
+ * (make PCC_DEBUG=1).
+ *
+ * pcc_exp() used to sum the Taylor series of e^x until a term rounded to 0,
+ * up to 40 iterations of two 64-bit divisions each for the arguments the
+ * modules pass. It now computes e^x = 2^(x * log2(e)) in constant time: the
+ * integer part of the power of two is a shift, and the fractional part is
+ * read from a table of 33 entries with linear interpolation, which is within
+ * 1e-4 of e^x before the result is rounded to an integer. exp_test compares
+ * it with the Taylor loop.
+ */
+
+#include <linux/kernel.h>
+
+#ifdef PCC_DEBUG
+#define pcc_dbg(fmt, ...)	printk(KERN_INFO fmt, ##__VA_ARGS__)
+#else
+/* the arguments are still checked, and count as used */
+#define pcc_dbg(fmt, ...)	do { if (0) printk(KERN_INFO fmt, ##__VA_ARGS__); } while (0)
+#endif
+
+/* scale of the fixed-point arguments and results */
+#define PCC_EXP_SCALE		1000
+
+/* log2(e) / PCC_EXP_SCALE, in 32 fractional bits */
+#define PCC_EXP_LOG2E		6196328LL
+
+#define PCC_EXP2_TABLE_BITS	5
+#define PCC_EXP2_FRAC_BITS	16
+
+/* 2^(i / 32) for i = 0..32, in 30 fractional bits */
+static const u32 pcc_exp2_table[(1 << PCC_EXP2_TABLE_BITS) + 1] = {
+	1073741824, 1097253708, 1121280436, 1145833280,
+	1170923762, 1196563654, 1222764986, 1249540052,
+	1276901417, 1304861917, 1333434672, 1362633090,
+	1392470869, 1422962010, 1454120821, 1485961921,
+	1518500250, 1551751076, 1585730000, 1620452965,
+	1655936265, 1692196547, 1729250827, 1767116489,
+	1805811301, 1845353420, 1885761398, 1927054196,
+	1969251188, 2012372174, 2056437387, 2101467502,
+	2147483648,
+};
+
+/* get x = number * PCC_EXP_SCALE, return (e^number) * PCC_EXP_SCALE, rounded,
+ * or U32_MAX if it does not fit
+ */
+static inline u32 pcc_exp(s32 x)
+{
+	const int interp_bits = PCC_EXP2_FRAC_BITS - PCC_EXP2_TABLE_BITS;
+	/* x * log2(e), in PCC_EXP2_FRAC_BITS fractional bits */
+	s64 y = ((s64)x * PCC_EXP_LOG2E) >> (32 - PCC_EXP2_FRAC_BITS);
+	s64 n = y >> PCC_EXP2_FRAC_BITS;
+	u32 frac = y & ((1 << PCC_EXP2_FRAC_BITS) - 1);
+	u32 i = frac >> interp_bits;
+	u32 rem = frac & ((1 << interp_bits) - 1);
+	u64 m;
+
+	/* 2^22 * PCC_EXP_SCALE is the largest power of two below U32_MAX */
+	if (n >= 22)
+		return U32_MAX;
+	if (n < -31)
+		return 0;
+
+	/* 2^(frac), in 30 fractional bits */
+	m = pcc_exp2_table[i] +
+	    ((((u64)(pcc_exp2_table[i + 1] - pcc_exp2_table[i])) * rem) >> interp_bits);
+	m *= PCC_EXP_SCALE;
+
+	if (n >= 0)
+		return (u32)(((m << n) + (1ULL << 29)) >> 30);
+	return (u32)((m + (1ULL << (29 - n))) >> (30 - n));
+}
+
+/* value / (1 + e^number), with x = number * PCC_EXP_SCALE */
+static inline s64 pcc_sigmoid(s64 value, s32 x)
+{
+	return (value * PCC_EXP_SCALE) / ((s64)pcc_exp(x) + PCC_EXP_SCALE);
+}
+
+#endif /* _PCC_MATH_H */
@@ -46,6 +46,8 @@ written by
    #include <cstring>
    #include <cstdio>
    #include <cerrno>
+   #include <cstdlib>
+   #include <pthread.h>
 #else
    #include <winsock2.h>
    #include <ws2tcpip.h>
@@ -55,6 +57,9 @@ written by
 #endif
 #include "channel.h"
 #include "packet.h"
+#ifndef WIN32
+   #include "emulator.h"
+#endif
 
 #ifdef WIN32
    #define socklen_t int
@@ -66,13 +71,50 @@ written by
    #define NET_ERROR WSAGetLastError()
 #endif
 
+#ifndef WIN32
+// Each thread counts its socket calls in a record of its own, padded to and
+// allocated on a cache line of 64 bytes, so that the send and receive workers
+// do not share a line for it. The records are never freed; there is one per
+// thread that ever used a channel.
+struct CSysCallCount
+{
+   volatile int64_t m_llCalls;          // written by the owning thread only
+   CSysCallCount* m_pNext;
+   char m_pcPad[64 - sizeof(int64_t) - sizeof(CSysCallCount*)];
+};
+
+static pthread_mutex_t s_SysCallLock = PTHREAD_MUTEX_INITIALIZER;
+static CSysCallCount* s_pSysCallCounts = NULL;
+static __thread CSysCallCount* t_pSysCallCount = NULL;
+
+static inline void countSysCall()
+{
+   if (NULL == t_pSysCallCount)
+   {
+      void* line = NULL;
+      if (0 != posix_memalign(&line, 64, sizeof(CSysCallCount)))
+         return;
+      CSysCallCount* c = (CSysCallCount*)line;
+      c->m_llCalls = 0;
+      pthread_mutex_lock(&s_SysCallLock);
+      c->m_pNext = s_pSysCallCounts;
+      s_pSysCallCounts = c;
+      pthread_mutex_unlock(&s_SysCallLock);
+      t_pSysCallCount = c;
+   }
+   t_pSysCallCount->m_llCalls = t_pSysCallCount->m_llCalls + 1;
+}
+#endif
+
 
 CChannel::CChannel():
 m_iIPversion(AF_INET),
 m_iSockAddrSize(sizeof(sockaddr_in)),
 m_iSocket(),
 m_iSndBufSize(65536),
-m_iRcvBufSize(65536)
+m_iRcvBufSize(65536),
+m_pEmulator(NULL),
+m_iPort(0)
 {
 }
 
@@ -80,7 +122,9 @@ CChannel::CChannel(const int& version):
 m_iIPversion(version),
 m_iSocket(),
 m_iSndBufSize(65536),
-m_iRcvBufSize(65536)
+m_iRcvBufSize(65536),
+m_pEmulator(NULL),
+m_iPort(0)
 {
    m_iSockAddrSize = (AF_INET == m_iIPversion) ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
 }
@@ -130,12 +174,29 @@ void CChannel::open(const sockaddr* addr)
    }
 
    setUDPSockOpt();
+   attachEmulator();
 }
 
 void CChannel::open(UDPSOCKET udpsock)
 {
    m_iSocket = udpsock;
    setUDPSockOpt();
+   attachEmulator();
+}
+
+void CChannel::attachEmulator()
+{
+   #ifndef WIN32
+      m_pEmulator = CEmuNetwork::instance();
+      if (NULL == m_pEmulator)
+         return;
+
+      // the port field sits at the same offset in sockaddr_in and sockaddr_in6
+      sockaddr_in6 addr;
+      getSockAddr((sockaddr*)&addr);
+      m_iPort = ntohs(addr.sin6_port);
+      m_pEmulator->attach(m_iPort);
+   #endif
 }
 
 void CChannel::setUDPSockOpt()
@@ -184,6 +245,8 @@ void CChannel::setUDPSockOpt()
 void CChannel::close() const
 {
    #ifndef WIN32
+      if (NULL != m_pEmulator)
+         m_pEmulator->detach(m_iPort);
       ::close(m_iSocket);
    #else
       closesocket(m_iSocket);
@@ -259,7 +322,16 @@ int CChannel::sendto(const sockaddr* addr, CPacket& packet) const
       mh.msg_controllen = 0;
       mh.msg_flags = 0;
 
-      int res = sendmsg(m_iSocket, &mh, 0);
+      int res = -1;
+      if (NULL != m_pEmulator)
+         res = m_pEmulator->send(m_iPort, addr, (char*)packet.m_nHeader, CPacket::m_iPktHdrSize, packet.m_pcData, packet.getLength());
+
+      // destinations outside this process are not emulated
+      if (res < 0)
+      {
+         res = sendmsg(m_iSocket, &mh, 0);
+         countSysCall();
+      }
    #else
       DWORD size = CPacket::m_iPktHdrSize + packet.getLength();
       int addrsize = m_iSockAddrSize;
@@ -298,17 +370,38 @@ int CChannel::recvfrom(sockaddr* addr, CPacket& packet) const
       mh.msg_controllen = 0;
       mh.msg_flags = 0;
 
-      #ifdef UNIX
-         fd_set set;
-         timeval tv;
-         FD_ZERO(&set);
-         FD_SET(m_iSocket, &set);
-         tv.tv_sec = 0;
-         tv.tv_usec = 10000;
-         select(m_iSocket+1, &set, NULL, &set, &tv);
-      #endif
-
-      int res = recvmsg(m_iSocket, &mh, 0);
+      int res;
+      if (NULL != m_pEmulator)
+      {
+         // peers outside this process still reach the socket: poll it, then wait on the
+         // emulator and the socket together
+         res = recvmsg(m_iSocket, &mh, MSG_DONTWAIT);
+         countSysCall();
+         if (res <= 0)
+         {
+            res = m_pEmulator->recv(m_iPort, addr, (char*)packet.m_nHeader, CPacket::m_iPktHdrSize, packet.m_pcData, packet.getLength(), 10000, m_iSocket);
+            if (res < 0)
+            {
+               res = recvmsg(m_iSocket, &mh, MSG_DONTWAIT);
+               countSysCall();
+            }
+         }
+      }
+      else
+      {
+         #ifdef UNIX
+            fd_set set;
+            timeval tv;
+            FD_ZERO(&set);
+            FD_SET(m_iSocket, &set);
+            tv.tv_sec = 0;
+            tv.tv_usec = 10000;
+            select(m_iSocket+1, &set, NULL, &set, &tv);
+         #endif
+
+         res = recvmsg(m_iSocket, &mh, 0);
+         countSysCall();
+      }
    #else
       DWORD size = CPacket::m_iPktHdrSize + packet.getLength();
       DWORD flag = 0;
@@ -344,3 +437,17 @@ int CChannel::recvfrom(sockaddr* addr, CPacket& packet) const
 
    return packet.getLength();
 }
+
+int64_t CChannel::getSysCalls()
+{
+#ifndef WIN32
+   int64_t calls = 0;
+   pthread_mutex_lock(&s_SysCallLock);
+   for (CSysCallCount* c = s_pSysCallCounts; NULL != c; c = c->m_pNext)
+      calls += c->m_llCalls;
+   pthread_mutex_unlock(&s_SysCallLock);
+   return calls;
+#else
+   return 0;
+#endif
+}
@@ -45,6 +45,8 @@ written by
 #include "udt.h"
 #include "packet.h"
 
+class CEmuNetwork;
+
 
 class CChannel
 {
@@ -154,8 +156,18 @@ public:
 
    int recvfrom(sockaddr* addr, CPacket& packet) const;
 
+      // Functionality:
+      //    Count the socket calls made by all the channels of the process.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Number of sendmsg() and recvmsg() calls so far.
+
+   static int64_t getSysCalls();
+
 private:
    void setUDPSockOpt();
+   void attachEmulator();
 
 private:
    int m_iIPversion;                    // IP version
@@ -165,6 +177,9 @@ private:
 
    int m_iSndBufSize;                   // UDP sending buffer size
    int m_iRcvBufSize;                   // UDP receiving buffer size
+
+   CEmuNetwork* m_pEmulator;            // in-process link emulator, NULL when packets go through the kernel
+   int m_iPort;                         // local UDP port, the channel's address on the emulator
 };
 
 
@@ -0,0 +1,1082 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include "common.h"
+#include "emulator.h"
+
+using namespace std;
+
+CEmuConfig::CEmuConfig():
+m_strTrace(),
+m_iDelay(0),
+m_dLoss(0),
+m_Queue(DROPTAIL),
+m_iQueueBytes(0),
+m_iQueuePackets(0),
+m_iRedMinBytes(0),
+m_iRedMaxBytes(0),
+m_dRedDrop(0),
+m_iSeed(1)
+{
+}
+
+CEmuConfig CEmuConfig::parse(const string& spec)
+{
+   CEmuConfig config;
+
+   stringstream ss(spec);
+   string item;
+   while (getline(ss, item, ','))
+   {
+      if (item.empty())
+         continue;
+
+      size_t eq = item.find('=');
+      if (string::npos == eq)
+         throw CUDTException(5, 3, 0);
+
+      string key = item.substr(0, eq);
+      string value = item.substr(eq + 1);
+      const char* v = value.c_str();
+
+      if (key == "trace")
+         config.m_strTrace = value;
+      else if (key == "delay")
+         config.m_iDelay = atoi(v);
+      else if (key == "loss")
+         config.m_dLoss = atof(v);
+      else if (key == "queue")
+      {
+         if (value == "droptail")
+            config.m_Queue = DROPTAIL;
+         else if (value == "red")
+            config.m_Queue = RED;
+         else
+            throw CUDTException(5, 3, 0);
+      }
+      else if (key == "bytes")
+         config.m_iQueueBytes = atoi(v);
+      else if (key == "packets")
+         config.m_iQueuePackets = atoi(v);
+      else if (key == "min_bytes")
+         config.m_iRedMinBytes = atoi(v);
+      else if (key == "max_bytes")
+         config.m_iRedMaxBytes = atoi(v);
+      else if (key == "drop_percentage")
+         config.m_dRedDrop = atoi(v) / 100.0;
+      else if (key == "seed")
+         config.m_iSeed = strtoul(v, NULL, 10);
+      else
+         throw CUDTException(5, 3, 0);
+   }
+
+   if ((config.m_iDelay < 0) || (config.m_dLoss < 0) || (config.m_dLoss > 1) || (config.m_dRedDrop < 0) || (config.m_dRedDrop > 1))
+      throw CUDTException(5, 3, 0);
+
+   if ((RED == config.m_Queue) && (config.m_iRedMaxBytes <= config.m_iRedMinBytes))
+      throw CUDTException(5, 3, 0);
+
+   return config;
+}
+
+CEmuLink::CEmuLink(const CEmuConfig& config, const CTraceFile* trace):
+m_Config(config),
+m_pTrace(trace),
+m_Stats(),
+m_bStarted(false),
+m_ullEpoch(0),
+m_ullCycle(0),
+m_iRun(0),
+m_ullMs(0),
+m_iLeft(0),
+m_Queue(),
+m_iQueueBytes(0),
+m_iHeadLeft(0),
+m_Flight(),
+m_dRedAverage(0),
+m_iRedCount(0),
+m_ullIdleSince(0),
+m_Random(config.m_iSeed),
+m_Uniform(0.0, 1.0)
+{
+}
+
+bool CEmuLink::enqueue(const char* data, const int& size, const uint64_t& now)
+{
+   advance(now);
+
+   ++ m_Stats.m_llArrived;
+
+   if ((m_Config.m_dLoss > 0) && (m_Uniform(m_Random) < m_Config.m_dLoss))
+   {
+      ++ m_Stats.m_llLost;
+      return false;
+   }
+
+   CEmuPacket p;
+   p.m_strData.assign(data, size);
+
+   if (NULL == m_pTrace)
+   {
+      p.m_ullTime = now + m_Config.m_iDelay * 1000ULL;
+      m_Flight.push_back(p);
+      return true;
+   }
+
+   if (!admit(size, now))
+   {
+      ++ m_Stats.m_llDropped;
+      return false;
+   }
+
+   if (m_Queue.empty())
+      m_iHeadLeft = size;
+   m_iQueueBytes += size;
+   m_Queue.push_back(p);
+
+   return true;
+}
+
+int CEmuLink::dequeue(char* data, const int& size, const uint64_t& now)
+{
+   advance(now);
+
+   if (m_Flight.empty() || (m_Flight.front().m_ullTime > now))
+      return -1;
+
+   const string& p = m_Flight.front().m_strData;
+   int len = min(size, (int)p.size());
+   memcpy(data, p.data(), len);
+   m_Flight.pop_front();
+
+   ++ m_Stats.m_llDelivered;
+   m_Stats.m_llDeliveredBytes += len;
+
+   return len;
+}
+
+uint64_t CEmuLink::nextArrival(const uint64_t& now)
+{
+   advance(now);
+
+   if (!m_Flight.empty())
+      return m_Flight.front().m_ullTime;
+
+   // the head packet may need more than one opportunity, so this is only a lower bound
+   if (!m_Queue.empty())
+      return opportunityTime() + m_Config.m_iDelay * 1000ULL;
+
+   return ~0ULL;
+}
+
+void CEmuLink::advance(const uint64_t& now)
+{
+   if (!m_bStarted)
+   {
+      m_bStarted = true;
+      m_ullEpoch = now;
+      m_ullIdleSince = now;
+      if (NULL != m_pTrace)
+         startRun(0, 0);
+   }
+
+   if (NULL == m_pTrace)
+      return;
+
+   while (!m_Queue.empty())
+   {
+      uint64_t t = opportunityTime();
+      if (t > now)
+         break;
+
+      deliver(t);
+      nextOpportunity();
+   }
+
+   if (m_Queue.empty())
+      skipIdle(now);
+}
+
+void CEmuLink::skipIdle(const uint64_t& now)
+{
+   // opportunities that find the queue empty are lost, as in mahimahi; jump over
+   // them instead of walking an idle period one opportunity at a time
+   if (opportunityTime() >= now)
+      return;
+
+   uint64_t period = m_pTrace->period() * 1000ULL;
+   uint64_t rel = now - m_ullEpoch;
+
+   m_ullCycle = rel / period * period;
+   uint64_t ms = (rel - m_ullCycle + 999) / 1000;
+   size_t run = m_pTrace->findRun(ms);
+
+   if (run == m_pTrace->runCount())
+   {
+      m_ullCycle += period;
+      startRun(0, 0);
+   }
+   else
+      startRun(run, ms);
+}
+
+void CEmuLink::startRun(const size_t& run, const uint64_t& ms)
+{
+   const CTraceRun& r = m_pTrace->run(run);
+   m_iRun = run;
+   m_ullMs = (ms > r.m_iStart) ? ms : r.m_iStart;
+   m_iLeft = r.m_iCount;
+}
+
+uint64_t CEmuLink::opportunityTime() const
+{
+   return m_ullEpoch + m_ullCycle + m_ullMs * 1000ULL;
+}
+
+void CEmuLink::nextOpportunity()
+{
+   if (-- m_iLeft > 0)
+      return;
+
+   const CTraceRun& r = m_pTrace->run(m_iRun);
+   if (++ m_ullMs < (uint64_t)r.m_iStart + r.m_iLength)
+   {
+      m_iLeft = r.m_iCount;
+      return;
+   }
+
+   if (m_iRun + 1 < m_pTrace->runCount())
+      startRun(m_iRun + 1, 0);
+   else
+   {
+      m_ullCycle += m_pTrace->period() * 1000ULL;
+      startRun(0, 0);
+   }
+}
+
+void CEmuLink::deliver(const uint64_t& t)
+{
+   // a packet leaves once the opportunities have carried all of its bytes, so a
+   // packet may be split across two opportunities
+   int bytes = CTraceFile::m_iOpportunityBytes;
+
+   while ((bytes > 0) && !m_Queue.empty())
+   {
+      int amount = min(bytes, m_iHeadLeft);
+      bytes -= amount;
+      m_iHeadLeft -= amount;
+
+      if (m_iHeadLeft > 0)
+         break;
+
+      CEmuPacket& p = m_Queue.front();
+      p.m_ullTime = t + m_Config.m_iDelay * 1000ULL;
+      m_iQueueBytes -= p.m_strData.size();
+      m_Flight.push_back(p);
+      m_Queue.pop_front();
+
+      if (m_Queue.empty())
+         m_ullIdleSince = t;
+      else
+         m_iHeadLeft = m_Queue.front().m_strData.size();
+   }
+}
+
+bool CEmuLink::admit(const int& size, const uint64_t& now)
+{
+   if (CEmuConfig::DROPTAIL == m_Config.m_Queue)
+   {
+      if ((m_Config.m_iQueueBytes > 0) && (m_iQueueBytes + size > m_Config.m_iQueueBytes))
+         return false;
+      if ((m_Config.m_iQueuePackets > 0) && ((int)m_Queue.size() + 1 > m_Config.m_iQueuePackets))
+         return false;
+      return true;
+   }
+
+   // RED as in mm-modified/queue/red_packet_queue.hh, on the link's clock
+   const double w = 0.002;
+   const double packet_rate = 800;
+
+   if (m_iQueueBytes > 0)
+      m_dRedAverage = (1 - w) * m_dRedAverage + w * m_iQueueBytes;
+   else
+   {
+      double m = packet_rate * ((now - m_ullIdleSince) / 1000);
+      m_dRedAverage = pow(1 - w, m) * m_dRedAverage;
+   }
+
+   if (m_dRedAverage >= m_Config.m_iRedMaxBytes)
+   {
+      m_iRedCount = 0;
+      return false;
+   }
+
+   if (m_dRedAverage >= m_Config.m_iRedMinBytes)
+   {
+      ++ m_iRedCount;
+
+      double pb = m_Config.m_dRedDrop * (m_dRedAverage - m_Config.m_iRedMinBytes) / (m_Config.m_iRedMaxBytes - m_Config.m_iRedMinBytes);
+      pb = pb * size / 1500.0;
+      double pa = pb / (1 - m_iRedCount * pb);
+
+      if (m_Uniform(m_Random) < pa)
+      {
+         m_iRedCount = 0;
+         return false;
+      }
+   }
+
+   m_iRedCount = -1;
+
+   return true;
+}
+
+CEmuClock* CEmuClock::s_pInstance = NULL;
+pthread_mutex_t CEmuClock::s_InstanceLock = PTHREAD_MUTEX_INITIALIZER;
+__thread CEmuClock::CWaiter* CEmuClock::s_pSelf = NULL;
+
+CEmuClock* CEmuClock::enable()
+{
+   CGuard instguard(s_InstanceLock);
+
+   if (NULL == s_pInstance)
+      s_pInstance = new CEmuClock;
+   s_pInstance->enter(false);
+
+   return s_pInstance;
+}
+
+CEmuClock::CEmuClock():
+m_Lock(),
+m_ThreadKey(),
+m_ullNow(CTimer::getTime()),
+m_iRunning(0),
+m_vWaiters()
+{
+   pthread_mutex_init(&m_Lock, NULL);
+   pthread_key_create(&m_ThreadKey, leave);
+}
+
+CEmuClock::~CEmuClock()
+{
+   pthread_key_delete(m_ThreadKey);
+   pthread_mutex_destroy(&m_Lock);
+}
+
+uint64_t CEmuClock::time()
+{
+   CEmuClock* c = s_pInstance;
+   return (NULL != c) ? c->now() : CTimer::getTime();
+}
+
+int CEmuClock::wait(pthread_cond_t* cond, pthread_mutex_t* lock)
+{
+   CEmuClock* c = s_pInstance;
+   if (NULL == c)
+      return pthread_cond_wait(cond, lock);
+
+   return c->block(cond, lock, ~0ULL);
+}
+
+int CEmuClock::timedwait(pthread_cond_t* cond, pthread_mutex_t* lock, const uint64_t& deadline)
+{
+   CEmuClock* c = s_pInstance;
+   if (NULL == c)
+   {
+      // CTimer::getTime() is gettimeofday(), the clock of pthread_cond_timedwait()
+      timespec ts;
+      ts.tv_sec = deadline / 1000000;
+      ts.tv_nsec = (deadline % 1000000) * 1000;
+      return pthread_cond_timedwait(cond, lock, &ts);
+   }
+
+   return c->block(cond, lock, deadline);
+}
+
+void CEmuClock::signal(pthread_cond_t* cond)
+{
+   CEmuClock* c = s_pInstance;
+   if (NULL == c)
+      pthread_cond_signal(cond);
+   else
+      c->notify(cond, false);
+}
+
+void CEmuClock::broadcast(pthread_cond_t* cond)
+{
+   CEmuClock* c = s_pInstance;
+   if (NULL == c)
+      pthread_cond_broadcast(cond);
+   else
+      c->notify(cond, true);
+}
+
+void CEmuClock::sleepto(const uint64_t& deadline)
+{
+   CEmuClock* c = s_pInstance;
+   if (NULL != c)
+   {
+      c->block(NULL, NULL, deadline);
+      return;
+   }
+
+   uint64_t now = CTimer::getTime();
+   if (deadline <= now)
+      return;
+
+   timespec ts;
+   ts.tv_sec = (deadline - now) / 1000000;
+   ts.tv_nsec = ((deadline - now) % 1000000) * 1000;
+   nanosleep(&ts, NULL);
+}
+
+int CEmuClock::spawn(pthread_t* thread, void* (*start)(void*), void* arg)
+{
+   CEmuClock* c = s_pInstance;
+   if (NULL == c)
+      return pthread_create(thread, NULL, start, arg);
+
+   CStart* s = new CStart;
+   s->m_pStart = start;
+   s->m_pArg = arg;
+
+   // the new thread counts as running from now on, so the clock cannot move
+   // before it gets to run
+   {
+      CGuard clockguard(c->m_Lock);
+      ++ c->m_iRunning;
+   }
+
+   int res = pthread_create(thread, NULL, run, s);
+   if (0 != res)
+   {
+      delete s;
+      CGuard clockguard(c->m_Lock);
+      -- c->m_iRunning;
+      c->advance();
+   }
+
+   return res;
+}
+
+int CEmuClock::join(const pthread_t& thread)
+{
+   CEmuClock* c = s_pInstance;
+   if ((NULL == c) || (NULL == s_pSelf))
+      return pthread_join(thread, NULL);
+
+   // the caller blocks outside the clock until the thread has ended
+   {
+      CGuard clockguard(c->m_Lock);
+      -- c->m_iRunning;
+      c->advance();
+   }
+
+   int res = pthread_join(thread, NULL);
+
+   CGuard clockguard(c->m_Lock);
+   ++ c->m_iRunning;
+
+   return res;
+}
+
+void* CEmuClock::run(void* param)
+{
+   CStart s = *(CStart*)param;
+   delete (CStart*)param;
+
+   s_pInstance->enter(true);
+
+   return s.m_pStart(s.m_pArg);
+}
+
+void CEmuClock::leave(void* waiter)
+{
+   CEmuClock* c = s_pInstance;
+   CWaiter* w = (CWaiter*)waiter;
+
+   {
+      CGuard clockguard(c->m_Lock);
+      -- c->m_iRunning;
+      c->advance();
+   }
+
+   pthread_cond_destroy(&w->m_Cond);
+   delete w;
+}
+
+CEmuClock::CWaiter* CEmuClock::enter(const bool& counted)
+{
+   if (NULL != s_pSelf)
+      return s_pSelf;
+
+   CWaiter* w = new CWaiter;
+   pthread_cond_init(&w->m_Cond, NULL);
+   w->m_pKey = NULL;
+   w->m_ullDeadline = ~0ULL;
+   w->m_bWaiting = false;
+   w->m_bTimedOut = false;
+
+   s_pSelf = w;
+   pthread_setspecific(m_ThreadKey, w);
+
+   if (!counted)
+   {
+      CGuard clockguard(m_Lock);
+      ++ m_iRunning;
+   }
+
+   return w;
+}
+
+int CEmuClock::block(const void* key, pthread_mutex_t* lock, const uint64_t& deadline)
+{
+   CWaiter* w = enter(false);
+
+   pthread_mutex_lock(&m_Lock);
+
+   if (deadline <= now())
+   {
+      pthread_mutex_unlock(&m_Lock);
+      return ETIMEDOUT;
+   }
+
+   w->m_pKey = key;
+   w->m_ullDeadline = deadline;
+   w->m_bWaiting = true;
+   w->m_bTimedOut = false;
+   m_vWaiters.push_back(w);
+   -- m_iRunning;
+
+   // the waiter is registered before the caller's lock is released, so a
+   // signal sent under that lock cannot be missed
+   if (NULL != lock)
+      pthread_mutex_unlock(lock);
+
+   advance();
+
+   while (w->m_bWaiting)
+      pthread_cond_wait(&w->m_Cond, &m_Lock);
+   bool timedout = w->m_bTimedOut;
+
+   pthread_mutex_unlock(&m_Lock);
+
+   if (NULL != lock)
+      pthread_mutex_lock(lock);
+
+   return timedout ? ETIMEDOUT : 0;
+}
+
+void CEmuClock::notify(const void* key, const bool& all)
+{
+   CGuard clockguard(m_Lock);
+
+   for (size_t i = 0; i < m_vWaiters.size(); )
+   {
+      if (m_vWaiters[i]->m_pKey != key)
+      {
+         ++ i;
+         continue;
+      }
+
+      wake(i, false);
+      if (!all)
+         return;
+   }
+}
+
+void CEmuClock::wake(const size_t& i, const bool& timedout)
+{
+   CWaiter* w = m_vWaiters[i];
+   m_vWaiters[i] = m_vWaiters.back();
+   m_vWaiters.pop_back();
+
+   // counted as running at once, so the clock cannot move before the thread runs
+   ++ m_iRunning;
+   w->m_bWaiting = false;
+   w->m_bTimedOut = timedout;
+   pthread_cond_signal(&w->m_Cond);
+}
+
+void CEmuClock::advance()
+{
+   if ((m_iRunning > 0) || m_vWaiters.empty())
+      return;
+
+   uint64_t next = ~0ULL;
+   for (vector<CWaiter*>::iterator i = m_vWaiters.begin(); i != m_vWaiters.end(); ++ i)
+      next = min(next, (*i)->m_ullDeadline);
+
+   // every thread waits for another one without a deadline; nothing can happen any more
+   if (~0ULL == next)
+      return;
+
+   if (next > now())
+      m_ullNow.store(next, std::memory_order_release);
+
+   for (size_t i = 0; i < m_vWaiters.size(); )
+   {
+      if (m_vWaiters[i]->m_ullDeadline <= next)
+         wake(i, true);
+      else
+         ++ i;
+   }
+}
+
+// Holds the lock of the network tables, for reading or for writing, for a scope.
+class CTableGuard
+{
+public:
+   CTableGuard(pthread_rwlock_t& lock, const bool& write): m_Lock(lock)
+   {
+      if (write)
+         pthread_rwlock_wrlock(&m_Lock);
+      else
+         pthread_rwlock_rdlock(&m_Lock);
+   }
+
+   ~CTableGuard() {pthread_rwlock_unlock(&m_Lock);}
+
+private:
+   pthread_rwlock_t& m_Lock;
+};
+
+pthread_mutex_t CEmuNetwork::s_InstanceLock = PTHREAD_MUTEX_INITIALIZER;
+CEmuNetwork* CEmuNetwork::s_pInstance = NULL;
+bool CEmuNetwork::s_bChecked = false;
+
+CEmuNetwork* CEmuNetwork::instance()
+{
+   CGuard instguard(s_InstanceLock);
+
+   if (!s_bChecked)
+   {
+      s_bChecked = true;
+
+      const char* spec = getenv("UDT_EMULATOR");
+      if ((NULL != spec) && ('\0' != *spec))
+         s_pInstance = new CEmuNetwork(CEmuConfig::parse(spec));
+   }
+
+   return s_pInstance;
+}
+
+CEmuNetwork* CEmuNetwork::enable(const CEmuConfig& config)
+{
+   CGuard instguard(s_InstanceLock);
+
+   s_bChecked = true;
+
+   if (NULL == s_pInstance)
+      s_pInstance = new CEmuNetwork(config);
+   else
+   {
+      CTableGuard tableguard(s_pInstance->m_Lock, true);
+      s_pInstance->trace(config.m_strTrace);
+      s_pInstance->m_Default = config;
+   }
+
+   return s_pInstance;
+}
+
+CEmuNetwork::CEmuNetwork(const CEmuConfig& config):
+m_Lock(),
+m_Default(config),
+m_Ports(),
+m_Configs(),
+m_Traces()
+{
+   pthread_rwlockattr_t attr;
+   pthread_rwlockattr_init(&attr);
+   #ifdef LINUX
+      // senders and receivers hold the read lock nearly all the time; let a new
+      // port or route get in between them
+      pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+   #endif
+   pthread_rwlock_init(&m_Lock, &attr);
+   pthread_rwlockattr_destroy(&attr);
+
+   // load the trace now rather than under the lock on the first packet
+   trace(config.m_strTrace);
+}
+
+CEmuNetwork::~CEmuNetwork()
+{
+   for (map<int, CEmuPort*>::iterator i = m_Ports.begin(); i != m_Ports.end(); ++ i)
+   {
+      CEmuPort* ep = i->second;
+      for (vector<CEmuRoute*>::iterator r = ep->m_vRoutes.begin(); r != ep->m_vRoutes.end(); ++ r)
+      {
+         delete (*r)->m_pLink;
+         pthread_mutex_destroy(&(*r)->m_Lock);
+         delete *r;
+      }
+      if (ep->m_piPipe[0] >= 0)
+      {
+         ::close(ep->m_piPipe[0]);
+         ::close(ep->m_piPipe[1]);
+      }
+      pthread_cond_destroy(&ep->m_Cond);
+      pthread_mutex_destroy(&ep->m_Lock);
+      delete ep;
+   }
+
+   for (map<string, CTraceFile*>::iterator t = m_Traces.begin(); t != m_Traces.end(); ++ t)
+      delete t->second;
+
+   pthread_rwlock_destroy(&m_Lock);
+}
+
+void CEmuNetwork::setLink(const int& srcport, const int& dstport, const CEmuConfig& config)
+{
+   CTableGuard tableguard(m_Lock, true);
+
+   trace(config.m_strTrace);
+   m_Configs[make_pair(srcport, dstport)] = config;
+
+   // a link already in use restarts with the new configuration
+   map<int, CEmuPort*>::iterator p = m_Ports.find(dstport);
+   if (p == m_Ports.end())
+      return;
+
+   CEmuRoute* r = route(p->second, srcport);
+   if (NULL != r)
+   {
+      delete r->m_pLink;
+      r->m_pLink = new CEmuLink(config, trace(config.m_strTrace));
+   }
+}
+
+void CEmuNetwork::attach(const int& port)
+{
+   CTableGuard tableguard(m_Lock, true);
+
+   map<int, CEmuPort*>::iterator p = m_Ports.find(port);
+   if (p != m_Ports.end())
+   {
+      p->second->m_bOpen = true;
+      return;
+   }
+
+   CEmuPort* ep = new CEmuPort;
+   pthread_mutex_init(&ep->m_Lock, NULL);
+   pthread_cond_init(&ep->m_Cond, NULL);
+   ep->m_bPending = false;
+   ep->m_bSelecting = false;
+   ep->m_bOpen = true;
+   ep->m_iNext = 0;
+
+   // without the pipe, a receiver on the wall clock notices new packets only
+   // when its select() times out
+   if (0 != pipe(ep->m_piPipe))
+      ep->m_piPipe[0] = ep->m_piPipe[1] = -1;
+   else
+   {
+      fcntl(ep->m_piPipe[0], F_SETFL, fcntl(ep->m_piPipe[0], F_GETFL) | O_NONBLOCK);
+      fcntl(ep->m_piPipe[1], F_SETFL, fcntl(ep->m_piPipe[1], F_GETFL) | O_NONBLOCK);
+   }
+
+   m_Ports[port] = ep;
+}
+
+void CEmuNetwork::detach(const int& port)
+{
+   CTableGuard tableguard(m_Lock, true);
+
+   map<int, CEmuPort*>::iterator p = m_Ports.find(port);
+   if ((p == m_Ports.end()) || !p->second->m_bOpen)
+      return;
+
+   // a receiving thread may still be waiting on the port; wake it and let it find
+   // the port closed, the port itself is kept for the life of the process
+   CEmuPort* ep = p->second;
+   for (vector<CEmuRoute*>::iterator r = ep->m_vRoutes.begin(); r != ep->m_vRoutes.end(); ++ r)
+   {
+      delete (*r)->m_pLink;
+      pthread_mutex_destroy(&(*r)->m_Lock);
+      delete *r;
+   }
+   ep->m_vRoutes.clear();
+   ep->m_bOpen = false;
+   wake(ep);
+}
+
+int CEmuNetwork::send(const int& srcport, const sockaddr* addr, const char* header, const int& hdrsize, const char* data, const int& size)
+{
+   // the port field sits at the same offset in sockaddr_in and sockaddr_in6
+   int dstport = ntohs(((const sockaddr_in*)addr)->sin_port);
+
+   while (true)
+   {
+      {
+         CTableGuard tableguard(m_Lock, false);
+
+         map<int, CEmuPort*>::iterator p = m_Ports.find(dstport);
+         if ((p == m_Ports.end()) || !p->second->m_bOpen)
+            return -1;
+
+         CEmuRoute* r = route(p->second, srcport);
+         if (NULL != r)
+         {
+            char packet[65536];
+            int len = min(hdrsize + size, (int)sizeof(packet));
+            memcpy(packet, header, hdrsize);
+            memcpy(packet + hdrsize, data, len - hdrsize);
+
+            bool queued;
+            {
+               CGuard linkguard(r->m_Lock);
+               queued = r->m_pLink->enqueue(packet, len, CEmuClock::time());
+            }
+            if (queued)
+               wake(p->second);
+
+            // like UDP, a packet dropped on the path still counts as sent
+            return hdrsize + size;
+         }
+      }
+
+      // the first packet from this port: create the route, then look again
+      addRoute(srcport, dstport, addr->sa_family);
+   }
+}
+
+int CEmuNetwork::recv(const int& port, sockaddr* addr, char* header, const int& hdrsize, char* data, const int& size, const uint64_t& timeout, const int& fd)
+{
+   uint64_t deadline = CEmuClock::time() + timeout;
+
+   CEmuPort* ep;
+   {
+      CTableGuard tableguard(m_Lock, false);
+
+      map<int, CEmuPort*>::iterator p = m_Ports.find(port);
+      if (p == m_Ports.end())
+         return -1;
+
+      // ports are never freed, so ep stays valid once the lock is released
+      ep = p->second;
+   }
+
+   char packet[65536];
+
+   while (true)
+   {
+      // cleared before the links are polled, so a packet queued meanwhile is not missed
+      pthread_mutex_lock(&ep->m_Lock);
+      ep->m_bPending = false;
+      pthread_mutex_unlock(&ep->m_Lock);
+
+      uint64_t now = CEmuClock::time();
+      uint64_t next = deadline;
+      int len = -1;
+      int srcport = 0;
+      int family = AF_INET;
+
+      {
+         CTableGuard tableguard(m_Lock, false);
+
+         if (!ep->m_bOpen)
+            return -1;
+
+         for (size_t i = 0, n = ep->m_vRoutes.size(); (len < 0) && (i < n); ++ i)
+         {
+            CEmuRoute* r = ep->m_vRoutes[(ep->m_iNext + i) % n];
+            CGuard linkguard(r->m_Lock);
+
+            len = r->m_pLink->dequeue(packet, sizeof(packet), now);
+            if (len >= 0)
+            {
+               ep->m_iNext = (ep->m_iNext + i + 1) % n;
+               srcport = r->m_iSrcPort;
+               family = r->m_iFamily;
+            }
+            else
+               next = min(next, r->m_pLink->nextArrival(now));
+         }
+      }
+
+      if (len >= 0)
+      {
+         int hlen = min(len, hdrsize);
+         int dlen = min(len - hlen, size);
+         memcpy(header, packet, hlen);
+         memcpy(data, packet + hlen, dlen);
+
+         if (AF_INET == family)
+         {
+            sockaddr_in* a = (sockaddr_in*)addr;
+            memset(a, 0, sizeof(sockaddr_in));
+            a->sin_family = AF_INET;
+            a->sin_port = htons(srcport);
+            a->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+         }
+         else
+         {
+            sockaddr_in6* a = (sockaddr_in6*)addr;
+            memset(a, 0, sizeof(sockaddr_in6));
+            a->sin6_family = AF_INET6;
+            a->sin6_port = htons(srcport);
+            a->sin6_addr = in6addr_loopback;
+         }
+
+         return hlen + dlen;
+      }
+
+      if (now >= deadline)
+         return -1;
+
+      // sleep until the earliest arrival; a new packet on a route, or the socket, wakes us earlier
+      if (wait(ep, max(next, now + 1), fd))
+         return -1;
+   }
+}
+
+bool CEmuNetwork::stats(const int& srcport, const int& dstport, CEmuStats& stats)
+{
+   CTableGuard tableguard(m_Lock, false);
+
+   map<int, CEmuPort*>::iterator p = m_Ports.find(dstport);
+   if (p == m_Ports.end())
+      return false;
+
+   CEmuRoute* r = route(p->second, srcport);
+   if (NULL == r)
+      return false;
+
+   CGuard linkguard(r->m_Lock);
+   stats = r->m_pLink->stats();
+
+   return true;
+}
+
+CEmuNetwork::CEmuRoute* CEmuNetwork::route(CEmuPort* ep, const int& srcport)
+{
+   for (vector<CEmuRoute*>::iterator r = ep->m_vRoutes.begin(); r != ep->m_vRoutes.end(); ++ r)
+      if ((*r)->m_iSrcPort == srcport)
+         return *r;
+
+   return NULL;
+}
+
+void CEmuNetwork::addRoute(const int& srcport, const int& dstport, const int& family)
+{
+   CTableGuard tableguard(m_Lock, true);
+
+   map<int, CEmuPort*>::iterator p = m_Ports.find(dstport);
+   if ((p == m_Ports.end()) || !p->second->m_bOpen || (NULL != route(p->second, srcport)))
+      return;
+
+   map<pair<int, int>, CEmuConfig>::iterator c = m_Configs.find(make_pair(srcport, dstport));
+   const CEmuConfig& config = (c != m_Configs.end()) ? c->second : m_Default;
+
+   CEmuRoute* r = new CEmuRoute;
+   r->m_iSrcPort = srcport;
+   r->m_iFamily = family;
+   pthread_mutex_init(&r->m_Lock, NULL);
+   r->m_pLink = new CEmuLink(config, trace(config.m_strTrace));
+   p->second->m_vRoutes.push_back(r);
+}
+
+void CEmuNetwork::wake(CEmuPort* ep)
+{
+   CGuard portguard(ep->m_Lock);
+
+   // the first packet since the receiver last looked wakes it, the others find it awake
+   if (ep->m_bPending)
+      return;
+   ep->m_bPending = true;
+
+   if (ep->m_bSelecting)
+   {
+      char c = 0;
+      ssize_t res = write(ep->m_piPipe[1], &c, 1);
+      (void)res;
+   }
+   else
+      CEmuClock::signal(&ep->m_Cond);
+}
+
+bool CEmuNetwork::wait(CEmuPort* ep, const uint64_t& until, const int& fd)
+{
+   pthread_mutex_lock(&ep->m_Lock);
+
+   if (ep->m_bPending)
+   {
+      pthread_mutex_unlock(&ep->m_Lock);
+      return false;
+   }
+
+   if (NULL != CEmuClock::instance())
+   {
+      // no real file can be waited on in virtual time; the caller polls the socket afterwards
+      CEmuClock::timedwait(&ep->m_Cond, &ep->m_Lock, until);
+      pthread_mutex_unlock(&ep->m_Lock);
+      return false;
+   }
+
+   ep->m_bSelecting = true;
+   pthread_mutex_unlock(&ep->m_Lock);
+
+   fd_set set;
+   FD_ZERO(&set);
+   int maxfd = -1;
+   if (ep->m_piPipe[0] >= 0)
+   {
+      FD_SET(ep->m_piPipe[0], &set);
+      maxfd = ep->m_piPipe[0];
+   }
+   if (fd >= 0)
+   {
+      FD_SET(fd, &set);
+      maxfd = max(maxfd, fd);
+   }
+
+   uint64_t now = CEmuClock::time();
+   uint64_t wait = (until > now) ? until - now : 0;
+   timeval tv;
+   tv.tv_sec = wait / 1000000;
+   tv.tv_usec = wait % 1000000;
+   int n = select(maxfd + 1, &set, NULL, NULL, &tv);
+
+   // drained under the lock: no sender writes to the pipe once m_bSelecting is off
+   pthread_mutex_lock(&ep->m_Lock);
+   ep->m_bSelecting = false;
+   if ((n > 0) && (ep->m_piPipe[0] >= 0) && FD_ISSET(ep->m_piPipe[0], &set))
+   {
+      char buf[64];
+      while (read(ep->m_piPipe[0], buf, sizeof(buf)) > 0)
+      {
+      }
+   }
+   pthread_mutex_unlock(&ep->m_Lock);
+
+   return (n > 0) && (fd >= 0) && FD_ISSET(fd, &set);
+}
+
+const CTraceFile* CEmuNetwork::trace(const string& file)
+{
+   if (file.empty())
+      return NULL;
+
+   map<string, CTraceFile*>::iterator t = m_Traces.find(file);
+   if (t != m_Traces.end())
+      return t->second;
+
+   CTraceFile* tf = new CTraceFile;
+   if (!tf->open(file))
+   {
+      delete tf;
+      throw CUDTException(4, 0, 0);
+   }
+   m_Traces[file] = tf;
+
+   return tf;
+}
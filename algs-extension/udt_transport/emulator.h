@@ -0,0 +1,411 @@
+#ifndef __UDT_EMULATOR_H__
+#define __UDT_EMULATOR_H__
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "udt.h"
+#include "tracefile.h"
+
+
+// In-process emulation of a cellular path, following the semantics of the
+// mahimahi shells used by mm-tcp: mm-loss drops packets on entry, mm-link
+// serves its queue at the delivery opportunities of a trace, and mm-delay
+// holds every departed packet for a fixed one-way delay.
+//
+// CEmuLink is a pure model: every call takes the current time, so a driver with
+// its own virtual clock can push packets through it as fast as it likes.
+// CEmuNetwork connects the UDT channels of one process through such links, on
+// the wall clock or on the virtual clock of CEmuClock.
+
+struct CEmuConfig
+{
+   enum QueueType {DROPTAIL, RED};
+
+   std::string m_strTrace;              // mahimahi or binary trace file, empty for a link without rate limit
+   int m_iDelay;                        // one-way propagation delay, in milliseconds
+   double m_dLoss;                      // probability that a packet is lost before it enters the queue
+   QueueType m_Queue;                   // queue discipline in front of the link
+   int m_iQueueBytes;                   // droptail limit in bytes, 0 for no limit
+   int m_iQueuePackets;                 // droptail limit in packets, 0 for no limit
+   int m_iRedMinBytes;                  // RED minimum threshold of the average queue size
+   int m_iRedMaxBytes;                  // RED maximum threshold of the average queue size
+   double m_dRedDrop;                   // RED drop probability at the maximum threshold
+   uint32_t m_iSeed;                    // seed of the loss and RED random draws
+
+   CEmuConfig();
+
+      // Functionality:
+      //    Parse a link description such as
+      //    "trace=traces/mit/ATT-LTE-driving.down,delay=20,loss=0.01,queue=red,min_bytes=30000,max_bytes=90000,drop_percentage=10".
+      //    Other keys are "bytes" and "packets" for droptail and "seed".
+      // Parameters:
+      //    0) [in] spec: comma separated key=value list.
+      // Returned value:
+      //    The configuration, unspecified keys keep their defaults.
+
+   static CEmuConfig parse(const std::string& spec);
+};
+
+struct CEmuStats
+{
+   int64_t m_llArrived;                 // packets offered to the link
+   int64_t m_llLost;                    // packets lost on entry
+   int64_t m_llDropped;                 // packets dropped by the queue
+   int64_t m_llDelivered;               // packets taken from the far end
+   int64_t m_llDeliveredBytes;          // bytes taken from the far end
+};
+
+class CEmuLink
+{
+public:
+      // Functionality:
+      //    Create an idle link. Time starts at the first call that passes a clock value.
+      // Parameters:
+      //    0) [in] config: delay, loss and queue of the link.
+      //    1) [in] trace: delivery schedule, NULL for a link without rate limit. Must outlive the link.
+      // Returned value:
+      //    None.
+
+   CEmuLink(const CEmuConfig& config, const CTraceFile* trace);
+
+      // Functionality:
+      //    Offer a packet to the link.
+      // Parameters:
+      //    0) [in] data: packet content.
+      //    1) [in] size: packet size.
+      //    2) [in] now: current time, in microseconds.
+      // Returned value:
+      //    true if the packet was queued, false if it was lost or dropped by the queue.
+
+   bool enqueue(const char* data, const int& size, const uint64_t& now);
+
+      // Functionality:
+      //    Take the next packet that has reached the far end of the link by "now".
+      // Parameters:
+      //    0) [out] data: buffer for the packet, longer packets are truncated.
+      //    1) [in] size: buffer size.
+      //    2) [in] now: current time, in microseconds.
+      // Returned value:
+      //    Size of the packet, or -1 if no packet has arrived.
+
+   int dequeue(char* data, const int& size, const uint64_t& now);
+
+      // Functionality:
+      //    Earliest time at which dequeue() may return a packet.
+      // Parameters:
+      //    0) [in] now: current time, in microseconds.
+      // Returned value:
+      //    Time in microseconds, or ~0ULL if the link is empty.
+
+   uint64_t nextArrival(const uint64_t& now);
+
+   const CEmuStats& stats() const {return m_Stats;}
+
+private:
+   struct CEmuPacket
+   {
+      std::string m_strData;
+      uint64_t m_ullTime;               // arrival time at the far end, for packets in flight
+   };
+
+   void advance(const uint64_t& now);
+   void skipIdle(const uint64_t& now);
+   void startRun(const size_t& run, const uint64_t& ms);
+   uint64_t opportunityTime() const;
+   void nextOpportunity();
+   void deliver(const uint64_t& t);
+   bool admit(const int& size, const uint64_t& now);
+
+private:
+   CEmuConfig m_Config;
+   const CTraceFile* m_pTrace;
+   CEmuStats m_Stats;
+
+   bool m_bStarted;
+   uint64_t m_ullEpoch;                 // time of the first call, the start of the trace
+   uint64_t m_ullCycle;                 // start of the current trace period, relative to the epoch, in microseconds
+   size_t m_iRun;                       // trace run of the next opportunity
+   uint64_t m_ullMs;                    // time of the next opportunity inside the period, in milliseconds
+   uint32_t m_iLeft;                    // opportunities left at that time
+
+   std::deque<CEmuPacket> m_Queue;      // packets waiting for the link
+   int m_iQueueBytes;                   // bytes in m_Queue
+   int m_iHeadLeft;                     // bytes of the head packet not yet carried by the link
+   std::deque<CEmuPacket> m_Flight;     // packets crossing the delay, in arrival order
+
+   double m_dRedAverage;                // RED average queue size, in bytes
+   int m_iRedCount;                     // packets since the last RED drop
+   uint64_t m_ullIdleSince;             // time the queue last became empty
+
+   std::mt19937 m_Random;
+   std::uniform_real_distribution<double> m_Uniform;
+};
+
+// A virtual clock for the threads of a process that runs UDT flows over
+// CEmuNetwork, as tcpsim runs the kernel modules over CEmuLink. Time stands
+// still while any of the threads runs, and once all of them wait it jumps to
+// the earliest deadline among their waits. A flow then runs as fast as its
+// threads can process its packets, and its timers and pacing see the same time
+// as its links.
+//
+// The threads taking part are the one that calls enable(), those started with
+// spawn(), and any other thread from its first wait through this class on. A
+// thread leaves when it ends. Waits go through the static calls below, which
+// are plain pthread calls while the clock is off; a thread that blocks
+// anywhere else, in a system call or a sleep of its own, stops the clock until
+// it returns. Only the Allegro core reads its time (CTimer) from the clock, so
+// it must not be enabled in the Vivace builds.
+
+class CEmuClock
+{
+public:
+      // Functionality:
+      //    Get the virtual clock of this process.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    The clock, or NULL if it is not enabled.
+
+   static CEmuClock* instance() {return s_pInstance;}
+
+      // Functionality:
+      //    Start the virtual clock at the current wall clock time, with the calling
+      //    thread taking part. Must be called before any UDT socket is opened.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    The clock.
+
+   static CEmuClock* enable();
+
+      // Functionality:
+      //    Read the clock.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Virtual time in microseconds, or CTimer::getTime() if the clock is not enabled.
+
+   static uint64_t time();
+
+   uint64_t now() const {return m_ullNow.load(std::memory_order_acquire);}
+
+      // Functionality:
+      //    pthread_cond_wait() and pthread_cond_timedwait() on the clock.
+      // Parameters:
+      //    0) [in] cond: the condition, which signal() and broadcast() wake.
+      //    1) [in] lock: held by the caller, released during the wait.
+      //    2) [in] deadline: time(), in microseconds, at which the wait ends.
+      // Returned value:
+      //    0, or ETIMEDOUT if the deadline has passed.
+
+   static int wait(pthread_cond_t* cond, pthread_mutex_t* lock);
+   static int timedwait(pthread_cond_t* cond, pthread_mutex_t* lock, const uint64_t& deadline);
+
+      // Functionality:
+      //    pthread_cond_signal() and pthread_cond_broadcast() on the clock.
+      // Parameters:
+      //    0) [in] cond: the condition.
+      // Returned value:
+      //    None.
+
+   static void signal(pthread_cond_t* cond);
+   static void broadcast(pthread_cond_t* cond);
+
+      // Functionality:
+      //    Sleep until a time.
+      // Parameters:
+      //    0) [in] deadline: time(), in microseconds.
+      // Returned value:
+      //    None.
+
+   static void sleepto(const uint64_t& deadline);
+
+      // Functionality:
+      //    pthread_create() and pthread_join() for threads taking part in the clock.
+      // Parameters:
+      //    as pthread_create() and pthread_join(), without attributes and result.
+      // Returned value:
+      //    0, or the error number.
+
+   static int spawn(pthread_t* thread, void* (*start)(void*), void* arg);
+   static int join(const pthread_t& thread);
+
+private:
+   CEmuClock();
+   ~CEmuClock();
+
+   struct CWaiter
+   {
+      pthread_cond_t m_Cond;
+      const void* m_pKey;               // condition waited on, NULL for a sleep
+      uint64_t m_ullDeadline;           // ~0ULL for no deadline
+      bool m_bWaiting;
+      bool m_bTimedOut;
+   };
+
+   struct CStart
+   {
+      void* (*m_pStart)(void*);
+      void* m_pArg;
+   };
+
+   static void* run(void* param);
+   static void leave(void* waiter);
+
+   CWaiter* enter(const bool& counted);
+   int block(const void* key, pthread_mutex_t* lock, const uint64_t& deadline);
+   void notify(const void* key, const bool& all);
+   void wake(const size_t& i, const bool& timedout);
+   void advance();
+
+private:
+   static CEmuClock* s_pInstance;
+   static pthread_mutex_t s_InstanceLock;
+   static __thread CWaiter* s_pSelf;    // the calling thread, NULL until it takes part
+
+   pthread_mutex_t m_Lock;
+   pthread_key_t m_ThreadKey;           // calls leave() when a thread taking part ends
+   std::atomic<uint64_t> m_ullNow;      // written under m_Lock
+   int m_iRunning;                      // threads taking part that are not waiting
+   std::vector<CWaiter*> m_vWaiters;
+};
+
+// Routes the packets of CChannel objects in this process through emulated
+// links instead of the kernel. Emulation is turned on by calling enable() before
+// any socket is opened, or by setting UDT_EMULATOR to a link description.
+//
+// A read-write lock guards the tables of ports and routes, and is only taken
+// for writing when a port, a route or a link configuration is added or
+// removed. Each link has a lock of its own and each port a small one for
+// waking its receiver, so flows on different links do not contend.
+
+class CEmuNetwork
+{
+public:
+      // Functionality:
+      //    Get the emulated network of this process.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    The network, or NULL if emulation is not enabled.
+
+   static CEmuNetwork* instance();
+
+      // Functionality:
+      //    Turn emulation on for every channel opened from now on.
+      // Parameters:
+      //    0) [in] config: link used between any two ports without an explicit link.
+      // Returned value:
+      //    The network.
+
+   static CEmuNetwork* enable(const CEmuConfig& config);
+
+      // Functionality:
+      //    Use a specific link for the packets from one port to another, e.g. a
+      //    downlink trace for data and an uplink trace for ACKs.
+      // Parameters:
+      //    0) [in] srcport: sending UDP port.
+      //    1) [in] dstport: receiving UDP port.
+      //    2) [in] config: the link.
+      // Returned value:
+      //    None.
+
+   void setLink(const int& srcport, const int& dstport, const CEmuConfig& config);
+
+      // Functionality:
+      //    Make a port reachable through the emulator, or remove it.
+      // Parameters:
+      //    0) [in] port: local UDP port of the channel.
+      // Returned value:
+      //    None.
+
+   void attach(const int& port);
+   void detach(const int& port);
+
+      // Functionality:
+      //    Send a packet, made of a header and a payload, to an attached port.
+      // Parameters:
+      //    0) [in] srcport: sending UDP port.
+      //    1) [in] addr: destination address.
+      //    2) [in] header, hdrsize: first part of the packet.
+      //    3) [in] data, size: second part of the packet.
+      // Returned value:
+      //    Bytes accepted, or -1 if the destination is not attached and the packet must go to the kernel.
+
+   int send(const int& srcport, const sockaddr* addr, const char* header, const int& hdrsize, const char* data, const int& size);
+
+      // Functionality:
+      //    Wait for a packet addressed to an attached port, or for the port's
+      //    socket to become readable.
+      // Parameters:
+      //    0) [in] port: receiving UDP port.
+      //    1) [out] addr: loopback address of the sending port.
+      //    2) [out] header, hdrsize: buffer for the first part of the packet.
+      //    3) [out] data, size: buffer for the second part of the packet.
+      //    4) [in] timeout: longest wait, in microseconds.
+      //    5) [in] fd: socket of the port, watched on the wall clock only; -1 for none.
+      // Returned value:
+      //    Size of the packet, or -1 if none arrived in time or the socket is readable.
+
+   int recv(const int& port, sockaddr* addr, char* header, const int& hdrsize, char* data, const int& size, const uint64_t& timeout, const int& fd);
+
+      // Functionality:
+      //    Read the statistics of the link from one port to another.
+      // Parameters:
+      //    0) [in] srcport: sending UDP port.
+      //    1) [in] dstport: receiving UDP port.
+      //    2) [out] stats: the counters of the link, taken under its lock.
+      // Returned value:
+      //    true, or false if no packet has used the link yet.
+
+   bool stats(const int& srcport, const int& dstport, CEmuStats& stats);
+
+private:
+   explicit CEmuNetwork(const CEmuConfig& config);
+   ~CEmuNetwork();
+
+   struct CEmuRoute
+   {
+      int m_iSrcPort;
+      int m_iFamily;
+      pthread_mutex_t m_Lock;           // guards the link
+      CEmuLink* m_pLink;
+   };
+
+   struct CEmuPort
+   {
+      pthread_mutex_t m_Lock;           // guards the wakeup fields below
+      pthread_cond_t m_Cond;            // the receiver waits here on the virtual clock
+      int m_piPipe[2];                  // and selects on m_piPipe[0] on the wall clock
+      bool m_bPending;                  // a packet was queued since the receiver last looked
+      bool m_bSelecting;                // the receiver is in select()
+      bool m_bOpen;                     // attached; a detached port is kept for a later attach
+      std::vector<CEmuRoute*> m_vRoutes;   // links that end at this port
+      size_t m_iNext;                      // route to poll first, so busy links do not starve the others
+   };
+
+   CEmuRoute* route(CEmuPort* ep, const int& srcport);
+   void addRoute(const int& srcport, const int& dstport, const int& family);
+   void wake(CEmuPort* ep);
+   bool wait(CEmuPort* ep, const uint64_t& until, const int& fd);
+   const CTraceFile* trace(const std::string& file);
+
+private:
+   static pthread_mutex_t s_InstanceLock;
+   static CEmuNetwork* s_pInstance;
+   static bool s_bChecked;              // UDT_EMULATOR has been read
+
+   pthread_rwlock_t m_Lock;
+   CEmuConfig m_Default;
+   std::map<int, CEmuPort*> m_Ports;
+   std::map<std::pair<int, int>, CEmuConfig> m_Configs;
+   std::map<std::string, CTraceFile*> m_Traces;
+};
+
+
+#endif
@@ -50,6 +50,9 @@ written by
 #include "common.h"
 #include "core.h"
 #include "queue.h"
+#ifndef WIN32
+#include "emulator.h"
+#endif
 #include<iostream>
 
 using namespace std;
@@ -253,6 +256,13 @@ CSndUList::~CSndUList()
 #endif
 }
 
+void CSndUList::init(const CTimer* timer, pthread_mutex_t* windowlock, pthread_cond_t* windowcond)
+{
+	m_pTimer = (CTimer*)timer;
+	m_pWindowLock = windowlock;
+	m_pWindowCond = windowcond;
+}
+
 void CSndUList::insert(const int64_t& ts, const CUDT* u)
 {
 	//struct timeval t0,t1;
@@ -425,7 +435,7 @@ void CSndUList::insert_(const int64_t& ts, const CUDT* u)
 	{
 #ifndef WIN32
 		pthread_mutex_lock(m_pWindowLock);
-		pthread_cond_signal(m_pWindowCond);
+		CEmuClock::signal(m_pWindowCond);
 		//cout<<"wake up!"<<endl;
 		pthread_mutex_unlock(m_pWindowLock);
 #else
@@ -505,10 +515,10 @@ CSndQueue::~CSndQueue()
 
 #ifndef WIN32
 	pthread_mutex_lock(&m_WindowLock);
-	pthread_cond_signal(&m_WindowCond);
+	CEmuClock::signal(&m_WindowCond);
 	pthread_mutex_unlock(&m_WindowLock);
 	if (0 != m_WorkerThread)
-		pthread_join(m_WorkerThread, NULL);
+		CEmuClock::join(m_WorkerThread);
 	pthread_cond_destroy(&m_WindowCond);
 	pthread_mutex_destroy(&m_WindowLock);
 #else
@@ -529,12 +539,10 @@ void CSndQueue::init(const CChannel* c, const CTimer* t)
 	m_pChannel = (CChannel*)c;
 	m_pTimer = (CTimer*)t;
 	m_pSndUList = new CSndUList;
-	m_pSndUList->m_pWindowLock = &m_WindowLock;
-	m_pSndUList->m_pWindowCond = &m_WindowCond;
-	m_pSndUList->m_pTimer = m_pTimer;
+	m_pSndUList->init(m_pTimer, &m_WindowLock, &m_WindowCond);
 
 #ifndef WIN32
-	if (0 != pthread_create(&m_WorkerThread, NULL, CSndQueue::worker, this))
+	if (0 != CEmuClock::spawn(&m_WorkerThread, CSndQueue::worker, this))
 	{
 		m_WorkerThread = 0;
 		throw CUDTException(3, 1);
@@ -582,7 +590,7 @@ DWORD WINAPI CSndQueue::worker(LPVOID param)
 #ifndef WIN32
 			pthread_mutex_lock(&self->m_WindowLock);
 			if (!self->m_bClosing && (self->m_pSndUList->m_iLastEntry < 0))
-				pthread_cond_wait(&self->m_WindowCond, &self->m_WindowLock);
+				CEmuClock::wait(&self->m_WindowCond, &self->m_WindowLock);
 			pthread_mutex_unlock(&self->m_WindowLock);
 #else
 			WaitForSingleObject(self->m_WindowCond, INFINITE);
@@ -942,7 +950,7 @@ CRcvQueue::~CRcvQueue()
 
 #ifndef WIN32
 	if (0 != m_WorkerThread)
-		pthread_join(m_WorkerThread, NULL);
+		CEmuClock::join(m_WorkerThread);
 	pthread_mutex_destroy(&m_PassLock);
 	pthread_cond_destroy(&m_PassCond);
 	pthread_mutex_destroy(&m_LSLock);
@@ -991,7 +999,7 @@ void CRcvQueue::init(const int& qsize, const int& payload, const int& version, c
 	m_pRendezvousQueue = new CRendezvousQueue;
 
 #ifndef WIN32
-	if (0 != pthread_create(&m_WorkerThread, NULL, CRcvQueue::worker, this))
+	if (0 != CEmuClock::spawn(&m_WorkerThread, CRcvQueue::worker, this))
 	{
 		m_WorkerThread = 0;
 		throw CUDTException(3, 1);
@@ -1150,13 +1158,7 @@ int CRcvQueue::recvfrom(const int32_t& id, CPacket& packet)
 	if (i == m_mBuffer.end())
 	{
 #ifndef WIN32
-		uint64_t now = CTimer::getTime();
-		timespec timeout;
-
-		timeout.tv_sec = now / 1000000 + 1;
-		timeout.tv_nsec = (now % 1000000) * 1000;
-
-		pthread_cond_timedwait(&m_PassCond, &m_PassLock, &timeout);
+		CEmuClock::timedwait(&m_PassCond, &m_PassLock, CTimer::getTime() + 1000000);
 #else
 		ReleaseMutex(m_PassLock);
 		WaitForSingleObject(m_PassCond, 1000);
@@ -1275,7 +1277,7 @@ void CRcvQueue::storePkt(const int32_t& id, CPacket* pkt)
 		m_mBuffer[id].push(pkt);
 
 #ifndef WIN32
-pthread_cond_signal(&m_PassCond);
+		CEmuClock::signal(&m_PassCond);
 #else
 	SetEvent(m_PassCond);
 #endif
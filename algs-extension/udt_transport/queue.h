@@ -151,6 +151,17 @@ public:
 
 public:
 
+      // Functionality:
+      //    Connect the list to the sending worker that it wakes up.
+      // Parameters:
+      //    1) [in] timer: timer the worker sleeps on until the next processing time
+      //    2) [in] windowlock: lock of the worker's wait for a non-empty list
+      //    3) [in] windowcond: condition of the worker's wait for a non-empty list
+      // Returned value:
+      //    None.
+
+   void init(const CTimer* timer, pthread_mutex_t* windowlock, pthread_cond_t* windowcond);
+
       // Functionality:
       //    Insert a new UDT instance into the list.
       // Parameters:
@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tracefile.h"
+
+using namespace std;
+
+const char CTraceFile::m_pcMagic[8] = {'M', 'M', 'T', 'R', 'A', 'C', 'E', 'B'};
+
+CTraceFile::CTraceFile():
+m_strError(),
+m_llPeriod(0),
+m_llTotal(0),
+m_iBlockShift(0),
+m_iRuns(0),
+m_pRuns(NULL),
+m_pBase(NULL),
+m_pIndex(NULL),
+m_pMap(NULL),
+m_iMapSize(0),
+m_vRuns(),
+m_vBase(),
+m_vIndex(),
+m_llPendingMs(-1),
+m_iPendingCount(0),
+m_bUnordered(false),
+m_bOverflow(false)
+{
+}
+
+CTraceFile::~CTraceFile()
+{
+   close();
+}
+
+void CTraceFile::close()
+{
+   if (NULL != m_pMap)
+      munmap(m_pMap, m_iMapSize);
+   m_pMap = NULL;
+   m_iMapSize = 0;
+
+   m_vRuns.clear();
+   m_vBase.clear();
+   m_vIndex.clear();
+
+   m_llPeriod = m_llTotal = 0;
+   m_iRuns = 0;
+   m_pRuns = NULL;
+   m_pBase = NULL;
+   m_pIndex = NULL;
+
+   m_llPendingMs = -1;
+   m_iPendingCount = 0;
+   m_bUnordered = false;
+   m_bOverflow = false;
+}
+
+bool CTraceFile::fail(const string& reason) const
+{
+   m_strError = reason;
+   return false;
+}
+
+bool CTraceFile::open(const string& path)
+{
+   close();
+
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+      return fail("cannot open " + path);
+
+   struct stat st;
+   if ((0 != fstat(fd, &st)) || (0 == st.st_size))
+   {
+      ::close(fd);
+      return fail("empty trace " + path);
+   }
+
+   void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if (MAP_FAILED == map)
+      return fail("cannot map " + path);
+
+   size_t size = st.st_size;
+
+   if ((size < sizeof(m_pcMagic)) || (0 != memcmp(map, m_pcMagic, sizeof(m_pcMagic))))
+   {
+      // a mahimahi text trace, parsed once from the mapping
+      bool ok = parseText((const char*)map, size);
+      munmap(map, size);
+      if (!ok)
+         m_strError += " in " + path;
+      return ok;
+   }
+
+   m_pMap = map;
+   m_iMapSize = size;
+
+   if (size < sizeof(CTraceHeader))
+      return fail("truncated trace " + path);
+
+   const CTraceHeader* h = (const CTraceHeader*)map;
+   if (m_iVersion != h->m_iVersion)
+      return fail("unsupported version or byte order in " + path);
+
+   uint64_t blocks = ((h->m_llPeriod + 1) >> h->m_iBlockShift) + 1;
+   if ((h->m_iBlockShift > 31) || (0 == h->m_llPeriod) || (0 == h->m_llRuns) || (blocks != h->m_llBlocks) ||
+       (h->m_llRunOffset + h->m_llRuns * sizeof(CTraceRun) > size) ||
+       (h->m_llBaseOffset + blocks * sizeof(uint32_t) > size) ||
+       (h->m_llIndexOffset + blocks * sizeof(uint32_t) > size) ||
+       (0 != h->m_llRunOffset % 4) || (0 != h->m_llBaseOffset % 4) || (0 != h->m_llIndexOffset % 4))
+      return fail("corrupt trace " + path);
+
+   m_llPeriod = h->m_llPeriod;
+   m_llTotal = h->m_llTotal;
+   m_iBlockShift = h->m_iBlockShift;
+   m_iRuns = h->m_llRuns;
+   m_pRuns = (const CTraceRun*)((const char*)map + h->m_llRunOffset);
+   m_pBase = (const uint32_t*)((const char*)map + h->m_llBaseOffset);
+   m_pIndex = (const uint32_t*)((const char*)map + h->m_llIndexOffset);
+
+   return true;
+}
+
+bool CTraceFile::parseText(const char* text, const size_t& size)
+{
+   const char* p = text;
+   const char* end = text + size;
+
+   while (p < end)
+   {
+      if ((*p == '\n') || (*p == '\r') || (*p == ' ') || (*p == '\t'))
+      {
+         ++ p;
+         continue;
+      }
+
+      if ((*p < '0') || (*p > '9'))
+         return fail("not a trace");
+
+      uint64_t ms = 0;
+      while ((p < end) && (*p >= '0') && (*p <= '9'))
+      {
+         ms = ms * 10 + (*p - '0');
+         if (ms > 0xFFFFFFFFULL)
+            return fail("timestamp out of range");
+         ++ p;
+      }
+
+      add((uint32_t)ms, 1);
+   }
+
+   return finish();
+}
+
+void CTraceFile::add(const uint32_t& ms, const uint32_t& count)
+{
+   if (0 == count)
+      return;
+
+   if (m_llPendingMs == (int64_t)ms)
+   {
+      m_iPendingCount += count;
+      if (m_iPendingCount > 0xFFFF)
+         m_bOverflow = true;
+      return;
+   }
+
+   if (m_llPendingMs > (int64_t)ms)
+   {
+      m_bUnordered = true;
+      return;
+   }
+
+   flush();
+
+   m_llPendingMs = ms;
+   m_iPendingCount = count;
+   if (m_iPendingCount > 0xFFFF)
+      m_bOverflow = true;
+}
+
+void CTraceFile::flush()
+{
+   if (m_llPendingMs < 0)
+      return;
+
+   // extend the last run if the pending millisecond continues it
+   if (!m_vRuns.empty() && (m_vRuns.back().m_iStart + m_vRuns.back().m_iLength == m_llPendingMs) &&
+       (m_vRuns.back().m_iCount == m_iPendingCount) && (m_vRuns.back().m_iLength < 0xFFFF))
+      ++ m_vRuns.back().m_iLength;
+   else
+   {
+      CTraceRun r;
+      r.m_iStart = (uint32_t)m_llPendingMs;
+      r.m_iLength = 1;
+      r.m_iCount = m_iPendingCount;
+      m_vRuns.push_back(r);
+   }
+
+   m_llPendingMs = -1;
+   m_iPendingCount = 0;
+}
+
+bool CTraceFile::finish()
+{
+   if (m_bUnordered)
+      return fail("timestamps out of order");
+   if (m_bOverflow)
+      return fail("more than 65535 opportunities in one millisecond");
+
+   flush();
+
+   if (m_vRuns.empty())
+      return fail("empty trace");
+
+   const CTraceRun& last = m_vRuns.back();
+   m_llPeriod = (uint64_t)last.m_iStart + last.m_iLength - 1;
+   if (0 == m_llPeriod)
+      return fail("trace period is 0");
+
+   m_llTotal = 0;
+   for (vector<CTraceRun>::const_iterator r = m_vRuns.begin(); r != m_vRuns.end(); ++ r)
+      m_llTotal += (uint64_t)r->m_iLength * r->m_iCount;
+
+   if (m_llTotal > 0xFFFFFFFFULL)
+      return fail("more than 2^32 opportunities in one period");
+
+   // blocks from 16 to 256 ms: the shortest whose two index entries cost no
+   // more than an eighth of the runs, so the index adds little to the file and
+   // a lookup scans the few runs of one block
+   m_iBlockShift = 4;
+   while ((m_iBlockShift < 8) && ((((m_llPeriod + 1) >> m_iBlockShift) + 1) * 8 > m_vRuns.size()))
+      ++ m_iBlockShift;
+   uint64_t blocks = ((m_llPeriod + 1) >> m_iBlockShift) + 1;
+
+   m_vBase.assign(blocks, 0);
+   m_vIndex.assign(blocks, 0);
+
+   uint64_t cum = 0;                    // opportunities before run "run"
+   size_t run = 0;
+   for (uint64_t b = 0; b < blocks; ++ b)
+   {
+      uint64_t t = b << m_iBlockShift;
+      while ((run < m_vRuns.size()) && (m_vRuns[run].m_iStart + m_vRuns[run].m_iLength <= t))
+      {
+         cum += (uint64_t)m_vRuns[run].m_iLength * m_vRuns[run].m_iCount;
+         ++ run;
+      }
+
+      m_vIndex[b] = run;
+      m_vBase[b] = cum;
+      // a run that started in an earlier block
+      if ((run < m_vRuns.size()) && (m_vRuns[run].m_iStart < t))
+         m_vBase[b] += (t - m_vRuns[run].m_iStart) * m_vRuns[run].m_iCount;
+   }
+
+   m_iRuns = m_vRuns.size();
+   m_pRuns = &m_vRuns[0];
+   m_pBase = &m_vBase[0];
+   m_pIndex = &m_vIndex[0];
+
+   return true;
+}
+
+bool CTraceFile::save(const string& path) const
+{
+   if (0 == m_iRuns)
+      return fail("no trace to save");
+
+   uint64_t blocks = ((m_llPeriod + 1) >> m_iBlockShift) + 1;
+
+   CTraceHeader h;
+   memset(&h, 0, sizeof(h));
+   memcpy(h.m_pcMagic, m_pcMagic, sizeof(m_pcMagic));
+   h.m_iVersion = m_iVersion;
+   h.m_iBlockShift = m_iBlockShift;
+   h.m_llPeriod = m_llPeriod;
+   h.m_llTotal = m_llTotal;
+   h.m_llRuns = m_iRuns;
+   h.m_llBlocks = blocks;
+
+   // every section is made of 32 bit fields and stays aligned
+   h.m_llRunOffset = sizeof(CTraceHeader);
+   h.m_llBaseOffset = h.m_llRunOffset + m_iRuns * sizeof(CTraceRun);
+   h.m_llIndexOffset = h.m_llBaseOffset + blocks * sizeof(uint32_t);
+
+   FILE* f = fopen(path.c_str(), "wb");
+   if (NULL == f)
+      return fail("cannot create " + path);
+
+   bool ok = (1 == fwrite(&h, sizeof(h), 1, f)) &&
+             (m_iRuns == fwrite(m_pRuns, sizeof(CTraceRun), m_iRuns, f)) &&
+             (blocks == fwrite(m_pBase, sizeof(uint32_t), blocks, f)) &&
+             (blocks == fwrite(m_pIndex, sizeof(uint32_t), blocks, f));
+
+   if (0 != fclose(f))
+      ok = false;
+
+   return ok ? true : fail("cannot write " + path);
+}
+
+bool CTraceFile::saveText(const string& path) const
+{
+   if (0 == m_iRuns)
+      return fail("no trace to save");
+
+   FILE* f = fopen(path.c_str(), "wb");
+   if (NULL == f)
+      return fail("cannot create " + path);
+
+   // format each timestamp once and repeat the line, rather than one printf per opportunity
+   const size_t bufsize = 1 << 16;
+   char buf[bufsize];
+   size_t used = 0;
+   bool ok = true;
+
+   for (size_t i = 0; ok && (i < m_iRuns); ++ i)
+   {
+      const CTraceRun& r = m_pRuns[i];
+      for (uint32_t ms = r.m_iStart; ok && (ms < r.m_iStart + r.m_iLength); ++ ms)
+      {
+         char line[16];
+         int len = 0;
+         char digits[12];
+         int n = 0;
+         uint32_t v = ms;
+         do
+         {
+            digits[n ++] = '0' + v % 10;
+            v /= 10;
+         } while (0 != v);
+         while (n > 0)
+            line[len ++] = digits[-- n];
+         line[len ++] = '\n';
+
+         for (uint32_t c = 0; c < r.m_iCount; ++ c)
+         {
+            if (used + len > bufsize)
+            {
+               ok = (used == fwrite(buf, 1, used, f));
+               used = 0;
+            }
+            memcpy(buf + used, line, len);
+            used += len;
+         }
+      }
+   }
+
+   if (ok && (used > 0))
+      ok = (used == fwrite(buf, 1, used, f));
+
+   if (0 != fclose(f))
+      ok = false;
+
+   return ok ? true : fail("cannot write " + path);
+}
+
+size_t CTraceFile::findRun(const uint64_t& ms) const
+{
+   if (ms > m_llPeriod)
+      return m_iRuns;
+
+   size_t i = m_pIndex[ms >> m_iBlockShift];
+   while ((i < m_iRuns) && (m_pRuns[i].m_iStart + m_pRuns[i].m_iLength <= ms))
+      ++ i;
+
+   return i;
+}
+
+uint64_t CTraceFile::before(const uint64_t& ms) const
+{
+   if (ms > m_llPeriod + 1)
+      return m_llTotal;
+
+   uint64_t b = ms >> m_iBlockShift;
+   uint64_t begin = b << m_iBlockShift;
+   uint64_t n = m_pBase[b];
+   for (size_t i = m_pIndex[b]; (i < m_iRuns) && (m_pRuns[i].m_iStart < ms); ++ i)
+   {
+      const CTraceRun& r = m_pRuns[i];
+      uint64_t from = max<uint64_t>(r.m_iStart, begin);
+      uint64_t to = min<uint64_t>((uint64_t)r.m_iStart + r.m_iLength, ms);
+      n += (to - from) * r.m_iCount;
+   }
+
+   return n;
+}
+
+uint64_t CTraceFile::opportunities(const uint64_t& ms) const
+{
+   if (0 == m_llPeriod)
+      return 0;
+
+   uint64_t k = ms / m_llPeriod;
+   uint64_t r = ms % m_llPeriod;
+   uint64_t n = k * m_llTotal + before(r);
+
+   // the opportunities at the last timestamp of the previous period fall at the
+   // same time as the first timestamp of this one, so they are not "before" it
+   if ((0 == r) && (k > 0))
+      n -= m_llTotal - before(m_llPeriod);
+
+   return n;
+}
+
+uint64_t CTraceFile::capacity(const uint64_t& begin, const uint64_t& end) const
+{
+   if (end <= begin)
+      return 0;
+
+   return (opportunities(end) - opportunities(begin)) * m_iOpportunityBytes;
+}
@@ -0,0 +1,175 @@
+#ifndef __UDT_TRACEFILE_H__
+#define __UDT_TRACEFILE_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+// Cellular link traces in the mahimahi format (one millisecond timestamp per
+// delivery opportunity, one line each) and in a compact binary equivalent that
+// is mapped into memory instead of parsed.
+//
+// The binary file holds, after a fixed header:
+//    runs:  spans of milliseconds that all have the same non-zero number of
+//           opportunities, 8 bytes each; idle milliseconds are not stored
+//    base:  opportunities before the start of each block of 2^shift ms
+//    index: first run that ends inside or after each block
+// so the run at a time, and the number of opportunities before it, are found
+// from the block's entries with a scan of the runs of one block. The blocks are
+// as short as the index allows while it stays an eighth of the runs' size.
+// Fields are in host byte order; the magic rejects files from the other order.
+
+struct CTraceRun
+{
+   uint32_t m_iStart;                   // first millisecond of the run
+   uint16_t m_iLength;                  // number of milliseconds in the run
+   uint16_t m_iCount;                   // opportunities in each of those milliseconds
+};
+
+class CTraceFile
+{
+public:
+   CTraceFile();
+   ~CTraceFile();
+
+      // Functionality:
+      //    Load a trace, mapping it if it is binary and parsing it if it is text.
+      // Parameters:
+      //    0) [in] path: trace file.
+      // Returned value:
+      //    true on success, otherwise false with the reason in error().
+
+   bool open(const std::string& path);
+
+      // Functionality:
+      //    Write the trace in the binary format.
+      // Parameters:
+      //    0) [in] path: output file.
+      // Returned value:
+      //    true on success, otherwise false with the reason in error().
+
+   bool save(const std::string& path) const;
+
+      // Functionality:
+      //    Write the trace in the mahimahi text format.
+      // Parameters:
+      //    0) [in] path: output file.
+      // Returned value:
+      //    true on success, otherwise false with the reason in error().
+
+   bool saveText(const std::string& path) const;
+
+      // Functionality:
+      //    Build a trace in memory: add the opportunities of each millisecond in
+      //    increasing order of time, then call finish().
+      // Parameters:
+      //    0) [in] ms: timestamp, not less than that of the previous call.
+      //    1) [in] count: opportunities at that time.
+      // Returned value:
+      //    None.
+
+   void add(const uint32_t& ms, const uint32_t& count);
+
+      // Functionality:
+      //    Complete a trace built with add().
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    true on success, false if the trace is empty, its last timestamp is 0,
+      //    a millisecond has more than 65535 opportunities or a period more than 2^32.
+
+   bool finish();
+
+   const std::string& error() const {return m_strError;}
+
+   uint64_t period() const {return m_llPeriod;}
+   uint64_t total() const {return m_llTotal;}
+   size_t runCount() const {return m_iRuns;}
+   const CTraceRun& run(const size_t& i) const {return m_pRuns[i];}
+
+      // Functionality:
+      //    Locate the first run that ends after a time of one period.
+      // Parameters:
+      //    0) [in] ms: time inside the period, in milliseconds.
+      // Returned value:
+      //    Run index, runCount() if no opportunity is left in the period.
+
+   size_t findRun(const uint64_t& ms) const;
+
+      // Functionality:
+      //    Count the opportunities before a time, with the trace repeating every period as in mahimahi.
+      // Parameters:
+      //    0) [in] ms: time since the start of the trace, in milliseconds.
+      // Returned value:
+      //    Number of opportunities at times less than "ms".
+
+   uint64_t opportunities(const uint64_t& ms) const;
+
+      // Functionality:
+      //    Bytes the link can carry in a window of time.
+      // Parameters:
+      //    0) [in] begin: start of the window, in milliseconds, inclusive.
+      //    1) [in] end: end of the window, in milliseconds, exclusive.
+      // Returned value:
+      //    Capacity in bytes.
+
+   uint64_t capacity(const uint64_t& begin, const uint64_t& end) const;
+
+public:
+   static const int m_iOpportunityBytes = 1504;   // bytes per delivery opportunity, as in mahimahi
+
+private:
+   void close();
+   void flush();
+   bool parseText(const char* text, const size_t& size);
+   bool fail(const std::string& reason) const;
+   uint64_t before(const uint64_t& ms) const;    // opportunities before "ms" inside one period
+
+private:
+   struct CTraceHeader
+   {
+      char m_pcMagic[8];
+      uint32_t m_iVersion;
+      uint32_t m_iBlockShift;
+      uint64_t m_llPeriod;
+      uint64_t m_llTotal;
+      uint64_t m_llRuns;
+      uint64_t m_llBlocks;
+      uint64_t m_llRunOffset;
+      uint64_t m_llBaseOffset;
+      uint64_t m_llIndexOffset;
+   };
+
+   static const char m_pcMagic[8];
+   static const uint32_t m_iVersion = 2;
+
+   mutable std::string m_strError;
+
+   uint64_t m_llPeriod;                 // last timestamp, the trace repeats with this period
+   uint64_t m_llTotal;                  // opportunities in one period
+   uint32_t m_iBlockShift;              // log2 of the block length in milliseconds
+   size_t m_iRuns;
+   const CTraceRun* m_pRuns;
+   const uint32_t* m_pBase;             // per block
+   const uint32_t* m_pIndex;            // per block
+
+   void* m_pMap;                        // mapped binary file, or NULL
+   size_t m_iMapSize;
+
+   std::vector<CTraceRun> m_vRuns;      // storage of a trace that is not mapped
+   std::vector<uint32_t> m_vBase;
+   std::vector<uint32_t> m_vIndex;
+
+   int64_t m_llPendingMs;               // millisecond being accumulated by add(), -1 for none
+   uint32_t m_iPendingCount;
+   bool m_bUnordered;                   // add() was called with a decreasing time
+   bool m_bOverflow;                    // a millisecond has more opportunities than a run can hold
+
+private:
+   CTraceFile(const CTraceFile&);
+   CTraceFile& operator=(const CTraceFile&);
+};
+
+
+#endif
@@ -25,6 +25,7 @@
 #include <linux/module.h>
 #include <net/tcp.h>
 #include <linux/random.h>
+#include "pcc_math.h"
 
 /* The number of past monitor intervals used for decision making.
  *
@@ -235,22 +236,6 @@ static void start_interval(struct sock *sk, struct pcc_data *pcc)
  * **********************/
 #define PCC_LOSS_MARGIN 5
 #define PCC_MAX_LOSS 10
-/* get x = number * PCC_SCALE, return (e^number)*PCC_SCALE */
-static u32 pcc_exp(s32 x)
-{
-	s64 temp = PCC_SCALE;
-	s64 e = PCC_SCALE;
-	int i;
-
-	for (i = 1; temp != 0; i++) {
-		temp *= x;
-		temp /= i;
-		temp /= PCC_SCALE;
-		e += temp;
-	}
-	return e;
-}
-
 /* Calculate the graident of utility w.r.t. sending rate, but only if the rates
  * are far enough apart for the measurment to have low noise.
  */
@@ -279,7 +264,7 @@ static void pcc_calc_utility_vivace(struct pcc_data *pcc, struct pcc_interval *i
 	if (recv_dur > 0)
 		throughput = (USEC_PER_SEC * delivered * mss) / recv_dur;
 	if (delivered == 0) {
-        printk(KERN_INFO "No packets delivered\n");
+        pcc_dbg("No packets delivered\n");
 		//interval->utility = S64_MIN;
 		interval->utility = 0;
 		return;
@@ -291,7 +276,7 @@ static void pcc_calc_utility_vivace(struct pcc_data *pcc, struct pcc_interval *i
 	if (send_dur > 0)
 		lat_infl = (PCC_SCALE * rtt_diff) / send_dur;
 	
-	printk(KERN_INFO
+	pcc_dbg(
 		"%d ucalc: lat (%lld->%lld) lat_infl %lld\n",
 		 pcc->id, interval->start_rtt / USEC_PER_MSEC, interval->end_rtt / USEC_PER_MSEC,
 		 lat_infl);
@@ -313,7 +298,7 @@ static void pcc_calc_utility_vivace(struct pcc_data *pcc, struct pcc_interval *i
 
 	util = /* int_sqrt((u64)rate)*/ rate - (rate * (900 * lat_infl + 11 * loss_ratio)) / PCC_SCALE;
 
-	printk(KERN_INFO
+	pcc_dbg(
 		"%d ucalc: rate %lld sent %u delv %lld lost %lld lat (%lld->%lld) util %lld rate %lld thpt %lld\n",
 		 pcc->id, rate, interval->packets_ended - interval->packets_sent_base,
 		 delivered, lost, interval->start_rtt / USEC_PER_MSEC, interval->end_rtt / USEC_PER_MSEC, util, rate, throughput);
@@ -344,7 +329,7 @@ static void pcc_calc_utility_allegro(struct pcc_data *pcc, struct pcc_interval *
 	 */
 	util = loss_ratio- (PCC_LOSS_MARGIN * PCC_SCALE);
 	if (util < PCC_MAX_LOSS*PCC_SCALE)
-		util = (throughput /* rate */ * PCC_SCALE) / (pcc_exp(util) + PCC_SCALE);
+		util = pcc_sigmoid(throughput /* rate */, util);
 	else
 		util = 0;
 
@@ -354,7 +339,7 @@ static void pcc_calc_utility_allegro(struct pcc_data *pcc, struct pcc_interval *
 	/* util -= "wasted rate" */
 	util -= (rate * loss_ratio) / (PCC_ALPHA * PCC_SCALE);
 
-	printk(KERN_INFO
+	pcc_dbg(
 		"rate %lld sent %u delv %lld lost %lld util %lld\n",
 		 rate, interval->packets_ended - interval->packets_sent_base,
 		 delivered, lost, util);
@@ -410,13 +395,13 @@ static void pcc_decide(struct pcc_data *pcc, struct sock *sk)
 	new_rate = pcc_decide_rate(pcc);
 
 	if (new_rate != pcc->rate) {
-		printk(KERN_INFO "%d decide: on new rate %d %d (%d)\n",
+		pcc_dbg("%d decide: on new rate %d %d (%d)\n",
 			   pcc->id, pcc->rate < new_rate, new_rate,
 			   pcc->decisions_count);
 		pcc->moving = true;
 	    pcc_setup_intervals_moving(pcc);
 	} else {
-		printk(KERN_INFO "%d decide: stay %d (%d)\n", pcc->id,
+		pcc_dbg("%d decide: stay %d (%d)\n", pcc->id,
 			pcc->rate, pcc->decisions_count);
 	    pcc_setup_intervals_probing(pcc);
 	}
@@ -457,7 +442,7 @@ static s64 pcc_apply_change_bound(struct pcc_data *pcc, s64 step) {
 
 	if (change_ratio > pcc->change_bound) {
 		step = (pcc->rate * pcc->change_bound) / PCC_SCALE;
-		printk("bound %u rate %u step %lld\n", pcc->change_bound, pcc->rate, step);
+		pcc_dbg("bound %u rate %u step %lld\n", pcc->change_bound, pcc->rate, step);
 		pcc->change_bound += PCC_CHANGE_BOUND_STEP;
 	} else {
 		pcc->change_bound = PCC_MIN_CHANGE_BOUND;
@@ -476,7 +461,7 @@ static u32 pcc_decide_rate_moving(struct sock *sk, struct pcc_data *pcc)
 	(*pcc->util_func)(pcc, interval, sk);
 	utility = interval->utility;
 	
-	printk(KERN_INFO "%d mv: pr %u pu %lld nr %u nu %lld\n",
+	pcc_dbg("%d mv: pr %u pu %lld nr %u nu %lld\n",
 		   pcc->id, pcc->last_rate, prev_utility, pcc->rate, utility);
 
 	grad = pcc_calc_util_grad(pcc->rate, utility, pcc->last_rate, prev_utility);
@@ -498,7 +483,7 @@ static u32 pcc_decide_rate_moving(struct sock *sk, struct pcc_data *pcc)
 	else if (step < 0 && step > -1 * min_step)
 		step = -1 * min_step;
 
-	printk(KERN_INFO "%d mv: grad %lld step %lld amp %d min_step %lld\n",
+	pcc_dbg("%d mv: grad %lld step %lld amp %d min_step %lld\n",
 		   pcc->id, grad, step, pcc->amplifier, min_step);
 
 	return pcc->rate + step;
@@ -514,7 +499,7 @@ static void pcc_decide_moving(struct sock *sk, struct pcc_data *pcc)
         tcp_sk(sk)->mss_cache) / pcc_get_rtt(tcp_sk(sk));
     new_rate = max(new_rate, packet_min_rate);
 	pcc->last_rate = pcc->rate;
-	printk(KERN_INFO "%d moving: new rate %lld (%d) old rate %d\n",
+	pcc_dbg("%d moving: new rate %lld (%d) old rate %d\n",
 		   pcc->id, new_rate,
 		   pcc->decisions_count, pcc->last_rate);
 	pcc->rate = new_rate;
@@ -558,7 +543,7 @@ static void pcc_decide_slow_start(struct sock *sk, struct pcc_data *pcc)
 	prev_adjust_utility = prev_utility * (prev_utility > 0 ? 750 : 1000) /
 				pcc->last_rate;
 
-	printk(KERN_INFO "%d: start mode: r %lld u %lld pr %lld pu %lld\n",
+	pcc_dbg("%d: start mode: r %lld u %lld pr %lld pu %lld\n",
 		pcc->id, pcc->rate, utility, pcc->last_rate, prev_utility);
 	//if (adjust_utility > prev_adjust_utility) {
 	if (utility > prev_utility) {
@@ -581,7 +566,7 @@ static void pcc_decide_slow_start(struct sock *sk, struct pcc_data *pcc)
 		pcc->last_rate = pcc->rate;
 		pcc->rate = tmp_rate;
 		pcc->start_mode = false;
-		printk(KERN_INFO "%d: start mode ended\n", pcc->id);
+		pcc_dbg("%d: start mode ended\n", pcc->id);
 		
 		// njay -> nogah: I've commented out the setup for the 4-RTT decision
 		// process and just directly used the "moving" stage. We may not really
@@ -792,14 +777,14 @@ static void pcc_set_state(struct sock *sk, u8 new_state)
 		spare -= tcp_sk(sk)->data_segs_out;
 		spare -= pcc->spare;
 		pcc->spare+= spare;
-		printk(KERN_INFO "%d loss ended: spare %d\n", pcc->id, spare);
+		pcc_dbg("%d loss ended: spare %d\n", pcc->id, spare);
 
 		pcc->loss_state = false;
 		pcc_setup_intervals_probing(pcc);
 		start_interval(sk, pcc);
 	}
 	else if (!pcc->loss_state && new_state	== 4) {
-		printk(KERN_INFO "%d loss: started\n", pcc->id);
+		pcc_dbg("%d loss: started\n", pcc->id);
 		pcc->loss_state = true;
 		pcc->wait = true;
 		start_interval(sk, pcc);
@@ -845,7 +830,7 @@ static struct tcp_congestion_ops tcp_pcc_cong_ops __read_mostly = {
 static int __init pcc_register(void)
 {
 	BUILD_BUG_ON(sizeof(struct pcc_data) > ICSK_CA_PRIV_SIZE);
-	printk(KERN_INFO "pcc init reg\n");
+	pcc_dbg("pcc init reg\n");
 	return tcp_register_congestion_control(&tcp_pcc_cong_ops);
 }
 
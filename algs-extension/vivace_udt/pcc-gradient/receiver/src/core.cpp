@@ -2445,29 +2445,32 @@ int CUDT::processData(CUnit* unit)
    ++ m_llTraceRecv;
    ++ m_llRecvTotal;
    counter_32767++;
+   // Echo only the sender's monitor tag. Bits 29 - 31 are the message flags,
+   // which this side reads from the data packet and does not send back.
+   int32_t tag = packet.m_iMsgNo & CMsgNo::m_iMaxMsgNo;
 #ifdef INCAST
    if (counter_32767 == 1) {
-      tsn_payload[counter_32767-1] = packet.m_iMsgNo;
+      tsn_payload[counter_32767-1] = tag;
       sendCtrl(32767, NULL, tsn_payload, 1*4);
       counter_32767 = 0;
    } else {
-      tsn_payload[counter_32767-1] = packet.m_iMsgNo;
+      tsn_payload[counter_32767-1] = tag;
    }
 #elif LATENCY
    if (counter_32767 == 1) {
-      tsn_payload[counter_32767-1] = packet.m_iMsgNo;
+      tsn_payload[counter_32767-1] = tag;
       sendCtrl(32767, NULL, tsn_payload, 1*4);
       counter_32767 = 0;
    } else {
-      tsn_payload[counter_32767-1] = packet.m_iMsgNo;
+      tsn_payload[counter_32767-1] = tag;
    }
 #else
    if (counter_32767 == 1) {
-      tsn_payload[counter_32767-1] = packet.m_iMsgNo;
+      tsn_payload[counter_32767-1] = tag;
       sendCtrl(32767, NULL, tsn_payload, 1*4);
       counter_32767 = 0;
    } else {
-      tsn_payload[counter_32767-1] = packet.m_iMsgNo;
+      tsn_payload[counter_32767-1] = tag;
    }
 #endif
    int32_t offset = CSeqNo::seqoff(m_iRcvLastAck, packet.m_iSeqNo);
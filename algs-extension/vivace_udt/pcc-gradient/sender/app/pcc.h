@@ -15,8 +15,12 @@
 #include <mutex>
 #include <thread>
 #include <stdlib.h>
+#include "utility.h"
 #define DEBUG
 #define MAX_MONITOR 500
+#ifndef PCC_UTILITY
+#define PCC_UTILITY VivaceLatencyUtility
+#endif
 using namespace std;
 
 bool kInTimeout = false;
@@ -78,7 +82,8 @@ class PCC : public CCC {
         alpha_(kAlpha), beta_(kBeta), exponent_(kExponent),
         factor_(kFactor), step_(kStep), rate_(0.8),
         utility_sum_(0), measurement_intervals_(0),
-        last_utility_(-100000) {
+        last_utility_(-100000),
+        utility_engine_(kAlpha, kExponent, kLatencyCoefficient) {
         amplifier = 0;
         boundary_amplifier = 0;
 	sum_total = 0;
@@ -1078,89 +1083,15 @@ class PCC : public CCC {
 
     virtual long double utility(double total, double loss,
                                 double time, double rtt, double latency_info) {
-        static long double last_measurement_interval = 1;
-
-        long double norm_measurement_interval = last_measurement_interval;
-
-        if (!kInTimeout) {
-            norm_measurement_interval = time / rtt;
-            last_measurement_interval = norm_measurement_interval;
-        }
-        long double loss_rate = (long double)((double) loss/(double) total);
-	sum_total += total;
+        double loss_rate = loss / total;
+        sum_total += total;
         sum_loss += loss;
-        //if(loss_rate > 0) {
-        //   loss_rate = ceil(loss_rate * 100)/100.0;
-        //}
-        //if(loss_rate > 0.05) {
-        //   loss_rate = ceil(loss_rate * 100 +1)/2*2/100.0;
-        //}
-
         avg_loss =  loss_rate * 0.2 + avg_loss *0.8;
 
-
-        // convert to milliseconds
-        double rtt_penalty = (rtt - get_min_rtt(rtt))/time;
-        //rtt_penalty = (pow(rtt_penalty+1, 2) -1) * rtt/0.03;
-        //cout<<"RTT penalty is"<<rtt_penalty<<endl;
-        rtt_penalty = int(int(latency_info * 100) / 100.0 * 100) / 2  * 2/ 100.0;
-        if(rtt_penalty < -0.2) {
-            //cout<<"rtt penalty"<<rtt_penalty<<endl;
-            //rtt_penalty = -0.2;
-        }
-        //rtt_penalty = int(latency_info * 100) / 100.0;
-        //cerr<<"new rtt penalty is "<<rtt_penalty<<endl;
-        //if (rtt_penalty > 2) rtt_penalty  = 2;
-        //if (rtt_penalty < -2) rtt_penalty  = -2;
-        exponent_ = 1;
-        //if(rtt_penalty<1) {
-        //    rtt_penalty=1;
-        //}
-
-        //long double loss_contribution = total * (long double) (alpha_* (pow((1+((long double)((double) loss/(double) total))), exponent_)-1));
-        long double loss_contribution = total* (11.35 * (pow((1+loss_rate),
-                                                exponent_)-1));
-        
-
-        if(loss_rate <= 0.03)
-            loss_contribution = total* (1* (pow((1+loss_rate), exponent_)-1));
-
-        //    //loss_contribution = 0;
-        //else if (loss_rate<=0.01)
-        //    loss_contribution = 0;
-
-        //if(avg_loss > 0.05) {
-        //   loss_control_amplifier += 0.1;
-        //   if(loss_control_amplifier > 4) {
-        //       loss_control_amplifier = 4;
-        //   }
-        //}else {
-        //   loss_control_amplifier = 1;
-        //}
-
-
-        //cout<<"avg_loss is "<<avg_loss<<endl;
-        //cout<<"loss rate"<<loss_rate<<endl;
-        //long double loss_contribution = total* (11.35 * (pow((1+loss_rate), exponent_)-1));
-        //long double loss_contribution = total* (kBeta * (1/(1-loss_rate)-1));
-        //long double rtt_contribution = 1 * total*(pow(rtt_penalty,1) -1);
-        //long double rtt_contribution = 1 * total*(pow(latency_info,2) -1);
-        //long double rtt_contribution = 1 * total*(pow(latency_info,1));
-        long double rtt_contribution =  kLatencyCoefficient * 11330 * total*(pow(
-                                            rtt_penalty,1));
-        long double rtt_factor = rtt;
-        //TODO We should also consider adding just rtt into the utility function, because it is not just change that matters
-        // This may turn out to be extremely helpful during LTE environment
-        //long double utility = ((long double)total - loss_contribution - rtt_contribution)/norm_measurement_interval/rtt;
-        //long double utility = (((long double)total - loss_contribution) - rtt_contribution)/time/norm_measurement_interval;
-        double normalized_rtt = rtt / 0.04;
-        //long double utility = (((long double)total - loss_contribution) - rtt_contribution)*m_iMSS/1024/1024*8/time/latency_info;
-        long double utility = kAlpha * pow((long double)(total)
-                                           *m_iMSS/1024/1024*8/time,
-                                           kExponent) - (1*loss_contribution + rtt_contribution)*m_iMSS/1024/1024*8/time;
+        double utility = utility_engine_(total, loss, time, rtt, latency_info,
+                                         m_iMSS, kInTimeout);
 #ifdef DEBUG
-        cerr<<"total "<<
-            total<<"loss contri"<<loss_contribution<<"rtt contr"<<rtt_contribution<<"time "<<time<<"norm measurement"<<norm_measurement_interval<<endl;
+        cerr<<"total "<<total<<"loss "<<loss<<"time "<<time<<"norm measurement"<<utility_engine_.measurement_interval()<<endl;
         cerr<<"rtt is "<<rtt<<"loss rate is "<<loss_rate<<"avg loss rate is "<<avg_loss<<endl;
         cerr<<"latency info is "<<latency_info<<endl;
 #endif
@@ -1207,6 +1138,7 @@ class PCC : public CCC {
     double swing_buffer;
     int loss_ignore_count;
     int last_stop_monitor;
+    PccUtility<PCC_UTILITY> utility_engine_;
 };
 
 #endif
@@ -0,0 +1,156 @@
+#ifndef __PCC_UTILITY_H__
+#define __PCC_UTILITY_H__
+
+#include <cmath>
+
+// Utility functions for the PCC congestion controller. Each shape maps the
+// statistics of one monitor to a utility value, in Mbps units:
+//    rate: sending rate achieved over the monitor, in Mbps
+//    loss_rate: fraction of the monitor's packets that were lost
+//    latency_info: slope of RTT against send time over the monitor
+// The shape is picked at compile time through PccUtility<Shape>; PCC uses
+// PCC_UTILITY, which can be overridden with -DPCC_UTILITY=AllegroUtility etc.
+
+// x^exponent for an exponent fixed when the table is built. The mantissa f of
+// x = f * 2^k, in [0.5, 1), is interpolated linearly in a table of f^exponent
+// and 2^(k * exponent) comes from a second table, so a call costs a frexp()
+// and a few multiplies instead of a pow(), a third of its time. The relative
+// error is 2e-7 for the default exponent 0.9 and below 4e-6 for exponents
+// between 0 and 2; x outside the tables falls back to pow().
+class PccPowTable {
+  public:
+    explicit PccPowTable(double exponent = 1) {
+        reset(exponent);
+    }
+
+    void reset(double exponent) {
+        exponent_ = exponent;
+        for (int i = 0; i <= kMantissaSteps; ++i) {
+            mantissa_[i] = pow(0.5 + 0.5 * i / kMantissaSteps, exponent);
+        }
+        for (int k = kMinExp; k <= kMaxExp; ++k) {
+            scale_[k - kMinExp] = pow(2.0, k * exponent);
+        }
+    }
+
+    double operator()(double x) const {
+        int k;
+        double f = frexp(x, &k);
+        if (!(x > 0) || k < kMinExp || k > kMaxExp) {
+            return pow(x, exponent_);
+        }
+        double pos = (f - 0.5) * (2 * kMantissaSteps);
+        int i = int(pos);
+        double lo = mantissa_[i];
+        return (lo + (mantissa_[i + 1] - lo) * (pos - i)) * scale_[k - kMinExp];
+    }
+
+  private:
+    static const int kMantissaSteps = 256;
+    static const int kMinExp = -64;
+    static const int kMaxExp = 64;
+
+    double exponent_;
+    double mantissa_[kMantissaSteps + 1];
+    double scale_[kMaxExp - kMinExp + 1];
+};
+
+struct PccUtilityParams {
+    double alpha;                   // weight of the throughput term
+    double exponent;                // exponent of the throughput term
+    double latency_coefficient;     // weight of the latency gradient term
+    PccPowTable power;              // x^exponent
+};
+
+// Allegro: throughput discounted by a sigmoid once loss passes 5%, minus the
+// lost rate.
+struct AllegroUtility {
+    static double evaluate(const PccUtilityParams&, double rate, double loss_rate,
+                           double) {
+        double sigmoid = 1.0 / (1.0 + exp(kSigmoidAlpha * (loss_rate - kLossTolerance)));
+        return rate * (1 - loss_rate) * sigmoid - rate * loss_rate;
+    }
+
+    static constexpr double kSigmoidAlpha = 100;
+    static constexpr double kLossTolerance = 0.05;
+};
+
+// Vivace with loss only: concave throughput reward minus a linear loss
+// penalty that becomes steeper above 3% loss.
+struct VivaceLossUtility {
+    static double evaluate(const PccUtilityParams& p, double rate, double loss_rate,
+                           double) {
+        return reward(p, rate) - rate * loss_penalty(loss_rate);
+    }
+
+    static double reward(const PccUtilityParams& p, double rate) {
+        // exact closed forms for the common exponents, the table otherwise
+        if (p.exponent == 1)
+            return p.alpha * rate;
+        if (p.exponent == 0.5)
+            return p.alpha * sqrt(rate);
+        return p.alpha * p.power(rate);
+    }
+
+    static double loss_penalty(double loss_rate) {
+        return (loss_rate <= kLossThreshold ? 1 : kLossCoefficient) * loss_rate;
+    }
+
+    static constexpr double kLossThreshold = 0.03;
+    static constexpr double kLossCoefficient = 11.35;
+};
+
+// Vivace with latency: the loss utility minus a penalty on the RTT gradient,
+// which is truncated to even hundredths so measurement noise does not move
+// the rate.
+struct VivaceLatencyUtility {
+    static double evaluate(const PccUtilityParams& p, double rate, double loss_rate,
+                           double latency_info) {
+        double gradient = int(int(latency_info * 100) / 100.0 * 100) / 2 * 2 / 100.0;
+        return VivaceLossUtility::reward(p, rate)
+               - rate * (VivaceLossUtility::loss_penalty(loss_rate)
+                         + p.latency_coefficient * kLatencyCoefficient * gradient);
+    }
+
+    static constexpr double kLatencyCoefficient = 11330;
+};
+
+// Per-connection utility engine. Holds the parameters it was created with and
+// the state carried between monitors, so flows in one process do not share it.
+template <class Shape>
+class PccUtility {
+  public:
+    PccUtility(double alpha, double exponent, double latency_coefficient)
+        : last_measurement_interval_(1) {
+        params_.alpha = alpha;
+        params_.exponent = exponent;
+        params_.power.reset(exponent);
+        params_.latency_coefficient = latency_coefficient;
+    }
+
+    // total and loss are packet counts, time and rtt are in seconds.
+    double operator()(double total, double loss, double time, double rtt,
+                      double latency_info, int mss, bool in_timeout) {
+        // a monitor that ended by timeout has no meaningful length in RTTs
+        if (!in_timeout) {
+            last_measurement_interval_ = time / rtt;
+        }
+        double rate = total * mss * 8 / (1024 * 1024) / time;
+        return Shape::evaluate(params_, rate, loss / total, latency_info);
+    }
+
+    // Length in RTTs of the last monitor that did not time out.
+    double measurement_interval() const {
+        return last_measurement_interval_;
+    }
+
+    const PccUtilityParams& params() const {
+        return params_;
+    }
+
+  private:
+    PccUtilityParams params_;
+    double last_measurement_interval_;
+};
+
+#endif
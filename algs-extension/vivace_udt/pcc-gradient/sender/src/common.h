@@ -298,6 +298,34 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Vivace monitor tag. The sender overwrites the message number of each data
+// packet with the index of the monitor it belongs to (bits 20 - 28) and the
+// packet's position inside that monitor (bits 0 - 19), keeping the boundary and
+// order flags in bits 29 - 31, which travel to the receiver as before. The
+// receiver echoes bits 0 - 28 in its 0x7FFF feedback without looking into them,
+// and the decoders below mask the flags off, so only the sender reads the tag.
+
+class CMonitorTag
+{
+public:
+   inline static int32_t pack(int32_t msgno, int monitor, int32_t seq)
+   {return (msgno & m_iFlagMask) | (monitor << m_iSeqBits) | (seq & (m_iMaxSeq - 1));}
+
+   inline static int monitor(const int32_t& tag)
+   {return (tag >> m_iSeqBits) & (m_iMaxMonitor - 1);}
+
+   inline static int32_t seq(const int32_t& tag)
+   {return tag & (m_iMaxSeq - 1);}
+
+public:
+   static const int m_iSeqBits = 20;                    // bits for the position inside a monitor
+   static const int32_t m_iMaxSeq = 1 << 20;            // packets one monitor can tag
+   static const int m_iMaxMonitor = 1 << 9;             // monitor indices the tag can carry
+   static const int32_t m_iFlagMask = (int32_t)0xE0000000;      // message boundary and order flags
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct CIPAddress
 {
    static bool ipcmp(const sockaddr* addr1, const sockaddr* addr2, const int& ver = AF_INET);
@@ -78,6 +78,8 @@ const int32_t CSeqNo::m_iMaxSeqNo = 0x7FFFFFFF;
 const int32_t CAckNo::m_iMaxAckSeqNo = 0x7FFFFFFF;
 const int32_t CMsgNo::m_iMsgNoTH = 0xFFFFFFF;
 const int32_t CMsgNo::m_iMaxMsgNo = 0x1FFFFFFF;
+static_assert(MAX_MONITOR <= CMonitorTag::m_iMaxMonitor, "monitor index does not fit in the monitor tag");
+static_assert((((CMonitorTag::m_iMaxMonitor - 1) << CMonitorTag::m_iSeqBits) | (CMonitorTag::m_iMaxSeq - 1)) == ~CMonitorTag::m_iFlagMask, "monitor tag must decode without the message flag bits");
 
 const int CUDT::m_iVersion = 4;
 const int CUDT::m_iSYNInterval = 1000000;
@@ -140,7 +142,10 @@ CUDT::CUDT()
 	m_ullLingerExpiration = 0;
 	start_ = time(NULL);
 	remove( "/home/yossi/timeout_times.txt" );
-	for (int i = 0; i < MAX_MONITOR; i++) state[i] = 0;
+	for (int i = 0; i < MAX_MONITOR; i++) {
+		state[i] = 0;
+		m_pMonitor[i] = NULL;
+	}
 }
 
 CUDT::CUDT(const CUDT& ancestor)
@@ -196,7 +201,10 @@ CUDT::CUDT(const CUDT& ancestor)
 	m_ullLingerExpiration = 0;
 	start_ = time(NULL);
 	remove( "/home/yossi/timeout_times.txt" );
-	for (int i = 0; i < MAX_MONITOR; i++) state[i] = 0;
+	for (int i = 0; i < MAX_MONITOR; i++) {
+		state[i] = 0;
+		m_pMonitor[i] = NULL;
+	}
 }
 
 CUDT::~CUDT()
@@ -217,6 +225,8 @@ CUDT::~CUDT()
 	delete m_pPeerAddr;
 	delete m_pSNode;
 	delete m_pRNode;
+	for (int i = 0; i < MAX_MONITOR; i++)
+		m_MonitorPool.release(m_pMonitor[i]);
 }
 
 void CUDT::setOpt(UDTOpt optName, const void* optval, const int&)
@@ -536,6 +546,7 @@ void CUDT::open()
 	last_rtt_ = 10 * m_iSYNInterval;
 	//for (int i = 0; i < MAX_MONITOR; i++) m_last_rtt[i] = 5 * m_iSYNInterval;
 	m_monitor_count = 0;
+	m_llMonitorSerial = 0;
 	m_iRTTVar = m_iRTT >> 1;
 	m_ullCPUFrequency = CTimer::getCPUFrequency();
 
@@ -2398,21 +2409,30 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
 		int32_t current_time;
 		int32_t* tsn_payload = (int32_t *)(ctrlpkt.m_pcData);
 		int last_position = (int)(ctrlpkt.getLength() / 4)-1;
-		int Mon = tsn_payload[last_position]>>16;
-		rtt_count[Mon]++;
-		rtt_value[Mon]+= int(CTimer::getTime() - m_StartTime) - send_timestamp[Mon][tsn_payload[last_position]&0xFFFF];
-		rtt_trace[Mon][tsn_payload[last_position]&0xFFFF] = int(CTimer::getTime() - m_StartTime) - send_timestamp[Mon][tsn_payload[last_position]&0xFFFF];
+		int Mon = CMonitorTag::monitor(tsn_payload[last_position]);
+
+		// one lock for the whole feedback packet
+		lock_guard<mutex> lck(monitor_mutex_);
+		{
+			CMonitorRecord* r = m_pMonitor[Mon];
+			int seq = CMonitorTag::seq(tsn_payload[last_position]);
+			if ((NULL != r) && (seq < r->m_iLength) && r->m_pbSent[seq] && !r->m_pbSampled[seq]) {
+				uint64_t rtt = int(CTimer::getTime() - m_StartTime) - r->m_pullSendTime[seq];
+				rtt_count[Mon]++;
+				rtt_value[Mon]+= rtt;
+				r->addRTTSample(seq, rtt);
+			}
+		}
 		if(latency_time_start[Mon] == 0){
 			latency_time_start[Mon]=ctrlpkt.m_iTimeStamp;
-			latency_seq_start[Mon] = tsn_payload[last_position] & 0xFFFF;
+			latency_seq_start[Mon] = CMonitorTag::seq(tsn_payload[last_position]);
 		} else{
 			latency_time_end[Mon] = ctrlpkt.m_iTimeStamp;
-			latency_seq_end[Mon] = tsn_payload[last_position] & 0xFFFF;
+			latency_seq_end[Mon] = CMonitorTag::seq(tsn_payload[last_position]);
 		}
 		for (int i = 0, n = (int)(ctrlpkt.getLength() / 4); i < n; ++ i) {
-	        lock_guard<mutex> lck(monitor_mutex_);
-			monitorNo = tsn_payload[i] >> 16;
-			SeqNoInMonitor = tsn_payload[i] & 0xFFFF;
+			monitorNo = CMonitorTag::monitor(tsn_payload[i]);
+			SeqNoInMonitor = CMonitorTag::seq(tsn_payload[i]);
                 //cout<<"mon is "<<monitorNo<<" "<<SeqNoInMonitor<<endl;
 			++ m_iRecvNAKTotal;
 			//cout<<monitorNo<<' '<<SeqNoInMonitor<<' '<<current_monitor<<' '<<left_monitor<<endl;
@@ -2422,58 +2442,46 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
                 latest_received_seq[monitorNo] = SeqNoInMonitor;
             }
 			//cout<<monitorNo<<' '<<SeqNoInMonitor<<endl;
-			recv_ack[monitorNo][SeqNoInMonitor] = true;
+			CMonitorRecord* r = m_pMonitor[monitorNo];
+			if ((NULL != r) && (SeqNoInMonitor < r->m_iLength) && !r->m_pbAcked[SeqNoInMonitor]) {
+				r->m_pbAcked[SeqNoInMonitor] = true;
+				++ r->m_iAcked;
+			}
 			current_time = CTimer::getTime();
-            bool includeThisMonitor = false;
-            if (SeqNoInMonitor == total[monitorNo] -1) {
-                //cout<<"include this mon"<<endl;
-                includeThisMonitor = true;
-            }
-			//pkt_sending[monitorNo][SeqNoInMonitor] = ctrlpkt.m_iTimeStamp;
-			//cout<<pkt_sending[monitorNo][SeqNoInMonitor]<<endl;
-
-			if (left_monitor) {
 
-				// find out the monitor which didn't end
-
-				int tmp;
-                if(includeThisMonitor) {
-                    tmp = monitorNo;
-                } else {
-                    tmp = (monitorNo+MAX_MONITOR-1)%MAX_MONITOR;
-                }
-				int count=0;
-				//.....................
-				while (tmp!=current_monitor) {
-					if (state[tmp]==2) {
-						//cerr<<"TEST "<<current_monitor<<" "<<state[tmp]<<endl;
-						for(int i=0;i<total[tmp];i++){
-							if(recv_ack[tmp][i]){
-								//latency[tmp]+=pkt_sending[tmp][i];
-								count++;
-							}
-						}
-						if(count>0)
-							latency[tmp]/=count;
-						//cout<<latency[tmp]<<' '<<(total[tmp]-left[tmp])<<' '<<count<<endl;
-						state[tmp] = 3;
-						lost[tmp]=total[tmp]-left[tmp];
-						end_time[tmp] = current_time;
-						left_monitor--;
-						//cerr<<"Killed monitor"<<left[tmp]<<endl;
-						//cerr<<"latency info"<<" "<<double(latency_time_end[tmp]-latency_time_start[tmp])/left[tmp]/m_pCC->m_dPktSndPeriod<<endl;
-						//cerr<<"latency info"<<" "<<double(latency_time_end[tmp]-latency_time_start[tmp])/(end_transmission_time[tmp]-start_time[tmp]);
+			// A report for a monitor ends every older waiting monitor, and the
+			// monitor itself once its last packet is reported. A monitor whose
+			// record is gone has already ended together with everything older.
+			if ((NULL == r) || m_WaitingMonitors.empty())
+				continue;
+			int64_t ready = r->m_llSerial;
+			if (SeqNoInMonitor != total[monitorNo] -1)
+				-- ready;
+
+			while (!m_WaitingMonitors.empty() && (m_pMonitor[m_WaitingMonitors.front()]->m_llSerial <= ready)) {
+				int tmp = m_WaitingMonitors.front();
+				m_WaitingMonitors.pop_front();
+					if(m_pMonitor[tmp]->m_iAcked>0)
+						latency[tmp]/=m_pMonitor[tmp]->m_iAcked;
+					//cout<<latency[tmp]<<' '<<(total[tmp]-left[tmp])<<' '<<count<<endl;
+					state[tmp] = 3;
+					lost[tmp]=total[tmp]-left[tmp];
+					end_time[tmp] = current_time;
+					left_monitor--;
+					//cerr<<"Killed monitor"<<left[tmp]<<endl;
+					//cerr<<"latency info"<<" "<<double(latency_time_end[tmp]-latency_time_start[tmp])/left[tmp]/m_pCC->m_dPktSndPeriod<<endl;
+					//cerr<<"latency info"<<" "<<double(latency_time_end[tmp]-latency_time_start[tmp])/(end_transmission_time[tmp]-start_time[tmp]);
 //						cerr<<"latency info"<<" "<<latency_time_end[tmp]<<" "<<latency_time_start[tmp]<<" "<<m_pCC->m_dPktSndPeriod<<" "<<latency_seq_end[tmp]<<" "<<latency_seq_start[tmp]<<endl;
-						if(rtt_count[Mon]==0){
+					if(rtt_count[Mon]==0){
                                                   //cout<<"zero "<<Mon<<endl;
-							rtt_value[Mon]=0;
-							rtt_count[Mon]=1;
+						rtt_value[Mon]=0;
+						rtt_count[Mon]=1;
                         }
                                                 //c<<"before on monitor ends"<<Mon<<" "<<rtt_value[Mon]<<" "<<rtt_count[Mon]<<endl;
                                                 //cout<<"before on monitor "<<tmp<< "ends loss is"<<total[tmp] - left[tmp]<<endl;
                         double latency_info1 = double(latency_time_end[tmp]*1000-(start_time[tmp]-1471107640000000+m_iRTT/2))/(end_transmission_time[tmp]-start_time[tmp]);
                                                 m_iRTT = rtt_value[Mon]/double(rtt_count[Mon]);
-						last_rtt_ = m_iRTT;
+					last_rtt_ = m_iRTT;
 	                                        m_pCC->setRTT(m_iRTT);
                         double latency_info2 = double(latency_time_end[tmp]*1000-(start_time[tmp]-1471107400000000+m_iRTT/2))/(end_transmission_time[tmp]-start_time[tmp]);
 
@@ -2489,42 +2497,19 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
                         //cout<<latency_time_end[tmp] - latency_time_start[tmp]<<" "<<end_transmission_time[tmp]-start_time[tmp]<<endl;
                         //cout<<latency_time_end[tmp]*1000<<" "<<start_time[tmp] -1470892000000000<<endl;
 
-						m_last_rtt.push_front(last_rtt_);
-						if (m_last_rtt.size() > kRTTHistorySize) {
-							m_last_rtt.pop_back();
-						}
-vector<double> x, y;
-
-for(int i=0; i< total[tmp]; i++) {
-    if(rtt_trace[tmp][i] != 0) {
-        x.push_back(send_timestamp[tmp][i]);
-        y.push_back(rtt_trace[tmp][i]);
-    }
-}
-    double n = x.size();
-
-    double avgX = accumulate(x.begin(), x.end(), 0.0) / n;
-    double avgY = accumulate(y.begin(), y.end(), 0.0) / n;
-
-    double numerator = 0.0;
-    double denominator = 0.0;
-
-    for(int i=0; i<n; ++i){
-        numerator += (x[i] - avgX) * (y[i] - avgY);
-        denominator += (x[i] - avgX) * (x[i] - avgX);
-    }
-
-    latency_info = numerator / denominator;
-						//m_last_rtt[Mon % MAX_MONITOR] = rtt_value[Mon]/((double) rtt_count[Mon]);
+					m_last_rtt.push_front(last_rtt_);
+					if (m_last_rtt.size() > kRTTHistorySize) {
+						m_last_rtt.pop_back();
+					}
+					// slope of RTT against send time, kept as samples arrive
+					latency_info = m_pMonitor[tmp]->latencyGradient();
+					release_monitor(tmp);
+					//m_last_rtt[Mon % MAX_MONITOR] = rtt_value[Mon]/((double) rtt_count[Mon]);
                                                 //cout<<"Fill in rtt value as"<<m_last_rtt[Mon % MAX_MONITOR]<<endl;
                                                 //cerr<<"Monitor"<<tmp<<"ends at"<<CTimer::getTime()<<endl;
 
-						m_pCC->onMonitorEnds(total[tmp],total[tmp]-left[tmp],(end_transmission_time[tmp]-start_time[tmp])/1000000,current_monitor,tmp, rtt_value[Mon]/double(rtt_count[Mon]), latency_info);
-						m_ullInterval = (uint64_t)(m_pCC->m_dPktSndPeriod * m_ullCPUFrequency);
-						if (!left_monitor) break;
-					}
-					tmp = (tmp+MAX_MONITOR-1)%MAX_MONITOR;
-				}
+					m_pCC->onMonitorEnds(total[tmp],total[tmp]-left[tmp],(end_transmission_time[tmp]-start_time[tmp])/1000000,current_monitor,tmp, rtt_value[Mon]/double(rtt_count[Mon]), latency_info);
+					m_ullInterval = (uint64_t)(m_pCC->m_dPktSndPeriod * m_ullCPUFrequency);
 			}
 		}
 
@@ -2584,7 +2569,7 @@ int CUDT::packData(CPacket& packet, uint64_t& ts)
 		//gettimeofday(&end,NULL);
 		//cerr<<end.tv_usec-begin.tv_usec<<endl;
 		//  cout<<packet.m_iMsgNo<<endl;
-		packet.m_iMsgNo=m_iMonitorCurrSeqNo | (current_monitor<<16);
+		packet.m_iMsgNo = CMonitorTag::pack(packet.m_iMsgNo, current_monitor, m_iMonitorCurrSeqNo);
 
 		m_iMonitorCurrSeqNo++;
 		if (-1 == payload)
@@ -2619,9 +2604,7 @@ int CUDT::packData(CPacket& packet, uint64_t& ts)
 			}
 			if (monitor_ttl==0){
 				//cerr<<"this monitor has ended"<<current_monitor<<" "<<left[current_monitor]<<endl;
-				end_transmission_time[current_monitor] = CTimer::getTime();
-				state[current_monitor] = 2;
-				left_monitor++;
+				wait_monitor();
 				start_monitor(100000);
 			}
 		}
@@ -2646,7 +2629,7 @@ int CUDT::packData(CPacket& packet, uint64_t& ts)
                 start_monitor(100000);}
 				m_iSndCurrSeqNo = CSeqNo::incseq(m_iSndCurrSeqNo);
 				m_pCC->setSndCurrSeqNo((int32_t&)m_iSndCurrSeqNo);
-				packet.m_iMsgNo=m_iMonitorCurrSeqNo | (current_monitor<<16);
+				packet.m_iMsgNo = CMonitorTag::pack(packet.m_iMsgNo, current_monitor, m_iMonitorCurrSeqNo);
                                 //cout<<m_iSndCurrSeqNo<<endl;
 				m_iMonitorCurrSeqNo++;
 				packet.m_iSeqNo = m_iSndCurrSeqNo;
@@ -2671,9 +2654,7 @@ int CUDT::packData(CPacket& packet, uint64_t& ts)
 					}
 					if (monitor_ttl==0){
 						//cerr<<"this monitor has ended"<<current_monitor<<" "<<left[current_monitor]<<endl;
-						end_transmission_time[current_monitor] = CTimer::getTime();
-						state[current_monitor] = 2;
-						left_monitor++;
+						wait_monitor();
 						start_monitor(100000);
 					}
 				}
@@ -2761,7 +2742,15 @@ m_pSndLossList->insert(const_cast<int32_t&>(m_iSndLastAck), const_cast<int32_t&>
 	}
 
 	packet.m_iTimeStamp = int(CTimer::getTime() - m_StartTime);
-    send_timestamp[packet.m_iMsgNo>>16][packet.m_iMsgNo & 0xFFFF] = packet.m_iTimeStamp;
+	{
+		lock_guard<mutex> lck(monitor_mutex_);
+		CMonitorRecord* r = m_pMonitor[CMonitorTag::monitor(packet.m_iMsgNo)];
+		int32_t seq = CMonitorTag::seq(packet.m_iMsgNo);
+		if ((NULL != r) && (seq < r->m_iLength)) {
+			r->m_pullSendTime[seq] = packet.m_iTimeStamp;
+			r->m_pbSent[seq] = true;
+		}
+	}
 	packet.m_iID = m_PeerID;
 	packet.setLength(payload);
 	m_pCC->onPktSent(&packet);
@@ -3132,7 +3121,8 @@ void CUDT::start_monitor(int length)
 	//int count = 0;
 
 	//ygi: hack here!
-    int suggested_length = 100000;
+    // the longest monitor the tag can number; the controller may ask for less
+    int suggested_length = CMonitorTag::m_iMaxSeq;
     int mss = m_iMSS;
     double amplifier = 0;
 	m_pCC->onMonitorStart(current_monitor, suggested_length, mss, amplifier);
@@ -3169,8 +3159,8 @@ void CUDT::start_monitor(int length)
             //cout<<"super short length because of short sent period? send period is "<< send_period<<endl;
             length=10;
         }
-        if (length > 3000) {
-           length = 3000;
+        if (length > CMonitorTag::m_iMaxSeq) {
+           length = CMonitorTag::m_iMaxSeq;
         }
        // length += (amplifier * 10);
         //if(length < 100) {
@@ -3206,12 +3196,15 @@ void CUDT::start_monitor(int length)
 
 
 
-	for (int i=0;i<length;++i)
-    {
-        recv_ack[current_monitor][i] = false;
-        send_timestamp[current_monitor][i] = 0;
-        rtt_trace[current_monitor][i] = 0;
-    }
+	// a slot still holding a record belongs to a monitor that never ended,
+	// which is the oldest one if it is still waiting for feedback
+	if (!m_WaitingMonitors.empty() && (m_WaitingMonitors.front() == current_monitor)) {
+		m_WaitingMonitors.pop_front();
+		left_monitor--;
+	}
+	m_MonitorPool.release(m_pMonitor[current_monitor]);
+	m_pMonitor[current_monitor] = m_MonitorPool.acquire(length);
+	m_pMonitor[current_monitor]->m_llSerial = ++ m_llMonitorSerial;
 	lost[current_monitor] = 0;
         latency_time_start[current_monitor] = 0;
         latency_time_end[current_monitor] = 0;
@@ -3225,102 +3218,76 @@ void CUDT::start_monitor(int length)
 	monitor = true;
 }
 
-void CUDT::init_state() {
-	current_monitor = 0;
+void CUDT::reset_monitors() {
+	// Only the monitor being sent and those waiting for feedback hold state;
+	// every other slot is ended already and start_monitor() sets it up again
+	// before reusing it.
+	if (state[current_monitor] == 1)
+		clear_monitor(current_monitor);
+	for (deque<int>::iterator i = m_WaitingMonitors.begin(); i != m_WaitingMonitors.end(); ++ i)
+		clear_monitor(*i);
+	m_WaitingMonitors.clear();
 	loss_record1.clear();
 	loss_record2.clear();
-	for (unsigned int mon_index = 0; mon_index < MAX_MONITOR; mon_index++) {
-		state[mon_index] = 3;
-		total[mon_index] = 0;
-		lost[mon_index] = 0;
-		retransmission[mon_index] = 0;
-		new_transmission[mon_index] = 0;
-		latency[mon_index] = 0;
-		latency_seq_end[mon_index] = 0;
-		latency_time_start[mon_index] = 0;
-		latency_time_end[mon_index] = 0;
-		time_interval[mon_index] = 0;
-        latest_received_seq[mon_index] = -1;
-		rtt_count[mon_index] = 0;
-		rtt_value[mon_index] = 0;
-		deadlines[mon_index] = 0;
-		allocated_times_[mon_index] = 0;
-	}
 	monitor = true;
 	left_monitor = 0;
 	m_monitor_count = 0;
-	m_iRTT = 10 * m_iSYNInterval;
-	//return;
-	for (unsigned int i = 0; i < 5; i++) {
-		m_last_rtt[i] = 5 * m_iSYNInterval;
-	}
-	cout << "initialized " << 5 << " in the m_last_rtt to be "<< 5 * m_iSYNInterval << endl;
-
-
-	//if (m_pSndLossList) delete m_pSndLossList;
-	//m_pSndLossList = new CSndLossList(m_iFlowWindowSize * 2);
-
-	//if (m_pRcvLossList) delete m_pRcvLossList;
-	//m_pRcvLossList = new CRcvLossList(m_iFlightFlagSize);
+}
 
+void CUDT::clear_monitor(int mon_index) {
+	state[mon_index] = 3;
+	release_monitor(mon_index);
+	total[mon_index] = 0;
+	lost[mon_index] = 0;
+	retransmission[mon_index] = 0;
+	new_transmission[mon_index] = 0;
+	latency[mon_index] = 0;
+	latency_seq_end[mon_index] = 0;
+	latency_time_start[mon_index] = 0;
+	latency_time_end[mon_index] = 0;
+	time_interval[mon_index] = 0;
+	latest_received_seq[mon_index] = -1;
+	rtt_count[mon_index] = 0;
+	rtt_value[mon_index] = 0;
+	deadlines[mon_index] = 0;
+	allocated_times_[mon_index] = 0;
 }
 
 bool CUDT::timeout_monitors() {
-        return false;
 	lock_guard<mutex> lck(monitor_mutex_);
+	if ((state[current_monitor] != 1) && m_WaitingMonitors.empty())
+		return false;
+
 	uint64_t current_time = CTimer::getTime();
-	int tmp = (current_monitor + 1) % MAX_MONITOR;
-	while (tmp != current_monitor) {
+	// waiting monitors oldest first, then the one being sent
+	for (int k = 0; k <= (int)m_WaitingMonitors.size(); ++ k) {
+		bool waiting = (k < (int)m_WaitingMonitors.size());
+		int tmp = waiting ? m_WaitingMonitors[k] : current_monitor;
 		if ((state[tmp]==1) || (state[tmp]==2)) {
             //if(start_time[tmp] + (latest_received_seq[tmp]+1) * time_interval[tmp] + allocated_times_[tmp] < current_time){
 			if((deadlines[tmp] < current_time) && (allocated_times_[tmp] > 0)) {
-				int count=0;
 				//cout<<"killing "<<tmp<<" at "<<current_time<<endl;
-				cout << "waited more than " << allocated_times_[tmp] <<endl;
 				m_monitor_count = 0;
-				for(int i=0;i<total[tmp];i++){
-					if(recv_ack[tmp][i]){
-						count++;
-					}
+				if(m_pMonitor[tmp]->m_iAcked>0) latency[tmp] /= m_pMonitor[tmp]->m_iAcked;
+				if (waiting) {
+					m_WaitingMonitors.erase(m_WaitingMonitors.begin() + k);
+					-- k;
+					left_monitor--;
 				}
-				if(count>0) latency[tmp] /= count;
 				state[tmp] = 3;
+				release_monitor(tmp);
 				lost[tmp]=total[tmp]-left[tmp];
 				end_time[tmp] = current_time;
-				left_monitor--;
 				bool isContinue = m_pCC->onTimeout(total[tmp],total[tmp]-left[tmp],(end_transmission_time[tmp]-start_time[tmp])/1000000,current_monitor,tmp, allocated_times_[tmp]/1000);
                 if(isContinue) {
                     continue;
                 }
 				m_iRTT = allocated_times_[tmp];
-	            loss_record1.clear();
-	            loss_record2.clear();
-	            for (unsigned int mon_index = 0; mon_index < MAX_MONITOR; mon_index++) {
-	            	state[mon_index] = 3;
-	            	total[mon_index] = 0;
-	            	lost[mon_index] = 0;
-	            	retransmission[mon_index] = 0;
-	            	new_transmission[mon_index] = 0;
-	            	latency[mon_index] = 0;
-	            	latency_seq_end[mon_index] = 0;
-	            	latency_time_start[mon_index] = 0;
-	            	latency_time_end[mon_index] = 0;
-	            	time_interval[mon_index] = 0;
-                    latest_received_seq[mon_index] = -1;
-	            	rtt_count[mon_index] = 0;
-	            	rtt_value[mon_index] = 0;
-	            	deadlines[mon_index] = 0;
-	            	allocated_times_[mon_index] = 0;
-					m_last_rtt.clear();
-	            }
-
-	            monitor = true;
-	            left_monitor = 0;
-	            m_monitor_count = 0;
+				m_last_rtt.clear();
+				reset_monitors();
                 return true;
 			}
 		}
-    tmp = (tmp + 1) % MAX_MONITOR;
 	}
     return false;
 }
@@ -3339,3 +3306,19 @@ void CUDT::save_timeout_time() {
 double CUDT::estimate_rtt_for_timedout_monitors(int monitor) {
 	return allocated_times_[monitor];
 }
+
+void CUDT::wait_monitor() {
+	lock_guard<mutex> lck(monitor_mutex_);
+	end_transmission_time[current_monitor] = CTimer::getTime();
+	// a monitor that timed out while still sending has already been reported
+	if (NULL == m_pMonitor[current_monitor])
+		return;
+	state[current_monitor] = 2;
+	left_monitor++;
+	m_WaitingMonitors.push_back(current_monitor);
+}
+
+void CUDT::release_monitor(int monitor) {
+	m_MonitorPool.release(m_pMonitor[monitor]);
+	m_pMonitor[monitor] = NULL;
+}
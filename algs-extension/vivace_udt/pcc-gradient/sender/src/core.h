@@ -55,6 +55,7 @@ written by
 #include "ccc.h"
 #include "cache.h"
 #include "queue.h"
+#include "monitor.h"
 #include <vector>
 #include <deque>
 #include <mutex>
@@ -302,7 +303,6 @@ private: // monitor
    double start_time[MAX_MONITOR], end_time[MAX_MONITOR], end_transmission_time[MAX_MONITOR];
    // for state, 1=sending, 2= waiting, 3=finished
    int lost[MAX_MONITOR], retransmission[MAX_MONITOR], total[MAX_MONITOR], new_transmission[MAX_MONITOR], left[MAX_MONITOR], state[MAX_MONITOR], left_monitor;//, end_pkt[MAX_MONITOR];
-   int32_t pkt_sending[MAX_MONITOR][8000];
    int32_t latency[MAX_MONITOR];
    vector<int32_t> loss_record1, loss_record2;
    vector<int32_t>::iterator itr_loss_record1, itr_loss_record2;
@@ -310,11 +310,12 @@ private: // monitor
    int32_t latency_time_start[MAX_MONITOR], latency_time_end[MAX_MONITOR];
    int32_t time_interval[MAX_MONITOR];
    int lossptr;
-   bool recv_ack[MAX_MONITOR][30000];
    int64_t latest_received_seq[MAX_MONITOR];
    uint64_t packet_space[MAX_MONITOR];
-   uint64_t send_timestamp[MAX_MONITOR][30000];
-   uint64_t rtt_trace[MAX_MONITOR][30000];
+   CMonitorRecord* m_pMonitor[MAX_MONITOR];     // per-packet state, NULL unless the monitor is in flight
+   CMonitorPool m_MonitorPool;                  // recycled per-packet state records
+   deque<int> m_WaitingMonitors;                // monitors done sending and waiting for feedback, oldest first
+   int64_t m_llMonitorSerial;                   // number of monitors started on this connection
    int rtt_count[MAX_MONITOR];
    uint64_t rtt_value[MAX_MONITOR];
    bool monitor;
@@ -457,6 +458,10 @@ private: // Generation and processing of packets
    void add_to_loss_record(int32_t loss1, int32_t loss2);
    bool timeout_monitors();
    double estimate_rtt_for_timedout_monitors(int monitor);
+   void wait_monitor();
+   void reset_monitors();
+   void clear_monitor(int monitor);
+   void release_monitor(int monitor);
    uint64_t deadlines[MAX_MONITOR];
    uint64_t allocated_times_[MAX_MONITOR];
 
@@ -520,7 +525,6 @@ private: // for UDP multiplexer
    CSNode* m_pSNode;				// node information for UDT list used in snd queue
    CRNode* m_pRNode;                            // node information for UDT list used in rcv queue
 
-   void init_state();
    void save_timeout_time();
    time_t start_;
 
@@ -0,0 +1,131 @@
+#include <cstring>
+#include "monitor.h"
+
+CMonitorRecord::CMonitorRecord():
+m_iLength(0),
+m_iAcked(0),
+m_llSerial(0),
+m_pbAcked(NULL),
+m_pbSent(NULL),
+m_pbSampled(NULL),
+m_pullSendTime(NULL),
+m_iRTTSamples(0),
+m_ullFirstSendTime(0),
+m_dSumX(0),
+m_dSumY(0),
+m_dSumXX(0),
+m_dSumXY(0),
+m_iCapacity(0),
+m_pNext(NULL)
+{
+}
+
+CMonitorRecord::~CMonitorRecord()
+{
+   delete [] m_pbAcked;
+   delete [] m_pbSent;
+   delete [] m_pbSampled;
+   delete [] m_pullSendTime;
+}
+
+void CMonitorRecord::addRTTSample(const int& seq, const uint64_t& rtt)
+{
+   // a duplicate report of the same packet would weigh it twice in the fit
+   if ((0 == rtt) || m_pbSampled[seq])
+      return;
+   m_pbSampled[seq] = true;
+
+   uint64_t sendtime = m_pullSendTime[seq];
+   if (0 == m_iRTTSamples)
+      m_ullFirstSendTime = sendtime;
+
+   double x = double(sendtime) - double(m_ullFirstSendTime);
+   double y = double(rtt);
+
+   ++ m_iRTTSamples;
+   m_dSumX += x;
+   m_dSumY += y;
+   m_dSumXX += x * x;
+   m_dSumXY += x * y;
+}
+
+double CMonitorRecord::latencyGradient() const
+{
+   double n = m_iRTTSamples;
+   return (n * m_dSumXY - m_dSumX * m_dSumY) / (n * m_dSumXX - m_dSumX * m_dSumX);
+}
+
+CMonitorPool::CMonitorPool(const int& maxfree):
+m_pFree(NULL),
+m_iFree(0),
+m_iMaxFree(maxfree)
+{
+}
+
+CMonitorPool::~CMonitorPool()
+{
+   while (NULL != m_pFree)
+   {
+      CMonitorRecord* r = m_pFree;
+      m_pFree = r->m_pNext;
+      delete r;
+   }
+}
+
+CMonitorRecord* CMonitorPool::acquire(const int& length)
+{
+   CMonitorRecord* r;
+   if (NULL != m_pFree)
+   {
+      r = m_pFree;
+      m_pFree = r->m_pNext;
+      -- m_iFree;
+   }
+   else
+      r = new CMonitorRecord;
+
+   if (r->m_iCapacity < length)
+   {
+      delete [] r->m_pbAcked;
+      delete [] r->m_pbSent;
+      delete [] r->m_pbSampled;
+      delete [] r->m_pullSendTime;
+
+      r->m_pbAcked = new bool[length];
+      r->m_pbSent = new bool[length];
+      r->m_pbSampled = new bool[length];
+      r->m_pullSendTime = new uint64_t[length];
+      r->m_iCapacity = length;
+   }
+
+   r->m_iLength = length;
+   r->m_iAcked = 0;
+   r->m_llSerial = 0;
+   r->m_iRTTSamples = 0;
+   r->m_ullFirstSendTime = 0;
+   r->m_dSumX = r->m_dSumY = r->m_dSumXX = r->m_dSumXY = 0;
+   r->m_pNext = NULL;
+   // a recycled record still holds the previous monitor's send times, so the
+   // sent flags say which of them belong to this monitor
+   memset(r->m_pbAcked, 0, length * sizeof(bool));
+   memset(r->m_pbSent, 0, length * sizeof(bool));
+   memset(r->m_pbSampled, 0, length * sizeof(bool));
+
+   return r;
+}
+
+void CMonitorPool::release(CMonitorRecord* record)
+{
+   if (NULL == record)
+      return;
+
+   if (m_iFree >= m_iMaxFree)
+   {
+      delete record;
+      return;
+   }
+
+   record->m_pNext = m_pFree;
+   m_pFree = record;
+   ++ m_iFree;
+}
@@ -0,0 +1,102 @@
+#ifndef __UDT_MONITOR_H__
+#define __UDT_MONITOR_H__
+
+#include "udt.h"
+
+
+// Per-packet state of one in-flight monitor. The arrays hold one slot for each
+// packet the monitor is allowed to send, indexed by the sequence number inside
+// the monitor that is carried in the data packet's message number field.
+
+class CMonitorRecord
+{
+friend class CMonitorPool;
+
+public:
+   CMonitorRecord();
+   ~CMonitorRecord();
+
+      // Functionality:
+      //    Add an RTT sample to the running least-squares fit of RTT against send time.
+      // Parameters:
+      //    0) [in] seq: sequence number of the sampled packet inside the monitor.
+      //    1) [in] rtt: RTT measured on the packet, samples of 0 are ignored.
+      // Returned value:
+      //    None. Only the first sample of each packet is used.
+
+   void addRTTSample(const int& seq, const uint64_t& rtt);
+
+      // Functionality:
+      //    Slope of the fitted RTT against send time, the monitor's latency gradient.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Gradient, NaN if the samples do not span two send times.
+
+   double latencyGradient() const;
+
+public:
+   int m_iLength;                       // number of packet slots in use by this monitor
+   int m_iAcked;                        // number of distinct packets reported by the receiver
+   int64_t m_llSerial;                  // start order of the monitor, never reused by the connection
+   bool* m_pbAcked;                     // if the packet has been reported by the receiver
+   bool* m_pbSent;                      // if m_pullSendTime holds the packet's send time
+   bool* m_pbSampled;                   // if the packet's RTT sample is in the fit
+   uint64_t* m_pullSendTime;            // send timestamp of each sent packet, relative to the connection start
+
+private: // running sums of the RTT samples, send times are taken relative to the first sample
+   int m_iRTTSamples;
+   uint64_t m_ullFirstSendTime;
+   double m_dSumX;
+   double m_dSumY;
+   double m_dSumXX;
+   double m_dSumXY;
+
+private:
+   int m_iCapacity;                     // number of packet slots allocated
+   CMonitorRecord* m_pNext;             // next record in the pool's free list
+
+private:
+   CMonitorRecord(const CMonitorRecord&);
+   CMonitorRecord& operator=(const CMonitorRecord&);
+};
+
+// Recycles monitor records so that only the monitors currently in flight hold
+// packet state, and starting a monitor normally reuses warm memory.
+
+class CMonitorPool
+{
+public:
+   CMonitorPool(const int& maxfree = 64);
+   ~CMonitorPool();
+
+      // Functionality:
+      //    Get a cleared record with room for "length" packets.
+      // Parameters:
+      //    0) [in] length: number of packets the monitor will send.
+      // Returned value:
+      //    Pointer to the record.
+
+   CMonitorRecord* acquire(const int& length);
+
+      // Functionality:
+      //    Return a record to the pool once its monitor has ended.
+      // Parameters:
+      //    0) [in] record: the record to be recycled, may be NULL.
+      // Returned value:
+      //    None.
+
+   void release(CMonitorRecord* record);
+
+private:
+   CMonitorRecord* m_pFree;             // free list
+   int m_iFree;                         // number of records in the free list
+   int m_iMaxFree;                      // records kept for reuse, the rest are freed
+
+private:
+   CMonitorPool(const CMonitorPool&);
+   CMonitorPool& operator=(const CMonitorPool&);
+};
+
+
+#endif
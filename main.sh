@@ -25,6 +25,12 @@ export SPROUT_MODEL_IN="./protocols/sprout/src/examples/sprout.model"
 export SPROUT_BT2="./protocols/sprout/src/examples/sproutbt2"
 export VERUS_SERVER="./protocols/verus/src/verus_server"
 export VERUS_CLIENT="./protocols/verus/src/verus_client"
+# The native analyzer in metric/ prints the same summary in one pass; the Perl
+# script is kept for hosts where it has not been built.
+METRIC="./mm-metric"
+if [ -x ./metric/mm-metric ]; then
+	METRIC="./metric/mm-metric -n"
+fi
 
 # Manually extensible part: uplink and downlink trace file, congestion control algorithms
 if [[ $traceset == "mit" ]]; then
@@ -46,7 +52,7 @@ fi
 
 TCPCCA=("hybla" "illinois" "lp" "nv" "vegas" "veno" "westwood" "bbr" "cdg" "verus" "sprout")
 RTT=("10" "20" "40" "80" "120" "160" "200") # ms
-QUEUE_ALG=("droptail" "codel" "pie" "red" "abc")
+QUEUE_ALG=("droptail" "codel" "pie" "red" "abc" "fq_codel")
 BUFFER_SIZE=("50" "100" "200" "300" "400" "500")
 LOSS_RATE=("0.00001" "0.0001" "0.001" "0.01" "0.1")
 
@@ -113,15 +119,15 @@ then
 						echo ${TCPCCA[$j]} > /proc/sys/net/ipv4/tcp_congestion_control
 EOF
 						./mm-tcp ${DOWNLINKS[$i]} ${UPLINKS[$i]} ${TCPCCA[$j]} $((DEFAULT_PORT+10*j)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$i]}
-						./mm-metric 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
+						$METRIC 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
 					elif [[ ${TCPCCA[$j]} == "verus" ]]
 					then
 						./mm-verus ${DOWNLINKS[$i]} ${UPLINKS[$i]} ${TCPCCA[$j]} $((DEFAULT_PORT+10*j)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$i]}
-						./mm-metric 500 down-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
+						$METRIC 500 down-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
 					elif [[ ${TCPCCA[$j]} == "sprout" ]]
 					then
 						./mm-sprout ${DOWNLINKS[$i]} ${UPLINKS[$i]} ${TCPCCA[$j]} $((DEFAULT_PORT+10*j)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$i]}
-						./mm-metric 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
+						$METRIC 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
 					fi
 					rm up-${TCPCCA[$j]}-$DEFAULT_RTT
 					rm down-${TCPCCA[$j]}-$DEFAULT_RTT
@@ -144,15 +150,15 @@ EOF
 					echo ${TCPCCA[$selectedtcp]} > /proc/sys/net/ipv4/tcp_congestion_control
 EOF
 					./mm-tcp ${DOWNLINKS[$i]} ${UPLINKS[$i]} ${TCPCCA[$selectedtcp]} $((DEFAULT_PORT+10*selectedtcp)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$i]}
-					./mm-metric 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
+					$METRIC 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
 				elif [[ ${TCPCCA[$selectedtcp]} == "verus" ]]
 				then
 					./mm-verus ${DOWNLINKS[$i]} ${UPLINKS[$i]} ${TCPCCA[$selectedtcp]} $((DEFAULT_PORT+10*selectedtcp)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$i]}
-					./mm-metric 500 down-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
+					$METRIC 500 down-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
 				elif [[ ${TCPCCA[$selectedtcp]} == "sprout" ]]
 				then
 					./mm-sprout ${DOWNLINKS[$i]} ${UPLINKS[$i]} ${TCPCCA[$selectedtcp]} $((DEFAULT_PORT+10*selectedtcp)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$i]}
-					./mm-metric 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
+					$METRIC 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
 				fi
 				rm up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT
 				rm down-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT
@@ -181,15 +187,15 @@ EOF
 					echo ${TCPCCA[$j]} > /proc/sys/net/ipv4/tcp_congestion_control
 EOF
 					./mm-tcp ${DOWNLINKS[$traceid]} ${UPLINKS[$traceid]} ${TCPCCA[$j]} $((DEFAULT_PORT+10*j)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$traceid]}
-					./mm-metric 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
+					$METRIC 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
 				elif [[ ${TCPCCA[$j]} == "verus" ]]
 				then
 					./mm-verus ${DOWNLINKS[$traceid]} ${UPLINKS[$traceid]} ${TCPCCA[$j]} $((DEFAULT_PORT+10*j)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$traceid]}
-					./mm-metric 500 down-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
+					$METRIC 500 down-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
 				elif [[ ${TCPCCA[$j]} == "sprout" ]]
 				then
 					./mm-sprout ${DOWNLINKS[$traceid]} ${UPLINKS[$traceid]} ${TCPCCA[$j]} $((DEFAULT_PORT+10*j)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$traceid]}
-					./mm-metric 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
+					$METRIC 500 up-${TCPCCA[$j]}-$DEFAULT_RTT 1>/dev/null
 				fi
 				rm up-${TCPCCA[$j]}-$DEFAULT_RTT
 				rm down-${TCPCCA[$j]}-$DEFAULT_RTT
@@ -211,15 +217,15 @@ EOF
 				echo ${TCPCCA[$selectedtcp]} > /proc/sys/net/ipv4/tcp_congestion_control
 EOF
 				./mm-tcp ${DOWNLINKS[$traceid]} ${UPLINKS[$traceid]} ${TCPCCA[$selectedtcp]} $((DEFAULT_PORT+10*selectedtcp)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$traceid]}
-				./mm-metric 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
+				$METRIC 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
 			elif [[ ${TCPCCA[$selectedtcp]} == "verus" ]]
 			then
 				./mm-verus ${DOWNLINKS[$traceid]} ${UPLINKS[$traceid]} ${TCPCCA[$selectedtcp]} $((DEFAULT_PORT+10*selectedtcp)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$traceid]}
-				./mm-metric 500 down-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
+				$METRIC 500 down-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
 			elif [[ ${TCPCCA[$selectedtcp]} == "sprout" ]]
 			then
 				./mm-sprout ${DOWNLINKS[$traceid]} ${UPLINKS[$traceid]} ${TCPCCA[$selectedtcp]} $((DEFAULT_PORT+10*selectedtcp)) $DEFAULT_RTT $DEFAULT_LOSS_RATE $DEFAULT_QUEUE_ALG $DEFAULT_BUFFER_SIZE $traceset ${duration[$traceid]}
-				./mm-metric 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
+				$METRIC 500 up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT 1>/dev/null
 			fi
 			rm up-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT
 			rm down-${TCPCCA[$selectedtcp]}-$DEFAULT_RTT
@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "binary_event_log.hh"
+
+using namespace std;
+
+// Writes a binary mm-link log (MAHIMAHI_LOG_FORMAT=binary) as the text log
+// that mm-link would have written, byte for byte:
+//
+//    mm-log-export BINARY_LOG [TEXT_LOG]
+//
+// The text goes to stdout when TEXT_LOG is not given.
+
+// appends the decimal form of v, as the ostream of mm-link prints it
+static char* format(char* p, uint64_t v)
+{
+   char digits[20];
+   int n = 0;
+   do
+   {
+      digits[n ++] = '0' + v % 10;
+      v /= 10;
+   } while (v > 0);
+
+   while (n > 0)
+      *p ++ = digits[-- n];
+   return p;
+}
+
+int main(int argc, char* argv[])
+{
+   if ((argc < 2) || (argc > 3))
+   {
+      fprintf(stderr, "usage: %s BINARY_LOG [TEXT_LOG]\n", argv[0]);
+      return 1;
+   }
+
+   FILE* out = (3 == argc) ? fopen(argv[2], "w") : stdout;
+   if (NULL == out)
+   {
+      perror(argv[2]);
+      return 1;
+   }
+
+   try
+   {
+      BinaryEventLogFile log(argv[1]);
+
+      string header = log.header_text();
+      fwrite(header.data(), 1, header.size(), out);
+
+      const uint64_t base = log.base_timestamp();
+      vector<char> buf(1 << 20);
+      char* p = &buf[0];
+      char* const limit = &buf[0] + buf.size() - 64;
+
+      for (size_t i = 0, n = log.size(); i < n; ++ i)
+      {
+         const BinaryLogRecord& r = log[i];
+         p = format(p, base + r.time);
+         *p ++ = ' ';
+         *p ++ = r.event;
+         *p ++ = ' ';
+         p = format(p, r.bytes);
+         if ('-' == r.event)
+         {
+            *p ++ = ' ';
+            p = format(p, r.delay);
+         }
+         *p ++ = '\n';
+
+         if (p >= limit)
+         {
+            fwrite(&buf[0], 1, p - &buf[0], out);
+            p = &buf[0];
+         }
+      }
+
+      fwrite(&buf[0], 1, p - &buf[0], out);
+   }
+   catch (const exception& e)
+   {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+
+   if ((0 != fflush(out)) || ferror(out))
+   {
+      perror("write");
+      return 1;
+   }
+
+   if (stdout != out)
+      fclose(out);
+
+   return 0;
+}
@@ -0,0 +1,799 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "binary_event_log.hh"
+
+using namespace std;
+
+// A single pass replacement for the Perl mm-metric. It reads mahimahi link logs
+// ("# base timestamp: N", then "TIME + BYTES", "TIME # BYTES" and
+// "TIME - BYTES DELAY" lines) and prints the same summary on stderr, without
+// holding the log in memory:
+//
+//    mm-metric [-j THREADS] [-w WINDOW] [-g | -n] MS_PER_BIN [FILE...]
+//
+// With one FILE, or none to read stdin, the per-bin series
+// "TIME CAPACITY INGRESS EGRESS OCCUPANCY" is written to stdout, or with -g
+// piped through gnuplot into the SVG graph that the Perl script drew. With
+// several files they are analysed in parallel (-j, default one thread per
+// processor); each summary is printed after a "==> FILE <==" line, in the order
+// of the arguments, and the series goes to FILE.dat (FILE.svg with -g). -n
+// skips the series. Binary logs, written by mm-link with
+// MAHIMAHI_LOG_FORMAT=binary (mm-modified/queue/binary_event_log.hh), are
+// recognised by their magic and mapped into memory instead of parsed.
+//
+// Memory does not grow with the length of the log:
+//    delays are counted in a histogram with one exact bucket per millisecond up
+//    to CHistogram::m_iExactLimit and 1% wide buckets above, so percentiles are
+//    exact below about 17 minutes;
+//    the signal delay of a send time is final once departures have moved WINDOW
+//    ms (default 10000) past it. A FIFO queue departs in send order, so the
+//    result is exact; a departure that arrives later than that is counted and
+//    reported;
+//    per-bin sums are written once the log has moved one second past the bin.
+
+class CHistogram
+{
+public:
+   CHistogram(): m_llCount(0) {}
+
+   void add(const int64_t& value, const uint64_t& count = 1)
+   {
+      if (value < m_iExactLimit)
+      {
+         if ((size_t)value >= m_vExact.size())
+            m_vExact.resize(max((size_t)value + 1, m_vExact.size() * 2), 0);
+         m_vExact[value] += count;
+      }
+      else
+         m_Wide[(int)floor(log((double)value) / log(m_dWideRatio))] += count;
+
+      m_llCount += count;
+   }
+
+   uint64_t count() const {return m_llCount;}
+
+      // Functionality:
+      //    Select an element of the sorted values as the Perl script did, i.e.
+      //    the one at index floor(q * count()).
+      // Parameters:
+      //    0) [in] q: quantile in [0, 1).
+      // Returned value:
+      //    The value, or the lower bound of its bucket above m_iExactLimit.
+
+   double quantile(const double& q) const
+   {
+      uint64_t k = (uint64_t)(q * m_llCount);
+      uint64_t seen = 0;
+
+      for (size_t v = 0; v < m_vExact.size(); ++ v)
+      {
+         seen += m_vExact[v];
+         if (seen > k)
+            return v;
+      }
+
+      for (map<int, uint64_t>::const_iterator i = m_Wide.begin(); i != m_Wide.end(); ++ i)
+      {
+         seen += i->second;
+         if (seen > k)
+            return max((double)m_iExactLimit, floor(pow(m_dWideRatio, i->first)));
+      }
+
+      return 0;
+   }
+
+public:
+   static const int64_t m_iExactLimit = 1 << 20;
+   static const double m_dWideRatio;
+
+private:
+   vector<uint64_t> m_vExact;
+   map<int, uint64_t> m_Wide;
+   uint64_t m_llCount;
+};
+
+const double CHistogram::m_dWideRatio = 1.01;
+
+// The minimum delay of the packets sent at each millisecond. A millisecond in
+// which nothing was sent takes the delay of the next one that has a sample plus
+// the wait for it, as in the Perl script.
+class CSignalDelay
+{
+public:
+   CSignalDelay(CHistogram& out, const int64_t& window):
+   m_Out(out), m_llWindow(window), m_llBase(0), m_llLast(0), m_llGap(0), m_bStarted(false), m_bFinal(false), m_bSampled(false), m_llLate(0) {}
+
+   void add(const int64_t& sent, const int64_t& delay)
+   {
+      if (!m_bStarted)
+      {
+         m_llBase = m_llLast = sent;
+         m_bStarted = true;
+      }
+
+      if (sent < m_llBase)
+      {
+         if (m_bFinal)
+         {
+            ++ m_llLate;
+            return;
+         }
+         m_Min.insert(m_Min.begin(), m_llBase - sent, -1);
+         m_llBase = sent;
+      }
+
+      if (sent - m_llBase >= (int64_t)m_Min.size())
+         m_Min.resize(sent - m_llBase + 1, -1);
+
+      int64_t& v = m_Min[sent - m_llBase];
+      if ((v < 0) || (delay < v))
+         v = delay;
+
+      m_llLast = max(m_llLast, sent);
+      while (m_llBase < m_llLast - m_llWindow)
+         pop();
+   }
+
+   void finish()
+   {
+      while (!m_Min.empty())
+         pop();
+   }
+
+   uint64_t late() const {return m_llLate;}
+
+private:
+   void pop()
+   {
+      int64_t v = m_Min.front();
+      m_Min.pop_front();
+      ++ m_llBase;
+      m_bFinal = true;
+
+      if (v < 0)
+      {
+         // times before the first sample are outside the range
+         if (m_bSampled)
+            ++ m_llGap;
+         return;
+      }
+
+      for (int64_t i = 1; i <= m_llGap; ++ i)
+         m_Out.add(v + i);
+      m_Out.add(v);
+      m_llGap = 0;
+      m_bSampled = true;
+   }
+
+private:
+   CHistogram& m_Out;
+   int64_t m_llWindow;
+   deque<int64_t> m_Min;                // per send time from m_llBase, -1 for no sample
+   int64_t m_llBase;
+   int64_t m_llLast;                    // latest send time seen
+   int64_t m_llGap;                     // send times without a sample since the last final one
+   bool m_bStarted;
+   bool m_bFinal;                       // send times before m_llBase are final
+   bool m_bSampled;
+   uint64_t m_llLate;
+};
+
+// Per-bin sums, written in order once no more events can fall in them.
+class CBinSeries
+{
+public:
+   CBinSeries(FILE* out, const int64_t& msperbin):
+   m_pOut(out), m_llMsPerBin(msperbin), m_llFront(0), m_llFirst(0), m_llLast(0), m_bStarted(false), m_bWritten(false), m_llOccupancy(0) {}
+
+   bool add(const int64_t& ms, const int& type, const uint64_t& bits)
+   {
+      int64_t bin = ms / m_llMsPerBin;
+
+      if (!m_bStarted)
+      {
+         m_llFront = m_llFirst = m_llLast = bin;
+         m_bStarted = true;
+      }
+
+      if (bin < m_llFront)
+      {
+         if (m_bWritten)
+            return false;
+         m_Bins.insert(m_Bins.begin(), m_llFront - bin, CBin());
+         m_llFront = bin;
+      }
+
+      if (bin - m_llFront >= (int64_t)m_Bins.size())
+         m_Bins.resize(bin - m_llFront + 1);
+
+      m_Bins[bin - m_llFront].m_llBits[type] += bits;
+      m_llFirst = min(m_llFirst, bin);
+      m_llLast = max(m_llLast, bin);
+
+      while (!m_Bins.empty() && ((m_llFront + 1) * m_llMsPerBin <= ms - m_iSlack))
+         pop();
+
+      return true;
+   }
+
+   void finish()
+   {
+      while (!m_Bins.empty())
+         pop();
+   }
+
+   int64_t first() const {return m_llFirst;}
+   int64_t last() const {return m_llLast;}
+
+public:
+   static const int m_iSlack = 1000;    // ms an event may be logged out of time order
+
+   enum {CAPACITY, ARRIVAL, DEPARTURE};
+
+private:
+   struct CBin
+   {
+      CBin() {m_llBits[0] = m_llBits[1] = m_llBits[2] = 0;}
+      uint64_t m_llBits[3];
+   };
+
+   void pop()
+   {
+      const CBin& b = m_Bins.front();
+      m_llOccupancy += (int64_t)b.m_llBits[ARRIVAL] - (int64_t)b.m_llBits[DEPARTURE];
+
+      if (NULL != m_pOut)
+      {
+         double scale = (m_llMsPerBin / 1000.0) * 1000000.0;
+         fprintf(m_pOut, "%.3f %.15g %.15g %.15g %lld\n", m_llFront * m_llMsPerBin / 1000.0,
+                 b.m_llBits[CAPACITY] / scale, b.m_llBits[ARRIVAL] / scale, b.m_llBits[DEPARTURE] / scale, (long long)m_llOccupancy);
+      }
+
+      m_Bins.pop_front();
+      ++ m_llFront;
+      m_bWritten = true;
+   }
+
+private:
+   FILE* m_pOut;
+   int64_t m_llMsPerBin;
+   deque<CBin> m_Bins;                  // from bin m_llFront
+   int64_t m_llFront;
+   int64_t m_llFirst;
+   int64_t m_llLast;
+   bool m_bStarted;
+   bool m_bWritten;                     // bins before m_llFront are written
+   int64_t m_llOccupancy;               // bits
+};
+
+class CMetric
+{
+public:
+   CMetric(const int64_t& msperbin, const int64_t& window, FILE* series):
+   m_Signal(m_SignalDelays, window), m_Bins(series, msperbin),
+   m_llBase(0), m_bBase(false), m_llFirst(0), m_llLastTime(0), m_bEvent(false), m_llDelaySum(0)
+   {
+      m_llSum[0] = m_llSum[1] = m_llSum[2] = 0;
+   }
+
+      // Functionality:
+      //    Analyse a whole log.
+      // Parameters:
+      //    0) [in] in: the log.
+      // Returned value:
+      //    true on success, otherwise false with the reason in error().
+
+   bool read(FILE* in)
+   {
+      vector<char> buf(1 << 20);
+      size_t kept = 0;
+
+      while (true)
+      {
+         size_t n = fread(&buf[kept], 1, buf.size() - kept, in);
+         size_t end = kept + n;
+         size_t line = 0;
+
+         for (size_t i = 0; i < end; ++ i)
+         {
+            if ('\n' != buf[i])
+               continue;
+            if (!parse(&buf[line], i - line))
+               return false;
+            line = i + 1;
+         }
+
+         kept = end - line;
+         memmove(&buf[0], &buf[line], kept);
+
+         if (0 == n)
+            break;
+         if (kept == buf.size())
+            buf.resize(buf.size() * 2);
+      }
+
+      if (ferror(in))
+         return fail(strerror(errno));
+
+      if ((kept > 0) && !parse(&buf[0], kept))
+         return false;
+
+      m_Signal.finish();
+      m_Bins.finish();
+      return true;
+   }
+
+      // Functionality:
+      //    Analyse a whole binary log, written by mm-link with
+      //    MAHIMAHI_LOG_FORMAT=binary.
+      // Parameters:
+      //    0) [in] log: the mapped log.
+      // Returned value:
+      //    true on success, otherwise false with the reason in error().
+
+   bool read(const BinaryEventLogFile& log)
+   {
+      m_llBase = log.base_timestamp();
+      m_bBase = true;
+
+      for (size_t i = 0, n = log.size(); i < n; ++ i)
+      {
+         const BinaryLogRecord& r = log[i];
+         int kind;
+
+         if ('+' == r.event)
+            kind = CBinSeries::ARRIVAL;
+         else if ('#' == r.event)
+            kind = CBinSeries::CAPACITY;
+         else if ('-' == r.event)
+            kind = CBinSeries::DEPARTURE;
+         else
+            return fail("Unknown event type: " + string(1, (char)r.event));
+
+         if (!event(r.time, kind, r.bytes, r.delay))
+            return false;
+      }
+
+      m_Signal.finish();
+      m_Bins.finish();
+      return true;
+   }
+
+      // Functionality:
+      //    Format the statistics of a log that has been read.
+      // Parameters:
+      //    0) [out] summary: the lines the Perl script printed on stderr.
+      // Returned value:
+      //    true on success, otherwise false with the reason in error().
+
+   bool summarize(string& summary)
+   {
+      if (!m_bEvent)
+         return fail("Must have at least one event");
+
+      double duration = (m_llLastTime - m_llFirst) / 1000.0;
+      if (duration <= 0)
+         return fail("Log must span more than one millisecond");
+
+      m_dCapacity = m_llSum[CBinSeries::CAPACITY] / duration / 1000000.0;
+      m_dIngress = m_llSum[CBinSeries::ARRIVAL] / duration / 1000000.0;
+      m_dThroughput = m_llSum[CBinSeries::DEPARTURE] / duration / 1000000.0;
+
+      if (0 == m_Delays.count())
+         return fail("Must have at least one departure event");
+      if (0 == m_llSum[CBinSeries::CAPACITY])
+         return fail("Must have at least one delivery opportunity");
+
+      char line[256];
+      summary.clear();
+      sprintf(line, "Average capacity: %.2f Mbits/s\n", m_dCapacity);
+      summary += line;
+      sprintf(line, "Average throughput: %.2f Mbits/s (%.1f%% utilization)\n", m_dThroughput, 100.0 * m_dThroughput / m_dCapacity);
+      summary += line;
+      sprintf(line, "95th percentile per-packet queueing delay: %.0f ms\n", m_Delays.quantile(0.95));
+      summary += line;
+      sprintf(line, "95th percentile signal delay: %.0f ms\n", m_SignalDelays.quantile(0.95));
+      summary += line;
+      sprintf(line, "Average per packet delay: %.0f ms\n", (double)m_llDelaySum / m_Delays.count());
+      summary += line;
+
+      if (m_Signal.late() > 0)
+      {
+         sprintf(line, "Warning: %llu departures reordered beyond the signal delay window\n", (unsigned long long)m_Signal.late());
+         summary += line;
+      }
+
+      if (m_Bins.first() == m_Bins.last())
+         return fail("MS_PER_BIN is too large for length of trace");
+
+      return true;
+   }
+
+      // Functionality:
+      //    Draw the graph of the Perl script from a series written by this log.
+      // Parameters:
+      //    0) [in] series: file holding the series.
+      //    1) [in] svg: output file, "/dev/stdout" for stdout.
+      // Returned value:
+      //    true on success, otherwise false with the reason in error().
+
+   bool plot(const string& series, const string& svg)
+   {
+      FILE* gnuplot = popen("gnuplot", "w");
+      if (NULL == gnuplot)
+         return fail("cannot run gnuplot");
+
+      fprintf(gnuplot, "set xlabel \"time (s)\"\n"
+                       "set ylabel \"throughput (Mbits/s)\"\n"
+                       "set key center outside top horizontal\n"
+                       "set style fill solid 0.2 noborder\n"
+                       "set terminal svg size 1024,560 fixed fname 'Arial'\n"
+                       "set output \"%s\"\n", svg.c_str());
+      fprintf(gnuplot, "plot [%f:%f] \"%s\" using 1:2 title \"Capacity (mean %.2f Mbits/s)\" with filledcurves above x1 lw 0.5, "
+                       "\"%s\" using 1:3 with lines lc rgb \"#0020a0\" lw 2 title \"Traffic ingress (mean %.2f Mbits/s)\", "
+                       "\"%s\" using 1:4 with lines lc rgb \"#ff6040\" lw 2 title \"Traffic egress (mean %.2f Mbits/s)\"\n",
+              m_llFirst / 1000.0, m_llLastTime / 1000.0, series.c_str(), m_dCapacity, series.c_str(), m_dIngress, series.c_str(), m_dThroughput);
+
+      if (0 != pclose(gnuplot))
+         return fail("gnuplot failed");
+
+      return true;
+   }
+
+   const string& error() const {return m_strError;}
+
+private:
+   static bool number(const char* s, const char* end, int64_t& value)
+   {
+      if (s == end)
+         return false;
+      value = 0;
+      for (; s < end; ++ s)
+      {
+         if ((*s < '0') || (*s > '9'))
+            return false;
+         value = value * 10 + (*s - '0');
+      }
+      return true;
+   }
+
+   bool parse(const char* line, size_t size)
+   {
+      if ((size > 0) && ('\r' == line[size - 1]))
+         -- size;
+
+      const char* end = line + size;
+
+      if ((size > 0) && ('#' == line[0]))
+      {
+         static const char base[] = "# base timestamp: ";
+         const size_t len = sizeof(base) - 1;
+         if ((size <= len) || (0 != strncmp(line, base, len)) || (line[len] < '0') || (line[len] > '9'))
+            return true;
+
+         if (m_bBase)
+            return fail("base timestamp multiply defined");
+
+         const char* p = line + len;
+         const char* q = p;
+         while ((q < end) && (*q >= '0') && (*q <= '9'))
+            ++ q;
+         number(p, q, m_llBase);
+         m_bBase = true;
+         return true;
+      }
+
+      // split on white space, as Perl's split /\s+/ does with no leading blank
+      const char* field[5];
+      const char* fieldEnd[5];
+      int fields = 0;
+      const char* p = line;
+      while ((p <= end) && (fields < 5))
+      {
+         const char* q = p;
+         while ((q < end) && !isspace(*q))
+            ++ q;
+         field[fields] = p;
+         fieldEnd[fields] = q;
+         ++ fields;
+         while ((q < end) && isspace(*q))
+            ++ q;
+         if (q == end)
+            break;
+         p = q;
+      }
+
+      if (fields < 3)
+         return fail("Format: timestamp event_type num_bytes [delay]");
+
+      int64_t ts, bytes, delay = 0;
+      if (!number(field[0], fieldEnd[0], ts))
+         return fail("Invalid timestamp: " + string(field[0], fieldEnd[0]));
+      if (!number(field[2], fieldEnd[2], bytes))
+         return fail("Invalid byte count: " + string(field[2], fieldEnd[2]));
+      if (!m_bBase)
+         return fail("logfile is missing base timestamp");
+
+      string type(field[1], fieldEnd[1]);
+      int kind;
+
+      if ("+" == type)
+         kind = CBinSeries::ARRIVAL;
+      else if ("#" == type)
+         kind = CBinSeries::CAPACITY;
+      else if ("-" == type)
+      {
+         kind = CBinSeries::DEPARTURE;
+         if (fields < 4)
+            return fail("Departure format: timestamp - num_bytes delay");
+         if (!number(field[3], fieldEnd[3], delay))
+            return fail("Invalid delay: " + string(field[3], fieldEnd[3]));
+      }
+      else
+         return fail("Unknown event type: " + type);
+
+      return event(ts - m_llBase, kind, bytes, delay);
+   }
+
+   bool event(const int64_t& ts, const int& kind, const int64_t& bytes, const int64_t& delay)
+   {
+      if (!m_bEvent)
+      {
+         m_llFirst = m_llLastTime = ts;
+         m_bEvent = true;
+      }
+      m_llLastTime = max(m_llLastTime, ts);
+
+      uint64_t bits = bytes * 8;
+
+      if (CBinSeries::DEPARTURE == kind)
+      {
+         if (ts - delay < 0)
+         {
+            char msg[128];
+            sprintf(msg, "Invalid timestamp and delay: ts=%lld, delay=%lld", (long long)ts, (long long)delay);
+            return fail(msg);
+         }
+
+         m_Delays.add(delay);
+         m_llDelaySum += delay;
+         m_Signal.add(ts - delay, delay);
+      }
+
+      m_llSum[kind] += bits;
+
+      if (!m_Bins.add(ts, kind, bits))
+         return fail("Events are out of time order by more than a second");
+
+      return true;
+   }
+
+   bool fail(const string& reason)
+   {
+      m_strError = reason;
+      return false;
+   }
+
+private:
+   CHistogram m_Delays;
+   CHistogram m_SignalDelays;
+   CSignalDelay m_Signal;
+   CBinSeries m_Bins;
+
+   int64_t m_llBase;                    // "# base timestamp"
+   bool m_bBase;
+   int64_t m_llFirst;                   // time of the first event
+   int64_t m_llLastTime;                // latest event time
+   bool m_bEvent;
+   uint64_t m_llSum[3];                 // bits, by CBinSeries kind
+   int64_t m_llDelaySum;
+
+   double m_dCapacity;                  // Mb/s
+   double m_dIngress;
+   double m_dThroughput;
+
+   string m_strError;
+};
+
+enum OutputMode {SERIES, GRAPH, NONE};
+
+struct CJob
+{
+   string m_strFile;                    // empty for stdin
+   string m_strSummary;
+   string m_strError;
+};
+
+struct CWork
+{
+   vector<CJob>* m_pJobs;
+   size_t m_iNext;
+   pthread_mutex_t m_Lock;
+   int64_t m_llMsPerBin;
+   int64_t m_llWindow;
+   OutputMode m_Mode;
+   bool m_bSingle;                      // series and graph go to stdout
+};
+
+static bool analyse(CWork& w, CJob& job)
+{
+   FILE* in = job.m_strFile.empty() ? stdin : fopen(job.m_strFile.c_str(), "r");
+   if (NULL == in)
+   {
+      job.m_strError = job.m_strFile + ": " + strerror(errno);
+      return false;
+   }
+
+   // the graph needs the series three times and the means first, so it is
+   // kept in a file rather than in memory
+   string series;
+   FILE* out = NULL;
+   if (GRAPH == w.m_Mode)
+   {
+      char tmp[] = "/tmp/mm-metric.XXXXXX";
+      int fd = mkstemp(tmp);
+      if ((fd < 0) || (NULL == (out = fdopen(fd, "w"))))
+      {
+         job.m_strError = string("cannot create a temporary file: ") + strerror(errno);
+         if (in != stdin)
+            fclose(in);
+         return false;
+      }
+      series = tmp;
+   }
+   else if (SERIES == w.m_Mode)
+   {
+      series = w.m_bSingle ? "/dev/stdout" : job.m_strFile + ".dat";
+      out = w.m_bSingle ? stdout : fopen(series.c_str(), "w");
+      if (NULL == out)
+      {
+         job.m_strError = series + ": " + strerror(errno);
+         if (in != stdin)
+            fclose(in);
+         return false;
+      }
+   }
+
+   CMetric metric(w.m_llMsPerBin, w.m_llWindow, out);
+   bool ok;
+   if (!job.m_strFile.empty() && BinaryEventLogFile::is_binary(job.m_strFile))
+   {
+      try
+      {
+         BinaryEventLogFile log(job.m_strFile);
+         ok = metric.read(log) && metric.summarize(job.m_strSummary);
+      }
+      catch (const exception& e)
+      {
+         ok = false;
+         job.m_strError = e.what();
+      }
+   }
+   else
+      ok = metric.read(in) && metric.summarize(job.m_strSummary);
+
+   if (in != stdin)
+      fclose(in);
+   if ((NULL != out) && (stdout != out))
+      fclose(out);
+   else if (stdout == out)
+      fflush(out);
+
+   if (ok && (GRAPH == w.m_Mode))
+      ok = metric.plot(series, w.m_bSingle ? "/dev/stdout" : job.m_strFile + ".svg");
+   if (GRAPH == w.m_Mode)
+      unlink(series.c_str());
+
+   if (!ok && job.m_strError.empty())
+      job.m_strError = metric.error();
+   return ok;
+}
+
+static void* worker(void* param)
+{
+   CWork& w = *(CWork*)param;
+
+   while (true)
+   {
+      pthread_mutex_lock(&w.m_Lock);
+      size_t i = w.m_iNext ++;
+      pthread_mutex_unlock(&w.m_Lock);
+
+      if (i >= w.m_pJobs->size())
+         break;
+
+      analyse(w, (*w.m_pJobs)[i]);
+   }
+
+   return NULL;
+}
+
+static int usage(const char* name)
+{
+   fprintf(stderr, "Usage: %s [-j THREADS] [-w WINDOW] [-g | -n] MS_PER_BIN [FILE...]\n", name);
+   return 1;
+}
+
+int main(int argc, char* argv[])
+{
+   int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   int64_t window = 10000;
+   OutputMode mode = SERIES;
+
+   int i = 1;
+   for (; (i < argc) && ('-' == argv[i][0]) && ('\0' != argv[i][1]); ++ i)
+   {
+      if ((0 == strcmp(argv[i], "-j")) && (i + 1 < argc))
+         threads = atoi(argv[++ i]);
+      else if ((0 == strcmp(argv[i], "-w")) && (i + 1 < argc))
+         window = atoll(argv[++ i]);
+      else if (0 == strcmp(argv[i], "-g"))
+         mode = GRAPH;
+      else if (0 == strcmp(argv[i], "-n"))
+         mode = NONE;
+      else
+         return usage(argv[0]);
+   }
+
+   if (i >= argc)
+      return usage(argv[0]);
+
+   char* end;
+   int64_t msperbin = strtoll(argv[i], &end, 10);
+   if (('\0' != *end) || (msperbin <= 0) || (window < 0))
+      return usage(argv[0]);
+
+   vector<CJob> jobs(max(argc - i - 1, 1));
+   for (int k = i + 1; k < argc; ++ k)
+      jobs[k - i - 1].m_strFile = argv[k];
+
+   CWork w;
+   w.m_pJobs = &jobs;
+   w.m_iNext = 0;
+   pthread_mutex_init(&w.m_Lock, NULL);
+   w.m_llMsPerBin = msperbin;
+   w.m_llWindow = window;
+   w.m_Mode = mode;
+   w.m_bSingle = (1 == jobs.size());
+
+   threads = max(1, min(threads, (int)jobs.size()));
+   if (1 == threads)
+      worker(&w);
+   else
+   {
+      vector<pthread_t> t(threads);
+      for (int k = 0; k < threads; ++ k)
+         pthread_create(&t[k], NULL, worker, &w);
+      for (int k = 0; k < threads; ++ k)
+         pthread_join(t[k], NULL);
+   }
+
+   pthread_mutex_destroy(&w.m_Lock);
+
+   int failed = 0;
+   for (size_t k = 0; k < jobs.size(); ++ k)
+   {
+      if (!w.m_bSingle)
+         fprintf(stderr, "==> %s <==\n", jobs[k].m_strFile.c_str());
+      fputs(jobs[k].m_strSummary.c_str(), stderr);
+      if (!jobs[k].m_strError.empty())
+      {
+         fprintf(stderr, "%s\n", jobs[k].m_strError.c_str());
+         ++ failed;
+      }
+   }
+
+   return (failed > 0) ? 1 : 0;
+}
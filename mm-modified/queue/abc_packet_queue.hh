@@ -0,0 +1,298 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef ABC_PACKET_QUEUE_HH
+#define ABC_PACKET_QUEUE_HH
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <queue>
+#include <string>
+
+#include "queued_packet.hh"
+#include "abstract_packet_queue.hh"
+#include "exception.hh"
+#include "ezio.hh"
+#include "timestamp.hh"
+
+/* Accel-Brake Control (Goyal et al., NSDI 2020): a drop-tail queue that marks
+   every departing packet either accelerate or brake. An ABC sender grows its
+   window by one packet per accelerate and shrinks it by one per brake, so
+   marking a fraction f of the packets accelerate moves the sending rate to
+   2 * f times the dequeue rate within an RTT.
+
+   QUEUE_ARGS = "packets=N | bytes=N [, utilization=PERCENT] [, delta=MS]
+                 [, delay_threshold=MS] [, window=MS]"
+
+   The target rate is
+
+       tr = utilization * mu - mu / delta * max(0, x - delay_threshold)
+
+   where x is the queuing delay of the departing packet and mu the capacity
+   of the link. A cellular link only tells the queue how much it sent, so mu
+   is the dequeue rate over the 1 ms slots of the last window ms that ended
+   with packets still waiting, when the link was the bottleneck; it keeps its
+   last value through idle windows. f = tr / (2 * dequeue rate over the whole
+   window), capped to [0, 1], and a token bucket spreads the accelerates
+   evenly. Before the link has ever been backlogged, every packet is an
+   accelerate.
+
+   Marks go in the ECN field of IPv4 packets that carry ECT: accelerate is
+   ECT(1) and brake ECT(0). Not-ECT and CE packets are left alone, so other
+   senders only see a drop-tail queue. The defaults are utilization=98,
+   delta=133, delay_threshold=20 and window=40. */
+
+class AbcPacketQueue : public AbstractPacketQueue
+{
+private:
+    static const unsigned int max_window_ = 1000;
+    static constexpr double token_limit_ = 2;
+
+    /* what the link sent in one ms, and whether packets were still waiting
+       at the end of it */
+    struct Slot
+    {
+        unsigned int bytes;
+        bool backlogged;
+    };
+
+    std::queue<QueuedPacket> internal_queue_ {};
+    int queue_size_in_bytes_ = 0;
+
+    const unsigned int packet_limit_;
+    const unsigned int byte_limit_;
+    const double utilization_;
+    const double delta_;
+    const uint64_t delay_threshold_;
+    const unsigned int window_;
+
+    /* the ring of the last window_ slots, with running sums over it */
+    std::array<Slot, max_window_> slots_ {};
+    uint64_t last_time_ = 0;
+    uint64_t window_bytes_ = 0;
+    uint64_t backlogged_bytes_ = 0;
+    unsigned int backlogged_slots_ = 0;
+
+    /* link capacity in bytes per ms, 0 until it is first measured */
+    double capacity_ = 0;
+    double token_ = 0;
+
+    unsigned int get_arg( const std::string & args, const std::string & name, unsigned int default_value )
+    {
+        auto offset = args.find( name );
+        if ( offset == std::string::npos ) {
+            return default_value;
+        }
+        return parse_arg( args, offset + name.size() );
+    }
+
+    unsigned int parse_arg( const std::string & args, size_t offset )
+    {
+        /* make sure next char is "=" */
+        if ( args.substr( offset, 1 ) != "=" ) {
+            throw std::runtime_error( "could not parse queue arguments: " + args );
+        }
+
+        /* advance by length of "=" */
+        offset++;
+
+        /* find the first non-digit character */
+        auto offset2 = args.substr( offset ).find_first_not_of( "0123456789" );
+
+        auto digit_string = args.substr( offset ).substr( 0, offset2 );
+
+        if ( digit_string.empty() ) {
+            throw std::runtime_error( "could not parse queue arguments: " + args );
+        }
+
+        return myatoi( digit_string );
+    }
+
+    void set_backlogged( Slot & slot, const bool backlogged )
+    {
+        if ( slot.backlogged == backlogged ) {
+            return;
+        }
+        if ( backlogged ) {
+            backlogged_bytes_ += slot.bytes;
+            backlogged_slots_++;
+        } else {
+            backlogged_bytes_ -= slot.bytes;
+            backlogged_slots_--;
+        }
+        slot.backlogged = backlogged;
+    }
+
+    /* start the slots of the ms up to now; the queue has not changed since
+       the last event, so none of them has sent anything yet */
+    Slot & advance( const uint64_t now )
+    {
+        if ( now > last_time_ ) {
+            const uint64_t first = std::max( last_time_ + 1, now - std::min<uint64_t>( now, window_ - 1 ) );
+            for ( uint64_t t = first; t <= now; t++ ) {
+                Slot & slot = slots_[ t % window_ ];
+                set_backlogged( slot, false );
+                window_bytes_ -= slot.bytes;
+                slot.bytes = 0;
+                set_backlogged( slot, not internal_queue_.empty() );
+            }
+            last_time_ = now;
+        }
+        return slots_[ last_time_ % window_ ];
+    }
+
+    /* the fraction of packets to mark accelerate; the current slot is not
+       over, so it does not count towards the capacity */
+    double accelerate_fraction( const Slot & current, const uint64_t queuing_delay )
+    {
+        const unsigned int slots = backlogged_slots_ - current.backlogged;
+        if ( slots > 0 ) {
+            capacity_ = double( backlogged_bytes_ - ( current.backlogged ? current.bytes : 0 ) ) / slots;
+        }
+        if ( capacity_ == 0 or window_bytes_ == 0 ) {
+            return 1;
+        }
+
+        double target_rate = utilization_ * capacity_;
+        if ( queuing_delay > delay_threshold_ ) {
+            target_rate -= capacity_ / delta_ * ( queuing_delay - delay_threshold_ );
+        }
+
+        const double dequeue_rate = double( window_bytes_ ) / window_;
+        return std::min( 1.0, std::max( 0.0, target_rate / ( 2 * dequeue_rate ) ) );
+    }
+
+    /* offset of the IPv4 header in a packet, or npos. mahimahi's TUN device
+       keeps the 4 byte packet information, whose last two bytes are the
+       EtherType. */
+    static size_t ipv4_offset( const std::string & contents )
+    {
+        if ( contents.size() >= 24 and uint8_t( contents[ 2 ] ) == 0x08 and uint8_t( contents[ 3 ] ) == 0x00
+             and ( uint8_t( contents[ 4 ] ) >> 4 ) == 4 ) {
+            return 4;
+        }
+        if ( contents.size() >= 20 and ( uint8_t( contents[ 0 ] ) >> 4 ) == 4 ) {
+            return 0;
+        }
+        return std::string::npos;
+    }
+
+    /* set the ECN field of an ECT packet, updating the header checksum as in
+       RFC 1624 */
+    static void mark( std::string & contents, const bool accelerate )
+    {
+        const size_t ip = ipv4_offset( contents );
+        if ( ip == std::string::npos ) {
+            return;
+        }
+
+        const uint8_t tos = contents[ ip + 1 ];
+        if ( ( tos & 3 ) == 0 or ( tos & 3 ) == 3 ) {
+            return;
+        }
+        const uint8_t new_tos = ( tos & ~3 ) | ( accelerate ? 1 : 2 );
+        if ( new_tos == tos ) {
+            return;
+        }
+
+        const uint16_t old_word = ( uint8_t( contents[ ip ] ) << 8 ) | tos;
+        const uint16_t new_word = ( uint8_t( contents[ ip ] ) << 8 ) | new_tos;
+        uint32_t sum = uint16_t( ~( ( uint8_t( contents[ ip + 10 ] ) << 8 ) | uint8_t( contents[ ip + 11 ] ) ) );
+        sum += uint16_t( ~old_word );
+        sum += new_word;
+        sum = ( sum & 0xffff ) + ( sum >> 16 );
+        sum = ( sum & 0xffff ) + ( sum >> 16 );
+        const uint16_t checksum = ~sum;
+
+        contents[ ip + 1 ] = new_tos;
+        contents[ ip + 10 ] = checksum >> 8;
+        contents[ ip + 11 ] = checksum & 0xff;
+    }
+
+public:
+    AbcPacketQueue( const std::string & args )
+        : packet_limit_( get_arg( args, "packets", 0 ) ),
+          byte_limit_( get_arg( args, "bytes", 0 ) ),
+          utilization_( get_arg( args, "utilization", 98 ) / 100.0 ),
+          delta_( get_arg( args, "delta", 133 ) ),
+          delay_threshold_( get_arg( args, "delay_threshold", 20 ) ),
+          window_( get_arg( args, "window", 40 ) )
+    {
+        std::cout << "Packet limit: " << packet_limit_
+                  << ", Byte limit: " << byte_limit_
+                  << ", Utilization: " << utilization_
+                  << ", Delta: " << delta_
+                  << ", Delay threshold: " << delay_threshold_
+                  << ", Window: " << window_
+                  << std::endl;
+        if ( packet_limit_ == 0 and byte_limit_ == 0 ) {
+            throw std::runtime_error( "AbcPacketQueue needs a packets or a bytes limit" );
+        }
+        if ( delta_ == 0 ) {
+            throw std::runtime_error( "AbcPacketQueue delta must be above 0" );
+        }
+        if ( window_ == 0 or window_ > max_window_ ) {
+            throw std::runtime_error( "AbcPacketQueue window must be 1 to 1000 ms" );
+        }
+    }
+
+    void enqueue( QueuedPacket && p ) override
+    {
+        Slot & slot = advance( p.arrival_time );
+
+        if ( ( packet_limit_ and internal_queue_.size() >= packet_limit_ ) or
+             ( byte_limit_ and queue_size_in_bytes_ + p.contents.size() > byte_limit_ ) ) {
+            return;
+        }
+
+        queue_size_in_bytes_ += p.contents.size();
+        internal_queue_.emplace( std::move( p ) );
+        set_backlogged( slot, true );
+    }
+
+    QueuedPacket dequeue( void ) override
+    {
+        assert( not internal_queue_.empty() );
+
+        const uint64_t now = timestamp();
+        Slot & slot = advance( now );
+
+        QueuedPacket ret = std::move( internal_queue_.front() );
+        internal_queue_.pop();
+        queue_size_in_bytes_ -= ret.contents.size();
+
+        slot.bytes += ret.contents.size();
+        window_bytes_ += ret.contents.size();
+        if ( slot.backlogged ) {
+            backlogged_bytes_ += ret.contents.size();
+        }
+        set_backlogged( slot, not internal_queue_.empty() );
+
+        const uint64_t queuing_delay = now > ret.arrival_time ? now - ret.arrival_time : 0;
+        token_ += accelerate_fraction( slot, queuing_delay );
+        if ( token_ > token_limit_ ) {
+            token_ = token_limit_;
+        }
+        const bool accelerate = token_ >= 1;
+        if ( accelerate ) {
+            token_ -= 1;
+        }
+        mark( ret.contents, accelerate );
+
+        return ret;
+    }
+
+    bool empty( void ) const override
+    {
+        return internal_queue_.empty();
+    }
+
+    std::string to_string( void ) const override
+    {
+        return "abc";
+    }
+};
+
+#endif /* ABC_PACKET_QUEUE_HH */
@@ -0,0 +1,238 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef BINARY_EVENT_LOG_HH
+#define BINARY_EVENT_LOG_HH
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Binary form of the mm-link packet log (--uplink-log / --downlink-log).
+
+   file   = header, header text, records
+   header = magic "MMLOGBIN", version, record size, base timestamp and the
+            length of the header text, all in host byte order
+   header text = the "# ..." lines of the text log, padded with NULs to a
+            multiple of the record size
+   record = one fixed-width packet event, with its time relative to the base
+            timestamp
+
+   A record replaces a text line such as "1234 - 1504 25" and is written
+   without formatting; records are buffered and written in blocks. A log cut
+   short ends with whole records, because the reader ignores a partial one. */
+
+struct BinaryLogRecord
+{
+    uint32_t time;       /* ms since the base timestamp */
+    uint32_t delay;      /* ms in the queue, departures only */
+    uint16_t bytes;      /* at most the 1504 byte TUN payload */
+    uint8_t event;       /* '+' arrival, '#' delivery opportunity, '-' departure */
+    uint8_t reserved;
+};
+
+struct BinaryLogHeader
+{
+    char magic[ 8 ];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t base_timestamp;
+    uint32_t text_size;  /* header text, without the padding */
+    uint32_t reserved;
+};
+
+static const char binary_log_magic[ 8 ] = { 'M', 'M', 'L', 'O', 'G', 'B', 'I', 'N' };
+static const uint32_t binary_log_version = 1;
+
+class BinaryEventLog
+{
+private:
+    int fd_;
+    uint64_t base_timestamp_;
+    std::vector<BinaryLogRecord> buffer_;
+    size_t used_;
+
+    static const size_t buffer_records_ = 4096;
+
+    void write_all( const void * data, size_t size )
+    {
+        const char * p = static_cast<const char *>( data );
+        while ( size > 0 ) {
+            const ssize_t n = ::write( fd_, p, size );
+            if ( n < 0 ) {
+                if ( errno == EINTR ) {
+                    continue;
+                }
+                throw std::runtime_error( std::string( "binary log: write: " ) + strerror( errno ) );
+            }
+            p += n;
+            size -= n;
+        }
+    }
+
+    void record( const uint64_t time, const uint8_t event, const size_t bytes, const uint64_t delay )
+    {
+        BinaryLogRecord & r = buffer_[ used_++ ];
+        r.time = time - base_timestamp_;
+        r.bytes = bytes;
+        r.delay = delay;
+        r.event = event;
+        r.reserved = 0;
+
+        if ( used_ == buffer_.size() ) {
+            flush();
+        }
+    }
+
+public:
+    BinaryEventLog( const std::string & filename, const uint64_t base_timestamp, const std::string & header_text )
+        : fd_( ::open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) ),
+          base_timestamp_( base_timestamp ),
+          buffer_( buffer_records_ ),
+          used_( 0 )
+    {
+        if ( fd_ < 0 ) {
+            throw std::runtime_error( filename + ": error opening for writing" );
+        }
+
+        BinaryLogHeader header;
+        memset( &header, 0, sizeof( header ) );
+        memcpy( header.magic, binary_log_magic, sizeof( header.magic ) );
+        header.version = binary_log_version;
+        header.record_size = sizeof( BinaryLogRecord );
+        header.base_timestamp = base_timestamp;
+        header.text_size = header_text.size();
+
+        std::string text = header_text;
+        text.resize( ( text.size() + sizeof( BinaryLogRecord ) - 1 ) / sizeof( BinaryLogRecord ) * sizeof( BinaryLogRecord ), '\0' );
+
+        write_all( &header, sizeof( header ) );
+        write_all( text.data(), text.size() );
+    }
+
+    ~BinaryEventLog()
+    {
+        try {
+            flush();
+        } catch ( const std::exception & ) {
+            /* nothing more can be done from a destructor */
+        }
+        ::close( fd_ );
+    }
+
+    BinaryEventLog( const BinaryEventLog & other ) = delete;
+    BinaryEventLog & operator=( const BinaryEventLog & other ) = delete;
+
+    void arrival( const uint64_t time, const size_t bytes ) { record( time, '+', bytes, 0 ); }
+
+    void opportunity( const uint64_t time, const size_t bytes ) { record( time, '#', bytes, 0 ); }
+
+    void departure( const uint64_t time, const size_t bytes, const uint64_t delay ) { record( time, '-', bytes, delay ); }
+
+    void flush( void )
+    {
+        if ( used_ > 0 ) {
+            write_all( &buffer_[ 0 ], used_ * sizeof( BinaryLogRecord ) );
+            used_ = 0;
+        }
+    }
+};
+
+/* Read-only view of a binary log, mapped into memory. */
+class BinaryEventLogFile
+{
+private:
+    void * map_;
+    size_t map_size_;
+    const BinaryLogHeader * header_;
+    const BinaryLogRecord * records_;
+    size_t count_;
+
+public:
+    /* true if the file starts with the magic of a binary log */
+    static bool is_binary( const std::string & filename )
+    {
+        char magic[ sizeof( binary_log_magic ) ];
+        const int fd = ::open( filename.c_str(), O_RDONLY );
+        if ( fd < 0 ) {
+            return false;
+        }
+        const bool binary = ( ::read( fd, magic, sizeof( magic ) ) == sizeof( magic ) )
+            and ( memcmp( magic, binary_log_magic, sizeof( magic ) ) == 0 );
+        ::close( fd );
+        return binary;
+    }
+
+    BinaryEventLogFile( const std::string & filename )
+        : map_( MAP_FAILED ),
+          map_size_( 0 ),
+          header_( nullptr ),
+          records_( nullptr ),
+          count_( 0 )
+    {
+        const int fd = ::open( filename.c_str(), O_RDONLY );
+        if ( fd < 0 ) {
+            throw std::runtime_error( filename + ": " + strerror( errno ) );
+        }
+
+        struct stat st;
+        if ( ( fstat( fd, &st ) < 0 ) or ( static_cast<size_t>( st.st_size ) < sizeof( BinaryLogHeader ) ) ) {
+            ::close( fd );
+            throw std::runtime_error( filename + ": not a binary log" );
+        }
+
+        map_size_ = st.st_size;
+        map_ = mmap( nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+        if ( map_ == MAP_FAILED ) {
+            throw std::runtime_error( filename + ": mmap: " + strerror( errno ) );
+        }
+
+        header_ = static_cast<const BinaryLogHeader *>( map_ );
+        const size_t text = ( header_->text_size + sizeof( BinaryLogRecord ) - 1 ) / sizeof( BinaryLogRecord ) * sizeof( BinaryLogRecord );
+
+        if ( ( memcmp( header_->magic, binary_log_magic, sizeof( header_->magic ) ) != 0 )
+             or ( header_->version != binary_log_version )
+             or ( header_->record_size != sizeof( BinaryLogRecord ) )
+             or ( sizeof( BinaryLogHeader ) + text > map_size_ ) ) {
+            munmap( map_, map_size_ );
+            map_ = MAP_FAILED;
+            throw std::runtime_error( filename + ": not a binary log of this version" );
+        }
+
+        records_ = reinterpret_cast<const BinaryLogRecord *>( static_cast<const char *>( map_ ) + sizeof( BinaryLogHeader ) + text );
+        count_ = ( map_size_ - sizeof( BinaryLogHeader ) - text ) / sizeof( BinaryLogRecord );
+
+        madvise( map_, map_size_, MADV_SEQUENTIAL );
+    }
+
+    ~BinaryEventLogFile()
+    {
+        if ( map_ != MAP_FAILED ) {
+            munmap( map_, map_size_ );
+        }
+    }
+
+    BinaryEventLogFile( const BinaryEventLogFile & other ) = delete;
+    BinaryEventLogFile & operator=( const BinaryEventLogFile & other ) = delete;
+
+    uint64_t base_timestamp( void ) const { return header_->base_timestamp; }
+
+    std::string header_text( void ) const
+    {
+        return std::string( reinterpret_cast<const char *>( header_ + 1 ), header_->text_size );
+    }
+
+    size_t size( void ) const { return count_; }
+
+    const BinaryLogRecord & operator[]( const size_t i ) const { return records_[ i ]; }
+};
+
+#endif /* BINARY_EVENT_LOG_HH */
@@ -0,0 +1,436 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef FQ_CODEL_PACKET_QUEUE_HH
+#define FQ_CODEL_PACKET_QUEUE_HH
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "queued_packet.hh"
+#include "abstract_packet_queue.hh"
+#include "exception.hh"
+#include "ezio.hh"
+#include "timestamp.hh"
+
+/* FQ-CoDel (RFC 8290): packets are hashed on their 5-tuple into a fixed
+   table of flows, each a FIFO with its own CoDel (RFC 8289) state, and the
+   flows are served by deficit round robin.
+
+   QUEUE_ARGS = "packets=N | bytes=N [, flows=N] [, quantum=BYTES]
+                 [, target=MS] [, interval=MS]"
+
+   Flows that have just become active are served from a list of new flows
+   ahead of the list of old ones, so sparse flows see little delay. Both
+   lists are threaded through the flow table, so choosing the next flow is
+   O(1). When the queue is full, up to half of the longest flow is dropped
+   from its head, at most 64 packets at a time, as Linux does.
+
+   Packets sit in a pool of nodes allocated with the queue, one per packet
+   of the limit (or per 44 byte packet of a byte limit), and are moved in
+   and out of it without copying their contents. Packets that are not IPv4
+   all go to flow 0. The defaults are flows=1024, quantum=1514, target=5
+   and interval=100. */
+
+class FqCodelPacketQueue : public AbstractPacketQueue
+{
+private:
+    static const uint32_t none = UINT32_MAX;
+    static const unsigned int max_drop_batch = 64;
+    static const unsigned int min_packet_size = 44;
+    static const unsigned int max_packet_size = 1504;
+
+    struct Node
+    {
+        uint64_t arrival_time = 0;
+        std::string contents {};
+        uint32_t next = none;
+    };
+
+    struct Flow
+    {
+        /* the FIFO of nodes */
+        uint32_t head;
+        uint32_t tail;
+        int backlog_in_bytes;
+
+        /* deficit round robin, and the list of new or old flows it is on */
+        int deficit;
+        uint32_t next;
+        bool active;
+
+        /* CoDel */
+        uint64_t first_above_time;
+        uint64_t drop_next;
+        unsigned int count;
+        unsigned int lastcount;
+        bool dropping;
+    };
+
+    struct FlowList
+    {
+        uint32_t head;
+        uint32_t tail;
+    };
+
+    const unsigned int packet_limit_;
+    const unsigned int byte_limit_;
+    const uint32_t flow_count_;
+    const int quantum_;
+    const uint64_t target_;
+    const uint64_t interval_;
+
+    std::vector<Node> pool_ {};
+    uint32_t free_nodes_ = none;
+
+    std::vector<Flow> flows_ {};
+    FlowList new_flows_ { none, none };
+    FlowList old_flows_ { none, none };
+
+    unsigned int queue_size_in_packets_ = 0;
+    int queue_size_in_bytes_ = 0;
+
+    unsigned int get_arg( const std::string & args, const std::string & name, unsigned int default_value )
+    {
+        auto offset = args.find( name );
+        if ( offset == std::string::npos ) {
+            return default_value;
+        }
+        return parse_arg( args, offset + name.size() );
+    }
+
+    unsigned int parse_arg( const std::string & args, size_t offset )
+    {
+        /* make sure next char is "=" */
+        if ( args.substr( offset, 1 ) != "=" ) {
+            throw std::runtime_error( "could not parse queue arguments: " + args );
+        }
+
+        /* advance by length of "=" */
+        offset++;
+
+        /* find the first non-digit character */
+        auto offset2 = args.substr( offset ).find_first_not_of( "0123456789" );
+
+        auto digit_string = args.substr( offset ).substr( 0, offset2 );
+
+        if ( digit_string.empty() ) {
+            throw std::runtime_error( "could not parse queue arguments: " + args );
+        }
+
+        return myatoi( digit_string );
+    }
+
+    static uint32_t read32( const std::string & contents, const size_t offset )
+    {
+        return ( uint32_t( uint8_t( contents[ offset ] ) ) << 24 ) | ( uint8_t( contents[ offset + 1 ] ) << 16 )
+            | ( uint8_t( contents[ offset + 2 ] ) << 8 ) | uint8_t( contents[ offset + 3 ] );
+    }
+
+    /* the flow of a packet, from its addresses, protocol and, for TCP and
+       UDP, ports. mahimahi's TUN device keeps the 4 byte packet
+       information, whose last two bytes are the EtherType. */
+    uint32_t classify( const std::string & contents ) const
+    {
+        size_t ip;
+        if ( contents.size() >= 24 and uint8_t( contents[ 2 ] ) == 0x08 and uint8_t( contents[ 3 ] ) == 0x00
+             and ( uint8_t( contents[ 4 ] ) >> 4 ) == 4 ) {
+            ip = 4;
+        } else if ( contents.size() >= 20 and ( uint8_t( contents[ 0 ] ) >> 4 ) == 4 ) {
+            ip = 0;
+        } else {
+            return 0;
+        }
+
+        const uint8_t protocol = contents[ ip + 9 ];
+        uint64_t key = ( uint64_t( read32( contents, ip + 12 ) ) << 32 ) | read32( contents, ip + 16 );
+        key ^= uint64_t( protocol ) << 56;
+
+        /* ports, unless this is a fragment other than the first */
+        const size_t transport = ip + ( uint8_t( contents[ ip ] ) & 0x0f ) * 4;
+        const bool first_fragment = ( ( uint8_t( contents[ ip + 6 ] ) & 0x1f ) | uint8_t( contents[ ip + 7 ] ) ) == 0;
+        if ( ( protocol == 6 or protocol == 17 ) and first_fragment and contents.size() >= transport + 4 ) {
+            key += uint64_t( read32( contents, transport ) ) * 0x9E3779B97F4A7C15ULL;
+        }
+
+        /* murmur3's finalizer, then multiply-shift onto the table */
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return ( ( key & 0xffffffff ) * flow_count_ ) >> 32;
+    }
+
+    void push_back( FlowList & list, const uint32_t f )
+    {
+        flows_[ f ].next = none;
+        if ( list.tail == none ) {
+            list.head = f;
+        } else {
+            flows_[ list.tail ].next = f;
+        }
+        list.tail = f;
+    }
+
+    uint32_t pop_front( FlowList & list )
+    {
+        const uint32_t f = list.head;
+        list.head = flows_[ f ].next;
+        if ( list.head == none ) {
+            list.tail = none;
+        }
+        return f;
+    }
+
+    /* take the head node of a flow off it, or none */
+    uint32_t pop_node( Flow & flow )
+    {
+        const uint32_t n = flow.head;
+        if ( n == none ) {
+            return none;
+        }
+        flow.head = pool_[ n ].next;
+        if ( flow.head == none ) {
+            flow.tail = none;
+        }
+        flow.backlog_in_bytes -= pool_[ n ].contents.size();
+        queue_size_in_bytes_ -= pool_[ n ].contents.size();
+        queue_size_in_packets_--;
+        return n;
+    }
+
+    void free_node( const uint32_t n )
+    {
+        pool_[ n ].contents.clear();
+        pool_[ n ].next = free_nodes_;
+        free_nodes_ = n;
+    }
+
+    /* drop from the head of the flow with the largest backlog */
+    void drop_from_longest_flow( void )
+    {
+        uint32_t longest = 0;
+        for ( uint32_t f = 1; f < flow_count_; f++ ) {
+            if ( flows_[ f ].backlog_in_bytes > flows_[ longest ].backlog_in_bytes ) {
+                longest = f;
+            }
+        }
+
+        Flow & flow = flows_[ longest ];
+        const int threshold = flow.backlog_in_bytes / 2;
+        for ( unsigned int i = 0; i < max_drop_batch and flow.head != none; i++ ) {
+            free_node( pop_node( flow ) );
+            if ( flow.backlog_in_bytes <= threshold ) {
+                break;
+            }
+        }
+    }
+
+    bool full( const size_t size_in_bytes ) const
+    {
+        return free_nodes_ == none
+            or ( packet_limit_ and queue_size_in_packets_ >= packet_limit_ )
+            or ( byte_limit_ and queue_size_in_bytes_ + size_in_bytes > byte_limit_ );
+    }
+
+    /* RFC 8289's dodequeue: the head of the flow, and whether CoDel may drop
+       it */
+    uint32_t codel_dodequeue( Flow & flow, const uint64_t now, bool & ok_to_drop )
+    {
+        ok_to_drop = false;
+        const uint32_t n = pop_node( flow );
+        if ( n == none ) {
+            flow.first_above_time = 0;
+            return none;
+        }
+
+        const uint64_t sojourn_time = now > pool_[ n ].arrival_time ? now - pool_[ n ].arrival_time : 0;
+        if ( sojourn_time < target_ or flow.backlog_in_bytes <= int( max_packet_size ) ) {
+            /* below target, or too little left in the flow to keep the
+               link busy */
+            flow.first_above_time = 0;
+        } else if ( flow.first_above_time == 0 ) {
+            flow.first_above_time = now + interval_;
+        } else if ( now >= flow.first_above_time ) {
+            ok_to_drop = true;
+        }
+        return n;
+    }
+
+    uint64_t control_law( const uint64_t t, const unsigned int count ) const
+    {
+        return t + interval_ / std::sqrt( count );
+    }
+
+    /* RFC 8289's dequeue, for one flow */
+    uint32_t codel_dequeue( Flow & flow, const uint64_t now )
+    {
+        bool ok_to_drop;
+        uint32_t n = codel_dodequeue( flow, now, ok_to_drop );
+        if ( n == none ) {
+            flow.dropping = false;
+            return none;
+        }
+
+        if ( flow.dropping ) {
+            if ( not ok_to_drop ) {
+                flow.dropping = false;
+            }
+            while ( flow.dropping and now >= flow.drop_next ) {
+                free_node( n );
+                flow.count++;
+                n = codel_dodequeue( flow, now, ok_to_drop );
+                if ( not ok_to_drop ) {
+                    flow.dropping = false;
+                } else {
+                    flow.drop_next = control_law( flow.drop_next, flow.count );
+                }
+            }
+        } else if ( ok_to_drop ) {
+            free_node( n );
+            n = codel_dodequeue( flow, now, ok_to_drop );
+            flow.dropping = true;
+
+            const unsigned int delta = flow.count - flow.lastcount;
+            if ( delta > 1 and now - flow.drop_next < 16 * interval_ ) {
+                flow.count = delta;
+            } else {
+                flow.count = 1;
+            }
+            flow.drop_next = control_law( now, flow.count );
+            flow.lastcount = flow.count;
+        }
+
+        /* CoDel never drops the last packet of a flow */
+        assert( n != none );
+        return n;
+    }
+
+public:
+    FqCodelPacketQueue( const std::string & args )
+        : packet_limit_( get_arg( args, "packets", 0 ) ),
+          byte_limit_( get_arg( args, "bytes", 0 ) ),
+          flow_count_( get_arg( args, "flows", 1024 ) ),
+          quantum_( get_arg( args, "quantum", 1514 ) ),
+          target_( get_arg( args, "target", 5 ) ),
+          interval_( get_arg( args, "interval", 100 ) )
+    {
+        std::cout << "Packet limit: " << packet_limit_
+                  << ", Byte limit: " << byte_limit_
+                  << ", Flows: " << flow_count_
+                  << ", Quantum: " << quantum_
+                  << ", Target: " << target_
+                  << ", Interval: " << interval_
+                  << std::endl;
+        if ( packet_limit_ == 0 and byte_limit_ == 0 ) {
+            throw std::runtime_error( "FqCodelPacketQueue needs a packets or a bytes limit" );
+        }
+        if ( flow_count_ == 0 or flow_count_ > 65536 ) {
+            throw std::runtime_error( "FqCodelPacketQueue flows must be 1 to 65536" );
+        }
+        if ( quantum_ == 0 or interval_ == 0 ) {
+            throw std::runtime_error( "FqCodelPacketQueue quantum and interval must be above 0" );
+        }
+
+        const unsigned int pool_size = packet_limit_ ? packet_limit_ : byte_limit_ / min_packet_size + 1;
+        pool_.resize( pool_size );
+        for ( uint32_t n = 0; n < pool_size; n++ ) {
+            pool_[ n ].next = n + 1 < pool_size ? n + 1 : none;
+        }
+        free_nodes_ = 0;
+
+        flows_.resize( flow_count_, Flow { none, none, 0, 0, none, false, 0, 0, 0, 0, false } );
+    }
+
+    void enqueue( QueuedPacket && p ) override
+    {
+        const size_t size = p.contents.size();
+        if ( byte_limit_ and size > byte_limit_ ) {
+            return;
+        }
+        while ( full( size ) ) {
+            drop_from_longest_flow();
+        }
+
+        const uint32_t n = free_nodes_;
+        Node & node = pool_[ n ];
+        free_nodes_ = node.next;
+        node.arrival_time = p.arrival_time;
+        node.contents = std::move( p.contents );
+        node.next = none;
+
+        const uint32_t f = classify( node.contents );
+        Flow & flow = flows_[ f ];
+        if ( flow.tail == none ) {
+            flow.head = n;
+        } else {
+            pool_[ flow.tail ].next = n;
+        }
+        flow.tail = n;
+        flow.backlog_in_bytes += size;
+        queue_size_in_bytes_ += size;
+        queue_size_in_packets_++;
+
+        if ( not flow.active ) {
+            flow.active = true;
+            flow.deficit = quantum_;
+            push_back( new_flows_, f );
+        }
+    }
+
+    QueuedPacket dequeue( void ) override
+    {
+        assert( not empty() );
+
+        const uint64_t now = timestamp();
+        while ( true ) {
+            FlowList & list = new_flows_.head != none ? new_flows_ : old_flows_;
+            assert( list.head != none );
+            const uint32_t f = list.head;
+            Flow & flow = flows_[ f ];
+
+            if ( flow.deficit <= 0 ) {
+                flow.deficit += quantum_;
+                push_back( old_flows_, pop_front( list ) );
+                continue;
+            }
+
+            const uint32_t n = codel_dequeue( flow, now );
+            if ( n == none ) {
+                pop_front( list );
+                /* an emptied new flow goes round the old ones once, so it
+                   cannot jump the queue by coming back as new */
+                if ( &list == &new_flows_ and old_flows_.head != none ) {
+                    push_back( old_flows_, f );
+                } else {
+                    flow.active = false;
+                }
+                continue;
+            }
+
+            Node & node = pool_[ n ];
+            flow.deficit -= node.contents.size();
+
+            QueuedPacket ret( std::string(), node.arrival_time );
+            ret.contents = std::move( node.contents );
+            free_node( n );
+            return ret;
+        }
+    }
+
+    bool empty( void ) const override
+    {
+        return queue_size_in_packets_ == 0;
+    }
+
+    std::string to_string( void ) const override
+    {
+        return "fq_codel";
+    }
+};
+
+#endif /* FQ_CODEL_PACKET_QUEUE_HH */
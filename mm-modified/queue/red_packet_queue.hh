@@ -3,10 +3,10 @@
 #ifndef RED_PACKET_QUEUE_HH
 #define RED_PACKET_QUEUE_HH
 
+#include <array>
 #include <cassert>
-#include <chrono>
-#include <cstdlib>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <queue>
 #include <string>
@@ -15,21 +15,64 @@
 #include "abstract_packet_queue.hh"
 #include "exception.hh"
 #include "ezio.hh"
+#include "timestamp.hh"
+
+/* Random Early Detection (Floyd and Jacobson, 1993) on the queue length in
+   bytes.
+
+   QUEUE_ARGS = "min_bytes=N, max_bytes=N, drop_percentage=N
+                 [, byte_mode=0|1] [, gentle=0|1] [, seed=N]"
+
+   The average queue length is an EWMA updated on every arrival. When a packet
+   arrives at an empty queue, the average decays as if the link had sent
+   idle time * drain rate / 1500 packets of zero queue. Times are the
+   emulator's millisecond timestamps, and the drain rate is the bytes sent in
+   busy periods over the milliseconds they spanned, both averaged over the
+   last periods; a period within one millisecond counts as one millisecond,
+   so a burst sent at once does not read as a fast link. The decay (1 - W)^m
+   comes from two precomputed tables, so there is no pow() per packet.
+   Between min_bytes and max_bytes the drop probability rises to
+   drop_percentage, and is spread evenly between drops by the count of
+   packets since the last one.
+
+   byte_mode (default 1) scales the probability by packet size / 1500, so
+   small packets are dropped less often. gentle (default 0) raises the
+   probability from drop_percentage to 1 between max_bytes and 2 * max_bytes
+   instead of dropping everything above max_bytes. Each queue draws from its
+   own xorshift generator, seeded by seed (default 1). */
 
 class RedPacketQueue : public AbstractPacketQueue
 {
 private:
+    static constexpr double W = 0.002;
+    static constexpr double typical_packet_size_ = 1500;
+
+    /* (1 - W)^m for m < 2^16, as lo[m & 255] * hi[m >> 8]; 0 beyond, since
+       (1 - W)^65536 < 1e-56 */
+    std::array<double, 256> decay_lo_ {};
+    std::array<double, 256> decay_hi_ {};
+
     std::queue<QueuedPacket> internal_queue_ {};
 
     int queue_size_in_bytes_ = 0;
     int min_queue_size_threshold_in_bytes_ = 0;
     int max_queue_size_threshold_in_bytes_ = 0;
     double average_queue_size_in_bytes_ = 0;
-    const double W = 0.002;
-    const double packet_rate_ = 800;
     double drop_probability_ = 0;
-    int count_ = 0;
-    long q_time_ = 0;
+    bool byte_mode_ = true;
+    bool gentle_ = false;
+    int count_ = -1;
+
+    /* the start and the bytes of the current busy period, and the averages
+       of the bytes and the milliseconds of the previous ones */
+    uint64_t busy_start_ = 0;
+    uint64_t idle_start_ = 0;
+    int64_t busy_bytes_ = 0;
+    double drain_bytes_ = typical_packet_size_;   /* 12 Mbit/s until measured */
+    double drain_ms_ = 1;
+    bool idle_ = false;
+
+    uint64_t random_state_ = 1;
 
     unsigned int get_arg( const std::string & args, const std::string & name )
     {
@@ -39,82 +82,152 @@ private:
             std::cout << "[get_arg] Could not find " << name << std::endl;
             return 0; /* default value */
         } else {
-            /* extract the value */
+            return parse_arg( args, offset + name.size() );
+        }
+    }
+
+    unsigned int get_arg( const std::string & args, const std::string & name, unsigned int default_value )
+    {
+        auto offset = args.find( name );
+        if ( offset == std::string::npos ) {
+            return default_value;
+        }
+        return parse_arg( args, offset + name.size() );
+    }
+
+    unsigned int parse_arg( const std::string & args, size_t offset )
+    {
+        /* make sure next char is "=" */
+        if ( args.substr( offset, 1 ) != "=" ) {
+            throw std::runtime_error( "could not parse queue arguments: " + args );
+        }
 
-            /* advance by length of name */
-            offset += name.size();
+        /* advance by length of "=" */
+        offset++;
 
-            /* make sure next char is "=" */
-            if ( args.substr( offset, 1 ) != "=" ) {
-                throw std::runtime_error( "could not parse queue arguments: " + args );
-            }
+        /* find the first non-digit character */
+        auto offset2 = args.substr( offset ).find_first_not_of( "0123456789" );
 
-            /* advance by length of "=" */
-            offset++;
+        auto digit_string = args.substr( offset ).substr( 0, offset2 );
 
-            /* find the first non-digit character */
-            auto offset2 = args.substr( offset ).find_first_not_of( "0123456789" );
+        if ( digit_string.empty() ) {
+            throw std::runtime_error( "could not parse queue arguments: " + args );
+        }
 
-            auto digit_string = args.substr( offset ).substr( 0, offset2 );
+        return myatoi( digit_string );
+    }
 
-            if ( digit_string.empty() ) {
-                throw std::runtime_error( "could not parse queue arguments: " + args );
-            }
+    /* xorshift64*, uniform in [0, 1) */
+    double random_uniform( void )
+    {
+        random_state_ ^= random_state_ >> 12;
+        random_state_ ^= random_state_ << 25;
+        random_state_ ^= random_state_ >> 27;
+        return ( ( random_state_ * 2685821657736338717ULL ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+    }
+
+    double decay( const double m ) const
+    {
+        if ( m >= 65536 ) {
+            return 0;
+        }
+        const unsigned int i = m;
+        return decay_lo_[ i & 255 ] * decay_hi_[ i >> 8 ];
+    }
+
+    /* probability of dropping a packet of this size, before spreading */
+    double drop_probability( const size_t packet_size ) const
+    {
+        double p_b;
+
+        if ( average_queue_size_in_bytes_ < max_queue_size_threshold_in_bytes_ ) {
+            p_b = drop_probability_ *
+                ( average_queue_size_in_bytes_ - min_queue_size_threshold_in_bytes_ ) /
+                ( max_queue_size_threshold_in_bytes_ - min_queue_size_threshold_in_bytes_ );
+        } else {
+            /* gentle: from drop_probability_ at max_bytes to 1 at twice it */
+            p_b = drop_probability_ + ( 1 - drop_probability_ ) *
+                ( average_queue_size_in_bytes_ - max_queue_size_threshold_in_bytes_ ) /
+                max_queue_size_threshold_in_bytes_;
+        }
 
-            return myatoi( digit_string );
+        if ( byte_mode_ ) {
+            p_b = p_b * packet_size / typical_packet_size_;
         }
+        return p_b;
     }
 
 public:
     RedPacketQueue( const std::string & args )
         : min_queue_size_threshold_in_bytes_( get_arg( args, "min_bytes") ),
           max_queue_size_threshold_in_bytes_( get_arg( args, "max_bytes") ),
-          drop_probability_( get_arg( args, "drop_percentage" ) / 100.0)
+          drop_probability_( get_arg( args, "drop_percentage" ) / 100.0),
+          byte_mode_( get_arg( args, "byte_mode", 1 ) ),
+          gentle_( get_arg( args, "gentle", 0 ) ),
+          random_state_( get_arg( args, "seed", 1 ) )
     {
         std::cout << "Min queue: " << min_queue_size_threshold_in_bytes_
                   << ", Max queue: " << max_queue_size_threshold_in_bytes_
                   << ", Drop probability: " << drop_probability_
+                  << ", Byte mode: " << byte_mode_
+                  << ", Gentle: " << gentle_
                   << std::endl;
         if (drop_probability_ < 0 || drop_probability_ > 1) {
             throw std::runtime_error( "Invalid RedPacketQueue drop percentage" );
         }
+        if ( max_queue_size_threshold_in_bytes_ <= min_queue_size_threshold_in_bytes_ ) {
+            throw std::runtime_error( "RedPacketQueue max_bytes must be above min_bytes" );
+        }
+
+        /* xorshift never leaves 0 */
+        if ( random_state_ == 0 ) {
+            random_state_ = 1;
+        }
+
+        for ( unsigned int i = 0; i < decay_lo_.size(); i++ ) {
+            decay_lo_[ i ] = pow( 1 - W, i );
+            decay_hi_[ i ] = pow( 1 - W, 256.0 * i );
+        }
     }
 
     void enqueue( QueuedPacket && p ) override
     {
-        if (queue_size_in_bytes_ > 0) {
-            average_queue_size_in_bytes_ =
-                (1 - W) * average_queue_size_in_bytes_ + W * queue_size_in_bytes_;
-        } else {
-            unsigned long curr_time = 
-                std::chrono::system_clock::now().time_since_epoch() /
-                std::chrono::milliseconds(1);
-            double m = packet_rate_ * (curr_time - q_time_);
-            average_queue_size_in_bytes_ = pow(1 - W, m) * average_queue_size_in_bytes_;
+        if ( queue_size_in_bytes_ > 0 ) {
+            average_queue_size_in_bytes_ += W * ( queue_size_in_bytes_ - average_queue_size_in_bytes_ );
+        } else if ( idle_ and p.arrival_time > idle_start_ ) {
+            /* the queue stays idle if this packet is dropped, and the next
+               arrival decays the average from here */
+            const double idle_ms = p.arrival_time - idle_start_;
+            average_queue_size_in_bytes_ *=
+                decay( idle_ms * drain_bytes_ / drain_ms_ / typical_packet_size_ );
+            idle_start_ = p.arrival_time;
         }
 
-        if (average_queue_size_in_bytes_ >= max_queue_size_threshold_in_bytes_) {
-            count_ = 0;
-            return;
-        } else if (average_queue_size_in_bytes_ >= min_queue_size_threshold_in_bytes_) {
+        if ( average_queue_size_in_bytes_ >= min_queue_size_threshold_in_bytes_ ) {
+            if ( average_queue_size_in_bytes_ >= max_queue_size_threshold_in_bytes_ &&
+                 ( not gentle_ or average_queue_size_in_bytes_ >= 2.0 * max_queue_size_threshold_in_bytes_ ) ) {
+                count_ = 0;
+                return;
+            }
+
             ++count_;
-            
-            double p_b = drop_probability_ *
-                (average_queue_size_in_bytes_ - min_queue_size_threshold_in_bytes_) /
-                (max_queue_size_threshold_in_bytes_ - min_queue_size_threshold_in_bytes_);
-            // double p_a = p_b / (1 - count_ * p_b);
-            p_b = p_b * p.contents.size() / 1500.0;
-            double p_a = p_b / (1 - count_ * p_b);
-
-            float r = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
-            if (r < p_a) {
+            const double p_b = drop_probability( p.contents.size() );
+            /* p_a = p_b / (1 - count * p_b), and 1 once count * p_b reaches 1 */
+            const double denominator = 1 - count_ * p_b;
+            if ( denominator <= 0 or random_uniform() * denominator < p_b ) {
                 count_ = 0;
                 return;
             }
+        } else {
+            count_ = -1;
+        }
+
+        if ( queue_size_in_bytes_ == 0 ) {
+            busy_start_ = p.arrival_time;
+            busy_bytes_ = 0;
+            idle_ = false;
         }
 
-        count_ = -1;
-        
         queue_size_in_bytes_ += p.contents.size();
         internal_queue_.emplace( std::move( p ) );
     }
@@ -127,11 +240,17 @@ public:
         internal_queue_.pop();
 
         queue_size_in_bytes_ -= ret.contents.size();
+        busy_bytes_ += ret.contents.size();
 
         if (queue_size_in_bytes_ == 0) {
-            q_time_ =
-                std::chrono::system_clock::now().time_since_epoch() /
-                std::chrono::milliseconds(1);
+            /* the timestamp is read only when the queue empties */
+            idle_start_ = timestamp();
+            idle_ = true;
+
+            /* the period had the opportunities of every millisecond it touched */
+            const double busy_ms = ( idle_start_ > busy_start_ ? idle_start_ - busy_start_ : 0 ) + 1;
+            drain_bytes_ += ( busy_bytes_ - drain_bytes_ ) / 8;
+            drain_ms_ += ( busy_ms - drain_ms_ ) / 8;
         }
 
         return ret;
@@ -148,4 +267,4 @@ public:
     }
 };
 
-#endif /* RED_PACKET_QUEUE_HH */ 
+#endif /* RED_PACKET_QUEUE_HH */
@@ -16,6 +16,8 @@ else
 	mkdir figures
 fi
 
+make -C metric
+
 chmod a+x main.sh
 chmod a+x mm-metric
 chmod a+x mm-tcp
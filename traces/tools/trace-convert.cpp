@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/time.h>
+#include "tracefile.h"
+
+using namespace std;
+
+// Converts cellular traces between the mahimahi text format and the binary
+// format of CTraceFile, and prints a summary of either.
+//    trace-convert INPUT OUTPUT      write INPUT in the binary format
+//    trace-convert -t INPUT OUTPUT   write INPUT in the mahimahi format
+//    trace-convert -a INPUT...       write each INPUT to INPUT.bin
+//    trace-convert -i INPUT...       print period, opportunities, rate and load time
+
+static uint64_t now_us()
+{
+   timeval t;
+   gettimeofday(&t, 0);
+   return (uint64_t)t.tv_sec * 1000000 + t.tv_usec;
+}
+
+static bool convert(const string& in, const string& out, bool text)
+{
+   CTraceFile trace;
+   if (!trace.open(in))
+   {
+      cerr << trace.error() << endl;
+      return false;
+   }
+
+   if (!(text ? trace.saveText(out) : trace.save(out)))
+   {
+      cerr << trace.error() << endl;
+      return false;
+   }
+
+   return true;
+}
+
+static bool info(const string& in)
+{
+   uint64_t start = now_us();
+
+   CTraceFile trace;
+   if (!trace.open(in))
+   {
+      cerr << trace.error() << endl;
+      return false;
+   }
+
+   uint64_t load = now_us() - start;
+
+   // the busiest second, from the prefix sums
+   uint64_t peak = 0;
+   for (uint64_t t = 0; t < trace.period(); t += 1000)
+      peak = max(peak, trace.capacity(t, t + 1000));
+
+   cout << in << "\t" << trace.period() << "\t" << trace.total() << "\t" << trace.runCount() << "\t"
+        << trace.capacity(0, trace.period()) * 8.0 / trace.period() / 1000 << "\t"
+        << peak * 8.0 / 1000000 << "\t" << load << endl;
+
+   return true;
+}
+
+int main(int argc, char* argv[])
+{
+   if ((argc >= 3) && (0 == strcmp(argv[1], "-i")))
+   {
+      cout << "trace\tperiod(ms)\topportunities\truns\tmean(Mb/s)\tpeak(Mb/s)\tload(us)" << endl;
+      bool ok = true;
+      for (int i = 2; i < argc; ++ i)
+         ok = info(argv[i]) && ok;
+      return ok ? 0 : 1;
+   }
+
+   if ((argc >= 3) && (0 == strcmp(argv[1], "-a")))
+   {
+      bool ok = true;
+      for (int i = 2; i < argc; ++ i)
+         ok = convert(argv[i], string(argv[i]) + ".bin", false) && ok;
+      return ok ? 0 : 1;
+   }
+
+   if ((argc == 4) && (0 == strcmp(argv[1], "-t")))
+      return convert(argv[2], argv[3], true) ? 0 : 1;
+
+   if ((argc == 3) && ('-' != argv[1][0]))
+      return convert(argv[1], argv[2], false) ? 0 : 1;
+
+   cout << "usage: " << argv[0] << " [-t] INPUT OUTPUT | -a INPUT... | -i INPUT..." << endl;
+   return 1;
+}
@@ -0,0 +1,319 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "tracefile.h"
+
+using namespace std;
+
+// Synthesizes cellular link traces, in the mahimahi text format or the binary
+// format of CTraceFile (-b). Rates are in Mb/s of CTraceFile::m_iOpportunityBytes
+// opportunities, and a fixed seed (-s) gives the same trace on every run.
+//
+//    trace-synth [-s SEED] [-b] [-p] OUTPUT uniform SECONDS MIN MAX
+//       a rate drawn uniformly from [MIN, MAX] for every second, as generateTrace.py did
+//    trace-synth [-s SEED] [-b] [-p] OUTPUT markov SECONDS RATES DWELL [MATRIX]
+//       a Markov-modulated rate: RATES is a comma separated list of state rates,
+//       DWELL the mean time in each state in ms, above 0 (one value or one per state), and
+//       MATRIX the transition probabilities as rows separated by ';', by default
+//       uniform over the other states
+//    trace-synth [-s SEED] [-b] OUTPUT resample SECONDS SOURCE BLOCK [SCALE]
+//       blocks of BLOCK ms drawn at random from the trace SOURCE, with the
+//       capacity scaled by SCALE
+//
+// Opportunities are spread evenly inside each millisecond's rate, carrying the
+// fraction over; -p draws the count of every millisecond from a Poisson
+// distribution instead.
+
+// splitmix64, so that a seed gives the same trace with any standard library
+class CRandom
+{
+public:
+   explicit CRandom(const uint64_t& seed): m_ullState(seed) {}
+
+   uint64_t next()
+   {
+      uint64_t z = (m_ullState += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+   }
+
+   // uniform in [0, 1)
+   double uniform() {return (next() >> 11) * (1.0 / 9007199254740992.0);}
+
+   double exponential(const double& mean) {return -mean * log(1.0 - uniform());}
+
+   uint32_t poisson(const double& lambda)
+   {
+      if (lambda <= 0)
+         return 0;
+
+      if (lambda < 30)
+      {
+         double limit = exp(-lambda), p = uniform();
+         uint32_t k = 0;
+         while (p > limit)
+         {
+            ++ k;
+            p *= uniform();
+         }
+         return k;
+      }
+
+      // normal approximation, exact enough at these rates
+      double u = 1.0 - uniform(), v = uniform();
+      double x = lambda + sqrt(lambda) * sqrt(-2 * log(u)) * cos(2 * M_PI * v) + 0.5;
+      return (x < 0) ? 0 : (uint32_t)x;
+   }
+
+private:
+   uint64_t m_ullState;
+};
+
+// Turns a rate per millisecond into opportunity counts.
+class CEmitter
+{
+public:
+   CEmitter(CTraceFile& trace, CRandom& random, const bool& poisson):
+   m_Trace(trace), m_Random(random), m_bPoisson(poisson), m_dCarry(0), m_iMs(0), m_iLast(0) {}
+
+   void emit(const double& perms)
+   {
+      uint32_t n;
+      if (m_bPoisson)
+         n = m_Random.poisson(perms);
+      else
+      {
+         m_dCarry += perms;
+         n = (uint32_t)m_dCarry;
+         m_dCarry -= n;
+      }
+
+      m_Trace.add(m_iMs ++, n);
+      m_iLast = n;
+   }
+
+   // the period of a trace ends at its last opportunity, so an idle last
+   // millisecond gets one to keep the requested duration
+   void close()
+   {
+      if ((m_iMs > 0) && (0 == m_iLast))
+         m_Trace.add(m_iMs - 1, 1);
+   }
+
+private:
+   CTraceFile& m_Trace;
+   CRandom& m_Random;
+   bool m_bPoisson;
+   double m_dCarry;
+   uint32_t m_iMs;
+   uint32_t m_iLast;
+};
+
+static double perms(const double& mbps)
+{
+   return mbps * 1000000 / 8 / 1000 / CTraceFile::m_iOpportunityBytes;
+}
+
+static vector<double> parseList(const string& s, const char& sep)
+{
+   vector<double> v;
+   stringstream ss(s);
+   string item;
+   while (getline(ss, item, sep))
+      v.push_back(atof(item.c_str()));
+   return v;
+}
+
+// true if every value is at least lo, or above it when strict; false for NaN
+static bool allAbove(const vector<double>& v, const double& lo, const bool& strict)
+{
+   for (size_t i = 0; i < v.size(); ++ i)
+      if (!(strict ? (v[i] > lo) : (v[i] >= lo)))
+         return false;
+   return true;
+}
+
+static bool uniformModel(CEmitter& out, CRandom& random, const int& seconds, const double& lo, const double& hi)
+{
+   if (!(lo >= 0) || !(hi >= lo))
+      return false;
+
+   for (int s = 0; s < seconds; ++ s)
+   {
+      double rate = perms(lo + (hi - lo) * random.uniform());
+      for (int ms = 0; ms < 1000; ++ ms)
+         out.emit(rate);
+   }
+
+   return true;
+}
+
+static bool markovModel(CEmitter& out, CRandom& random, const int& seconds, const string& rates, const string& dwell, const string& matrix)
+{
+   vector<double> r = parseList(rates, ',');
+   vector<double> d = parseList(dwell, ',');
+   size_t n = r.size();
+
+   if ((n < 1) || ((d.size() != 1) && (d.size() != n)))
+      return false;
+   // a dwell of 0 draws 0 ms in every state, and the walk below never ends
+   if (!allAbove(r, 0, false) || !allAbove(d, 0, true))
+      return false;
+   if (d.size() == 1)
+      d.assign(n, d[0]);
+
+   vector<vector<double> > p(n, vector<double>(n, (n > 1) ? 1.0 / (n - 1) : 1.0));
+   for (size_t i = 0; (n > 1) && (i < n); ++ i)
+      p[i][i] = 0;
+
+   if (!matrix.empty())
+   {
+      stringstream ss(matrix);
+      string row;
+      for (size_t i = 0; i < n; ++ i)
+      {
+         if (!getline(ss, row, ';'))
+            return false;
+         p[i] = parseList(row, ',');
+         if ((p[i].size() != n) || !allAbove(p[i], 0, false))
+            return false;
+      }
+   }
+
+   // cumulative rows, normalised so rows need not sum to exactly 1
+   for (size_t i = 0; i < n; ++ i)
+   {
+      double sum = 0;
+      for (size_t j = 0; j < n; ++ j)
+         sum += p[i][j];
+      if (sum <= 0)
+         return false;
+      double c = 0;
+      for (size_t j = 0; j < n; ++ j)
+         p[i][j] = (c += p[i][j] / sum);
+   }
+
+   size_t state = 0;
+   double left = random.exponential(d[state]);
+   for (int64_t ms = 0, end = seconds * 1000LL; ms < end; ++ ms)
+   {
+      while (left < 1)
+      {
+         double u = random.uniform();
+         size_t next = 0;
+         while ((next + 1 < n) && (u >= p[state][next]))
+            ++ next;
+         state = next;
+         left += random.exponential(d[state]);
+      }
+
+      out.emit(perms(r[state]));
+      left -= 1;
+   }
+
+   return true;
+}
+
+static bool resampleModel(CEmitter& out, CRandom& random, const int& seconds, const string& source, const int& block, const double& scale)
+{
+   CTraceFile src;
+   if (!src.open(source))
+   {
+      cerr << src.error() << endl;
+      return false;
+   }
+
+   if ((block <= 0) || ((uint64_t)block > src.period() + 1) || (scale < 0))
+      return false;
+
+   vector<uint16_t> counts(src.period() + 1, 0);
+   for (size_t i = 0; i < src.runCount(); ++ i)
+   {
+      const CTraceRun& r = src.run(i);
+      for (uint32_t k = 0; k < r.m_iLength; ++ k)
+         counts[r.m_iStart + k] = r.m_iCount;
+   }
+
+   uint64_t starts = counts.size() - block + 1;
+   for (int64_t ms = 0, end = seconds * 1000LL; ms < end; )
+   {
+      uint64_t start = random.next() % starts;
+      for (int k = 0; (k < block) && (ms < end); ++ k, ++ ms)
+         out.emit(counts[start + k] * scale);
+   }
+
+   return true;
+}
+
+static int usage(const char* name)
+{
+   cout << "usage: " << name << " [-s SEED] [-b] [-p] OUTPUT uniform SECONDS MIN MAX" << endl;
+   cout << "       " << name << " [-s SEED] [-b] [-p] OUTPUT markov SECONDS RATES DWELL [MATRIX]" << endl;
+   cout << "       " << name << " [-s SEED] [-b] OUTPUT resample SECONDS SOURCE BLOCK [SCALE]" << endl;
+   return 1;
+}
+
+int main(int argc, char* argv[])
+{
+   uint64_t seed = 1;
+   bool binary = false;
+   bool poisson = false;
+
+   int i = 1;
+   for (; (i < argc) && ('-' == argv[i][0]); ++ i)
+   {
+      if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc))
+         seed = strtoull(argv[++ i], NULL, 10);
+      else if (0 == strcmp(argv[i], "-b"))
+         binary = true;
+      else if (0 == strcmp(argv[i], "-p"))
+         poisson = true;
+      else
+         return usage(argv[0]);
+   }
+
+   if (argc - i < 3)
+      return usage(argv[0]);
+
+   string output = argv[i];
+   string model = argv[i + 1];
+   int seconds = atoi(argv[i + 2]);
+   char** args = argv + i + 3;
+   int nargs = argc - i - 3;
+
+   if (seconds <= 0)
+      return usage(argv[0]);
+
+   CTraceFile trace;
+   CRandom random(seed);
+   CEmitter out(trace, random, poisson);
+
+   bool ok;
+   if ((model == "uniform") && (nargs == 2))
+      ok = uniformModel(out, random, seconds, atof(args[0]), atof(args[1]));
+   else if ((model == "markov") && ((nargs == 2) || (nargs == 3)))
+      ok = markovModel(out, random, seconds, args[0], args[1], (nargs == 3) ? args[2] : "");
+   else if ((model == "resample") && ((nargs == 2) || (nargs == 3)))
+      ok = resampleModel(out, random, seconds, args[0], atoi(args[1]), (nargs == 3) ? atof(args[2]) : 1.0);
+   else
+      return usage(argv[0]);
+
+   if (!ok)
+      return usage(argv[0]);
+
+   out.close();
+
+   if (!trace.finish() || !(binary ? trace.save(output) : trace.saveText(output)))
+   {
+      cerr << trace.error() << endl;
+      return 1;
+   }
+
+   return 0;
+}